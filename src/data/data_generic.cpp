@@ -1,6 +1,11 @@
 #include "data/generic.hpp"
 
+#include "data/pack.hpp"
+#include "thr/timeline.hpp"
+
 #include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
 
 #include <sstream>
 
@@ -9,25 +14,67 @@ namespace fs = boost::filesystem;
 
 bool data::file_exists(const fs::path &pfname)
 {
-  if(!fs::exists(pfname))
+  fs::path fpath;
+  const uint8_t *pdata;
+  size_t psize;
+
+  return search_loose(pfname, fpath) || pack_find(pfname, pdata, psize);
+}
+
+bool data::file_stamp(const fs::path &pfname, uint64_t &psize, uint64_t &ptime)
+{
+  fs::path fpath;
+
+  if(search_loose(pfname, fpath))
   {
-#if defined(DATADIR)
-    fs::path fpath = fs::path(DATADIR) / pfname;
-    return fs::exists(fpath);
-#else
-    return false;
-#endif
+    boost::system::error_code err;
+    boost::uintmax_t size = fs::file_size(fpath, err);
+    if(err)
+    {
+      return false;
+    }
+    std::time_t time = fs::last_write_time(fpath, err);
+    if(err)
+    {
+      return false;
+    }
+    psize = static_cast<uint64_t>(size);
+    ptime = static_cast<uint64_t>(time);
+    return true;
+  }
+
+  const uint8_t *pdata;
+  size_t size;
+  if(pack_find(pfname, pdata, size))
+  {
+    psize = static_cast<uint64_t>(size);
+    ptime = 0;
+    return true;
   }
-  return true;
+  return false;
 }
 
 shristr data::open_read(const fs::path &pfname)
 {
-  // TODO: ZIPfile.
-  
-  // TODO: Datadir ZIPfile.
-  
-  return shristr(new fs::ifstream(open_search(pfname), std::ifstream::binary));
+  fs::path fpath;
+
+  if(!search_loose(pfname, fpath))
+  {
+    const uint8_t *pdata;
+    size_t psize;
+
+    // The mounted pack stays mapped, so the stream may read it in place.
+    if(pack_find(pfname, pdata, psize))
+    {
+      thr::timeline_read(psize);
+      return shristr(new boost::iostreams::stream<boost::iostreams::array_source>(
+            reinterpret_cast<const char*>(pdata), psize));
+    }
+    fpath = open_search(pfname);
+  }
+
+  timeline_read_file(fpath);
+  return shristr(new fs::ifstream(fpath, std::ifstream::binary));
 }
 
 shrostr data::open_write(const fs::path &pfname)
@@ -44,22 +91,46 @@ shrostr data::open_write(const fs::path &pfname)
 
 fs::path data::open_search(const fs::path &pfname)
 {
-  if(!fs::exists(pfname))
+  fs::path ret;
+
+  if(!search_loose(pfname, ret))
   {
+    std::stringstream err;
+    err << "could not find file: " << pfname;
+    BOOST_THROW_EXCEPTION(std::runtime_error(err.str()));
+  }
+  return ret;
+}
+
+bool data::search_loose(const fs::path &pfname, fs::path &fpath)
+{
+  if(fs::exists(pfname))
+  {
+    fpath = pfname;
+    return true;
+  }
 #if defined(DATADIR)
-    fs::path fpath = fs::path(DATADIR) / pfname;
-    if(!fs::exists(fpath))
-    {
-#endif
-      std::stringstream err;
-      err << "could not find file: " << pfname;
-      BOOST_THROW_EXCEPTION(std::runtime_error(err.str()));
-#if defined(DATADIR)
-    }
-    return fpath;
+  fs::path datadir_path = fs::path(DATADIR) / pfname;
+  if(fs::exists(datadir_path))
+  {
+    fpath = datadir_path;
+    return true;
+  }
 #endif
+  return false;
+}
+
+void data::timeline_read_file(const fs::path &pfname)
+{
+  if(!thr::timeline_enabled())
+  {
+    return;
   }
 
-  return pfname;
+  boost::system::error_code err;
+  boost::uintmax_t size = fs::file_size(pfname, err);
+  if(!err)
+  {
+    thr::timeline_read(size);
+  }
 }
-
@@ -18,15 +18,27 @@ namespace data
   /** \brief Tell if file exists.
    *
    * Technically, this will not tell if the exact file exists, but rather whether or not data::open_read() will
-   * find the file and be able to at least try to open it.
+   * find the file and be able to at least try to open it. Files in the mounted pack exist.
    *
    * \return True if found from a valid search location, false if not.
    */
   extern bool file_exists(const boost::filesystem::path &pfname);
 
+  /** \brief Get the size and modification time of a file.
+   *
+   * Found as data::open_read() would find it. Files in the mounted pack do not change, their modification
+   * time is zero.
+   *
+   * \param pfname Filename.
+   * \param psize Destination for the size in bytes.
+   * \param ptime Destination for the modification time.
+   * \return True if found, false if not.
+   */
+  extern bool file_stamp(const boost::filesystem::path &pfname, uint64_t &psize, uint64_t &ptime);
+
   /** \brief Open an input stream.
    *
-   * The user must delete the returned ifstream object.
+   * The user must delete the returned ifstream object. A loose file overrides the mounted pack.
    *
    * \param pfname Filename to open.
    * \return Newly reserved ifstream.
@@ -62,9 +74,19 @@ namespace data
     return open_write(boost::filesystem::path(pfname));
   }
 
+  /** \brief Find a loose file.
+   *
+   * Files in the mounted pack are not searched.
+   *
+   * \param pfname Filename to find.
+   * \param fpath Destination for the full path filename.
+   * \return True if found, false if not.
+   */
+  extern bool search_loose(const boost::filesystem::path &pfname, boost::filesystem::path &fpath);
+
   /** \brief Find a filename for input file.
    *
-   * Throws an error if the file is not found.
+   * Only loose files are found. Throws an error if the file is not found.
    *
    * \param pfname Filename to open.
    * \return Full path filename.
@@ -81,6 +103,14 @@ namespace data
     return open_search(boost::filesystem::path(pfname));
   }
 
+  /** \brief Account the size of a file as read in the timeline.
+   *
+   * Does nothing unless the timeline is enabled.
+   *
+   * \param pfname Full path filename.
+   */
+  extern void timeline_read_file(const boost::filesystem::path &pfname);
+
   /** \brief Tell if a filename is for an armature file.
    * 
    * Note that not accepting filenames in caps is intentional.
@@ -123,6 +153,20 @@ namespace data
     return (ext == boost::filesystem::path(".mesh"));
   }
 
+  /** \brief Tell if a filename is for a binary mesh file.
+   * 
+   * Note that not accepting filenames in caps is intentional.
+   *
+   * \param pfname Filename.
+   * \return True if yes, false if no.
+   */
+  inline bool filename_is_mesh_binary(const boost::filesystem::path &pfname)
+  {
+    boost::filesystem::path ext = pfname.extension();
+
+    return (ext == boost::filesystem::path(".bmesh"));
+  }
+
   /** \brief Tell if a filename is for a mesh collection.
    * 
    * Note that not accepting filenames in caps is intentional.
@@ -0,0 +1,270 @@
+#include "data/load_graph.hpp"
+
+#include "data/log.hpp"
+#include "thr/dispatch.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace data;
+
+LoadGraph::LoadGraph() :
+  m_remaining(0),
+  m_start(0),
+  m_running(false) { }
+
+LoadGraph::~LoadGraph()
+{
+  boost::mutex::scoped_lock scope(m_mutex);
+
+  while(m_remaining > 0)
+  {
+    m_cond.wait(scope);
+  }
+}
+
+void LoadGraph::add(const std::string &name, const thr::Task &task)
+{
+  this->add(name, task, std::vector<std::string>());
+}
+
+void LoadGraph::add(const std::string &name, const thr::Task &task, const std::string &dep)
+{
+  this->add(name, task, std::vector<std::string>(1, dep));
+}
+
+void LoadGraph::add(const std::string &name, const thr::Task &task, const std::vector<std::string> &deps)
+{
+  if(m_running)
+  {
+    std::stringstream sstr;
+    sstr << "can't add '" << name << "' into a running load graph";
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+  if(m_nodes.find(name) != m_nodes.end())
+  {
+    std::stringstream sstr;
+    sstr << "load graph already contains '" << name << '\'';
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+
+  LoadNodeSptr node(new LoadNode());
+  node->m_name = name;
+  node->m_task = task;
+  node->m_depends = deps;
+  node->m_pending = 0;
+  node->m_start = 0;
+  node->m_end = 0;
+  node->m_future = boost::shared_future<void>(node->m_promise.get_future());
+
+  m_nodes[name] = node;
+  m_order.push_back(node.get());
+}
+
+std::vector<const LoadNode*> LoadGraph::getCriticalPath() const
+{
+  std::vector<const LoadNode*> ret;
+  const LoadNode *last = NULL;
+
+  BOOST_FOREACH(const LoadNode *vv, m_order)
+  {
+    if((NULL == last) || (vv->m_end > last->m_end))
+    {
+      last = vv;
+    }
+  }
+
+  while(NULL != last)
+  {
+    ret.insert(ret.begin(), last);
+
+    const LoadNode *prev = NULL;
+    BOOST_FOREACH(const LoadNode *vv, last->m_predecessors)
+    {
+      if((NULL == prev) || (vv->m_end > prev->m_end))
+      {
+        prev = vv;
+      }
+    }
+    last = prev;
+  }
+
+  return ret;
+}
+
+boost::shared_future<void> LoadGraph::locate(const std::string &name) const
+{
+  map_type::const_iterator iter = m_nodes.find(name);
+
+  if(m_nodes.end() == iter)
+  {
+    std::stringstream sstr;
+    sstr << "no '" << name << "' in load graph";
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+
+  return iter->second->m_future;
+}
+
+void LoadGraph::report() const
+{
+  std::vector<const LoadNode*> path = this->getCriticalPath();
+
+  if(path.empty())
+  {
+    return;
+  }
+
+  std::ostringstream sstr;
+  sstr << "load graph: " << m_order.size() << " nodes in " << std::fixed << std::setprecision(1) <<
+    static_cast<double>(path.back()->m_end - m_start) / 1000.0 << " ms, critical path:";
+  BOOST_FOREACH(const LoadNode *vv, path)
+  {
+    sstr << ' ' << vv->m_name << " (" << static_cast<double>(vv->m_end - vv->m_start) / 1000.0 << " ms)";
+  }
+  log(sstr.str());
+}
+
+void LoadGraph::run()
+{
+  if(m_running)
+  {
+    std::stringstream sstr;
+    sstr << "load graph already running";
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+
+  BOOST_FOREACH(LoadNode *vv, m_order)
+  {
+    BOOST_FOREACH(const std::string &dep, vv->m_depends)
+    {
+      map_type::iterator iter = m_nodes.find(dep);
+
+      if(m_nodes.end() == iter)
+      {
+        std::stringstream sstr;
+        sstr << "'" << vv->m_name << "' depends on unknown '" << dep << '\'';
+        BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+      }
+      vv->m_predecessors.push_back(iter->second.get());
+      iter->second->m_successors.push_back(vv);
+    }
+    vv->m_pending = static_cast<unsigned>(vv->m_predecessors.size());
+  }
+
+  // Check for cycles by releasing nodes in topological order.
+  std::vector<LoadNode*> initial;
+  {
+    std::map<LoadNode*, unsigned> pending;
+    std::vector<LoadNode*> released;
+
+    BOOST_FOREACH(LoadNode *vv, m_order)
+    {
+      pending[vv] = vv->m_pending;
+      if(0 == vv->m_pending)
+      {
+        initial.push_back(vv);
+        released.push_back(vv);
+      }
+    }
+    for(unsigned ii = 0; (ii < released.size()); ++ii)
+    {
+      BOOST_FOREACH(LoadNode *vv, released[ii]->m_successors)
+      {
+        if(0 == --pending[vv])
+        {
+          released.push_back(vv);
+        }
+      }
+    }
+    if(released.size() != m_order.size())
+    {
+      std::stringstream sstr;
+      sstr << "dependency cycle in load graph";
+      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+    }
+  }
+
+  m_running = true;
+  m_remaining = static_cast<unsigned>(m_order.size());
+  m_start = thr::usec_get_timestamp();
+
+  BOOST_FOREACH(LoadNode *vv, initial)
+  {
+    thr::dispatch(run_node, this, vv);
+  }
+}
+
+void LoadGraph::run_node(LoadGraph *graph, LoadNode *node)
+{
+  node->m_start = thr::usec_get_timestamp();
+  if(!node->m_error)
+  {
+    try
+    {
+      node->m_task();
+    }
+    catch(...)
+    {
+      node->m_error = boost::current_exception();
+    }
+  }
+  node->m_end = thr::usec_get_timestamp();
+
+  if(node->m_error)
+  {
+    node->m_promise.set_exception(node->m_error);
+  }
+  else
+  {
+    node->m_promise.set_value();
+  }
+
+  // The graph may be destroyed as soon as the last node is completed, release successors under the lock.
+  std::vector<LoadNode*> ready;
+  {
+    boost::mutex::scoped_lock scope(graph->m_mutex);
+
+    BOOST_FOREACH(LoadNode *vv, node->m_successors)
+    {
+      if(node->m_error && !vv->m_error)
+      {
+        vv->m_error = node->m_error;
+      }
+      if(0 == --vv->m_pending)
+      {
+        ready.push_back(vv);
+      }
+    }
+
+    if(0 == --graph->m_remaining)
+    {
+      graph->m_cond.notify_all();
+    }
+  }
+
+  BOOST_FOREACH(LoadNode *vv, ready)
+  {
+    thr::dispatch(run_node, graph, vv);
+  }
+}
+
+void LoadGraph::wait()
+{
+  {
+    boost::mutex::scoped_lock scope(m_mutex);
+
+    while(m_remaining > 0)
+    {
+      m_cond.wait(scope);
+    }
+  }
+
+  BOOST_FOREACH(const LoadNode *vv, m_order)
+  {
+    if(vv->m_error)
+    {
+      boost::rethrow_exception(vv->m_error);
+    }
+  }
+}
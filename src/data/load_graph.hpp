@@ -0,0 +1,178 @@
+#ifndef DATA_LOAD_GRAPH_HPP
+#define DATA_LOAD_GRAPH_HPP
+
+#include "thr/generic.hpp"
+
+#include <map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace data
+{
+  /** \brief One node in a load graph.
+   */
+  struct LoadNode
+  {
+    /** Name of the node. */
+    std::string m_name;
+
+    /** Task to execute. */
+    thr::Task m_task;
+
+    /** Names of the nodes this depends on. */
+    std::vector<std::string> m_depends;
+
+    /** Nodes this depends on, resolved when run. */
+    std::vector<LoadNode*> m_predecessors;
+
+    /** Nodes depending on this. */
+    std::vector<LoadNode*> m_successors;
+
+    /** Number of predecessors not yet completed. */
+    unsigned m_pending;
+
+    /** Start timestamp (microseconds). */
+    uint64_t m_start;
+
+    /** End timestamp (microseconds). */
+    uint64_t m_end;
+
+    /** Error of this or a predecessor, empty if none. */
+    boost::exception_ptr m_error;
+
+    /** Promise fulfilled when the node is completed. */
+    boost::promise<void> m_promise;
+
+    /** Future of the promise. */
+    boost::shared_future<void> m_future;
+  };
+
+  /** \brief Declarative dependency graph of loading tasks.
+   *
+   * Each node declares the nodes it depends on. When run, all nodes without
+   * pending dependencies are dispatched into the thread pool and every
+   * completed node dispatches the successors it was the last dependency of,
+   * so independent chains proceed concurrently without global barriers.
+   *
+   * Nodes should wait for their own jobs with thr::TaskGroup, as thr::wait()
+   * would also wait for the other nodes. Nodes must not wait for the futures
+   * of other nodes.
+   */
+  class LoadGraph :
+    public boost::noncopyable
+  {
+    private:
+      /** Convenience typedef. */
+      typedef boost::shared_ptr<LoadNode> LoadNodeSptr;
+
+      /** Convenience typedef. */
+      typedef std::map<std::string, LoadNodeSptr> map_type;
+
+    private:
+      /** Nodes by name. */
+      map_type m_nodes;
+
+      /** Nodes in declaration order. */
+      std::vector<LoadNode*> m_order;
+
+      /** Guards completion bookkeeping. */
+      boost::mutex m_mutex;
+
+      /** Signaled when all nodes are completed. */
+      boost::condition_variable m_cond;
+
+      /** Number of nodes not yet completed. */
+      unsigned m_remaining;
+
+      /** Timestamp of run (microseconds). */
+      uint64_t m_start;
+
+      /** Set when run. */
+      bool m_running;
+
+    public:
+      /** \brief Constructor. */
+      LoadGraph();
+
+      /** \brief Destructor.
+       *
+       * Waits for the graph to complete if it was run.
+       */
+      ~LoadGraph();
+
+    private:
+      /** \brief Execute a node and dispatch the successors it releases.
+       *
+       * \param graph Graph the node belongs to.
+       * \param node Node to execute.
+       */
+      static void run_node(LoadGraph *graph, LoadNode *node);
+
+    public:
+      /** \brief Add a node without dependencies.
+       *
+       * \param name Unique node name.
+       * \param task Task to execute.
+       */
+      void add(const std::string &name, const thr::Task &task);
+
+      /** \brief Add a node with one dependency.
+       *
+       * \param name Unique node name.
+       * \param task Task to execute.
+       * \param dep Name of the node to depend on.
+       */
+      void add(const std::string &name, const thr::Task &task, const std::string &dep);
+
+      /** \brief Add a node.
+       *
+       * Dependencies may be declared before or after this node.
+       *
+       * \param name Unique node name.
+       * \param task Task to execute.
+       * \param deps Names of the nodes to depend on.
+       */
+      void add(const std::string &name, const thr::Task &task, const std::vector<std::string> &deps);
+
+      /** \brief Get the critical path.
+       *
+       * Starting from the node that completed last, follows the predecessor
+       * that completed last. Only valid after wait().
+       *
+       * \return Nodes on the critical path, first node first.
+       */
+      std::vector<const LoadNode*> getCriticalPath() const;
+
+      /** \brief Access the completion future of a node.
+       *
+       * The future carries the error of the node or of its predecessors.
+       *
+       * \param name Node name.
+       * \return Shared future.
+       */
+      boost::shared_future<void> locate(const std::string &name) const;
+
+      /** \brief Log the critical path.
+       */
+      void report() const;
+
+      /** \brief Resolve dependencies and dispatch the initial nodes.
+       *
+       * Throws an error on unknown dependencies or dependency cycles, in which
+       * case nothing is dispatched.
+       */
+      void run();
+
+      /** \brief Wait until all nodes are completed.
+       *
+       * Rethrows the first error in declaration order, if any.
+       */
+      void wait();
+  };
+}
+
+#endif
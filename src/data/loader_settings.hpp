@@ -14,10 +14,24 @@ namespace data
       /** Flags. */
       uint32_t m_flags;
 
+      /** May the loaded object be evicted from the store? */
+      bool m_evictable;
+
     protected:
       /** \brief Default constructor. */
       LoaderSettings() :
-        m_flags(0) { }
+        m_flags(0),
+        m_evictable(false) { }
+
+    public:
+      /** \brief May the loaded object be evicted from the store?
+       *
+       * \return True if yes, false if no.
+       */
+      bool isEvictable() const
+      {
+        return m_evictable;
+      }
 
     protected:
       /** \brief Tell if a flag(s) are set.
@@ -40,6 +54,15 @@ namespace data
         m_flags &= ~op;
       }
 
+      /** \brief Allow the loaded object to be evicted from the store.
+       *
+       * Only for objects that are referenced through shared pointers, if at all.
+       */
+      void setEvictable()
+      {
+        m_evictable = true;
+      }
+
       /** \brief Set flag(s).
        *
        * \param op Flag(s) to set. */
@@ -0,0 +1,300 @@
+#include "data/pack.hpp"
+
+#include "data/generic.hpp"
+#include "data/raw_cache.hpp"
+
+#include <map>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace fs = boost::filesystem;
+namespace ipc = boost::interprocess;
+using namespace data;
+
+/** Pack magic identifier. */
+static const char PACK_MAGIC[4] = { 'O', 'B', 'P', 'K' };
+
+/** Pack format version. */
+static const uint32_t PACK_VERSION = 1;
+
+/** Alignment of entry contents, one page. */
+static const uint32_t PACK_ALIGN = 4096;
+
+/** Mounted pack, if any. */
+static boost::scoped_ptr<Pack> pack_mounted;
+
+/** \brief Round up to the pack alignment.
+ *
+ * \param op Offset.
+ * \return Aligned offset.
+ */
+static uint64_t pack_align(uint64_t op)
+{
+  return (op + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN;
+}
+
+/** \brief Compare an entry to a hash.
+ *
+ * \param lhs Entry.
+ * \param rhs Hash.
+ * \return True if the entry is ordered before the hash.
+ */
+static bool pack_entry_less(const PackEntry &lhs, uint64_t rhs)
+{
+  return (lhs.m_hash < rhs);
+}
+
+/** \brief Write zeroes up to an offset.
+ *
+ * \param ostr Stream to write to.
+ * \param pos Current offset, updated.
+ * \param target Offset to write to.
+ */
+static void pack_pad(std::ostream &ostr, uint64_t &pos, uint64_t target)
+{
+  for(; (pos < target); ++pos)
+  {
+    ostr.put('\0');
+  }
+}
+
+Pack::Pack(const fs::path &pfname) :
+  m_file(pfname.string().c_str(), ipc::read_only),
+  m_region(m_file, ipc::read_only),
+  m_header(static_cast<const PackHeader*>(m_region.get_address()))
+{
+  uint64_t size = m_region.get_size();
+  bool valid = (size >= sizeof(PackHeader)) &&
+    std::equal(PACK_MAGIC, PACK_MAGIC + 4, m_header->m_magic) &&
+    (m_header->m_version == PACK_VERSION) &&
+    (size >= sizeof(PackHeader) + sizeof(PackEntry) * static_cast<uint64_t>(m_header->m_entry_count)) &&
+    (m_header->m_names_offset <= size) &&
+    (m_header->m_names_size <= size - m_header->m_names_offset);
+
+  if(valid)
+  {
+    const PackEntry *entries = reinterpret_cast<const PackEntry*>(m_header + 1);
+
+    for(unsigned ii = 0; (ii < m_header->m_entry_count); ++ii)
+    {
+      const PackEntry &vv = entries[ii];
+
+      if((vv.m_offset > size) || (vv.m_size > size - vv.m_offset) ||
+          (static_cast<uint64_t>(vv.m_name_offset) + vv.m_name_size > m_header->m_names_size) ||
+          ((ii > 0) && (entries[ii - 1].m_hash > vv.m_hash)))
+      {
+        valid = false;
+        break;
+      }
+    }
+  }
+
+  if(!valid)
+  {
+    std::stringstream sstr;
+    sstr << "invalid pack file: " << pfname;
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+}
+
+bool Pack::find(const fs::path &pfname, const uint8_t *&pdata, size_t &psize) const
+{
+  std::string name = pack_name(pfname);
+  uint64_t hash = hash_data(name.data(), name.size());
+  const uint8_t *base = static_cast<const uint8_t*>(m_region.get_address());
+  const char *names = reinterpret_cast<const char*>(base + m_header->m_names_offset);
+  const PackEntry *first = reinterpret_cast<const PackEntry*>(m_header + 1),
+        *last = first + m_header->m_entry_count;
+
+  for(const PackEntry *iter = std::lower_bound(first, last, hash, pack_entry_less);
+      ((iter != last) && (iter->m_hash == hash)); ++iter)
+  {
+    if((iter->m_name_size == name.size()) &&
+        std::equal(name.begin(), name.end(), names + iter->m_name_offset))
+    {
+      pdata = base + iter->m_offset;
+      psize = static_cast<size_t>(iter->m_size);
+      return true;
+    }
+  }
+  return false;
+}
+
+MappedFile::MappedFile(const fs::path &pfname) :
+  m_data(NULL),
+  m_size(0)
+{
+  fs::path fpath;
+
+  if(search_loose(pfname, fpath))
+  {
+    // Empty files cannot be mapped, they are left as empty views.
+    if(fs::file_size(fpath) > 0)
+    {
+      ipc::file_mapping file(fpath.string().c_str(), ipc::read_only);
+      ipc::mapped_region region(file, ipc::read_only);
+
+      m_file.swap(file);
+      m_region.swap(region);
+      m_data = static_cast<const uint8_t*>(m_region.get_address());
+      m_size = m_region.get_size();
+    }
+    return;
+  }
+
+  if(!pack_find(pfname, m_data, m_size))
+  {
+    std::stringstream sstr;
+    sstr << "could not find file: " << pfname;
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+}
+
+std::string data::pack_name(const fs::path &pfname)
+{
+  std::vector<std::string> parts;
+
+  for(fs::path::const_iterator ii = pfname.begin(), ee = pfname.end(); (ii != ee); ++ii)
+  {
+    std::string part = ii->generic_string();
+
+    if(part.empty() || (0 == part.compare(".")) || (0 == part.compare("/")))
+    {
+      continue;
+    }
+    if(0 == part.compare(".."))
+    {
+      if(!parts.empty())
+      {
+        parts.pop_back();
+      }
+      continue;
+    }
+    parts.push_back(part);
+  }
+
+  std::string ret;
+  BOOST_FOREACH(const std::string &vv, parts)
+  {
+    if(!ret.empty())
+    {
+      ret += '/';
+    }
+    ret += vv;
+  }
+  return ret;
+}
+
+void data::pack_mount(const fs::path &pfname)
+{
+  pack_mounted.reset(new Pack(pfname));
+}
+
+bool data::pack_find(const fs::path &pfname, const uint8_t *&pdata, size_t &psize)
+{
+  if(!pack_mounted)
+  {
+    return false;
+  }
+  return pack_mounted->find(pfname, pdata, psize);
+}
+
+void data::pack_write(const fs::path &pfname, const std::vector<fs::path> &files)
+{
+  // Ordered by hash as the entry table.
+  std::map<uint64_t, std::pair<std::string, fs::path> > sources;
+
+  BOOST_FOREACH(const fs::path &vv, files)
+  {
+    std::string name = pack_name(vv);
+    uint64_t hash = hash_data(name.data(), name.size());
+    std::map<uint64_t, std::pair<std::string, fs::path> >::iterator iter = sources.find(hash);
+
+    if(sources.end() == iter)
+    {
+      sources[hash] = std::make_pair(name, vv);
+    }
+    else if(0 != iter->second.first.compare(name))
+    {
+      std::stringstream sstr;
+      sstr << "pack name hash collision: " << iter->second.first << " and " << name;
+      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+    }
+  }
+
+  std::vector<PackEntry> entries;
+  std::string names;
+  for(std::map<uint64_t, std::pair<std::string, fs::path> >::const_iterator ii = sources.begin(),
+      ee = sources.end(); (ii != ee); ++ii)
+  {
+    PackEntry entry;
+    entry.m_hash = ii->first;
+    entry.m_offset = 0;
+    entry.m_size = fs::file_size(ii->second.second);
+    entry.m_name_offset = static_cast<uint32_t>(names.size());
+    entry.m_name_size = static_cast<uint32_t>(ii->second.first.size());
+    names += ii->second.first;
+    entries.push_back(entry);
+  }
+
+  PackHeader header;
+  std::copy(PACK_MAGIC, PACK_MAGIC + 4, header.m_magic);
+  header.m_version = PACK_VERSION;
+  header.m_entry_count = static_cast<uint32_t>(entries.size());
+  header.m_align = PACK_ALIGN;
+  header.m_names_offset = sizeof(PackHeader) + sizeof(PackEntry) * entries.size();
+  header.m_names_size = names.size();
+
+  uint64_t offset = header.m_names_offset + header.m_names_size;
+  BOOST_FOREACH(PackEntry &vv, entries)
+  {
+    offset = pack_align(offset);
+    vv.m_offset = offset;
+    offset += vv.m_size;
+  }
+
+  fs::path tmp_fname(pfname.string() + ".tmp");
+  {
+    fs::ofstream fd(tmp_fname, std::ios::binary);
+    uint64_t pos = header.m_names_offset + header.m_names_size;
+
+    fd.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!entries.empty())
+    {
+      fd.write(reinterpret_cast<const char*>(&entries.front()),
+          static_cast<std::streamsize>(sizeof(PackEntry) * entries.size()));
+    }
+    fd.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    unsigned idx = 0;
+    for(std::map<uint64_t, std::pair<std::string, fs::path> >::const_iterator ii = sources.begin(),
+        ee = sources.end(); (ii != ee); ++ii, ++idx)
+    {
+      const PackEntry &entry = entries[idx];
+
+      pack_pad(fd, pos, entry.m_offset);
+      if(entry.m_size > 0)
+      {
+        fs::ifstream src(ii->second.second, std::ios::binary);
+        if(!src.is_open())
+        {
+          std::stringstream sstr;
+          sstr << "could not read " << ii->second.second;
+          BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+        }
+        fd << src.rdbuf();
+      }
+      pos += entry.m_size;
+    }
+
+    if(fd.fail())
+    {
+      std::stringstream sstr;
+      sstr << "could not write " << tmp_fname;
+      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+    }
+  }
+  fs::rename(tmp_fname, pfname);
+}
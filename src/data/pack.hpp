@@ -0,0 +1,206 @@
+#ifndef DATA_PACK_HPP
+#define DATA_PACK_HPP
+
+#include "defaults.hpp"
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace data
+{
+  /** \brief Pack file header.
+   *
+   * The header is followed by the entry table sorted by name hash and the
+   * name block. File contents follow, each entry starting at a multiple of
+   * the alignment so that it can be handed to decoders straight from the
+   * mapping.
+   */
+  struct PackHeader
+  {
+    /** Magic identifier. */
+    char m_magic[4];
+
+    /** Format version. */
+    uint32_t m_version;
+
+    /** Number of entries. */
+    uint32_t m_entry_count;
+
+    /** Alignment of entry contents. */
+    uint32_t m_align;
+
+    /** Offset of the name block. */
+    uint64_t m_names_offset;
+
+    /** Size of the name block. */
+    uint64_t m_names_size;
+  };
+
+  /** \brief Pack file entry.
+   */
+  struct PackEntry
+  {
+    /** Hash of the normalized name. */
+    uint64_t m_hash;
+
+    /** Offset of contents from the start of the pack. */
+    uint64_t m_offset;
+
+    /** Size of contents. */
+    uint64_t m_size;
+
+    /** Offset of the name within the name block. */
+    uint32_t m_name_offset;
+
+    /** Size of the name. */
+    uint32_t m_name_size;
+  };
+
+  /** \brief Memory-mapped pack file.
+   *
+   * Holds all data files in one mapping. Lookups are binary searches over
+   * the hashed index and the name is compared to rule out collisions.
+   */
+  class Pack :
+    public boost::noncopyable
+  {
+    private:
+      /** File mapping. */
+      boost::interprocess::file_mapping m_file;
+
+      /** Mapped region. */
+      boost::interprocess::mapped_region m_region;
+
+      /** Header within the mapping. */
+      const PackHeader *m_header;
+
+    public:
+      /** \brief Accessor.
+       *
+       * \return Number of entries.
+       */
+      unsigned getEntryCount() const
+      {
+        return m_header->m_entry_count;
+      }
+
+    public:
+      /** \brief Constructor.
+       *
+       * Will throw an exception if the file cannot be mapped or is not a
+       * valid pack.
+       *
+       * \param pfname Pack filename.
+       */
+      Pack(const boost::filesystem::path &pfname);
+
+      /** \brief Destructor. */
+      ~Pack() { }
+
+    public:
+      /** \brief Find an entry.
+       *
+       * \param pfname Filename relative to the data root.
+       * \param pdata Destination for the contents.
+       * \param psize Destination for the size of contents.
+       * \return True if found, false if not.
+       */
+      bool find(const boost::filesystem::path &pfname, const uint8_t *&pdata, size_t &psize) const;
+  };
+
+  /** \brief Read-only view of a data file.
+   *
+   * A loose file is mapped on its own and overrides the mounted pack.
+   * Otherwise the view points into the pack and no data is copied.
+   */
+  class MappedFile :
+    public boost::noncopyable
+  {
+    private:
+      /** File mapping for a loose file. */
+      boost::interprocess::file_mapping m_file;
+
+      /** Mapped region for a loose file. */
+      boost::interprocess::mapped_region m_region;
+
+      /** Contents. */
+      const uint8_t *m_data;
+
+      /** Size of contents. */
+      size_t m_size;
+
+    public:
+      /** \brief Accessor.
+       *
+       * \return Contents.
+       */
+      const uint8_t* getData() const
+      {
+        return m_data;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Size of contents.
+       */
+      size_t getSize() const
+      {
+        return m_size;
+      }
+
+    public:
+      /** \brief Constructor.
+       *
+       * Will throw an exception if the file is not found.
+       *
+       * \param pfname Filename to open.
+       */
+      MappedFile(const boost::filesystem::path &pfname);
+
+      /** \brief Destructor. */
+      ~MappedFile() { }
+  };
+
+  /** \brief Normalize a filename for pack lookups.
+   *
+   * \param pfname Filename.
+   * \return Filename with '.' and '..' resolved, using '/' as separator.
+   */
+  extern std::string pack_name(const boost::filesystem::path &pfname);
+
+  /** \brief Mount a pack.
+   *
+   * Must be called before any loading starts, the mounted pack is read
+   * without locking. Will throw an exception on failure.
+   *
+   * \param pfname Pack filename.
+   */
+  extern void pack_mount(const boost::filesystem::path &pfname);
+
+  /** \brief Find a file from the mounted pack.
+   *
+   * \param pfname Filename relative to the data root.
+   * \param pdata Destination for the contents.
+   * \param psize Destination for the size of contents.
+   * \return True if found, false if no pack is mounted or it does not contain the file.
+   */
+  extern bool pack_find(const boost::filesystem::path &pfname, const uint8_t *&pdata, size_t &psize);
+
+  /** \brief Write a pack.
+   *
+   * Files are stored under their normalized names. The file is written under
+   * a temporary name and renamed into place. Will throw an exception on
+   * failure.
+   *
+   * \param pfname Pack filename.
+   * \param files Files to store.
+   */
+  extern void pack_write(const boost::filesystem::path &pfname,
+      const std::vector<boost::filesystem::path> &files);
+}
+
+#endif
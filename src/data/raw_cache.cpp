@@ -0,0 +1,110 @@
+#include "data/raw_cache.hpp"
+
+#include "data/generic.hpp"
+#include "thr/timeline.hpp"
+
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+
+namespace fs = boost::filesystem;
+using namespace data;
+
+/** Raw cache magic identifier. */
+static const char RAW_CACHE_MAGIC[4] = { 'O', 'B', 'R', 'C' };
+
+/** Raw cache format version. */
+static const uint32_t RAW_CACHE_VERSION = 1;
+
+/** Block size for hashing files. */
+static const unsigned HASH_BLOCK = 65536;
+
+RawCache::RawCache(const fs::path &pfname) :
+  m_map(pfname),
+  m_header(NULL)
+{
+  if(m_map.getSize() >= sizeof(RawCacheHeader))
+  {
+    m_header = reinterpret_cast<const RawCacheHeader*>(m_map.getData());
+  }
+  thr::timeline_read(m_map.getSize());
+}
+
+bool RawCache::isValid(uint64_t key) const
+{
+  if((NULL == m_header) ||
+      !std::equal(RAW_CACHE_MAGIC, RAW_CACHE_MAGIC + 4, m_header->m_magic) ||
+      (m_header->m_version != RAW_CACHE_VERSION) ||
+      (m_header->m_key != key))
+  {
+    return false;
+  }
+
+  uint64_t size = static_cast<uint64_t>(m_header->m_width) * m_header->m_height * m_header->m_depth *
+    (m_header->m_bpp / 8);
+  return (m_map.getSize() >= sizeof(RawCacheHeader) + size);
+}
+
+fs::path data::raw_cache_filename(const fs::path &pfname)
+{
+  fs::path ret(pfname);
+  return ret.replace_extension(".raw");
+}
+
+void data::raw_cache_write(const fs::path &pfname, uint64_t key, unsigned pw, unsigned ph, unsigned pd,
+    unsigned pb, const void *pdata)
+{
+  RawCacheHeader header;
+  std::copy(RAW_CACHE_MAGIC, RAW_CACHE_MAGIC + 4, header.m_magic);
+  header.m_version = RAW_CACHE_VERSION;
+  header.m_key = key;
+  header.m_width = pw;
+  header.m_height = ph;
+  header.m_depth = pd;
+  header.m_bpp = pb;
+
+  fs::path tmp_fname(pfname.string() + ".tmp");
+  {
+    fs::ofstream fd(tmp_fname, std::ios::binary);
+    fd.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fd.write(static_cast<const char*>(pdata), static_cast<std::streamsize>(pw * ph * pd * (pb / 8)));
+    if(fd.fail())
+    {
+      std::stringstream sstr;
+      sstr << "could not write " << tmp_fname;
+      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+    }
+  }
+  fs::rename(tmp_fname, pfname);
+}
+
+uint64_t data::hash_data(const void *pdata, size_t size, uint64_t hash)
+{
+  const uint8_t *iter = static_cast<const uint8_t*>(pdata);
+
+  for(size_t ii = 0; (ii < size); ++ii)
+  {
+    hash ^= iter[ii];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t data::hash_file(const fs::path &pfname, uint64_t hash)
+{
+  shristr fd = open_read(pfname);
+  std::vector<char> block(HASH_BLOCK);
+
+  while(fd->good())
+  {
+    fd->read(&block.front(), HASH_BLOCK);
+    hash = hash_data(&block.front(), static_cast<size_t>(fd->gcount()), hash);
+  }
+  if(fd->bad())
+  {
+    std::stringstream sstr;
+    sstr << "could not read " << pfname;
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+  return hash;
+}
@@ -0,0 +1,170 @@
+#ifndef DATA_RAW_CACHE_HPP
+#define DATA_RAW_CACHE_HPP
+
+#include "data/pack.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace data
+{
+  /** \brief Raw cache file header.
+   *
+   * Pixel data follows the header immediately, uncompressed and in the
+   * format it is uploaded in.
+   */
+  struct RawCacheHeader
+  {
+    /** Magic identifier. */
+    char m_magic[4];
+
+    /** Format version. */
+    uint32_t m_version;
+
+    /** Key of the inputs the data was created from. */
+    uint64_t m_key;
+
+    /** Width. */
+    uint32_t m_width;
+
+    /** Height. */
+    uint32_t m_height;
+
+    /** Depth, 1 for images. */
+    uint32_t m_depth;
+
+    /** Bit depth. */
+    uint32_t m_bpp;
+  };
+
+  /** \brief Memory-mapped raw cache file.
+   *
+   * Caches decoded or generated image data so that it can be uploaded
+   * straight from the mapping. The key is computed by the user from all
+   * inputs of the data, typically detail parameters and source file hashes.
+   * A cache with a different key is considered stale.
+   */
+  class RawCache :
+    public boost::noncopyable
+  {
+    private:
+      /** Mapped file. */
+      MappedFile m_map;
+
+      /** Header within the mapping, NULL if the file is not a valid cache. */
+      const RawCacheHeader *m_header;
+
+    public:
+      /** \brief Accessor.
+       *
+       * \return Width.
+       */
+      unsigned getWidth() const
+      {
+        return m_header->m_width;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Height.
+       */
+      unsigned getHeight() const
+      {
+        return m_header->m_height;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Depth.
+       */
+      unsigned getDepth() const
+      {
+        return m_header->m_depth;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Bit depth.
+       */
+      unsigned getBpp() const
+      {
+        return m_header->m_bpp;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Pointer to data within the mapping.
+       */
+      const uint8_t* getData() const
+      {
+        return reinterpret_cast<const uint8_t*>(m_header + 1);
+      }
+
+    public:
+      /** \brief Constructor.
+       *
+       * Will throw an exception if the file cannot be found.
+       *
+       * \param pfname Cache filename.
+       */
+      RawCache(const boost::filesystem::path &pfname);
+
+      /** \brief Destructor. */
+      ~RawCache() { }
+
+    public:
+      /** \brief Tell if the cache is valid for given inputs.
+       *
+       * \param key Key of the inputs.
+       * \return True if the header matches and all data is present.
+       */
+      bool isValid(uint64_t key) const;
+  };
+
+  /** \brief Get the cache filename for a file.
+   *
+   * \param pfname Source filename.
+   * \return Cache filename.
+   */
+  extern boost::filesystem::path raw_cache_filename(const boost::filesystem::path &pfname);
+
+  /** \brief Write a raw cache file.
+   *
+   * The file is written under a temporary name and renamed into place, so
+   * a partially written cache is never seen. Will throw an exception on
+   * failure.
+   *
+   * \param pfname Cache filename.
+   * \param key Key of the inputs.
+   * \param pw Width.
+   * \param ph Height.
+   * \param pd Depth.
+   * \param pb Bit depth.
+   * \param pdata Data.
+   */
+  extern void raw_cache_write(const boost::filesystem::path &pfname, uint64_t key, unsigned pw,
+      unsigned ph, unsigned pd, unsigned pb, const void *pdata);
+
+  /** \brief Hash a block of data.
+   *
+   * 64-bit FNV-1a.
+   *
+   * \param pdata Data.
+   * \param size Size in bytes.
+   * \param hash Hash to continue from.
+   * \return Hash.
+   */
+  extern uint64_t hash_data(const void *pdata, size_t size, uint64_t hash = 14695981039346656037ULL);
+
+  /** \brief Hash the contents of a file.
+   *
+   * Will throw an exception if the file cannot be read.
+   *
+   * \param pfname Filename, searched as with open_read().
+   * \param hash Hash to continue from.
+   * \return Hash.
+   */
+  extern uint64_t hash_file(const boost::filesystem::path &pfname, uint64_t hash = 14695981039346656037ULL);
+}
+
+#endif
@@ -11,13 +11,14 @@
 namespace data
 {
   /** \brief Registry base class.
+   *
+   * Instances are created from source data of type D, by default the property tree of an XML file.
    */
-  template <typename T, typename L> class Registry
+  template <typename T, typename L, typename D = boost::property_tree::ptree> class Registry
   {
     protected:
       /** Convenience typedef. */
-      typedef T* (*CreateFunction)(const boost::filesystem::path&, const boost::property_tree::ptree&,
-          const L&);
+      typedef T* (*CreateFunction)(const boost::filesystem::path&, const D&, const L&);
 
       /** Convenience typedef */
       typedef std::map<std::string, CreateFunction> registry_type;
@@ -30,11 +31,10 @@ namespace data
       /** \brief Create a instance of registered class.
        *
        * \param pfname Filename to load from.
-       * \param root Tree root from which to create.
+       * \param root Source data from which to create.
        * \param loader Loader to be passed into construction.
        */
-      static T* registryCreate(const boost::filesystem::path &pfname, const boost::property_tree::ptree &root,
-          const L &loader);
+      static T* registryCreate(const boost::filesystem::path &pfname, const D &root, const L &loader);
   };
 
   /** \brief Registration template class to be instantiated.
@@ -42,18 +42,17 @@ namespace data
    * Each class wanting to register itself into the registry must instantiate a Registration template. This
    * should be done in their own source file.
    */
-  template <class R, class L, class T> class Registration :
-    public Registry<R, L>
+  template <class R, class L, class T, class D = boost::property_tree::ptree> class Registration :
+    public Registry<R, L, D>
   {
     private:
       /** \brief Private creator function.
        *
        * \param pfname Filename to load from.
-       * \param root Tree root from which to create.
+       * \param root Source data from which to create.
        * \param loader Loader to be passed into construction.
        */
-      static R* privateCreate(const boost::filesystem::path &pfname, const boost::property_tree::ptree &root,
-          const L &loader)
+      static R* privateCreate(const boost::filesystem::path &pfname, const D &root, const L &loader)
       {
         return new T(pfname, root, loader);
       }
@@ -70,31 +69,31 @@ namespace data
       Registration(const char *pid) :
         m_id(pid)
       {
-        if(NULL == Registry<R, L>::g_registry)
+        if(NULL == Registry<R, L, D>::g_registry)
         {
-          Registry<R, L>::g_registry = new typename Registry<R, L>::registry_type();
+          Registry<R, L, D>::g_registry = new typename Registry<R, L, D>::registry_type();
         }
 
-        (*Registry<R, L>::g_registry)[m_id] = Registration<R, L, T>::privateCreate;
+        (*Registry<R, L, D>::g_registry)[m_id] = Registration<R, L, T, D>::privateCreate;
       }
 
       /** \brief Destructor. */
       ~Registration()
       {
-        BOOST_ASSERT(NULL != (Registry<R, L>::g_registry));
+        BOOST_ASSERT(NULL != (Registry<R, L, D>::g_registry));
 
-        typename Registry<R, L>::registry_type::iterator iter = Registry<R, L>::g_registry->find(m_id);
-        if(Registry<R, L>::g_registry->end() == iter)
+        typename Registry<R, L, D>::registry_type::iterator iter = Registry<R, L, D>::g_registry->find(m_id);
+        if(Registry<R, L, D>::g_registry->end() == iter)
         {
           std::ostringstream sstr;
           sstr << "trying to remove id '" << m_id << "' that is not registered";
           BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
         }
 
-        if(0 >= Registry<R, L>::g_registry->size())
+        if(0 >= Registry<R, L, D>::g_registry->size())
         {
-          delete Registry<R, L>::g_registry;
-          Registry<R, L>::g_registry = NULL;
+          delete Registry<R, L, D>::g_registry;
+          Registry<R, L, D>::g_registry = NULL;
         }
       }
   };
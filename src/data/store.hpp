@@ -4,9 +4,13 @@
 #include "data/generic.hpp"
 #include "math/generic.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 
+#include <boost/atomic.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 
+#include <iomanip>
 #include <map>
 #include <sstream>
 #include <vector>
@@ -15,7 +19,8 @@ namespace data
 {
   /** \brief Store container type.
    *
-   * Can store one or many objects of given type.
+   * Can store one or many objects of given type. The stored type must implement getStorageSize() returning
+   * the number of bytes it holds.
    */
   template <class T> class StoreContainer
   {
@@ -36,12 +41,18 @@ namespace data
       /** Contents of this. */
       std::vector<value_type> m_contents;
 
+      /** Size of contents in bytes. */
+      uint64_t m_size;
+
       /** Cache hit value. */
       unsigned m_cache_value;
 
       /** Is this value persistent (should it be ignored for clear and purge purposes)? */
       bool m_persistent;
 
+      /** May this be evicted when not referenced outside the store? */
+      bool m_evictable;
+
     public:
       /** \brief Accessor to actual value.
        *
@@ -170,6 +181,24 @@ namespace data
         return m_cache_value;
       }
 
+      /** \brief Accessor.
+       *
+       * \return Size of contents in bytes.
+       */
+      uint64_t getSize() const
+      {
+        return m_size;
+      }
+
+      /** \brief May this container be evicted?
+       *
+       * \return True if yes, false if no.
+       */
+      bool isEvictable() const
+      {
+        return m_evictable;
+      }
+
       /** \brief Should this container be treated as persistent?
        *
        * \return True if yes, false if no.
@@ -179,6 +208,24 @@ namespace data
         return m_persistent;
       }
 
+      /** \brief Is any of the contents referenced outside the store?
+       *
+       * Only references held as shared pointers are seen.
+       *
+       * \return True if yes, false if no.
+       */
+      bool isReferenced() const
+      {
+        BOOST_FOREACH(const value_type &vv, m_contents)
+        {
+          if(vv.use_count() > 1)
+          {
+            return true;
+          }
+        }
+        return false;
+      }
+
       /** \brief Setter
        *
        * \param op New cache value.
@@ -188,6 +235,18 @@ namespace data
         m_cache_value = op;
       }
 
+      /** \brief Turn eviction on or off.
+       *
+       * Evictable containers are erased least recently used first when the store exceeds its budget, unless
+       * the contents are referenced. Must be set before the container is stored.
+       *
+       * \param op New eviction flag (default: true).
+       */
+      void setEvictable(bool op = true)
+      {
+        m_evictable = op;
+      }
+
       /** \brief Turn persistence on or off.
        *
        * \param op New persistence flat (default: true).
@@ -209,14 +268,20 @@ namespace data
     public:
       /** \brief Empty constructor. */
       StoreContainer() :
-        m_cache_value(0) { }
+        m_size(0),
+        m_cache_value(0),
+        m_persistent(false),
+        m_evictable(false) { }
 
       /** \brief Constructor.
        *
        * \param op Element to start with.
        */
       StoreContainer(T* op) :
-        m_cache_value(0)
+        m_size(0),
+        m_cache_value(0),
+        m_persistent(false),
+        m_evictable(false)
       {
         this->add(op);
         this->trim();
@@ -233,6 +298,7 @@ namespace data
       void add(T* op)
       {
         m_contents.push_back(value_type(op));
+        m_size += op->getStorageSize();
       }
 
       /** \brief Trim used space.
@@ -243,15 +309,27 @@ namespace data
       }
   };
 
-  /** \brief Store union class. */
+  /** \brief Store union class.
+   *
+   * Entries are spread over lock stripes by name hash so that lookups from different threads rarely
+   * contend. Lookups only lock the stripe of the entry. Changes to the set of entries are also serialized
+   * by the store mutex, which guards the total size and the budget. The lock order is store mutex first,
+   * stripe second.
+   *
+   * Containers are held through handles that stay valid for as long as they are held, so a handle taken
+   * once turns later lookups into a pointer dereference.
+   */
   template <class T> class Store
   {
     public:
       /** Convenience typedef. */
       typedef StoreContainer<T> container_type;
 
+      /** Handle to a stored container. */
+      typedef boost::shared_ptr<container_type> handle_type;
+
       /** Convenience typedef. */
-      typedef std::map<boost::filesystem::path, container_type> map_type;
+      typedef std::map<std::string, handle_type> map_type;
 
       /** Convenience typedef. */
       typedef typename map_type::iterator iterator;
@@ -259,138 +337,326 @@ namespace data
       /** Convenience typedef. */
       typedef typename map_type::const_iterator const_iterator;
 
+      /** Number of lock stripes. */
+      static const unsigned STRIPE_COUNT = 16;
+
     private:
-      /** Storage for all objects. */
-      map_type m_data;
+      /** \brief One lock stripe.
+       */
+      struct Stripe
+      {
+        /** Entries in this stripe by name. */
+        map_type m_data;
+
+        /** Guards the entries in this stripe. */
+        boost::mutex m_mutex;
+      };
 
-      /** Safety for operations within the storage. */
+    private:
+      /** Lock stripes. */
+      Stripe m_stripes[STRIPE_COUNT];
+
+      /** Serializes changes to the set of entries. */
       boost::mutex m_mutex;
 
-      /** Current cache value. */
-      unsigned m_cache_value;
+      /** Current cache value, stamped on entries as they are accessed. */
+      boost::atomic<unsigned> m_cache_value;
+
+      /** Size of all contents in bytes. */
+      uint64_t m_size;
+
+      /** Budget in bytes, 0 for unlimited. */
+      uint64_t m_budget;
 
     public:
-      /** \brief Iterator begin.
+      /** \brief Default constructor.
+       *
+       * \param pcv Cache value to start with.
+       */
+      Store(unsigned pcv = 0) :
+        m_cache_value(pcv),
+        m_size(0),
+        m_budget(0) { }
+
+      /** \brief Destructor. */
+      ~Store() { }
+
+    private:
+      /** \brief Get the stripe of a name.
        *
-       * \return Iterator to beginning.
+       * \param pfname Name.
+       * \return Stripe.
        */
-      iterator begin()
+      Stripe& getStripe(const std::string &pfname)
       {
-        return m_data.begin();
+        return m_stripes[boost::hash<std::string>()(pfname) % STRIPE_COUNT];
       }
 
-      /** \brief Const iterator begin.
+      /** \brief Erase from iterator.
+       *
+       * Store mutex and the stripe must be locked. The container is moved into the victim list instead of
+       * being destroyed, since destroying it may need to wait for the privileged thread. The caller must
+       * release the victims only after releasing the locks.
        *
-       * \return Const iterator to beginning.
+       * \param stripe Stripe to erase from.
+       * \param ii Iterator to erase from.
+       * \param victims Erased containers are appended here.
+       * \return Iterator to next position.
        */
-      const_iterator cbegin()
+      iterator erase(Stripe &stripe, iterator ii, std::vector<handle_type> &victims)
       {
-        return m_data.cbegin();
+        iterator jj = ii;
+        ++jj;
+
+        m_size -= ii->second->getSize();
+        victims.push_back(ii->second);
+        stripe.m_data.erase(ii);
+
+        return jj;
       }
 
-      /** \brief Iterator end.
+      /** \brief Tell if a container may be evicted.
        *
-       * \return Iterator to end.
+       * \param op Container handle.
+       * \return True if yes, false if no.
        */
-      iterator end()
+      static bool isEvictable(const handle_type &op)
       {
-        return m_data.end();
+        // One reference is held by the store, others are handles in use.
+        return op->isEvictable() && !op->isPersistent() && (1 >= op.use_count()) && !op->isReferenced();
       }
 
-      /** \brief Const iterator end.
+      /** \brief Evict least recently used entries until within a limit.
        *
-       * \return Const iterator to end.
+       * Store mutex must be locked. Only evictable entries that are not referenced outside the store are
+       * taken.
+       *
+       * \param keep Container not to evict, may be NULL.
+       * \param limit Size to evict down to.
+       * \param victims Evicted containers are appended here.
        */
-      const_iterator cend()
+      void evict(const container_type *keep, uint64_t limit, std::vector<handle_type> &victims)
       {
-        return m_data.cend();
+        while(m_size > limit)
+        {
+          Stripe *victim_stripe = NULL;
+          iterator victim;
+          unsigned victim_cache_value = 0;
+
+          // The set of entries may only change under the store mutex, so the iterator remains valid.
+          BOOST_FOREACH(Stripe &vv, m_stripes)
+          {
+            boost::mutex::scoped_lock scope(vv.m_mutex);
+
+            for(iterator ii = vv.m_data.begin(), ee = vv.m_data.end(); (ii != ee); ++ii)
+            {
+              if((ii->second.get() == keep) || !isEvictable(ii->second))
+              {
+                continue;
+              }
+              // Cache value of the victim is remembered, its stripe is no longer locked.
+              if((NULL == victim_stripe) || (ii->second->getCacheValue() < victim_cache_value))
+              {
+                victim_stripe = &vv;
+                victim = ii;
+                victim_cache_value = ii->second->getCacheValue();
+              }
+            }
+          }
+
+          if(NULL == victim_stripe)
+          {
+            return;
+          }
+          boost::mutex::scoped_lock scope(victim_stripe->m_mutex);
+          // A handle may have been taken while the stripe was unlocked.
+          if(isEvictable(victim->second))
+          {
+            this->erase(*victim_stripe, victim, victims);
+          }
+        }
       }
 
-    public:
-      /** \brief Default constructor.
+      /** \brief Evict until within budget.
        *
-       * \param pcv Cache value to start with.
+       * Store mutex must be locked.
+       *
+       * \param keep Container not to evict, may be NULL.
+       * \param victims Evicted containers are appended here.
        */
-      Store(unsigned pcv = 0) :
-        m_cache_value(pcv) { }
+      void evict(const container_type *keep, std::vector<handle_type> &victims)
+      {
+        if(0 < m_budget)
+        {
+          this->evict(keep, m_budget, victims);
+        }
+      }
 
-      /** \brief Destructor. */
-      ~Store() { }
+      /** \brief Find an entry.
+       *
+       * The stripe must be locked. Marks the entry as most recently used. Throws an error if not found.
+       *
+       * \param stripe Stripe of the name.
+       * \param pfname Name to find.
+       * \return Handle.
+       */
+      const handle_type& find(Stripe &stripe, const std::string &pfname)
+      {
+        iterator ii = stripe.m_data.find(pfname);
+
+        if(stripe.m_data.end() == ii)
+        {
+          std::stringstream sstr;
+          sstr << "no " << pfname << " available in the store";
+          BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+        }
+        // Every lookup advances the cache value, so that eviction follows access order. Only atomicity is
+        // needed, the stamp itself is written under the stripe lock.
+        ii->second->setCacheValue(m_cache_value.fetch_add(1, boost::memory_order_relaxed) + 1);
+        return ii->second;
+      }
+
+      /** \brief Insert a container.
+       *
+       * If an entry already exists, it is returned instead and the container is discarded.
+       *
+       * \param pfname Name to store under.
+       * \param op Container to store.
+       * \param allow_existing True to return an existing entry, false to treat it as an error.
+       * \return Handle to stored container.
+       */
+      handle_type insert(const std::string &pfname, const container_type &op, bool allow_existing)
+      {
+        std::vector<handle_type> victims;
+        boost::mutex::scoped_lock scope(m_mutex);
+        handle_type ret;
+        {
+          Stripe &stripe = this->getStripe(pfname);
+          boost::mutex::scoped_lock stripe_scope(stripe.m_mutex);
+          iterator ii = stripe.m_data.find(pfname);
+
+          if(stripe.m_data.end() != ii)
+          {
+            BOOST_ASSERT(allow_existing);
+
+            ii->second->setCacheValue(++m_cache_value);
+            return ii->second;
+          }
+
+          // Flags are part of the container before it is published to other threads.
+          ret = handle_type(new container_type(op));
+          ret->setCacheValue(++m_cache_value);
+          stripe.m_data[pfname] = ret;
+        }
+        m_size += ret->getSize();
+        this->evict(ret.get(), victims);
+        return ret;
+      }
 
     public:
       /** \brief Clear everything. */
       void clear()
       {
+        std::vector<handle_type> victims;
         boost::mutex::scoped_lock scope(m_mutex);
 
-        for(iterator ii = this->begin(), ee = this->end(); (ii != ee);)
+        BOOST_FOREACH(Stripe &vv, m_stripes)
         {
-          if(!ii->second.isPersistent())
-          {
-            ii = this->erase(ii, scope);
-          }
-          else
+          boost::mutex::scoped_lock stripe_scope(vv.m_mutex);
+
+          for(iterator ii = vv.m_data.begin(), ee = vv.m_data.end(); (ii != ee);)
           {
-            ++ii;
+            if(!ii->second->isPersistent())
+            {
+              ii = this->erase(vv, ii, victims);
+            }
+            else
+            {
+              ++ii;
+            }
           }
         }
 
         m_cache_value = 0;
       }
 
-      /** \brief Erase from iterator.
+      /** \brief Evict until within budget.
        *
-       * \param ii Iterator to erase from.
-       * \param scope Already acquired lock.
-       * \return Iterator to next position.
+       * Should be called when references to evictable entries have been released.
        */
-      iterator erase(iterator &ii, const boost::mutex::scoped_lock &scope)
+      void evict()
       {
-        boost::ignore_unused_variable_warning(scope);
+        std::vector<handle_type> victims;
+        boost::mutex::scoped_lock scope(m_mutex);
 
-        iterator jj = ii;
-        ++jj;
+        this->evict(NULL, victims);
+      }
 
-        m_data.erase(ii);
+      /** \brief Test if an entry already exists.
+       *
+       * \param pfname Name to test.
+       * \return True if yes, false if no.
+       */
+      bool exists(const std::string &pfname)
+      {
+        Stripe &stripe = this->getStripe(pfname);
+        boost::mutex::scoped_lock scope(stripe.m_mutex);
 
-        return jj;
+        return (stripe.m_data.end() != stripe.m_data.find(pfname));
       }
 
-      /** \brief Wrapper to erase.
+      /** \brief Accessor.
        *
-       * \param ii Iterator to erase from.
-       * \return Iterator to next position.
+       * \return Budget in bytes, 0 for unlimited.
        */
-      iterator erase(iterator &ii)
+      uint64_t getBudget()
       {
         boost::mutex::scoped_lock scope(m_mutex);
 
-        return erase(ii, scope);
+        return m_budget;
       }
 
-      /** \brief Test if an entry already exists.
+      /** \brief Accessor.
        *
-       * \param pfname Name to test.
-       * \param scope Already acquired lock.
-       * \return True if exists, false if no.
+       * \return Size of all contents in bytes.
        */
-      bool exists(const boost::filesystem::path &pfname, const boost::mutex::scoped_lock &scope)
+      uint64_t getSize()
       {
-        boost::ignore_unused_variable_warning(scope);
+        boost::mutex::scoped_lock scope(m_mutex);
 
-        return (m_data.find(pfname) != m_data.end());
+        return m_size;
       }
 
-      /** \brief Wrapper to exists.
+      /** \brief Get a handle to an entry.
+       *
+       * Throws an error if not found. An entry is never evicted while a handle to it is held.
        *
-       * \param op Filename to test.
-       * \return True if exists, false if no.
+       * \param pfname Name to access.
+       * \return Handle.
        */
-      bool exists(const boost::filesystem::path &pfname)
+      handle_type handle(const std::string &pfname)
       {
-        boost::mutex::scoped_lock scope(m_mutex);
+        Stripe &stripe = this->getStripe(pfname);
+        boost::mutex::scoped_lock scope(stripe.m_mutex);
+
+        return this->find(stripe, pfname);
+      }
+
+      /** \brief Get a handle to an entry if it exists.
+       *
+       * \param pfname Name to access.
+       * \return Handle, empty if not found.
+       */
+      handle_type lookup(const std::string &pfname)
+      {
+        Stripe &stripe = this->getStripe(pfname);
+        boost::mutex::scoped_lock scope(stripe.m_mutex);
 
-        return this->exists(pfname, scope);
+        if(stripe.m_data.end() == stripe.m_data.find(pfname))
+        {
+          return handle_type();
+        }
+        return this->find(stripe, pfname);
       }
 
       /** Increment cache value. */
@@ -400,22 +666,17 @@ namespace data
       }
 
       /** \brief Accessor.
+       *
+       * Marks the entry as most recently used.
        *
        * \param pfname Object to access.
        */
-      container_type& locate(const boost::filesystem::path &pfname)
+      container_type& locate(const std::string &pfname)
       {
-        boost::mutex::scoped_lock scope(m_mutex);
-        iterator ii = m_data.find(pfname);
+        Stripe &stripe = this->getStripe(pfname);
+        boost::mutex::scoped_lock scope(stripe.m_mutex);
 
-        if(m_data.end() == ii)
-        {
-          std::stringstream sstr;
-          sstr << "no " << pfname << " available in the store";
-          BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
-        }
-        ii->second.setCacheValue(m_cache_value);
-        return ii->second;
+        return *(this->find(stripe, pfname));
       }
 
       /** \brief Purge everything with cache value smaller than given.
@@ -425,39 +686,34 @@ namespace data
        *
        * \param op Minimum cache value to keep.
        */
-      void purge(unsigned op, const boost::mutex::scoped_lock &scope)
+      void purge(unsigned op)
       {
-        boost::ignore_unused_variable_warning(scope);
+        std::vector<handle_type> victims;
+        boost::mutex::scoped_lock scope(m_mutex);
 
         BOOST_ASSERT(op <= m_cache_value);
 
-        for(iterator ii = this->begin(), ee = this->end(); (ii != ee);)
+        BOOST_FOREACH(Stripe &vv, m_stripes)
         {
-          container_type &vv = ii->second;
+          boost::mutex::scoped_lock stripe_scope(vv.m_mutex);
 
-          if(!vv.isPersistent() && (vv.getCacheValue() < op))
+          for(iterator ii = vv.m_data.begin(), ee = vv.m_data.end(); (ii != ee);)
           {
-            ii = this->erase(ii, scope);
-          }
-          else
-          {
-            ii.second.decrementCacheValue(op);
-            ++ii;
+            container_type &cc = *(ii->second);
+
+            if(!cc.isPersistent() && (cc.getCacheValue() < op))
+            {
+              ii = this->erase(vv, ii, victims);
+            }
+            else
+            {
+              cc.decrementCacheValue(op);
+              ++ii;
+            }
           }
         }
       }
 
-      /** \brief Wrapper to purging.
-       *
-       * \param op Minimum cache value to keep.
-       */
-      void purge(unsigned op)
-      {
-        boost::mutex::scoped_lock scope;
-
-        this->purge(op, scope);
-      }
-
       /** \brief Purge the oldest entries.
        *
        * Will decrement cache values thus that entries with cache value one greater than the oldest one will
@@ -465,60 +721,173 @@ namespace data
        */
       void purge()
       {
-        boost::mutex::scoped_lock scope(m_mutex);
         unsigned minimum_cache_value = UINT_MAX;
 
-        for(iterator ii = this->begin(), ee = this->end(); (ii != ee); ++ii)
+        BOOST_FOREACH(Stripe &vv, m_stripes)
         {
-          minimum_cache_value = math::min(minimum_cache_value, ii.second.getCacheValue());
+          boost::mutex::scoped_lock scope(vv.m_mutex);
+
+          for(iterator ii = vv.m_data.begin(), ee = vv.m_data.end(); (ii != ee); ++ii)
+          {
+            minimum_cache_value = math::min(minimum_cache_value, ii->second->getCacheValue());
+          }
         }
 
         if(minimum_cache_value < UINT_MAX)
         {
-          this->purge(minimum_cache_value + 1, scope);
+          this->purge(minimum_cache_value + 1);
         }
       }
 
+      /** \brief Evict all evictable entries that are not referenced, regardless of budget.
+       */
+      void release()
+      {
+        std::vector<handle_type> victims;
+        boost::mutex::scoped_lock scope(m_mutex);
+
+        this->evict(NULL, 0, victims);
+      }
+
       /** \brief Remove based on name.
        *
        * \param pfname Name to erase.
        */
-      void remove(const boost::filesystem::path &pfname)
+      void remove(const std::string &pfname)
       {
-        boost::mutex::scoped_lock scope;
-        iterator ii = m_data.find(pfname);
+        std::vector<handle_type> victims;
+        boost::mutex::scoped_lock scope(m_mutex);
+        Stripe &stripe = this->getStripe(pfname);
+        boost::mutex::scoped_lock stripe_scope(stripe.m_mutex);
+        iterator ii = stripe.m_data.find(pfname);
 
-        BOOST_ASSERT(m_data.end() != ii);
+        BOOST_ASSERT(stripe.m_data.end() != ii);
 
-        m_data.erase(ii);
+        this->erase(stripe, ii, victims);
       }
 
-      /** \brief Store an object.
+      /** \brief Replace an object.
        *
-       * \param pfname Name to store under.
-       * \param op An object to store.
+       * A new container is swapped in under the name, so holders of a handle keep seeing the previous
+       * contents until they look the name up again. The handle to the previous contents is returned.
+       *
+       * \param pfname Name stored under.
+       * \param op New object.
+       * \return Handle to previous contents.
        */
-      container_type& store(const boost::filesystem::path &pfname, T *op)
+      handle_type replace(const std::string &pfname, T *op)
       {
         boost::mutex::scoped_lock scope(m_mutex);
+        Stripe &stripe = this->getStripe(pfname);
+        boost::mutex::scoped_lock stripe_scope(stripe.m_mutex);
+        iterator ii = stripe.m_data.find(pfname);
 
-        BOOST_ASSERT(!this->exists(pfname, scope));
+        if(stripe.m_data.end() == ii)
+        {
+          std::stringstream sstr;
+          sstr << "no " << pfname << " available in the store";
+          BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+        }
 
-        return (m_data[pfname] = container_type(op));
+        handle_type ret = ii->second;
+        handle_type cc(new container_type(op));
+        cc->setCacheValue(ret->getCacheValue());
+        cc->setPersistent(ret->isPersistent());
+        cc->setEvictable(ret->isEvictable());
+        ii->second = cc;
+        m_size += cc->getSize() - ret->getSize();
+        return ret;
       }
 
-      /** \brief Store an object collection.
+      /** \brief Write residency of the store.
+       *
+       * \param ostr Stream to write to.
+       * \param entries Also list every entry.
+       */
+      void report(std::ostream &ostr, bool entries)
+      {
+        boost::mutex::scoped_lock scope(m_mutex);
+        map_type sorted;
+
+        BOOST_FOREACH(Stripe &vv, m_stripes)
+        {
+          boost::mutex::scoped_lock stripe_scope(vv.m_mutex);
+
+          sorted.insert(vv.m_data.begin(), vv.m_data.end());
+        }
+
+        ostr << sorted.size() << " entries, " << std::fixed << std::setprecision(1) <<
+          static_cast<double>(m_size) / 1048576.0 << " MB";
+        if(0 < m_budget)
+        {
+          ostr << " of " << static_cast<double>(m_budget) / 1048576.0 << " MB";
+        }
+        ostr << '\n';
+
+        if(!entries)
+        {
+          return;
+        }
+        for(const_iterator ii = sorted.begin(), ee = sorted.end(); (ii != ee); ++ii)
+        {
+          const container_type &vv = *(ii->second);
+
+          // The copy made for sorting holds one more reference.
+          ostr << ii->first << ": " << static_cast<double>(vv.getSize()) / 1048576.0 << " MB" <<
+            (vv.isEvictable() ? " evictable" : "") <<
+            (((2 < ii->second.use_count()) || vv.isReferenced()) ? " referenced" : "") << '\n';
+        }
+      }
+
+      /** \brief Set the budget.
+       *
+       * Evicts immediately if over the new budget.
+       *
+       * \param op Budget in bytes, 0 for unlimited.
+       */
+      void setBudget(uint64_t op)
+      {
+        std::vector<handle_type> victims;
+        boost::mutex::scoped_lock scope(m_mutex);
+
+        m_budget = op;
+        this->evict(NULL, victims);
+      }
+
+      /** \brief Store an object.
        *
        * \param pfname Name to store under.
        * \param op An object to store.
+       * \param evictable May the object be evicted (default: false).
+       * \return Handle to stored container.
        */
-      container_type& store(const boost::filesystem::path &pfname, const container_type &op)
+      handle_type store(const std::string &pfname, T *op, bool evictable = false)
       {
-        boost::mutex::scoped_lock scope(m_mutex);
+        container_type cc(op);
+        cc.setEvictable(evictable);
+        return this->insert(pfname, cc, false);
+      }
 
-        BOOST_ASSERT(!this->exists(pfname, scope));
+      /** \brief Store an object collection.
+       *
+       * \param pfname Name to store under.
+       * \param op An object to store.
+       * \return Handle to stored container.
+       */
+      handle_type store(const std::string &pfname, const container_type &op)
+      {
+        return this->insert(pfname, op, false);
+      }
 
-        return (m_data[pfname] = op);
+      /** \brief Store an object collection unless an entry already exists.
+       *
+       * \param pfname Name to store under.
+       * \param op An object to store.
+       * \return Handle to stored or existing container.
+       */
+      handle_type storeOrFind(const std::string &pfname, const container_type &op)
+      {
+        return this->insert(pfname, op, true);
       }
   };
 
@@ -528,7 +897,8 @@ namespace data
    *
    * Should be inherited by objects desiring to be stored. The store provides generic utilities, but specific
    * load code should be implemented by the inheriting class. The name of this function should be
-   * createImplementation() and it should return a newly reserved object of the base type.
+   * createImplementation() and it should return a newly reserved object of the base type. The inheriting
+   * class should also implement getStorageSize() for the memory budget of the store.
    *
    * This class only has static functionality, and as such, no constructors or destructors.
    */
@@ -544,6 +914,9 @@ namespace data
       /** Convenience typedef. */
       typedef typename store_type::container_type container_type;
 
+      /** Convenience typedef. */
+      typedef typename store_type::handle_type handle_type;
+
     protected:
       /** All storage information. */
       static store_type g_store;
@@ -585,27 +958,71 @@ namespace data
        */
       static container_type& locate(const boost::filesystem::path &pfname)
       {
-        return g_store.locate(canonize(pfname));
+        return g_store.locate(canonize(pfname).string());
+      }
+
+      /** \brief Get a handle to an object in storage.
+       *
+       * Lookups through the handle are pointer dereferences. The object is not evicted while the handle is
+       * held. Replacing the object in storage is not seen through the handle, the previous object is kept
+       * alive for as long as the handle is held.
+       *
+       * Throws an error if not found.
+       *
+       * \param pfname Filename originally loaded as.
+       * \return Handle.
+       */
+      static handle_type handle(const boost::filesystem::path &pfname)
+      {
+        return g_store.handle(canonize(pfname).string());
       }
 
       /** \brief Store an object.
+       *
+       * An evictable object stays in storage only as long as the returned handle or a reference to its
+       * contents is held.
        *
        * \param pfname Path to store on.
        * \param op Object to store.
+       * \param evictable May the object be evicted (default: false).
+       * \return Handle.
        */
-      static container_type& store(const boost::filesystem::path &pfname, T* op)
+      static handle_type store(const boost::filesystem::path &pfname, T* op, bool evictable = false)
       {
-        return g_store.store(canonize(pfname), op);
+        return g_store.store(canonize(pfname).string(), op, evictable);
       }
 
       /** \brief Store an object container.
        *
        * \param pfname Path to store on.
        * \param op Object to store.
+       * \return Handle.
+       */
+      static handle_type store(const boost::filesystem::path &pfname, const container_type& op)
+      {
+        return g_store.store(canonize(pfname).string(), op);
+      }
+
+      /** \brief Replace an object in storage.
+       *
+       * Handles taken before the replacement keep the previous object.
+       *
+       * \param pfname Path stored on.
+       * \param op New object.
+       * \return Handle to previous contents.
+       */
+      static handle_type storageReplace(const boost::filesystem::path &pfname, T* op)
+      {
+        return g_store.replace(canonize(pfname).string(), op);
+      }
+
+      /** \brief Set the storage budget.
+       *
+       * \param op Budget in bytes, 0 for unlimited.
        */
-      static container_type& store(const boost::filesystem::path &pfname, const container_type& op)
+      static void storageBudget(uint64_t op)
       {
-        return g_store.store(canonize(pfname), op);
+        g_store.setBudget(op);
       }
 
       /** \brief Clear storage.
@@ -615,13 +1032,37 @@ namespace data
         g_store.clear();
       }
 
+      /** \brief Evict unreferenced elements from storage until within budget.
+       */
+      static void storageEvict()
+      {
+        g_store.evict();
+      }
+
+      /** \brief Evict all unreferenced evictable elements from storage, regardless of budget.
+       */
+      static void storageRelease()
+      {
+        g_store.release();
+      }
+
+      /** \brief Write residency of storage.
+       *
+       * \param ostr Stream to write to.
+       * \param entries Also list every element.
+       */
+      static void storageReport(std::ostream &ostr, bool entries = false)
+      {
+        g_store.report(ostr, entries);
+      }
+
       /** \brief Tell if store contains given object.
        *
        * \param pfname Filename to check.
        */
       static bool storageContains(const boost::filesystem::path &pfname)
       {
-        return g_store.exists(canonize(pfname));
+        return g_store.exists(canonize(pfname).string());
       }
 
       /** \brief Purge oldest elements from storage.
@@ -654,7 +1095,7 @@ namespace data
           BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
         }
 
-        g_store.remove(canonize(pfname));
+        g_store.remove(canonize(pfname).string());
       }
 
     public:
@@ -675,9 +1116,11 @@ namespace data
           BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
         }
 
+        thr::TimelineScope timeline("create " + pfname.extension().string(), pfname.string());
         container_type newObject = T::createImplementation(pfname, op);
+        newObject.setEvictable(op.isEvictable());
 
-        return store(pfname, newObject);
+        return *store(pfname, newObject);
       }
 
       /** \brief Access an instance.
@@ -697,6 +1140,33 @@ namespace data
         return create(pfname, op);
       }
 
+      /** \brief Get a handle to an instance.
+       *
+       * Create the instance if it's not available in storage. Unlike instanciate(), the instance can not be
+       * evicted between the lookup and the return. If another thread creates the same instance concurrently,
+       * the one stored first is returned.
+       *
+       * \param pfname File path passed to createImplementation.
+       * \param op Operand passed to createImplementation.
+       * \return Handle to existing or newly created container.
+       */
+      static handle_type instanciateHandle(const boost::filesystem::path &pfname, const S& op = S())
+      {
+        std::string name = canonize(pfname).string();
+        handle_type ret = g_store.lookup(name);
+
+        if(ret)
+        {
+          return ret;
+        }
+
+        thr::TimelineScope timeline("create " + pfname.extension().string(), pfname.string());
+        container_type newObject = T::createImplementation(pfname, op);
+        newObject.setEvictable(op.isEvictable());
+
+        return g_store.storeOrFind(name, newObject);
+      }
+
     private:
       /** \brief Function for parallel creation.
        *
@@ -719,6 +1189,19 @@ namespace data
         thr::dispatch(createParallerWorker, pfname, op);
       }
 
+      /** \brief Get a task that creates a new object.
+       *
+       * For declaring loads in a LoadGraph.
+       *
+       * \param pfname File path passed to createImplementation.
+       * \param op Operand passed to createImplementation.
+       * \return Task.
+       */
+      static thr::Task createTask(const boost::filesystem::path &pfname, const S& op = S())
+      {
+        return boost::bind(createParallerWorker, pfname, op);
+      }
+
       /** \brief Instanciate a new object in a parallel fashion.
        *
        * \param pfname File path passed to createImplementation.
@@ -2,6 +2,7 @@
 
 #include "gfx/lod.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 
 using namespace gfx;
 
@@ -28,18 +29,18 @@ namespace gfx
   }
 }
 
-static void buffer_unreserve(GLuint *op)
+static void buffer_unreserve(GLuint op)
 {
-  if(0 != *op)
-  {
-    glDeleteBuffers(1, op);
-    *op = 0;
-  }
+  glDeleteBuffers(1, &op);
 }
 
 void gfx::buffer_unreserve_dispatch(GLuint *op)
 {
-  thr::wait_privileged(&buffer_unreserve, op);
+  if(0 != *op)
+  {
+    thr::defer_privileged(&buffer_unreserve, *op);
+    *op = 0;
+  }
 }
 
 void BufferInterleavedRWTCNV::bind(const Attribute &rr, const Attribute &ww, const Attribute &tt,
@@ -121,6 +122,7 @@ void BufferInterleavedRWTCNV::upload(const std::vector<math::vec4u> &rr, const s
   this->reserve();
   this->Buffer<GL_ARRAY_BUFFER>::bind();
   glBufferData(get_buffer_type(), BLOCKSIZE * vcnt, ildata, GL_STATIC_DRAW);
+  thr::timeline_upload(BLOCKSIZE * vcnt);
   delete[] ildata;
 }
 
@@ -182,6 +184,7 @@ void BufferInterleavedTCNV::upload(const std::vector<math::vec2f> &tt, const std
   this->reserve();
   this->Buffer<GL_ARRAY_BUFFER>::bind();
   glBufferData(get_buffer_type(), BLOCKSIZE * vcnt, ildata, GL_STATIC_DRAW);
+  thr::timeline_upload(BLOCKSIZE * vcnt);
   delete[] ildata;
 }
 
@@ -234,6 +237,7 @@ void BufferInterleavedCNV::upload(const std::vector<Color> &cc, const std::vecto
   this->reserve();
   this->Buffer<GL_ARRAY_BUFFER>::bind();
   glBufferData(get_buffer_type(), BLOCKSIZE * vcnt, ildata, GL_STATIC_DRAW);
+  thr::timeline_upload(BLOCKSIZE * vcnt);
   delete[] ildata;
 }
 
@@ -285,6 +289,7 @@ void BufferInterleavedTCV::upload(const std::vector<math::vec2f> &tt, const std:
   this->reserve();
   this->Buffer<GL_ARRAY_BUFFER>::bind();
   glBufferData(get_buffer_type(), BLOCKSIZE * vcnt, ildata, GL_STATIC_DRAW);
+  thr::timeline_upload(BLOCKSIZE * vcnt);
   delete[] ildata;
 }
 
@@ -325,6 +330,7 @@ void BufferInterleavedTV::upload(const std::vector<math::vec2f> &tt, const std::
   this->reserve();
   this->Buffer<GL_ARRAY_BUFFER>::bind();
   glBufferData(get_buffer_type(), BLOCKSIZE * vcnt, ildata, GL_STATIC_DRAW);
+  thr::timeline_upload(BLOCKSIZE * vcnt);
   delete[] ildata;
 }
 
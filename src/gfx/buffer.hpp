@@ -5,6 +5,7 @@
 #include "gfx/color.hpp"
 #include "gfx/triangle.hpp"
 #include "math/vec.hpp"
+#include "thr/timeline.hpp"
 
 #include <vector>
 
@@ -13,6 +14,8 @@ namespace gfx
   class Lod;
 
   /** Buffer unreserve dispatcher.
+   *
+   * Deletion is deferred to the privileged thread, the identifier is cleared immediately.
    *
    * \param op Buffer to unreserve.
    */
@@ -168,6 +171,7 @@ namespace gfx
         this->reserve();
         this->bind();
         glBufferData(get_buffer_type(), m_array_size * sizeof(T), array.getData(), GL_STATIC_DRAW);
+        thr::timeline_upload(m_array_size * sizeof(T));
       }
 
       /** \brief Upload data to the GPU.
@@ -195,6 +199,7 @@ namespace gfx
         this->reserve();
         this->bind();
         glBufferData(get_buffer_type(), array.getSize() * sizeof(T), array.getData(), GL_STATIC_DRAW);
+        thr::timeline_upload(array.getSize() * sizeof(T));
       }
 
       /** \brief Upload a subsegment of data to the GPU.
@@ -299,6 +299,17 @@ namespace gfx
           m_array[2] * rhs,
           m_array[3] * rhs);
     }
+
+    /** \brief Equality comparison.
+     *
+     * \param rhs Right-hand-side operand.
+     * \return True if equal, false if not.
+     */
+    bool operator==(const Color &rhs) const
+    {
+      return (m_array[0] == rhs.r()) && (m_array[1] == rhs.g()) && (m_array[2] == rhs.b()) &&
+        (m_array[3] == rhs.a());
+    }
   };
 
   /** Common color. */
@@ -6,7 +6,9 @@ using namespace gfx;
 
 Entity::Entity(const math::vec3d &pos, const math::vec3d &rot) :
   m_pos(pos),
-  m_rot(rot) { }
+  m_rot(rot),
+  m_wm_prev_valid(false),
+  m_wm_stored(false) { }
 
 math::vec2f Entity::project() const
 {
@@ -31,12 +31,23 @@ namespace gfx
        */
       math::mat4f m_wm;
 
+      /** Modelview matrix of the previous simulation step. */
+      math::mat4f m_wm_prev;
+
+      /** Is the previous modelview matrix usable for interpolation? */
+      bool m_wm_prev_valid;
+
+      /** Has the modelview matrix been stored before? */
+      bool m_wm_stored;
+
     public:
       /** \brief Empty constructor.
        * 
        * Note that this will leave the positional data in unspecified values.
        */
-      Entity() { }
+      Entity() :
+        m_wm_prev_valid(false),
+        m_wm_stored(false) { }
 
       /** \brief Constructor. */
       Entity(const math::vec3d &pos, const math::vec3d &rot);
@@ -87,6 +98,23 @@ namespace gfx
         return m_wm;
       }
 
+      /** \brief Get the object matrix to render with.
+       *
+       * Interpolated between the previous and the current matrix by the render interpolation ratio if the
+       * previous matrix has been stored.
+       *
+       * \return Matrix.
+       */
+      math::mat4f getWmInterpolated() const
+      {
+        float ratio = get_interpolation();
+        if(!m_wm_prev_valid || (ratio >= 1.0f))
+        {
+          return m_wm;
+        }
+        return math::mix_rigid(m_wm_prev, m_wm, ratio);
+      }
+
       /** \brief Set the internal matrix as identity.
        *
        * This happens regardless of what the position and rotation actually are.
@@ -141,6 +169,18 @@ namespace gfx
       {
         m_wm = op;
       }
+
+      /** \brief Store the current matrix as the previous simulation step.
+       *
+       * Should be called before each simulation step for entities that are to be rendered interpolated. The
+       * matrix stored on the first call precedes the first simulation step of the entity and is not used.
+       */
+      void storeWm()
+      {
+        m_wm_prev = m_wm;
+        m_wm_prev_valid = m_wm_stored;
+        m_wm_stored = true;
+      }
   };
 }
 
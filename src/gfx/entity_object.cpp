@@ -108,7 +108,7 @@ void EntityObject::draw(const Shader &psh, const math::mat4f &pmat) const
 
 math::mat4f EntityObject::orient(const math::mat4f &pmat) const
 {
-  math::mat4f ret = pmat * m_wm;
+  math::mat4f ret = pmat * this->getWmInterpolated();
   load_transform(ret);
   return ret;
 }
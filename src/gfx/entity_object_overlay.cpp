@@ -6,7 +6,7 @@ using namespace gfx;
 
 math::mat4f EntityObjectOverlay::orient(const math::mat4f &pmat) const
 {
-  math::mat4f ret = pmat * m_wm;
+  math::mat4f ret = pmat * this->getWmInterpolated();
   load_transform(ret);
   return ret;
 }
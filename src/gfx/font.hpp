@@ -68,6 +68,21 @@ namespace gfx
       /** \brief Destructor. */
       ~Font();
 
+    public:
+      /** \brief Get the size of font textures.
+       *
+       * \return Size in bytes.
+       */
+      uint64_t getStorageSize() const
+      {
+        uint64_t ret = 0;
+        BOOST_FOREACH(const Texture2DSptr &vv, m_textures)
+        {
+          ret += vv->getStorageSize();
+        }
+        return ret;
+      }
+
     public:
       /** Gets the length of a given text line.
        *
@@ -119,6 +119,12 @@ namespace gfx
    */
   extern void clear_framebuffer(GLbitfield op);
 
+  /** \brief Get the render interpolation ratio.
+   *
+   * \return Ratio between the previous and the current simulation step.
+   */
+  extern float get_interpolation();
+
   /** \brief Set blend mode.
    *
    * \param mode New blend mode. */
@@ -149,6 +155,15 @@ namespace gfx
    * \param pheight Height.
    */
   extern void mode_scissor(int px, int py, unsigned pwidth, unsigned pheight);
+
+  /** \brief Set the render interpolation ratio.
+   *
+   * Entities that have stored their previous transformation are drawn interpolated between it and the
+   * current one by this ratio. 1 draws the current simulation step.
+   *
+   * \param op New ratio in [0, 1].
+   */
+  extern void set_interpolation(float op);
 }
 
 #endif
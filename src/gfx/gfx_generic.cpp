@@ -7,6 +7,9 @@ using namespace gfx;
 /** Current depth write state. Needed to be accessible to multiple functions. */
 static Mode current_depth_write_state = gfx::INVALID;
 
+/** Current render interpolation ratio. */
+static float current_interpolation = 1.0f;
+
 /** \brief Turn blending on/off.
  *
  * \param state New state. */
@@ -158,6 +161,11 @@ void gfx::clear_framebuffer(GLbitfield op)
   }
 }
 
+float gfx::get_interpolation()
+{
+  return current_interpolation;
+}
+
 void gfx::mode_blend(Mode mode)
 {
   static Mode current_mode = INVALID;
@@ -313,3 +321,8 @@ void gfx::mode_scissor(int px, int py, unsigned pwidth, unsigned pheight)
 
   glScissor(px, py, static_cast<GLsizei>(pwidth), static_cast<GLsizei>(pheight));
 }
+
+void gfx::set_interpolation(float op)
+{
+  current_interpolation = op;
+}
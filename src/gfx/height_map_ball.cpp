@@ -1,7 +1,110 @@
 #include "gfx/height_map_ball.hpp"
 
+#include "data/generic.hpp"
+#include "data/log.hpp"
+#include "thr/task_group.hpp"
+
+#include <sstream>
+#include <vector>
+
 using namespace gfx;
 
+/** Number of points processed at once in batch sampling. */
+static const unsigned HEIGHT_BATCH = 64;
+
+/** \brief Round to nearest for texel lookups.
+ *
+ * Rounding is done in double precision where adding one half is exact, so
+ * the result equals math::lround() for all non-negative inputs. Negative
+ * inputs are clamped to zero by the caller either way.
+ *
+ * \param op Value to round.
+ * \return Rounded value.
+ */
+static inline int texel_round(float op)
+{
+  return static_cast<int>(static_cast<double>(op) + 0.5);
+}
+
+/** \brief Get direction of a point on a normal cube map face.
+ *
+ * \param face Cube face index.
+ * \param ss First face coordinate [-1, 1].
+ * \param tt Second face coordinate [-1, 1].
+ * \return Direction (not normalized).
+ */
+static math::vec3f cube_direction(unsigned face, float ss, float tt)
+{
+  switch(face)
+  {
+    case 0:
+      return math::vec3f(1.0f, tt, ss);
+
+    case 1:
+      return math::vec3f(-1.0f, tt, ss);
+
+    case 2:
+      return math::vec3f(ss, 1.0f, tt);
+
+    case 3:
+      return math::vec3f(ss, -1.0f, tt);
+
+    case 4:
+      return math::vec3f(ss, tt, 1.0f);
+
+    case 5:
+    default:
+      return math::vec3f(ss, tt, -1.0f);
+  }
+}
+
+/** \brief Convert a normal cube map face coordinate into a texel index.
+ *
+ * \param op Face coordinate [-1, 1].
+ * \param side Face side length.
+ * \return Texel index.
+ */
+static unsigned cube_texel(float op, unsigned side)
+{
+  int ret = static_cast<int>((op + 1.0f) * 0.5f * static_cast<float>(side));
+  return static_cast<unsigned>(std::max(std::min(ret, static_cast<int>(side) - 1), 0));
+}
+
+/** \brief Get a basis vector for gradient directions around a surface point.
+ *
+ * The world up axis is used unless the point is close to a pole, where the
+ * cross product with it would degenerate.
+ *
+ * \param op Surface point.
+ * \return Vector not parallel to op.
+ */
+static inline math::vec3d normal_basis(const math::vec3d &op)
+{
+  if(math::abs(op.y()) > math::length(op) * 0.9)
+  {
+    return math::vec3d(1.0, 0.0, 0.0);
+  }
+  return math::vec3d(0.0, 1.0, 0.0);
+}
+
+/** \brief Sample a height face.
+ *
+ * Same as ImageGray8::getHeightValue(), but inlined for batch sampling.
+ *
+ * \param img Face image.
+ * \param px Image x.
+ * \param py Image y.
+ * \return Heightfield value [0, 1].
+ */
+static inline float sample_height(const ImageGray8 &img, float px, float py)
+{
+  int rx = texel_round(px * static_cast<float>(img.getWidth() - 1)),
+      ry = texel_round(py * static_cast<float>(img.getHeight() - 1));
+  rx = std::max(std::min(rx, static_cast<int>(img.getWidth())), 0);
+  ry = std::max(std::min(ry, static_cast<int>(img.getHeight())), 0);
+  return img.getLuminance(static_cast<unsigned>(rx), static_cast<unsigned>(ry));
+}
+
 HeightMapBall::HeightMapBall(const std::string &pbk, const std::string &pdn,
     const std::string &pfw, const std::string &plt,
     const std::string &prt, const std::string &pup, float pmin, float pmax) :
@@ -12,7 +115,128 @@ HeightMapBall::HeightMapBall(const std::string &pbk, const std::string &pdn,
   m_rt(prt),
   m_up(pup),
   m_min(pmin),
-  m_max(pmax) { }
+  m_max(pmax),
+  m_normal_gdist(0.0f) { }
+
+void HeightMapBall::buildNormalRow(unsigned face, unsigned row)
+{
+  ImageRGB &img = *(m_normal[face]);
+  unsigned side = img.getWidth();
+  float fside = static_cast<float>(side),
+        tt = (static_cast<float>(row) + 0.5f) / fside * 2.0f - 1.0f;
+  std::vector<math::vec3f> pnt(side),
+    nn(side);
+  std::vector<float> ht(side);
+
+  for(unsigned ii = 0; (ii < side); ++ii)
+  {
+    float ss = (static_cast<float>(ii) + 0.5f) / fside * 2.0f - 1.0f;
+    pnt[ii] = math::normalize(cube_direction(face, ss, tt));
+  }
+
+  this->calcHeight(&pnt.front(), &ht.front(), side);
+  this->calcNormal(&pnt.front(), &ht.front(), m_normal_gdist, &nn.front(), side);
+
+  for(unsigned ii = 0; (ii < side); ++ii)
+  {
+    math::vec3f col = nn[ii] * 0.5f + 0.5f;
+    img.setPixel(ii, row,
+        static_cast<uint8_t>(math::lround(col.x() * 255.0f)),
+        static_cast<uint8_t>(math::lround(col.y() * 255.0f)),
+        static_cast<uint8_t>(math::lround(col.z() * 255.0f)));
+  }
+}
+
+void HeightMapBall::loadNormals(unsigned side, float gdist, const std::string &fname_header, bool psave)
+{
+  std::string fnames[6];
+  bool built = false;
+  thr::TaskGroup group;
+
+  m_normal_gdist = gdist;
+
+  for(unsigned ii = 0; (ii < 6); ++ii)
+  {
+    {
+      std::ostringstream sstream_fname;
+      sstream_fname << fname_header << "_normal_" << side << "_" << ii << ".png";
+      fnames[ii] = sstream_fname.str();
+    }
+
+    if(data::file_exists(fnames[ii]))
+    {
+      m_normal[ii] = ImageRGBSptr(new ImageRGB(fnames[ii], ImageLoader().noPremultiplyAlpha()));
+      if((m_normal[ii]->getWidth() == side) && (m_normal[ii]->getHeight() == side))
+      {
+        continue;
+      }
+    }
+
+    {
+      std::stringstream sstr;
+      sstr << "creating normal map " << ii;
+      data::log(sstr.str());
+    }
+    m_normal[ii] = ImageRGBSptr(new ImageRGB(side, side));
+    for(unsigned jj = 0; (jj < side); ++jj)
+    {
+      group.dispatch(&HeightMapBall::buildNormalRow, this, ii, jj);
+    }
+    built = true;
+  }
+
+  if(!built)
+  {
+    return;
+  }
+  group.wait();
+
+  if(psave)
+  {
+    for(unsigned ii = 0; (ii < 6); ++ii)
+    {
+      std::stringstream sstr;
+      sstr << "saving " << fnames[ii];
+      data::log(sstr.str());
+      m_normal[ii]->write(fnames[ii]);
+    }
+  }
+}
+
+math::vec3f HeightMapBall::lookupNormal(const math::vec3f &pnt) const
+{
+  math::vec3f aa(math::abs(pnt.x()), math::abs(pnt.y()), math::abs(pnt.z()));
+  unsigned face;
+  float ss,
+        tt;
+
+  if((aa.x() >= aa.y()) && (aa.x() >= aa.z()))
+  {
+    face = (pnt.x() < 0.0f) ? 1 : 0;
+    ss = pnt.z() / aa.x();
+    tt = pnt.y() / aa.x();
+  }
+  else if(aa.y() >= aa.z())
+  {
+    face = (pnt.y() < 0.0f) ? 3 : 2;
+    ss = pnt.x() / aa.y();
+    tt = pnt.z() / aa.y();
+  }
+  else
+  {
+    face = (pnt.z() < 0.0f) ? 5 : 4;
+    ss = pnt.x() / aa.z();
+    tt = pnt.y() / aa.z();
+  }
+
+  const ImageRGB &img = *(m_normal[face]);
+  const uint8_t *iter = img.getData() + ((cube_texel(tt, img.getHeight()) * img.getWidth() +
+        cube_texel(ss, img.getWidth())) * 3);
+  math::vec3f ret(static_cast<float>(iter[0]),
+      static_cast<float>(iter[1]),
+      static_cast<float>(iter[2]));
+  return math::normalize(ret * (2.0f / 255.0f) - 1.0f);
+}
 
 math::vec3f HeightMapBall::calcNormal(const math::vec3f &pnt, float gdist) const
 {
@@ -22,7 +246,7 @@ math::vec3f HeightMapBall::calcNormal(const math::vec3f &pnt, float gdist) const
 math::vec3f HeightMapBall::calcNormal(const math::vec3f &pnt, float gdist, float ht) const
 {
   math::vec3d vv(this->normalizeHeight(pnt, ht)),
-    up(0.0, 1.0, 0.0), // TODO: fix
+    up(normal_basis(vv)),
     vd1(math::normalize(math::cross(up, vv))),
     vd2(math::normalize(math::cross(vv, vd1))),
     vd3(math::normalize(math::cross(vv, vd2))),
@@ -41,11 +265,89 @@ math::vec3f HeightMapBall::calcNormal(const math::vec3f &pnt, float gdist, float
   return math::vec3f(math::normalize(nn1 + nn2 + nn3 + nn4));
 }
 
+void HeightMapBall::calcNormal(const math::vec3f *pnt, const float *ht, float gdist, math::vec3f *ret,
+    unsigned count) const
+{
+  math::vec3d grad[HEIGHT_BATCH * 4];
+  math::vec3f grad_pnt[HEIGHT_BATCH * 4];
+  float grad_ht[HEIGHT_BATCH * 4];
+
+  for(unsigned ii = 0; (ii < count); ii += HEIGHT_BATCH)
+  {
+    unsigned cnt = std::min(count - ii, HEIGHT_BATCH);
+
+    for(unsigned jj = 0; (jj < cnt); ++jj)
+    {
+      const math::vec3f &pp = pnt[ii + jj];
+      math::vec3d vv(this->normalizeHeight(pp, ht[ii + jj])),
+        up(normal_basis(vv)),
+        vd1(math::normalize(math::cross(up, vv))),
+        vd2(math::normalize(math::cross(vv, vd1))),
+        vd3(math::normalize(math::cross(vv, vd2))),
+        vd4(math::normalize(math::cross(vv, vd3)));
+      math::vec3d *gg = grad + jj * 4;
+
+      gg[0] = vd1 * gdist + pp;
+      gg[1] = vd2 * gdist + pp;
+      gg[2] = vd3 * gdist + pp;
+      gg[3] = vd4 * gdist + pp;
+    }
+    for(unsigned jj = 0; (jj < cnt * 4); ++jj)
+    {
+      grad_pnt[jj] = math::vec3f(grad[jj]);
+    }
+
+    // All gradient points of the block are sampled in one virtual call.
+    this->calcHeight(grad_pnt, grad_ht, cnt * 4);
+
+    for(unsigned jj = 0; (jj < cnt); ++jj)
+    {
+      const math::vec3f &pp = pnt[ii + jj];
+      const math::vec3d *gg = grad + jj * 4;
+      const float *hh = grad_ht + jj * 4;
+      math::vec3d vd1(this->normalizeHeight(gg[0], hh[0]) - pp),
+        vd2(this->normalizeHeight(gg[1], hh[1]) - pp),
+        vd3(this->normalizeHeight(gg[2], hh[2]) - pp),
+        vd4(this->normalizeHeight(gg[3], hh[3]) - pp);
+
+      math::vec3d nn1(math::cross(vd1, vd2)),
+        nn2(math::cross(vd2, vd3)),
+        nn3(math::cross(vd3, vd4)),
+        nn4(math::cross(vd4, vd1));
+
+      ret[ii + jj] = math::vec3f(math::normalize(nn1 + nn2 + nn3 + nn4));
+    }
+  }
+}
+
 float HeightMapBall::calcHeight(const math::vec3f &pnt) const
 {
   return this->calcHeightNormalized(math::normalize(pnt));
 }
 
+void HeightMapBall::calcHeight(const math::vec3f *pnt, float *ret, unsigned count) const
+{
+  math::vec3f nor[HEIGHT_BATCH];
+
+  for(unsigned ii = 0; (ii < count); ii += HEIGHT_BATCH)
+  {
+    unsigned cnt = std::min(count - ii, HEIGHT_BATCH);
+    for(unsigned jj = 0; (jj < cnt); ++jj)
+    {
+      nor[jj] = math::normalize(pnt[ii + jj]);
+    }
+    this->calcHeightNormalized(nor, ret + ii, cnt);
+  }
+}
+
+void HeightMapBall::calcTerrain(const math::vec3f *pnt, float *ret, unsigned count) const
+{
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    ret[ii] = this->calcTerrain(pnt[ii]);
+  }
+}
+
 float HeightMapBall::calcHeightNormalized(const math::vec3f &vv) const
 {
   math::vec3f off(vv * 0.5f + 0.5f),
@@ -100,6 +402,66 @@ float HeightMapBall::calcHeightNormalized(const math::vec3f &vv) const
   return ret;
 }
 
+void HeightMapBall::calcHeightNormalized(const math::vec3f *pnt, float *ret, unsigned count) const
+{
+  const ImageGray8 *face_x[HEIGHT_BATCH],
+        *face_y[HEIGHT_BATCH],
+        *face_z[HEIGHT_BATCH];
+  math::vec3f off[HEIGHT_BATCH],
+    wt[HEIGHT_BATCH],
+    rad[HEIGHT_BATCH];
+
+  // Face selection, sampling and blending are done in separate passes over a block of points so that the
+  // arithmetic passes stay free of lookups.
+  for(unsigned ii = 0; (ii < count); ii += HEIGHT_BATCH)
+  {
+    const math::vec3f *vv = pnt + ii;
+    unsigned cnt = std::min(count - ii, HEIGHT_BATCH);
+
+    for(unsigned jj = 0; (jj < cnt); ++jj)
+    {
+      off[jj] = vv[jj] * 0.5f + 0.5f;
+      wt[jj] = math::vec3f((vv[jj].x() < 0.0f) ? -vv[jj].x() : vv[jj].x(),
+          (vv[jj].y() < 0.0f) ? -vv[jj].y() : vv[jj].y(),
+          (vv[jj].z() < 0.0f) ? -vv[jj].z() : vv[jj].z());
+      face_x[jj] = (vv[jj].x() < 0.0f) ? &m_lt : &m_rt;
+      face_y[jj] = (vv[jj].y() < 0.0f) ? &m_dn : &m_up;
+      face_z[jj] = (vv[jj].z() < 0.0f) ? &m_fw : &m_bk;
+    }
+
+    for(unsigned jj = 0; (jj < cnt); ++jj)
+    {
+      rad[jj] = math::vec3f(sample_height(*(face_x[jj]), off[jj].z(), off[jj].y()),
+          sample_height(*(face_y[jj]), off[jj].x(), off[jj].z()),
+          sample_height(*(face_z[jj]), off[jj].x(), off[jj].y()));
+    }
+
+    for(unsigned jj = 0; (jj < cnt); ++jj)
+    {
+      float sum = wt[jj].x() + wt[jj].y() + wt[jj].z(),
+            ht = math::dot(wt[jj], rad[jj]) / sum;
+      ret[ii + jj] = math::min(math::max(ht, 0.0f), 1.0f);
+    }
+  }
+}
+
+void HeightMapBall::normalizeHeight(const math::vec3f *pnt, math::vec3f *ret, unsigned count) const
+{
+  if(!count)
+  {
+    return;
+  }
+
+  std::vector<float> ht(count);
+
+  this->calcHeight(pnt, &ht.front(), count);
+
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    ret[ii] = this->normalizeHeight(pnt[ii], ht[ii]);
+  }
+}
+
 math::vec3f HeightMapBall::normalizeHeight(const math::vec3f &vv) const
 {
   return this->normalizeHeight(vv, this->calcHeight(vv));
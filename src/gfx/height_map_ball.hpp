@@ -32,6 +32,12 @@ namespace gfx
       /** Height field high point. */
       float m_max;
 
+      /** Normal cube map faces (+X, -X, +Y, -Y, +Z, -Z), empty if not built. */
+      ImageRGBSptr m_normal[6];
+
+      /** Gradient distance the normal cube map was built with. */
+      float m_normal_gdist;
+
     public:
       /** \brief Ball heightmap constructor.
        *
@@ -50,6 +56,50 @@ namespace gfx
       /** \brief Destructor. */
       virtual ~HeightMapBall() { }
 
+    private:
+      /** \brief Build one row of the normal cube map.
+       *
+       * \param face Cube face index.
+       * \param row Row to build.
+       */
+      void buildNormalRow(unsigned face, unsigned row);
+
+    public:
+      /** \brief Load or build the normal cube map.
+       *
+       * Faces are loaded from disk if they exist. Missing faces are built
+       * with calcNormal() in parallel, one task per row. Waits for all
+       * outstanding tasks as thr::wait() does.
+       *
+       * Must not be called from the constructor, since building uses the
+       * virtual height functions.
+       *
+       * \param side Face side length.
+       * \param gdist Gradient distance.
+       * \param fname_header Prefix for filenames used for loading and saving.
+       * \param psave True to save faces after generation.
+       */
+      void loadNormals(unsigned side, float gdist, const std::string &fname_header, bool psave = false);
+
+      /** \brief Tell if the normal cube map is usable.
+       *
+       * \param gdist Gradient distance the caller would use in calcNormal().
+       * \return True if the normal cube map has been built with given distance.
+       */
+      bool hasNormals(float gdist) const
+      {
+        return m_normal[0] && (m_normal_gdist == gdist);
+      }
+
+      /** \brief Look up a normal from the normal cube map.
+       *
+       * Nearest texel lookup, only valid if the normal cube map has been built.
+       *
+       * \param pnt Point vector.
+       * \return Normal value at given point.
+       */
+      math::vec3f lookupNormal(const math::vec3f &pnt) const;
+
     public:
       /** \brief Calculate height in a point.
        *
@@ -110,6 +160,40 @@ namespace gfx
        */
       math::vec3d normalizeHeight(const math::vec3d &vv, float ht) const;
 
+    public:
+      /** \brief Calculate heights for a batch of points.
+       *
+       * Assumes input already normalized to ball surface. Results are
+       * identical to calling the single-point version for each point.
+       *
+       * \param pnt Point vectors.
+       * \param ret Heightmap values are written here.
+       * \param count Number of points.
+       */
+      void calcHeightNormalized(const math::vec3f *pnt, float *ret, unsigned count) const;
+
+      /** \brief Calculate surface gradients for a batch of points.
+       *
+       * Samples the heights of all gradient points in one batch. Results are
+       * identical to calling the single-point version for each point.
+       *
+       * \param pnt Point vectors.
+       * \param ht Height values at given points.
+       * \param gdist Gradient distance.
+       * \param ret Normals are written here.
+       * \param count Number of points.
+       */
+      void calcNormal(const math::vec3f *pnt, const float *ht, float gdist, math::vec3f *ret,
+          unsigned count) const;
+
+      /** \brief Normalize heights of a batch of vertices.
+       *
+       * \param pnt Vertices to scale to correct level.
+       * \param ret Normalized vertices are written here, may be same as input.
+       * \param count Number of vertices.
+       */
+      void normalizeHeight(const math::vec3f *pnt, math::vec3f *ret, unsigned count) const;
+
     public:
       /** \brief Calculate height in a point.
        *
@@ -118,6 +202,16 @@ namespace gfx
        */
       virtual float calcHeight(const math::vec3f &pnt) const;
 
+      /** \brief Calculate heights for a batch of points.
+       *
+       * Must give the same results as the single-point version.
+       *
+       * \param pnt Point vectors.
+       * \param ret Heightmap values are written here.
+       * \param count Number of points.
+       */
+      virtual void calcHeight(const math::vec3f *pnt, float *ret, unsigned count) const;
+
     public:
       /** \brief Calculate teerrain level in a point.
        *
@@ -125,6 +219,16 @@ namespace gfx
        * \return Heightmap value at given point.
        */
       virtual float calcTerrain(const math::vec3f &pnt) const = 0;
+
+      /** \brief Calculate terrain levels for a batch of points.
+       *
+       * Default implementation calls the single-point version for each point.
+       *
+       * \param pnt Point vectors.
+       * \param ret Terrain values are written here.
+       * \param count Number of points.
+       */
+      virtual void calcTerrain(const math::vec3f *pnt, float *ret, unsigned count) const;
   };
 }
 
@@ -1,8 +1,12 @@
 #include "gfx/image.hpp"
 
 #include "data/generic.hpp"
+#include "data/log.hpp"
+#include "data/pack.hpp"
+#include "data/raw_cache.hpp"
 #include "gfx/image_jpeg.hpp"
 #include "gfx/image_png.hpp"
+#include "thr/timeline.hpp"
 
 #include <sstream>
 
@@ -23,12 +27,14 @@ void Image::loadBase(const boost::filesystem::path &pfname, const ImageLoader &l
 
   this->unreserve();
 
-  boost::filesystem::path location = data::open_search(pfname);
+  data::MappedFile mapped(pfname);
+  thr::timeline_read(mapped.getSize());
   if(data::filename_is_png(pfname))
   {
     if(image_png_supports_bpp(reqbpp))
     {
-      image_png_load(m_w, m_h, m_b, m_data, location.generic_string(), reqbpp);
+      image_png_load(m_w, m_h, m_b, m_data, pfname.generic_string(),
+          mapped.getData(), mapped.getSize(), reqbpp);
       m_filename = pfname;
     }
     else
@@ -42,7 +48,8 @@ void Image::loadBase(const boost::filesystem::path &pfname, const ImageLoader &l
   {
     if(image_jpeg_supports_bpp(reqbpp))
     {
-      image_jpeg_load(m_w, m_h, m_b, m_data, location.generic_string(), reqbpp);
+      image_jpeg_load(m_w, m_h, m_b, m_data, pfname.generic_string(),
+          mapped.getData(), mapped.getSize(), reqbpp);
       m_filename = pfname;
     }
     else
@@ -107,11 +114,11 @@ void Image::write(const boost::filesystem::path &pfname)
 
 Image* Image::create(const boost::filesystem::path &pfname, const ImageLoader &loader)
 {
-  boost::filesystem::path location = data::open_search(pfname);
+  data::MappedFile mapped(pfname);
 
   if(data::filename_is_png(pfname))
   {
-    unsigned bpp = image_png_probe(location.generic_string(), false);
+    unsigned bpp = image_png_probe(pfname.generic_string(), mapped.getData(), mapped.getSize(), false);
 
     switch(bpp)
     {
@@ -139,7 +146,7 @@ Image* Image::create(const boost::filesystem::path &pfname, const ImageLoader &l
   }
   else if(data::filename_is_jpeg(pfname))
   {
-    unsigned bpp = image_jpeg_probe(location.generic_string(), false);
+    unsigned bpp = image_jpeg_probe(pfname.generic_string(), mapped.getData(), mapped.getSize(), false);
 
     switch(bpp)
     {
@@ -252,3 +259,23 @@ void ImageRGBA::premultiplyAlpha()
   }
 }
 
+uint64_t gfx::image_cache_key(const fs::path &pfname, const ImageLoader &loader)
+{
+  uint8_t premultiply = loader.hasPremultiplyAlpha() ? 1 : 0;
+  return data::hash_data(&premultiply, 1, data::hash_file(pfname));
+}
+
+void gfx::image_cache_write(const fs::path &pfname, uint64_t key, unsigned pw, unsigned ph, unsigned pd,
+    unsigned pb, const void *pdata)
+{
+  try
+  {
+    data::raw_cache_write(pfname, key, pw, ph, pd, pb, pdata);
+  }
+  catch(const std::exception &err)
+  {
+    std::stringstream sstr;
+    sstr << "could not write cache " << pfname << ": " << err.what();
+    data::log(sstr.str());
+  }
+}
@@ -558,6 +558,33 @@ namespace gfx
 
   /** Convenience typedef. */
   typedef boost::shared_ptr<ImageRGBA> ImageRGBASptr;
+
+  /** \brief Get raw cache key for an image file.
+   *
+   * Combines the hash of the source file with the loader settings that
+   * affect decoded data.
+   *
+   * \param pfname Source filename.
+   * \param loader Loader settings.
+   * \return Cache key.
+   */
+  extern uint64_t image_cache_key(const boost::filesystem::path &pfname, const ImageLoader &loader);
+
+  /** \brief Write raw cache for decoded or generated data.
+   *
+   * Failure to write is logged but not fatal, since the data directory may
+   * be read-only.
+   *
+   * \param pfname Cache filename.
+   * \param key Cache key.
+   * \param pw Width.
+   * \param ph Height.
+   * \param pd Depth.
+   * \param pb Bit depth.
+   * \param pdata Data.
+   */
+  extern void image_cache_write(const boost::filesystem::path &pfname, uint64_t key, unsigned pw, unsigned ph,
+      unsigned pd, unsigned pb, const void *pdata);
 }
 
 #endif
@@ -12,9 +12,6 @@
 class JpegReader
 {
   public:
-    /** File handle. */
-    FILE *m_fd;
-
     /** JPEG decompress struct. */
     struct jpeg_decompress_struct m_decompress;
 
@@ -27,35 +24,23 @@ class JpegReader
   public:
     /** \brief Constructor.
      *
-     * \param filename File to open.
+     * \param src Source data.
+     * \param src_size Source data size.
      */ 
-    JpegReader(const std::string &filename) :
+    JpegReader(const uint8_t *src, size_t src_size) :
       m_block(NULL)
     {
-      m_fd = fopen(filename.c_str(), "rb");
-      if(NULL == m_fd)
-      {
-        std::stringstream sstr;
-        sstr << "could not open '" << filename << "' for reading";
-        BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
-      }
-
       m_decompress.err = jpeg_std_error(&m_err);
       jpeg_create_decompress(&m_decompress);
-      jpeg_stdio_src(&m_decompress, m_fd);
+      // source is only read from, older libjpeg versions just lack the const
+      jpeg_mem_src(&m_decompress, const_cast<unsigned char*>(src), static_cast<unsigned long>(src_size));
     }
 
     /** \brief Destructor.
      */
     ~JpegReader()
     {
-      if(NULL != m_fd)
-      {
-        fclose(m_fd);
-
-        // decompress struct may only be reserved if file was properly opened
-        jpeg_destroy_decompress(&m_decompress);
-      }
+      jpeg_destroy_decompress(&m_decompress);
 
       if(NULL != m_block)
       {
@@ -283,9 +268,10 @@ class JpegWriter
 
 namespace gfx
 {
-  unsigned image_jpeg_probe(const std::string &filename, bool require_volume)
+  unsigned image_jpeg_probe(const std::string &filename, const uint8_t *src, size_t src_size,
+      bool require_volume)
   {
-    JpegReader reader(filename);
+    JpegReader reader(src, src_size);
 
     reader.readHeader();
 
@@ -309,9 +295,9 @@ namespace gfx
   }
 
   void image_jpeg_load_extended(unsigned &pw, unsigned &ph, unsigned &pd, unsigned &pb, uint8_t *&pdata,
-      const std::string &filename, unsigned required_bpp)
+      const std::string &filename, const uint8_t *src, size_t src_size, unsigned required_bpp)
   {
-    JpegReader reader(filename);
+    JpegReader reader(src, src_size);
 
     reader.readHeader();
     unsigned width = reader.getWidth(),
@@ -358,11 +344,11 @@ namespace gfx
   }
 
   void image_jpeg_load(unsigned &pw, unsigned &ph, unsigned &pb, uint8_t *&pdata, const std::string &filename,
-      unsigned required_bpp)
+      const uint8_t *src, size_t src_size, unsigned required_bpp)
   {
     unsigned depth = 0;
 
-    image_jpeg_load_extended(pw, ph, depth, pb, pdata, filename, required_bpp);
+    image_jpeg_load_extended(pw, ph, depth, pb, pdata, filename, src, src_size, required_bpp);
 
     if(depth != 0)
     {
@@ -22,6 +22,9 @@ namespace gfx
       /** Premultiply alpha off. */
       static const uint32_t NO_PREMULTIPLY_ALPHA = 0x8;
 
+      /** Use raw cache for decoded data. */
+      static const uint32_t CACHE = 0x10;
+
     private:
       /** Anisotropy requested from the image, default: 2.0f. */
       float m_anisotropy;
@@ -52,6 +55,15 @@ namespace gfx
         return m_anisotropy;
       }
 
+      /** \brief Is raw cache on?
+       *
+       * \return True if yes, false if no.
+       */
+      bool hasCache() const
+      {
+        return this->hasFlag(CACHE);
+      }
+
       /** \brief Is clamp on?
        *
        * \return True if yes, false if no.
@@ -97,6 +109,19 @@ namespace gfx
         return !this->hasFlag(CLAMP);
       }
 
+      /** \brief Turn raw cache on.
+       *
+       * Decoded data is stored into a raw cache file next to the source file
+       * and loaded from there as long as the source does not change.
+       *
+       * \return Reference to this with raw cache turned on.
+       */
+      ImageLoader& cache()
+      {
+        this->setFlag(CACHE);
+        return *this;
+      }
+
       /** \brief Turn clamp on.
        *
        * \return A copy of this with clamp turned on.
@@ -107,6 +132,19 @@ namespace gfx
         return *this;
       }
 
+      /** \brief Allow eviction from the store.
+       *
+       * The texture may be evicted when the store is over budget and no mesh
+       * references it.
+       *
+       * \return Reference to this with eviction allowed.
+       */
+      ImageLoader& evictable()
+      {
+        this->setEvictable();
+        return *this;
+      }
+
       /** \brief Turn generate mipmaps on.
        *
        * \return Reference to this with generate mipmaps turned on.
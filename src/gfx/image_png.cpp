@@ -47,34 +47,52 @@ static uint8_t bpp_to_png_color_type(unsigned bpp)
   return PNG_COLOR_TYPE_GRAY;
 }
 
-/** \brief Read PNG header.
+/** \brief Memory source for reading PNG data.
+ */
+struct PngSource
+{
+  /** Source data. */
+  const uint8_t *m_data;
+
+  /** Source data size. */
+  size_t m_size;
+
+  /** Read position. */
+  size_t m_pos;
+};
+
+/** \brief Check PNG header.
  *
- * \param filename Filename to open.
- * \return File stream to after the header.
+ * \param filename Filename for error messages.
+ * \param src Source data.
+ * \param src_size Source data size.
  */
-static FILE* png_read_header(const std::string &filename)
+static void png_check_header(const std::string &filename, const uint8_t *src, size_t src_size)
 {
-    FILE *fd = fopen(filename.c_str(), "rb");
-    if(!fd)
-    {
-      std::stringstream sstr;
-      sstr << "could not open '" << filename << '\'';
-      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
-    }
+  if((src_size < 8) || png_sig_cmp(const_cast<uint8_t*>(src), 0, 8))
+  {
+    std::stringstream sstr;
+    sstr << "not a PNG file: " << filename;
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+}
 
-    {
-      uint8_t header[8];
-      fread(header, 1, 8, fd);
-      if(png_sig_cmp(header, 0, 8))
-      {
-        fclose(fd);
-        std::stringstream sstr;
-        sstr << "not a PNG file: " << filename;
-        BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
-      }
-    }
+/** \brief PNG read callback reading from memory.
+ *
+ * \param png_ptr PNG pointer.
+ * \param data Destination data.
+ * \param length Number of bytes to read.
+ */
+static void png_read_memory(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+  PngSource *source = static_cast<PngSource*>(png_get_io_ptr(png_ptr));
 
-    return fd;
+  if(source->m_size - source->m_pos < length)
+  {
+    png_error(png_ptr, "read past end of PNG data");
+  }
+  memcpy(data, source->m_data + source->m_pos, length);
+  source->m_pos += length;
 }
 
 /** Wrapper for png_set_text.
@@ -114,8 +132,8 @@ static void png_set_text_map(png_structp png_ptr, png_infop info_ptr,
 class PngReader
 {
   private:
-    /** File handle. */
-    FILE *m_fd;
+    /** Memory source. */
+    PngSource m_source;
 
     /** PNG read struct. */
     png_struct *m_png;
@@ -137,16 +155,20 @@ class PngReader
   public:
     /** \brief Constructor.
      *
-     * \param fd File handle to adapt.
-     * \param skip How many bytes of file have already been read
+     * \param src Source data.
+     * \param src_size Source data size.
+     * \param skip How many bytes of the source have already been checked.
      */
-    PngReader(FILE *fd, unsigned skip) :
-      m_fd(fd),
+    PngReader(const uint8_t *src, size_t src_size, unsigned skip) :
       m_png(NULL),
       m_info(NULL),
       m_end(NULL),
       m_block(NULL)
     {
+      m_source.m_data = src;
+      m_source.m_size = src_size;
+      m_source.m_pos = skip;
+
       m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
       if(!m_png)
       {
@@ -172,7 +194,7 @@ class PngReader
       png_byte keep_chunks[] = { 0 };
       png_set_keep_unknown_chunks(m_png, PNG_HANDLE_CHUNK_NEVER, keep_chunks, 0);
 
-      png_init_io(m_png, m_fd); 
+      png_set_read_fn(m_png, &m_source, png_read_memory);
       png_set_sig_bytes(m_png, static_cast<int>(skip));
     }
 
@@ -181,7 +203,6 @@ class PngReader
     {
       delete[] m_block;
       png_destroy_read_struct(&m_png, &m_info, &m_end);
-      fclose(m_fd);
     }
 
   public:
@@ -404,10 +425,10 @@ class PngWriter
 
 namespace gfx
 {
-  unsigned image_png_probe(const std::string &filename, bool require_volume)
+  unsigned image_png_probe(const std::string &filename, const uint8_t *src, size_t src_size, bool require_volume)
   {
-    FILE *fd = png_read_header(filename);
-    PngReader reader(fd, 8);
+    png_check_header(filename, src, src_size);
+    PngReader reader(src, src_size, 8);
 
     // error handling in libpng is retarded
     if(setjmp(png_jmpbuf(reader.getPng())))
@@ -439,10 +460,10 @@ namespace gfx
   }
 
   void image_png_load_extended(unsigned &pw, unsigned &ph, unsigned &pd, unsigned &pb, uint8_t *&pdata,
-      const std::string &filename, unsigned required_bpp)
+      const std::string &filename, const uint8_t *src, size_t src_size, unsigned required_bpp)
   {
-    FILE *fd = png_read_header(filename);
-    PngReader reader(fd, 8);
+    png_check_header(filename, src, src_size);
+    PngReader reader(src, src_size, 8);
 
     // error handling in libpng is still retarded
     if(setjmp(png_jmpbuf(reader.getPng())))
@@ -497,11 +518,11 @@ namespace gfx
   }
 
   void image_png_load(unsigned &pw, unsigned &ph, unsigned &pb, uint8_t *&pdata, const std::string &filename,
-      unsigned required_bpp)
+      const uint8_t *src, size_t src_size, unsigned required_bpp)
   {
     unsigned depth;
 
-    image_png_load_extended(pw, ph, depth, pb, pdata, filename, required_bpp);
+    image_png_load_extended(pw, ph, depth, pb, pdata, filename, src, src_size, required_bpp);
 
     if(depth != 0)
     {
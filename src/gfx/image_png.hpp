@@ -1,6 +1,7 @@
 #ifndef GFX_IMAGE_PNG_HPP
 #define GFX_IMAGE_PNG_HPP
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string>
 
@@ -18,11 +19,14 @@ namespace gfx
 
   /** \brief Probe PNG file.
    *
-   * \param pfname Filename to probe.
-   * \param Required to be a volume?
+   * \param filename Source filename, for error messages.
+   * \param src Source data.
+   * \param src_size Source data size.
+   * \param require_volume Required to be a volume?
    * \return Bit depth found.
    */
-  extern unsigned image_png_probe(const std::string &filename, bool require_volume = false);
+  extern unsigned image_png_probe(const std::string &filename, const uint8_t *src, size_t src_size,
+      bool require_volume = false);
 
   /** \brief Read a PNG image.
    *
@@ -35,11 +39,13 @@ namespace gfx
    * \param ph Destination height.
    * \param pb Destiantion bit depth.
    * \param pdata Destination data.
-   * \param filename Source filename.
+   * \param filename Source filename, for error messages.
+   * \param src Source data.
+   * \param src_size Source data size.
    * \param required_bpp If set, require this bit depth.
    */
   extern void image_png_load(unsigned &pw, unsigned &ph, unsigned &pb, uint8_t *&pdata,
-      const std::string &filename, unsigned required_bpp = 0);
+      const std::string &filename, const uint8_t *src, size_t src_size, unsigned required_bpp = 0);
 
   /** \brief Read an 'extended' PNG image with depth axis.
    *
@@ -53,11 +59,13 @@ namespace gfx
    * \param pd Destination depth.
    * \param pb Destiantion bit depth.
    * \param pdata Destination data.
-   * \param filename Source filename.
+   * \param filename Source filename, for error messages.
+   * \param src Source data.
+   * \param src_size Source data size.
    * \param required_bpp If set, require this bit depth.
    */
   extern void image_png_load_extended(unsigned &pw, unsigned &ph, unsigned &pd, unsigned &pb, uint8_t *&pdata,
-      const std::string &filename, unsigned required_bpp = 0);
+      const std::string &filename, const uint8_t *src, size_t src_size, unsigned required_bpp = 0);
 
   /** \brief Save a PNG image.
    *
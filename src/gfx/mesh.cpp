@@ -14,7 +14,7 @@ using namespace gfx;
 namespace data
 {
   template<> Mesh::store_type data::Storable<Mesh, MeshLoader>::g_store(0);
-  template<> Mesh::registry_type *data::Registry<Mesh, MeshLoader>::g_registry = NULL;
+  template<> Mesh::registry_type *data::Registry<Mesh, MeshLoader, MeshData>::g_registry = NULL;
 }
 
 void Mesh::addTexture(const std::string &id, const void *tex)
@@ -39,25 +39,15 @@ void Mesh::addTextureFile(const std::string &type, const fs::path &pfname, const
 {
   if(0 == type.compare("volume"))
   {
-    if(Texture3D::storageContains(pfname))
-    {
-      this->addTexture(type, Texture3D::locate(pfname).get().get());
-    }
-    else
-    {
-      this->addTexture(type, Texture3D::create(pfname, loader).get().get());
-    }
+    Texture3DSptr tex = Texture3D::instanciateHandle(pfname, loader)->get();
+    m_volume_refs.push_back(tex);
+    this->addTexture(type, tex.get());
   }
   else
   {
-    if(Texture2D::storageContains(pfname))
-    {
-      this->addTexture(type, Texture2D::locate(pfname).get().get());
-    }
-    else
-    {
-      this->addTexture(type, Texture2D::create(pfname, loader).get().get());
-    }
+    Texture2DSptr tex = Texture2D::instanciateHandle(pfname, loader)->get();
+    m_texture_refs.push_back(tex);
+    this->addTexture(type, tex.get());
   }
 }
 
@@ -123,57 +113,40 @@ math::rect3f Mesh::getBoundary() const
   return ret;
 }
 
-void Mesh::load(const fs::path &pfname, const pt::ptree &root, const MeshLoader &loader)
+uint64_t Mesh::getStorageSize() const
+{
+  return sizeof(Color) * m_color.size() + sizeof(math::vec3f) * m_normal.size() +
+    sizeof(math::vec4u) * m_reference.size() + sizeof(math::vec2f) * m_texcoord.size() +
+    sizeof(math::vec3f) * m_vertex.size() + sizeof(math::vec4f) * m_weight.size() +
+    sizeof(Triangle) * m_lod.getFaces().size();
+}
+
+void Mesh::load(const fs::path &pfname, const MeshData &mesh_data, const MeshLoader &loader)
 {
-  math::vec3f obj_scale(1.0f, 1.0f, 1.0f);
-  bool enable_center = false,
-       enable_into = false,
-       enable_scale = false;
+  math::vec3f obj_scale = mesh_data.m_scale;
+  bool enable_center = mesh_data.hasFlag(MeshData::SCALE_CENTER),
+       enable_into = mesh_data.hasFlag(MeshData::SCALE_INTO),
+       enable_scale = mesh_data.hasFlag(MeshData::SCALE);
 
   this->unreserve();
 
-  BOOST_FOREACH(const pt::ptree::value_type &vv, root)
+  m_color = mesh_data.m_color;
+  m_normal = mesh_data.m_normal;
+  m_reference = mesh_data.m_reference;
+  m_texcoord = mesh_data.m_texcoord;
+  m_vertex = mesh_data.m_vertex;
+  m_weight = mesh_data.m_weight;
+  m_lod.getFaces() = mesh_data.m_faces;
+  if(mesh_data.hasFlag(MeshData::OFFSET))
   {
-    const std::string &type = vv.first;
-    const pt::ptree &subtree = vv.second;
+    m_offset = mesh_data.m_offset;
+  }
 
-    if(0 == type.compare("offset"))
-    {
-      math::vec3f off(subtree.get<float>("x"),
-          subtree.get<float>("y"),
-          subtree.get<float>("z"));
-      m_offset = math::vec3f(off.y(), off.z(), -off.x());
-    }
-    else if(0 == type.compare("scale"))
-    {
-      enable_scale = true;
-      enable_center = subtree.get<bool>("center", 0);
-      enable_into = subtree.get<bool>("into", 0);
-      obj_scale.x() = subtree.get<float>("x", 1.0f);
-      obj_scale.y() = subtree.get<float>("y", 1.0f);
-      obj_scale.z() = subtree.get<float>("z", 1.0f);
-    }
-    else if(0 == type.compare("vertex"))
-    {
-      this->readVertex(subtree);
-    }
-    else if(0 == type.compare("face"))
-    {
-      // Must flip faces for correct orientation.
-      m_lod.addFace(Triangle(subtree.get<unsigned>("a"),
-            subtree.get<unsigned>("c"),
-            subtree.get<unsigned>("b")));
-    }
-    else if((0 == type.compare(0, 7, "texture")) || (0 == type.compare(0, 9, "normalmap")))
-    {
-      fs::path subpath = pfname.parent_path().parent_path() / fs::path(subtree.get<std::string>(""));
-      this->addTextureFile(type, subpath);
-    }
-    else if(0 == type.compare(0, 6, "volume"))
-    {
-      fs::path subpath = pfname.parent_path().parent_path() / fs::path(subtree.get<std::string>(""));
-      this->addTextureFile(type, subpath);
-    }
+  for(unsigned ii = 0; (ii < mesh_data.m_textures.size()); ++ii)
+  {
+    const std::pair<std::string, std::string> &vv = mesh_data.m_textures[ii];
+    fs::path subpath = pfname.parent_path().parent_path() / fs::path(vv.second);
+    this->addTextureFile(vv.first, subpath);
   }
 
   // perform transformations
@@ -221,43 +194,6 @@ void Mesh::load(const fs::path &pfname, const pt::ptree &root, const MeshLoader
   this->compile();
 }
 
-void Mesh::readVertex(const pt::ptree &subtree)
-{
-  try {
-    m_color.push_back(Color(subtree.get<float>("color.r"),
-          subtree.get<float>("color.g"),
-          subtree.get<float>("color.b"),
-          subtree.get<float>("color.a")));
-  } catch(...) { }
-  try {
-    m_normal.push_back(math::vec3f(subtree.get<float>("normal.x"),
-          subtree.get<float>("normal.y"),
-          subtree.get<float>("normal.z")));
-  } catch(...) { }
-  try {
-    m_reference.push_back(math::vec4u(subtree.get<unsigned>("reference.a"),
-          subtree.get<unsigned>("reference.b"),
-          subtree.get<unsigned>("reference.c"),
-          subtree.get<unsigned>("reference.d")));
-  } catch(...) { }
-  try {
-    m_texcoord.push_back(math::vec2f(subtree.get<float>("texcoord.s"),
-          subtree.get<float>("texcoord.t")));
-  } catch(...) { }
-  try {
-    m_weight.push_back(math::vec4f(subtree.get<float>("weight.a"),
-          subtree.get<float>("weight.b"),
-          subtree.get<float>("weight.c"),
-          subtree.get<float>("weight.d")));
-  } catch(...) { }
-  // Vertex MUST exist, others are voluntary.
-  math::vec3f ver(subtree.get<float>("x"),
-        subtree.get<float>("y"),
-        subtree.get<float>("z"));
-  // Must 'rotate' to correct orientation.
-  m_vertex.push_back(math::vec3f(ver.y(), ver.z(), -ver.x()));
-}
-
 void Mesh::scale(const math::vec3f &svec)
 {
   BOOST_FOREACH(math::vec3f &vv, m_vertex)
@@ -287,22 +223,16 @@ void Mesh::unreserve()
   m_lod.unreserve();
   m_textures.clear();
   m_volumes.clear();
+  m_texture_refs.clear();
+  m_volume_refs.clear();
 }
 
 namespace data
 {
-  template<> Mesh* Registry<Mesh, MeshLoader>::registryCreate(const fs::path &pfname, const pt::ptree &root,
-      const MeshLoader &loader)
+  template<> Mesh* Registry<Mesh, MeshLoader, MeshData>::registryCreate(const fs::path &pfname,
+      const MeshData &root, const MeshLoader &loader)
   {
-    std::string mesh_type("static"); // default type
-
-    {
-      pt::ptree::const_assoc_iterator iter = root.find("type");
-      if(iter != root.not_found())
-      {
-        mesh_type.assign(iter->second.get_value<std::string>());
-      }
-    }
+    const std::string &mesh_type = root.m_type;
 
     {
       std::ostringstream sstr;
@@ -324,7 +254,7 @@ namespace data
 
 Mesh::container_type Mesh::createImplementation(const fs::path &pfname, const MeshLoader &loader)
 {
-  if(!data::filename_is_mesh(pfname))
+  if(!data::filename_is_mesh(pfname) && !data::filename_is_mesh_binary(pfname))
   {
     // TODO: probe?
     std::ostringstream sstr;
@@ -332,11 +262,26 @@ Mesh::container_type Mesh::createImplementation(const fs::path &pfname, const Me
     BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
   }
 
+  {
+    MeshData mesh_data;
+
+    if(mesh_data.readBinary(pfname))
+    {
+      return Mesh::container_type(Mesh::registryCreate(pfname, mesh_data, loader));
+    }
+    if(data::filename_is_mesh_binary(pfname))
+    {
+      std::ostringstream sstr;
+      sstr << "invalid binary mesh file '" << pfname << '\'';
+      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+    }
+  }
+
   data::XmlFile xml_file(pfname);
 
   if(0 == xml_file.rootType().compare("mesh"))
   {
-    Mesh *ret = Mesh::registryCreate(pfname, xml_file.tree(), loader);
+    Mesh *ret = Mesh::registryCreate(pfname, MeshData(xml_file.tree()), loader);
 
     return Mesh::container_type(ret);
   }
@@ -375,20 +320,27 @@ Mesh::container_type Mesh::createImplementation(const fs::path &pfname, const Me
           if(iter != subtree.not_found())
           {
             fs::path subfname = pfname.parent_path() / fs::path(iter->second.get_value<std::string>());
-            data::XmlFile sub_xml_file(subfname);
+            MeshData sub_data;
 
-            if(0 != sub_xml_file.rootType().compare("mesh"))
+            if(!sub_data.readBinary(subfname))
             {
-              std::ostringstream sstr;
-              sstr << "unknown root type for additional mesh: " << subfname;
-              BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+              data::XmlFile sub_xml_file(subfname);
+
+              if(0 != sub_xml_file.rootType().compare("mesh"))
+              {
+                std::ostringstream sstr;
+                sstr << "unknown root type for additional mesh: " << subfname;
+                BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+              }
+
+              sub_data.read(sub_xml_file.tree());
             }
 
-            ret.add(Mesh::registryCreate(subfname, sub_xml_file.tree(), sub_loader));
+            ret.add(Mesh::registryCreate(subfname, sub_data, sub_loader));
           }
           else
           {
-            ret.add(Mesh::registryCreate(pfname, subtree, sub_loader));
+            ret.add(Mesh::registryCreate(pfname, MeshData(subtree), sub_loader));
           }
         }
         else if((0 != type.compare("<xmlattr>")) && (0 != type.compare("<xmlcomment>")))
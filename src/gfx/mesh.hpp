@@ -4,6 +4,7 @@
 #include "data/registry.hpp"
 #include "data/store.hpp"
 #include "gfx/lod.hpp"
+#include "gfx/mesh_data.hpp"
 #include "gfx/mesh_loader.hpp"
 #include "gfx/texture_2d.hpp"
 #include "gfx/texture_3d.hpp"
@@ -22,7 +23,7 @@ namespace gfx
    */
   class Mesh :
     public data::Storable<Mesh, MeshLoader>,
-    public data::Registry<Mesh, MeshLoader>
+    public data::Registry<Mesh, MeshLoader, MeshData>
   {
     protected:
       /** Attribute data array. */
@@ -55,6 +56,12 @@ namespace gfx
       /** Volumes in this mesh. */
       std::vector<const Texture3D*> m_volumes;
 
+      /** References to stored textures, keeping them from eviction. */
+      std::vector<Texture2DSptr> m_texture_refs;
+
+      /** References to stored volumes, keeping them from eviction. */
+      std::vector<Texture3DSptr> m_volume_refs;
+
       /** \brief Offset of this mesh.
        *
        * Note that for most purposes, the offset will be zero. It is meant as
@@ -126,17 +133,13 @@ namespace gfx
        */
       void calcNormals();
 
-      /** \brief Load this from a file.
+      /** \brief Load this from mesh file contents.
        *
-       * Unknown elements will be passed into a specific interpretation
-       * function that is implemented in inheriting classes.
-       *
-       * \param pfname Filename to load.
-       * \param root Property tree root.
+       * \param pfname Filename the contents were read from.
+       * \param mesh_data Mesh file contents.
        * \param loader Loader settings.
        */
-      void load(const boost::filesystem::path &pfname, const boost::property_tree::ptree &root,
-          const MeshLoader &loader);
+      void load(const boost::filesystem::path &pfname, const MeshData &mesh_data, const MeshLoader &loader);
 
     public:
       /** \brief Add image from file.
@@ -158,6 +161,14 @@ namespace gfx
        */
       math::rect3f getBoundary() const;
 
+      /** \brief Get the size of vertex data.
+       *
+       * Textures are accounted in their own stores.
+       *
+       * \return Size in bytes.
+       */
+      uint64_t getStorageSize() const;
+
       /** \brief Scale this object.
        *
        * Multiplies all vertices (but nothing else) with the given values.
@@ -236,14 +247,6 @@ namespace gfx
       virtual void upload() = 0;
 
     protected:
-      /** \brief Read one vertex from a property tree.
-       *
-       * Inheriting classes should call this base method.
-       *
-       * \param subtree Tree to read from.
-       */
-      virtual void readVertex(const boost::property_tree::ptree &subtree);
-
       /** \brief Free all resources required by the font.
        * 
        * Should be done before deinitializing OpenGL.
@@ -257,6 +260,8 @@ namespace gfx
        *
        * Despite being public, not to be called by user.
        *
+       * Meshes are read from up to date binary meshes when available and from the XML files otherwise.
+       *
        * \param pfname File to load.
        * \param loader Loader settings.
        * \return Container for all created instances.
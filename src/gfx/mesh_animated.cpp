@@ -4,11 +4,11 @@ namespace fs = boost::filesystem;
 namespace pt = boost::property_tree;
 using namespace gfx;
 
-static data::Registration<Mesh, MeshLoader, MeshAnimated> reg("animated");
+static data::Registration<Mesh, MeshLoader, MeshAnimated, MeshData> reg("animated");
 
-MeshAnimated::MeshAnimated(const fs::path &pfname, const pt::ptree &root, const MeshLoader &loader)
+MeshAnimated::MeshAnimated(const fs::path &pfname, const MeshData &mesh_data, const MeshLoader &loader)
 {
-  this->load(pfname, root, loader);
+  this->load(pfname, mesh_data, loader);
 }
 
 void MeshAnimated::compile()
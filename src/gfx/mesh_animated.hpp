@@ -19,10 +19,10 @@ namespace gfx
       /** \brief Load constructor.
        *
        * \param pfname File to load from.
-       * \param root Property tree root.
+       * \param mesh_data Mesh file contents.
        * \param loader Loader settings.
        */
-      MeshAnimated(const boost::filesystem::path &pfname, const boost::property_tree::ptree &root,
+      MeshAnimated(const boost::filesystem::path &pfname, const MeshData &mesh_data,
           const MeshLoader &loader);
 
       /** \brief Destructor. */
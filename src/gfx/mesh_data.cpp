@@ -0,0 +1,341 @@
+#include "gfx/mesh_data.hpp"
+
+#include "data/generic.hpp"
+#include "data/pack.hpp"
+#include "data/xml_file.hpp"
+#include "thr/timeline.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+
+namespace fs = boost::filesystem;
+namespace pt = boost::property_tree;
+using namespace gfx;
+
+/** Binary mesh magic identifier. */
+static const char MESH_BINARY_MAGIC[4] = { 'O', 'B', 'M', 'B' };
+
+/** Binary mesh format version. */
+static const uint32_t MESH_BINARY_VERSION = 2;
+
+/** \brief Copy an array out of a binary mesh.
+ *
+ * \param dst Destination array.
+ * \param src Source data.
+ * \param count Number of elements.
+ * \return Source data after the array.
+ */
+template<typename T> static const uint8_t* mesh_binary_copy(std::vector<T> &dst, const uint8_t *src,
+    uint32_t count)
+{
+  const T *begin = reinterpret_cast<const T*>(src);
+  dst.assign(begin, begin + count);
+  return src + sizeof(T) * count;
+}
+
+/** \brief Write an array into a binary mesh.
+ *
+ * \param ostr Stream to write to.
+ * \param src Source array.
+ */
+template<typename T> static void mesh_binary_write(std::ostream &ostr, const std::vector<T> &src)
+{
+  if(!src.empty())
+  {
+    ostr.write(reinterpret_cast<const char*>(&src.front()),
+        static_cast<std::streamsize>(sizeof(T) * src.size()));
+  }
+}
+
+/** \brief Read a zero-terminated string from the string block of a binary mesh.
+ *
+ * \param dst Destination string.
+ * \param iter Current position, advanced past the string.
+ * \param end End of the string block.
+ * \return True on success, false if the string is not terminated.
+ */
+static bool mesh_binary_string(std::string &dst, const char *&iter, const char *end)
+{
+  const char *term = std::find(iter, end, '\0');
+
+  if(end == term)
+  {
+    return false;
+  }
+  dst.assign(iter, term);
+  iter = term + 1;
+  return true;
+}
+
+MeshData::MeshData() :
+  m_type("static"),
+  m_offset(0.0f, 0.0f, 0.0f),
+  m_scale(1.0f, 1.0f, 1.0f),
+  m_flags(0) { }
+
+MeshData::MeshData(const pt::ptree &root) :
+  m_type("static"),
+  m_offset(0.0f, 0.0f, 0.0f),
+  m_scale(1.0f, 1.0f, 1.0f),
+  m_flags(0)
+{
+  this->read(root);
+}
+
+void MeshData::read(const pt::ptree &root)
+{
+  BOOST_FOREACH(const pt::ptree::value_type &vv, root)
+  {
+    const std::string &type = vv.first;
+    const pt::ptree &subtree = vv.second;
+
+    if(0 == type.compare("type"))
+    {
+      m_type.assign(subtree.get_value<std::string>());
+    }
+    else if(0 == type.compare("offset"))
+    {
+      math::vec3f off(subtree.get<float>("x"),
+          subtree.get<float>("y"),
+          subtree.get<float>("z"));
+      m_offset = math::vec3f(off.y(), off.z(), -off.x());
+      m_flags |= OFFSET;
+    }
+    else if(0 == type.compare("scale"))
+    {
+      m_flags |= SCALE;
+      if(subtree.get<bool>("center", 0))
+      {
+        m_flags |= SCALE_CENTER;
+      }
+      if(subtree.get<bool>("into", 0))
+      {
+        m_flags |= SCALE_INTO;
+      }
+      m_scale.x() = subtree.get<float>("x", 1.0f);
+      m_scale.y() = subtree.get<float>("y", 1.0f);
+      m_scale.z() = subtree.get<float>("z", 1.0f);
+    }
+    else if(0 == type.compare("vertex"))
+    {
+      this->readVertex(subtree);
+    }
+    else if(0 == type.compare("face"))
+    {
+      // Must flip faces for correct orientation.
+      m_faces.push_back(Triangle(subtree.get<unsigned>("a"),
+            subtree.get<unsigned>("c"),
+            subtree.get<unsigned>("b")));
+    }
+    else if((0 == type.compare(0, 7, "texture")) || (0 == type.compare(0, 9, "normalmap")) ||
+        (0 == type.compare(0, 6, "volume")))
+    {
+      m_textures.push_back(std::make_pair(type, subtree.get<std::string>("")));
+    }
+  }
+}
+
+bool MeshData::readBinary(const fs::path &pfname)
+{
+  bool is_binary = data::filename_is_mesh_binary(pfname);
+  fs::path bin_fname = is_binary ? pfname : mesh_binary_filename(pfname);
+
+  if(!data::file_exists(bin_fname))
+  {
+    return false;
+  }
+
+  data::MappedFile mapped(bin_fname);
+  thr::timeline_read(mapped.getSize());
+
+  if(mapped.getSize() < sizeof(MeshBinaryHeader))
+  {
+    return false;
+  }
+  const MeshBinaryHeader *header = reinterpret_cast<const MeshBinaryHeader*>(mapped.getData());
+  if(!std::equal(MESH_BINARY_MAGIC, MESH_BINARY_MAGIC + 4, header->m_magic) ||
+      (header->m_version != MESH_BINARY_VERSION))
+  {
+    return false;
+  }
+
+  uint64_t size = sizeof(MeshBinaryHeader) + static_cast<uint64_t>(header->m_string_size) +
+    sizeof(Color) * static_cast<uint64_t>(header->m_color_count) +
+    sizeof(math::vec3f) * static_cast<uint64_t>(header->m_normal_count) +
+    sizeof(math::vec4u) * static_cast<uint64_t>(header->m_reference_count) +
+    sizeof(math::vec2f) * static_cast<uint64_t>(header->m_texcoord_count) +
+    sizeof(math::vec3f) * static_cast<uint64_t>(header->m_vertex_count) +
+    sizeof(math::vec4f) * static_cast<uint64_t>(header->m_weight_count) +
+    sizeof(Triangle) * static_cast<uint64_t>(header->m_face_count);
+  if(mapped.getSize() < size)
+  {
+    return false;
+  }
+
+  // A binary mesh is stale if the source has changed since conversion. Only the source is stat'ed, reading it
+  // would defeat the purpose.
+  uint64_t source_size;
+  uint64_t source_time;
+  if(!is_binary && data::file_stamp(pfname, source_size, source_time) &&
+      ((source_size != header->m_source_size) || (source_time != header->m_source_time)))
+  {
+    return false;
+  }
+
+  const char *strings = reinterpret_cast<const char*>(header + 1);
+  const char *strings_end = strings + header->m_string_size;
+  if(!mesh_binary_string(m_type, strings, strings_end))
+  {
+    return false;
+  }
+  m_textures.resize(header->m_texture_count);
+  for(unsigned ii = 0; (ii < header->m_texture_count); ++ii)
+  {
+    if(!mesh_binary_string(m_textures[ii].first, strings, strings_end) ||
+        !mesh_binary_string(m_textures[ii].second, strings, strings_end))
+    {
+      return false;
+    }
+  }
+
+  m_offset = math::vec3f(header->m_offset[0], header->m_offset[1], header->m_offset[2]);
+  m_scale = math::vec3f(header->m_scale[0], header->m_scale[1], header->m_scale[2]);
+  m_flags = header->m_flags;
+
+  const uint8_t *iter = reinterpret_cast<const uint8_t*>(strings_end);
+  iter = mesh_binary_copy(m_color, iter, header->m_color_count);
+  iter = mesh_binary_copy(m_normal, iter, header->m_normal_count);
+  iter = mesh_binary_copy(m_reference, iter, header->m_reference_count);
+  iter = mesh_binary_copy(m_texcoord, iter, header->m_texcoord_count);
+  iter = mesh_binary_copy(m_vertex, iter, header->m_vertex_count);
+  iter = mesh_binary_copy(m_weight, iter, header->m_weight_count);
+  mesh_binary_copy(m_faces, iter, header->m_face_count);
+  return true;
+}
+
+void MeshData::readVertex(const pt::ptree &subtree)
+{
+  try {
+    m_color.push_back(Color(subtree.get<float>("color.r"),
+          subtree.get<float>("color.g"),
+          subtree.get<float>("color.b"),
+          subtree.get<float>("color.a")));
+  } catch(...) { }
+  try {
+    m_normal.push_back(math::vec3f(subtree.get<float>("normal.x"),
+          subtree.get<float>("normal.y"),
+          subtree.get<float>("normal.z")));
+  } catch(...) { }
+  try {
+    m_reference.push_back(math::vec4u(subtree.get<unsigned>("reference.a"),
+          subtree.get<unsigned>("reference.b"),
+          subtree.get<unsigned>("reference.c"),
+          subtree.get<unsigned>("reference.d")));
+  } catch(...) { }
+  try {
+    m_texcoord.push_back(math::vec2f(subtree.get<float>("texcoord.s"),
+          subtree.get<float>("texcoord.t")));
+  } catch(...) { }
+  try {
+    m_weight.push_back(math::vec4f(subtree.get<float>("weight.a"),
+          subtree.get<float>("weight.b"),
+          subtree.get<float>("weight.c"),
+          subtree.get<float>("weight.d")));
+  } catch(...) { }
+  // Vertex MUST exist, others are voluntary.
+  math::vec3f ver(subtree.get<float>("x"),
+        subtree.get<float>("y"),
+        subtree.get<float>("z"));
+  // Must 'rotate' to correct orientation.
+  m_vertex.push_back(math::vec3f(ver.y(), ver.z(), -ver.x()));
+}
+
+void MeshData::writeBinary(const fs::path &pfname, uint64_t source_size, uint64_t source_time) const
+{
+  std::string strings(m_type);
+  strings.push_back('\0');
+  for(unsigned ii = 0; (ii < m_textures.size()); ++ii)
+  {
+    strings.append(m_textures[ii].first);
+    strings.push_back('\0');
+    strings.append(m_textures[ii].second);
+    strings.push_back('\0');
+  }
+  // Keep the arrays aligned.
+  strings.resize((strings.size() + 3) & ~static_cast<size_t>(3), '\0');
+
+  MeshBinaryHeader header;
+  std::copy(MESH_BINARY_MAGIC, MESH_BINARY_MAGIC + 4, header.m_magic);
+  header.m_version = MESH_BINARY_VERSION;
+  header.m_source_size = source_size;
+  header.m_source_time = source_time;
+  header.m_flags = m_flags;
+  std::copy(m_offset.m_array, m_offset.m_array + 3, header.m_offset);
+  std::copy(m_scale.m_array, m_scale.m_array + 3, header.m_scale);
+  header.m_string_size = static_cast<uint32_t>(strings.size());
+  header.m_texture_count = static_cast<uint32_t>(m_textures.size());
+  header.m_color_count = static_cast<uint32_t>(m_color.size());
+  header.m_normal_count = static_cast<uint32_t>(m_normal.size());
+  header.m_reference_count = static_cast<uint32_t>(m_reference.size());
+  header.m_texcoord_count = static_cast<uint32_t>(m_texcoord.size());
+  header.m_vertex_count = static_cast<uint32_t>(m_vertex.size());
+  header.m_weight_count = static_cast<uint32_t>(m_weight.size());
+  header.m_face_count = static_cast<uint32_t>(m_faces.size());
+
+  fs::path tmp_fname(pfname.string() + ".tmp");
+  {
+    fs::ofstream fd(tmp_fname, std::ios::binary);
+    fd.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fd.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    mesh_binary_write(fd, m_color);
+    mesh_binary_write(fd, m_normal);
+    mesh_binary_write(fd, m_reference);
+    mesh_binary_write(fd, m_texcoord);
+    mesh_binary_write(fd, m_vertex);
+    mesh_binary_write(fd, m_weight);
+    mesh_binary_write(fd, m_faces);
+    if(fd.fail())
+    {
+      std::stringstream sstr;
+      sstr << "could not write " << tmp_fname;
+      BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+    }
+  }
+  fs::rename(tmp_fname, pfname);
+}
+
+bool gfx::mesh_binary_convert(const fs::path &pfname)
+{
+  data::XmlFile xml_file(pfname);
+
+  if(0 == xml_file.rootType().compare("meta-mesh"))
+  {
+    return false;
+  }
+  if(0 != xml_file.rootType().compare("mesh"))
+  {
+    std::stringstream sstr;
+    sstr << "unknown root type: " << xml_file.rootType();
+    BOOST_THROW_EXCEPTION(std::invalid_argument(sstr.str()));
+  }
+
+  uint64_t source_size;
+  uint64_t source_time;
+  if(!data::file_stamp(pfname, source_size, source_time))
+  {
+    std::stringstream sstr;
+    sstr << "could not stat " << pfname;
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+  MeshData(xml_file.tree()).writeBinary(mesh_binary_filename(data::open_search(pfname)), source_size,
+      source_time);
+  return true;
+}
+
+fs::path gfx::mesh_binary_filename(const fs::path &pfname)
+{
+  fs::path ret(pfname);
+  return ret.replace_extension(".bmesh");
+}
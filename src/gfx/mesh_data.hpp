@@ -0,0 +1,201 @@
+#ifndef GFX_MESH_DATA_HPP
+#define GFX_MESH_DATA_HPP
+
+#include "gfx/color.hpp"
+#include "gfx/triangle.hpp"
+#include "math/vec.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace gfx
+{
+  /** \brief Binary mesh file header.
+   *
+   * The header is followed by the string block, containing the mesh type
+   * and an id and a filename for each texture, all zero-terminated. The
+   * string block is followed by the attribute arrays and the face indices in
+   * the order of the counts below, each stored as in memory.
+   */
+  struct MeshBinaryHeader
+  {
+    /** Magic identifier. */
+    char m_magic[4];
+
+    /** Format version. */
+    uint32_t m_version;
+
+    /** Size of the source mesh file. */
+    uint64_t m_source_size;
+
+    /** Modification time of the source mesh file. */
+    uint64_t m_source_time;
+
+    /** Flags. */
+    uint32_t m_flags;
+
+    /** Offset. */
+    float m_offset[3];
+
+    /** Scale. */
+    float m_scale[3];
+
+    /** Size of the string block, padded to four bytes. */
+    uint32_t m_string_size;
+
+    /** Number of textures. */
+    uint32_t m_texture_count;
+
+    /** Number of colors. */
+    uint32_t m_color_count;
+
+    /** Number of normals. */
+    uint32_t m_normal_count;
+
+    /** Number of references. */
+    uint32_t m_reference_count;
+
+    /** Number of texture coordinates. */
+    uint32_t m_texcoord_count;
+
+    /** Number of vertices. */
+    uint32_t m_vertex_count;
+
+    /** Number of weights. */
+    uint32_t m_weight_count;
+
+    /** Number of faces. */
+    uint32_t m_face_count;
+  };
+
+  /** \brief Contents of one mesh file.
+   *
+   * Intermediate form between a mesh file and a mesh. Read either from the
+   * XML tree of a .mesh file or from a memory-mapped binary mesh converted
+   * from it. Vertices, offset and faces are already in the orientation used
+   * for drawing.
+   */
+  struct MeshData
+  {
+    /** Offset has been set. */
+    static const uint32_t OFFSET = 0x1;
+
+    /** Scale has been set. */
+    static const uint32_t SCALE = 0x2;
+
+    /** Center the mesh when scaling. */
+    static const uint32_t SCALE_CENTER = 0x4;
+
+    /** Scale into a boundary area. */
+    static const uint32_t SCALE_INTO = 0x8;
+
+    /** Mesh type in the registry. */
+    std::string m_type;
+
+    /** Texture ids and filenames relative to the data root. */
+    std::vector<std::pair<std::string, std::string> > m_textures;
+
+    /** Offset. */
+    math::vec3f m_offset;
+
+    /** Scale. */
+    math::vec3f m_scale;
+
+    /** Flags. */
+    uint32_t m_flags;
+
+    /** Attribute data array. */
+    std::vector<Color> m_color;
+
+    /** Attribute data array. */
+    std::vector<math::vec3f> m_normal;
+
+    /** Attribute data array. */
+    std::vector<math::vec4u> m_reference;
+
+    /** Attribute data array. */
+    std::vector<math::vec2f> m_texcoord;
+
+    /** Attribute data array. */
+    std::vector<math::vec3f> m_vertex;
+
+    /** Attribute data array. */
+    std::vector<math::vec4f> m_weight;
+
+    /** Faces, ready for the element buffer. */
+    std::vector<Triangle> m_faces;
+
+    /** \brief Empty constructor. */
+    MeshData();
+
+    /** \brief Constructor.
+     *
+     * \param root Property tree root.
+     */
+    explicit MeshData(const boost::property_tree::ptree &root);
+
+    /** \brief Tell if a flag is set.
+     *
+     * \param op Flag.
+     * \return True if yes, false if no.
+     */
+    bool hasFlag(uint32_t op) const
+    {
+      return (0 != (m_flags & op));
+    }
+
+    /** \brief Read from a property tree.
+     *
+     * \param root Property tree root.
+     */
+    void read(const boost::property_tree::ptree &root);
+
+    /** \brief Read from a binary mesh.
+     *
+     * For a .mesh file, the binary mesh next to it is read if it exists and
+     * the size and modification time of the source match those it was
+     * converted from. A binary mesh without its source is read as is.
+     *
+     * \param pfname Filename of either the source or the binary mesh.
+     * \return True if read, false if there was no valid binary mesh.
+     */
+    bool readBinary(const boost::filesystem::path &pfname);
+
+    /** \brief Write as a binary mesh.
+     *
+     * Will throw an exception on failure.
+     *
+     * \param pfname Filename to write.
+     * \param source_size Size of the source mesh file.
+     * \param source_time Modification time of the source mesh file.
+     */
+    void writeBinary(const boost::filesystem::path &pfname, uint64_t source_size, uint64_t source_time) const;
+
+    /** \brief Read one vertex from a property tree.
+     *
+     * \param subtree Tree to read from.
+     */
+    void readVertex(const boost::property_tree::ptree &subtree);
+  };
+
+  /** \brief Convert a mesh file into a binary mesh.
+   *
+   * The binary mesh is written next to the source. Meta-meshes are not
+   * converted, the meshes they refer to are converted separately.
+   *
+   * Will throw an exception on failure.
+   *
+   * \param pfname Source mesh filename.
+   * \return True if converted, false if the file is a meta-mesh.
+   */
+  extern bool mesh_binary_convert(const boost::filesystem::path &pfname);
+
+  /** \brief Get the binary mesh filename for a mesh file.
+   *
+   * \param pfname Source mesh filename.
+   * \return Binary mesh filename.
+   */
+  extern boost::filesystem::path mesh_binary_filename(const boost::filesystem::path &pfname);
+}
+
+#endif
@@ -4,11 +4,185 @@
 #include "gfx/height_map_ball.hpp"
 #include "gfx/shader.hpp"
 #include "ui/generic.hpp"
-#include "thr/dispatch.hpp"
+#include "thr/task_group.hpp"
+#include "thr/timeline.hpp"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace fs = boost::filesystem;
 using namespace gfx;
 
+/** Side length of one facet texture generation tile. */
+static const unsigned FACET_TILE = 64;
+
+/** \brief Facet pair being generated.
+ */
+struct FacetPair
+{
+  /** Image being generated. */
+  ImageRGBA m_image;
+
+  /** First corner. */
+  math::vec3f m_vv1;
+
+  /** Opposite corner. */
+  math::vec3f m_vv4;
+
+  /** First triangle X axis. */
+  math::vec3f m_vx1;
+
+  /** First triangle Y axis. */
+  math::vec3f m_vy1;
+
+  /** Second triangle X axis. */
+  math::vec3f m_vx2;
+
+  /** Second triangle Y axis. */
+  math::vec3f m_vy2;
+
+  /** \brief Constructor.
+   *
+   * \param side Texture side length.
+   * \param vv1 First vertex of first triangle.
+   * \param vv2 Shared vertex.
+   * \param vv3 Shared vertex.
+   * \param vv4 Last vertex of second triangle.
+   */
+  FacetPair(unsigned side, const math::vec3f &vv1, const math::vec3f &vv2, const math::vec3f &vv3,
+      const math::vec3f &vv4) :
+    m_image(side, side),
+    m_vv1(vv1),
+    m_vv4(vv4),
+    m_vx1(vv2 - vv1),
+    m_vy1(vv3 - vv1),
+    m_vx2(vv3 - vv4),
+    m_vy2(vv2 - vv4) { }
+};
+
+/** \brief Progress of facet generation.
+ */
+struct FacetProgress
+{
+  /** Guards the counters. */
+  boost::mutex m_mutex;
+
+  /** Total number of tiles. */
+  unsigned m_total;
+
+  /** Tiles done. */
+  unsigned m_done;
+
+  /** Last reported percentage. */
+  unsigned m_reported;
+
+  /** \brief Constructor.
+   *
+   * \param total Total number of tiles.
+   */
+  FacetProgress(unsigned total) :
+    m_total(total),
+    m_done(0),
+    m_reported(0) { }
+
+  /** \brief Mark one tile done.
+   *
+   * Logs the progress every ten percent.
+   */
+  void advance()
+  {
+    unsigned percent;
+    {
+      boost::mutex::scoped_lock scope(m_mutex);
+      percent = (++m_done * 100 / m_total) / 10 * 10;
+      if(percent <= m_reported)
+      {
+        return;
+      }
+      m_reported = percent;
+    }
+    std::stringstream sstr;
+    sstr << "planet facets " << percent << "% done";
+    data::log(sstr.str());
+  }
+};
+
+/** \brief Get number of tiles along one side of a facet texture.
+ *
+ * \param side Texture side length.
+ * \return Number of tiles.
+ */
+static unsigned facet_tile_count(unsigned side)
+{
+  return (side + FACET_TILE - 1) / FACET_TILE;
+}
+
+/** \brief Generate one tile of a facet pair texture.
+ *
+ * Tiles write disjoint texels, so the result does not depend on the order
+ * they are run in.
+ *
+ * \param pair Facet pair.
+ * \param hmap Heightmap.
+ * \param px Tile start X.
+ * \param py Tile start Y.
+ * \param progress Progress counter.
+ */
+static void facet_tile_task(FacetPair *pair, const HeightMapBall *hmap, unsigned px, unsigned py,
+    FacetProgress *progress)
+{
+  ImageRGBA &mtex = pair->m_image;
+  unsigned ex = std::min(px + FACET_TILE, mtex.getWidth()),
+           ey = std::min(py + FACET_TILE, mtex.getHeight());
+  float fwidth = static_cast<float>(mtex.getWidth() - 1),
+        fheight = static_cast<float>(mtex.getHeight() - 1),
+        gdist = MeshPlanet::gradient_distance(mtex.getWidth());
+
+  math::vec3f vv[FACET_TILE],
+    nn[FACET_TILE];
+  float ht[FACET_TILE];
+
+  for(unsigned ii = px; (ii < ex); ++ii)
+  {
+    float fi = static_cast<float>(ii) / fwidth;
+
+    for(unsigned jj = py; (jj < ey); ++jj)
+    {
+      float fj = static_cast<float>(jj) / fheight;
+
+      if(fi + fj < 1.0f)
+      {
+        vv[jj - py] = (fi * pair->m_vx1 + fj * pair->m_vy1) + pair->m_vv1;
+      }
+      else
+      {
+        vv[jj - py] = ((1.0f - fi) * pair->m_vx2 + (1.0f - fj) * pair->m_vy2) + pair->m_vv4;
+      }
+    }
+
+    hmap->calcTerrain(vv, ht, ey - py);
+    if(hmap->hasNormals(gdist))
+    {
+      for(unsigned jj = 0; (jj < ey - py); ++jj)
+      {
+        nn[jj] = hmap->lookupNormal(vv[jj]);
+      }
+    }
+    else
+    {
+      hmap->calcNormal(vv, ht, gdist, nn, ey - py);
+    }
+
+    for(unsigned jj = py; (jj < ey); ++jj)
+    {
+      math::vec3f col = nn[jj - py] * 0.5f + 0.5f;
+      mtex.setPixel(ii, jj, math::vec4f(col.x(), col.y(), col.z(), ht[jj - py]));
+    }
+  }
+
+  progress->advance();
+}
+
 MeshPlanet::MeshPlanet(unsigned subdivision,
     unsigned subdivision_coalesce, const HeightMapBall *hmap,
     unsigned texture_detail)
@@ -16,6 +190,11 @@ MeshPlanet::MeshPlanet(unsigned subdivision,
   this->compile(subdivision, subdivision_coalesce, hmap, texture_detail);
 }
 
+float MeshPlanet::gradient_distance(unsigned texture_detail)
+{
+  return 1.0f / (static_cast<float>(texture_detail) * 0.125f);
+}
+
 void MeshPlanet::compile()
 {
   this->compile(0);
@@ -24,12 +203,16 @@ void MeshPlanet::compile()
 void MeshPlanet::compile(unsigned subdivision, unsigned subdivision_coalesce, const HeightMapBall *hmap,
     unsigned texture_detail, unsigned volume_detail, const std::string &fname_header, bool psave)
 {
+  thr::TimelineScope timeline_subdivide("planet", "subdivide");
   this->subdivide(subdivision, true);
+  timeline_subdivide.close();
 
   // Height mapping phase. The image loads will throw an exception, and either all images are specified or none
-  // are.
+  // are. Facet pairs that need to be generated are all validated first.
   if(hmap)
   {
+    std::vector<fs::path> fnames;
+    unsigned tile_count = 0;
     for(unsigned kk = 0; (kk < 20); kk += 2)
     {
       fs::path fname;
@@ -38,20 +221,10 @@ void MeshPlanet::compile(unsigned subdivision, unsigned subdivision_coalesce, co
         sstream_fname << fname_header << "_map_" << texture_detail << "_" << (kk / 2) << ".png";
         fname = sstream_fname.str();
       }
+      fnames.push_back(fname);
 
-      if(data::file_exists(fname))
+      if(!data::file_exists(fname))
       {
-        this->addTextureFile(std::string("texture"), fname, ImageLoader().clamp().noPremultiplyAlpha());
-      }
-      else
-      {
-        ImageRGBA mtex(texture_detail, texture_detail);
-        {
-          std::stringstream sstr;
-          sstr << "creating planet facets " << kk << " and " << (kk + 1);
-          data::log(sstr.str());
-        }
-
         Lod &lod1 = *(m_lod.getRecursive()[kk + 0]),
             &lod2 = *(m_lod.getRecursive()[kk + 1]);
         Triangle &tt1 = lod1.getFaces().front(),
@@ -64,62 +237,73 @@ void MeshPlanet::compile(unsigned subdivision, unsigned subdivision_coalesce, co
         {
           BOOST_THROW_EXCEPTION(std::runtime_error("malformed triangle"));
         }
-        math::vec3f &vv1 = m_vertex[tt1.a()],
-          &vv2 = m_vertex[tt1.b()],
-          &vv3 = m_vertex[tt1.c()],
-          &vv4 = m_vertex[tt2.c()],
-          vx1(vv2 - vv1),
-          vy1(vv3 - vv1),
-          vx2(vv3 - vv4),
-          vy2(vv2 - vv4);
-
-        float fwidth = static_cast<float>(mtex.getWidth() - 1),
-              fheight = static_cast<float>(mtex.getHeight() - 1);
-        for(unsigned ii = 0; (ii < mtex.getWidth()); ++ii)
-        {
-          float fi = static_cast<float>(ii) / fwidth;
+        tile_count += facet_tile_count(texture_detail) * facet_tile_count(texture_detail);
+      }
+    }
+
+    // Pairs are generated one at a time with their tiles in parallel, so only one image is held at once.
+    // Textures are added in facet order regardless of which were generated.
+    FacetProgress progress(tile_count);
+    for(unsigned kk = 0; (kk < 20); kk += 2)
+    {
+      const fs::path &fname = fnames[kk / 2];
+
+      if(data::file_exists(fname))
+      {
+        this->addTextureFile(std::string("texture"), fname,
+            ImageLoader().clamp().noPremultiplyAlpha().cache().evictable());
+        continue;
+      }
+      std::stringstream sstr;
+      sstr << "creating planet facets " << kk << " and " << (kk + 1);
+      data::log(sstr.str());
+
+      Triangle &tt1 = m_lod.getRecursive()[kk + 0]->getFaces().front(),
+               &tt2 = m_lod.getRecursive()[kk + 1]->getFaces().front();
+      boost::scoped_ptr<FacetPair> pair(new FacetPair(texture_detail, m_vertex[tt1.a()], m_vertex[tt1.b()],
+            m_vertex[tt1.c()], m_vertex[tt2.c()]));
+      {
+        thr::TimelineScope timeline_facets("planet", "facets");
+        // Declared after the pair, so that tiles are waited for before the pair is freed on error.
+        thr::TaskGroup group;
 
-          for(unsigned jj = 0; (jj < mtex.getHeight()); ++jj)
+        for(unsigned ii = 0; (ii < texture_detail); ii += FACET_TILE)
+        {
+          for(unsigned jj = 0; (jj < texture_detail); jj += FACET_TILE)
           {
-            float fj = static_cast<float>(jj) / fheight;
-
-            math::vec3f vv;
-            if(fi + fj < 1.0f)
-            {
-              vv = (fi * vx1 + fj * vy1) + vv1;
-            }
-            else
-            {
-              vv = ((1.0f - fi) * vx2 + (1.0f - fj) * vy2) + vv4;
-            }
-
-            float ht = hmap->calcTerrain(vv);
-            math::vec3f nn = hmap->calcNormal(vv, 1.0f / (static_cast<float>(texture_detail) * 0.125f), ht);
-            nn = nn * 0.5f + 0.5f;
-            mtex.setPixel(ii, jj, math::vec4f(nn.x(), nn.y(), nn.z(), ht));
+            group.dispatch(facet_tile_task, pair.get(), hmap, ii, jj, &progress);
           }
         }
-        if(psave)
-        {
-          std::stringstream sstr;
-          sstr << "saving " << fname;
-          data::log(sstr.str());
-          mtex.write(fname);
-        }
-        Texture2D *tex = new Texture2D(mtex, ImageLoader().clamp());
-        Texture2D::store(canonize(fname), tex);
-        this->addTexture("texture", tex);
+        group.wait();
       }
+
+      thr::TimelineScope timeline_textures("planet", "textures");
+      if(psave)
+      {
+        std::stringstream sstr_save;
+        sstr_save << "saving " << fname;
+        data::log(sstr_save.str());
+        pair->m_image.write(fname);
+      }
+      // Stored first, so that the mesh references it like a loaded texture. The handle keeps it from being
+      // evicted before that.
+      Texture2D::handle_type tex = Texture2D::store(canonize(fname),
+          new Texture2D(pair->m_image, ImageLoader().clamp()), true);
+      this->addTextureFile(std::string("texture"), fname);
     }
 
     // Vertex height set phase after creating the correct polygons.
-    for(unsigned ii = 0; (ii < m_vertex.size()); ++ii)
+    if(!m_vertex.empty())
     {
-      m_vertex[ii] = hmap->normalizeHeight(m_vertex[ii]);
+      thr::TimelineScope timeline("planet", "heights");
+      hmap->normalizeHeight(&m_vertex.front(), &m_vertex.front(), static_cast<unsigned>(m_vertex.size()));
     }
   }
 
+  thr::TimelineScope timeline_coalesce("planet", "coalesce");
   this->coalesce(subdivision_coalesce, subdivision);
+  timeline_coalesce.close();
+
   this->createVolumes(fname_header, volume_detail, psave);
 
   m_color.clear();
@@ -129,8 +313,11 @@ void MeshPlanet::compile(unsigned subdivision, unsigned subdivision_coalesce, co
   data::stl_trim(m_texcoord);
   data::stl_trim(m_vertex);
 
+  thr::TimelineScope timeline_compile("planet", "compile");
   m_lod.compile(m_vertex);
+  timeline_compile.close();
 
+  thr::TimelineScope timeline_upload("planet", "upload");
   thr::wait_privileged(&Mesh::upload, this);
 }
 
@@ -83,6 +83,14 @@ namespace gfx
       virtual void createVolumes(const std::string &fname_header, unsigned vside,
           bool psave = false) = 0;
 
+    public:
+      /** \brief Get gradient distance used for surface normals.
+       *
+       * \param texture_detail Surface texture detail.
+       * \return Gradient distance for HeightMapBall::calcNormal().
+       */
+      static float gradient_distance(unsigned texture_detail);
+
     public:
       /** \cond */
       virtual void compile();
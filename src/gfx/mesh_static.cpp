@@ -7,11 +7,11 @@ namespace fs = boost::filesystem;
 namespace pt = boost::property_tree;
 using namespace gfx;
 
-static data::Registration<Mesh, MeshLoader, MeshStatic> reg("static");
+static data::Registration<Mesh, MeshLoader, MeshStatic, MeshData> reg("static");
 
-MeshStatic::MeshStatic(const fs::path &pfname, const pt::ptree &root, const MeshLoader &loader)
+MeshStatic::MeshStatic(const fs::path &pfname, const MeshData &mesh_data, const MeshLoader &loader)
 {
-  this->load(pfname, root, loader);
+  this->load(pfname, mesh_data, loader);
 }
 
 void MeshStatic::compile()
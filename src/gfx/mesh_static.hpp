@@ -24,10 +24,10 @@ namespace gfx
       /** \brief Load constructor.
        *
        * \param pfname File to load from.
-       * \param root Property tree root.
+       * \param mesh_data Mesh file contents.
        * \param loader Loader settigns.
        */
-      MeshStatic(const boost::filesystem::path &pfname, const boost::property_tree::ptree &root,
+      MeshStatic(const boost::filesystem::path &pfname, const MeshData &mesh_data,
           const MeshLoader &loader);
 
       /** \brief Destructor. */
@@ -506,7 +506,7 @@ void Shader::updateUniform(Uniform &op)
 
 void Shader::unreserve()
 {
-  thr::wait_privileged(delete_program, m_id, m_vsid, m_gsid, m_fsid);
+  thr::defer_privileged(delete_program, m_id, m_vsid, m_gsid, m_fsid);
 
   m_fshader.assign("");
   m_vshader.assign("");
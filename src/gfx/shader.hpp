@@ -181,6 +181,16 @@ namespace gfx
         return m_uniforms_common.find(op)->second;
       }
 
+    public:
+      /** \brief Get the size of shader sources.
+       *
+       * \return Size in bytes.
+       */
+      uint64_t getStorageSize() const
+      {
+        return m_vshader.size() + m_gshader.size() + m_fshader.size();
+      }
+
     public:
       /** \brief Get internal attribute.
        *
@@ -4,17 +4,17 @@
 
 using namespace gfx;
 
-static void texture_unreserve(GLuint *op)
+static void texture_unreserve(GLuint op)
 {
-  if(0 != *op)
-  {
-    glDeleteTextures(1, op);
-    *op = 0;
-  }
+  glDeleteTextures(1, &op);
 }
 
 void gfx::texture_unreserve_dispatch(GLuint *op)
 {
-  thr::wait_privileged(&texture_unreserve, op);
+  if(0 != *op)
+  {
+    thr::defer_privileged(&texture_unreserve, *op);
+    *op = 0;
+  }
 }
 
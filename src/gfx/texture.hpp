@@ -6,6 +6,8 @@
 namespace gfx
 {
   /** Texture unreserve dispatcher.
+   *
+   * Deletion is deferred to the privileged thread, the identifier is cleared immediately.
    *
    * \param op Texture to unreserve.
    */
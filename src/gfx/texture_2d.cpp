@@ -1,9 +1,12 @@
 #include "gfx/texture_2d.hpp"
 
+#include "data/generic.hpp"
 #include "data/log.hpp"
+#include "data/raw_cache.hpp"
 #include "gfx/image.hpp"
 #include "gfx/image_png.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 #include "ui/generic.hpp"
 
 namespace fs = boost::filesystem;
@@ -34,6 +37,12 @@ static void log_open(const char *type, const fs::path &pfname)
   }
 }
 
+Texture2D::Texture2D(unsigned pw, unsigned ph, unsigned pb, const void *pdata, const ImageLoader &loader) :
+  SurfaceBase(pw, ph, pb)
+{
+  thr::wait_privileged(&Texture2D::upload, this, static_cast<const uint8_t*>(pdata), loader);
+}
+
 Texture2D::Texture2D(const boost::filesystem::path &pfname, const ImageLoader &loader)
 {
   this->load(pfname, loader);
@@ -89,6 +98,27 @@ void Texture2D::adapt(const ImageRGBA &pimg, const ImageLoader &loader)
 
 void Texture2D::load(const fs::path &pfname, const ImageLoader &loader)
 {
+  fs::path cache_fname;
+  uint64_t cache_key = 0;
+
+  if(loader.hasCache())
+  {
+    cache_fname = data::raw_cache_filename(pfname);
+    cache_key = image_cache_key(pfname, loader);
+
+    if(data::file_exists(cache_fname))
+    {
+      data::RawCache cache(cache_fname);
+      if(cache.isValid(cache_key) && (1 == cache.getDepth()))
+      {
+        this->setInternalState(cache.getWidth(), cache.getHeight(), cache.getBpp());
+        log_open("cached", pfname);
+        thr::wait_privileged(&Texture2D::upload, this, cache.getData(), loader);
+        return;
+      }
+    }
+  }
+
   boost::scoped_ptr<Image> img(Image::create(pfname, loader));
 
   switch(img->getBpp())
@@ -116,6 +146,11 @@ void Texture2D::load(const fs::path &pfname, const ImageLoader &loader)
         BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
       }
   }
+
+  if(loader.hasCache())
+  {
+    image_cache_write(cache_fname, cache_key, img->getWidth(), img->getHeight(), 1, img->getBpp(), img->getData());
+  }
 }
 
 void Texture2D::upload(const uint8_t *pdata, const ImageLoader &loader)
@@ -173,6 +208,7 @@ void Texture2D::upload(const uint8_t *pdata, const ImageLoader &loader)
   GLenum pformat = bpp_to_pformat(m_b);
   glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(pformat), static_cast<GLsizei>(m_w),
       static_cast<GLsizei>(m_h), 0, pformat, GL_UNSIGNED_BYTE, pdata);
+  thr::timeline_upload(m_w * m_h * m_b / 8);
 
   if(!loader.hasGenerateMipmaps())
   {
@@ -37,6 +37,19 @@ namespace gfx
       /** \brief Empty constructor. */
       Texture2D() { }
 
+      /** \brief Constructor.
+       *
+       * Immediately adapts data from given block.
+       *
+       * \param pw Width.
+       * \param ph Height.
+       * \param pb Bit depth.
+       * \param pdata Data to adapt.
+       * \param loader Image loading options.
+       */
+      Texture2D(unsigned pw, unsigned ph, unsigned pb, const void *pdata,
+          const ImageLoader &loader = ImageLoader());
+
       /** \brief Image loading constructor.
        *
        * \param pfname Filename to load the texture from.
@@ -120,6 +133,16 @@ namespace gfx
        */
       void upload(const uint8_t *pdata, const ImageLoader &loader);
 
+    public:
+      /** \brief Get the size of texture data.
+       *
+       * \return Size in bytes, mipmaps not included.
+       */
+      uint64_t getStorageSize() const
+      {
+        return static_cast<uint64_t>(this->getWidth()) * this->getHeight() * (this->getBpp() / 8);
+      }
+
     public:
       /** \brief Accessor.
        *
@@ -1,8 +1,12 @@
 #include "gfx/texture_3d.hpp"
 
+#include "data/generic.hpp"
 #include "data/log.hpp"
+#include "data/raw_cache.hpp"
+#include "gfx/image.hpp"
 #include "gfx/volume.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 #include "ui/generic.hpp"
 
 namespace fs = boost::filesystem;
@@ -97,6 +101,27 @@ void Texture3D::adapt(const VolumeRGBA &volume, const ImageLoader &loader)
 
 void Texture3D::load(const fs::path &pfname, const ImageLoader &loader)
 {
+  fs::path cache_fname;
+  uint64_t cache_key = 0;
+
+  if(loader.hasCache())
+  {
+    cache_fname = data::raw_cache_filename(pfname);
+    cache_key = image_cache_key(pfname, loader);
+
+    if(data::file_exists(cache_fname))
+    {
+      data::RawCache cache(cache_fname);
+      if(cache.isValid(cache_key) && (1 < cache.getDepth()))
+      {
+        log_open("cached", pfname);
+        this->adapt(cache.getWidth(), cache.getHeight(), cache.getDepth(), cache.getBpp(), cache.getData(),
+            loader);
+        return;
+      }
+    }
+  }
+
   boost::scoped_ptr<Volume> img(Volume::create(pfname, loader));
 
   switch(img->getBpp())
@@ -124,6 +149,12 @@ void Texture3D::load(const fs::path &pfname, const ImageLoader &loader)
         BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
       }
   }
+
+  if(loader.hasCache())
+  {
+    image_cache_write(cache_fname, cache_key, img->getWidth(), img->getHeight(), img->getDepth(), img->getBpp(),
+        img->getData());
+  }
 }
 
 void Texture3D::upload(const void *pdata, const ImageLoader &loader)
@@ -157,6 +188,10 @@ void Texture3D::upload(const void *pdata, const ImageLoader &loader)
 
   GLenum pformat = bpp_to_pformat(m_b);
   glTexImage3D(GL_TEXTURE_3D, 0, pformat, m_w, m_h, m_d, 0, pformat, GL_UNSIGNED_BYTE, pdata);
+  if(pdata)
+  {
+    thr::timeline_upload(m_w * m_h * m_d * m_b / 8);
+  }
 
   if(!loader.hasGenerateMipmaps())
   {
@@ -156,6 +156,17 @@ namespace gfx
        */
       void load(const boost::filesystem::path &pfname, const ImageLoader &loader);
 
+    public:
+      /** \brief Get the size of texture data.
+       *
+       * \return Size in bytes.
+       */
+      uint64_t getStorageSize() const
+      {
+        return static_cast<uint64_t>(this->getWidth()) * this->getHeight() * this->getDepth() *
+          (this->getBpp() / 8);
+      }
+
     public:
       /** \brief Create implementation.
        *
@@ -101,6 +101,16 @@ namespace gfx
         return *this;
       }
 
+      /** \brief Equality comparison.
+       *
+       * \param rhs Right-hand side operand.
+       * \return True if equal, false if not.
+       */
+      bool operator==(const Triangle &rhs) const
+      {
+        return (m_corners[0] == rhs.a()) && (m_corners[1] == rhs.b()) && (m_corners[2] == rhs.c());
+      }
+
       /** \brief Indexing operator.
        *
        * Not checked, idx should be [0, 2].
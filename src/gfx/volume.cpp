@@ -1,11 +1,14 @@
 #include "gfx/volume.hpp"
 
 #include "data/generic.hpp"
+#include "data/pack.hpp"
 #include "gfx/color.hpp"
 #include "gfx/image_jpeg.hpp"
 #include "gfx/image_png.hpp"
 #include "math/generic.hpp"
 #include "math/random.hpp"
+#include "thr/task_group.hpp"
+#include "thr/timeline.hpp"
 
 #include <sstream>
 
@@ -15,6 +18,9 @@ using namespace gfx;
 /** Color value scale int <-> float. */
 static const float COLOR_SCALE = 1.0f / 255.0f;
 
+/** Number of Z slices in one Perlin noise task. */
+static const unsigned PERLIN_SLAB = 4;
+
 void Perlin::fill(VolumeGray8 &op, unsigned level)
 {
   boost::ignore_unused_variable_warning(level);
@@ -22,28 +28,95 @@ void Perlin::fill(VolumeGray8 &op, unsigned level)
   op.fillGarble();
 }
 
-Color Perlin::noise(const std::list<VolumeGray8Sptr> &op, const math::vec3d &tt)
+void Perlin::noise(Volume &dst, const PerlinSampler &op, unsigned z1, unsigned z2) const
 {
-  float ns = 0.0f,
-        wt = 1.0f;
+  unsigned octaves = op.getOctaveCount();
 
-  BOOST_FOREACH(const VolumeGray8Sptr &vv, op)
+  for(unsigned ii = z1; (ii < z2); ++ii)
   {
-    ns += wt * (vv->getAveragePixel(tt.x(), tt.y(), tt.z()) - 0.5f);
-    wt *= 0.75f;
+    for(unsigned jj = 0; (jj < dst.getHeight()); ++jj)
+    {
+      for(unsigned kk = 0; (kk < dst.getWidth()); ++kk)
+      {
+        float ns = 0.0f,
+              wt = 1.0f;
+
+        for(unsigned ll = 0; (ll < octaves); ++ll)
+        {
+          ns += wt * (op.sample(ll, kk, jj, ii) - 0.5f);
+          wt *= 0.75f;
+        }
+
+        ns = ns + 0.5f;
+        if(ns < 0.0f)
+        {
+          ns = -ns;
+        }
+        else if(ns > 1.0f)
+        {
+          ns = 2.0f - ns;
+        }
+
+        dst.setPixel(kk, jj, ii, Color(ns, ns, ns, ns));
+      }
+    }
   }
+}
 
-  ns = ns + 0.5f;
-  if(ns < 0.0f)
-  {
-    ns = -ns;
-  }
-  else if(ns > 1.0f)
+/** \brief Create taps along one axis for all octaves.
+ *
+ * \param octaves Octave volumes.
+ * \param side Destination side length along this axis.
+ * \param axis Axis index (0 = X, 1 = Y, 2 = Z).
+ * \return Taps, one row per octave.
+ */
+static std::vector<PerlinTap> perlin_taps(const std::vector<VolumeGray8Sptr> &octaves, unsigned side,
+    unsigned axis)
+{
+  std::vector<PerlinTap> ret;
+
+  BOOST_FOREACH(const VolumeGray8Sptr &vv, octaves)
   {
-    ns = 2.0f - ns;
+    unsigned dim = (0 == axis) ? vv->getWidth() : ((1 == axis) ? vv->getHeight() : vv->getDepth()),
+             stride = (0 == axis) ? 1 : ((1 == axis) ? vv->getWidth() : (vv->getWidth() * vv->getHeight()));
+
+    for(unsigned ii = 0; (ii < side); ++ii)
+    {
+      // Same computation as in VolumeGray8::getAveragePixel().
+      float pp = static_cast<float>(static_cast<double>(ii) / static_cast<double>(side - 1)),
+            rr = -0.5f + pp * static_cast<float>(dim);
+      PerlinTap tap;
+      tap.m_pwt = 1.0f - (::ceilf(rr) - rr);
+      tap.m_nwt = 1.0f - (rr - ::floorf(rr));
+      tap.m_lo = static_cast<unsigned>(math::congr(static_cast<int>(::floorf(rr)), static_cast<int>(dim))) * stride;
+      tap.m_hi = static_cast<unsigned>(math::congr(static_cast<int>(::ceilf(rr)), static_cast<int>(dim))) * stride;
+      ret.push_back(tap);
+    }
   }
+  return ret;
+}
 
-  return Color(ns, ns, ns, ns);
+PerlinSampler::PerlinSampler(const std::vector<VolumeGray8Sptr> &octaves, unsigned pw, unsigned ph,
+    unsigned pd) :
+  m_octaves(octaves),
+  m_taps_x(perlin_taps(octaves, pw, 0)),
+  m_taps_y(perlin_taps(octaves, ph, 1)),
+  m_taps_z(perlin_taps(octaves, pd, 2)),
+  m_w(pw),
+  m_h(ph),
+  m_d(pd) { }
+
+/** \brief Perlin noise task for one slab.
+ *
+ * \param op Perlin parameters.
+ * \param dst Target volume.
+ * \param sampler Noise octaves.
+ * \param z1 First Z coordinate (inclusive).
+ * \param z2 Last Z coordinate (exclusive).
+ */
+static void perlin_task(const Perlin *op, Volume *dst, const PerlinSampler *sampler, unsigned z1, unsigned z2)
+{
+  op->noise(*dst, *sampler, z1, z2);
 }
 
 /** Default Perlin noise parameters. */
@@ -70,12 +143,14 @@ void Volume::loadBase(const fs::path &pfname, const ImageLoader &loader,
 
   this->unreserve();
 
-  boost::filesystem::path location = data::open_search(pfname);
+  data::MappedFile mapped(pfname);
+  thr::timeline_read(mapped.getSize());
   if(data::filename_is_png(pfname))
   {
     if(image_png_supports_bpp(reqbpp))
     {
-      image_png_load_extended(m_w, m_h, m_d, m_b, m_data, location.generic_string(), reqbpp);
+      image_png_load_extended(m_w, m_h, m_d, m_b, m_data, pfname.generic_string(),
+          mapped.getData(), mapped.getSize(), reqbpp);
       m_filename = pfname;
     }
     else
@@ -89,7 +164,8 @@ void Volume::loadBase(const fs::path &pfname, const ImageLoader &loader,
   {
     if(image_jpeg_supports_bpp(reqbpp))
     {
-      image_jpeg_load_extended(m_w, m_h, m_d, m_b, m_data, location.generic_string(), reqbpp);
+      image_jpeg_load_extended(m_w, m_h, m_d, m_b, m_data, pfname.generic_string(),
+          mapped.getData(), mapped.getSize(), reqbpp);
       m_filename = pfname;
     }
     else
@@ -114,7 +190,8 @@ void Volume::perlinNoise(Perlin *op)
     op = &perlin_default;
   }
 
-  std::list<VolumeGray8Sptr> pn;
+  // Octaves are filled in order so that the random sequence stays the same.
+  std::vector<VolumeGray8Sptr> pn;
   for(unsigned ii = 2, level = 0; (ii <= m_d); ii*= 2, ++level)
   {
     VolumeGray8Sptr inst(new VolumeGray8(ii, ii, ii));
@@ -122,22 +199,9 @@ void Volume::perlinNoise(Perlin *op)
     op->fill(*inst, level);
   }
 
-  for(unsigned ii = 0; (ii < m_d); ++ii)
-  {
-    double di = static_cast<double>(ii) / static_cast<double>(m_d - 1);
-
-    for(unsigned jj = 0; (jj < m_h); ++jj)
-    {
-      double dj = static_cast<double>(jj) / static_cast<double>(m_h - 1);
-
-      for(unsigned kk = 0; (kk < m_w); ++kk)
-      {
-        double dk = static_cast<double>(kk) / static_cast<double>(m_w - 1);
-
-        this->setPixel(kk, jj, ii, op->noise(pn, math::vec3d(dk, dj, di)));
-      }
-    }
-  }
+  PerlinSampler sampler(pn, m_w, m_h, m_d);
+  thr::parallel_for(0, m_d, PERLIN_SLAB, boost::bind(perlin_task, op, this, &sampler,
+        boost::placeholders::_1, boost::placeholders::_2));
 }
 
 void Volume::unreserve()
@@ -188,11 +252,11 @@ void Volume::write(const boost::filesystem::path &pfname)
 
 Volume* Volume::create(const boost::filesystem::path &pfname, const ImageLoader &loader)
 {
-  boost::filesystem::path location = data::open_search(pfname);
+  data::MappedFile mapped(pfname);
 
   if(data::filename_is_png(pfname))
   {
-    unsigned bpp = image_png_probe(location.generic_string(), true);
+    unsigned bpp = image_png_probe(pfname.generic_string(), mapped.getData(), mapped.getSize(), true);
 
     switch(bpp)
     {
@@ -220,7 +284,7 @@ Volume* Volume::create(const boost::filesystem::path &pfname, const ImageLoader
   }
   else if(data::filename_is_jpeg(pfname))
   {
-    unsigned bpp = image_jpeg_probe(location.generic_string(), false);
+    unsigned bpp = image_jpeg_probe(pfname.generic_string(), mapped.getData(), mapped.getSize(), false);
 
     switch(bpp)
     {
@@ -261,7 +325,7 @@ void VolumeGray8::fillGarble()
   }
 }
 
-float VolumeGray8::getAveragePixel(float px, float py, float pz)
+float VolumeGray8::getAveragePixel(float px, float py, float pz) const
 {
   float rx = -0.5f + px * static_cast<float>(m_w),
         ry = -0.5f + py * static_cast<float>(m_h),
@@ -298,7 +362,7 @@ float VolumeGray8::getAveragePixel(float px, float py, float pz)
   return znwt * z1 + zpwt * z2;
 }
 
-float VolumeGray8::getIntensityModulod(int px, int py, int pz)
+float VolumeGray8::getIntensityModulod(int px, int py, int pz) const
 {
   unsigned ix = static_cast<unsigned>(math::congr(px, static_cast<int>(m_w)));
   unsigned iy = static_cast<unsigned>(math::congr(py, static_cast<int>(m_h)));
@@ -7,7 +7,7 @@
 
 #include <boost/filesystem.hpp>
 
-#include <list>
+#include <vector>
 
 namespace gfx
 {
@@ -122,6 +122,9 @@ namespace gfx
        * Borrows from the concept of Noise by Ken Perlin:
        * http://mrl.nyu.edu/~perlin/
        *
+       * Slabs along Z are generated in parallel. Waits for all outstanding
+       * tasks as thr::wait() does.
+       *
        * \param op Perlin parameters.
        */
       void perlinNoise(Perlin *op = NULL);
@@ -211,7 +214,7 @@ namespace gfx
        * \param px z coordinate.
        * \return Intensity value.
        */
-      float getAveragePixel(float px, float py, float pz);
+      float getAveragePixel(float px, float py, float pz) const;
 
       /** \brief Get intensity value.
        *
@@ -221,7 +224,7 @@ namespace gfx
        * \param px y coordinate.
        * \param px z coordinate.
        */
-      float getIntensityModulod(int px, int py, int pz);
+      float getIntensityModulod(int px, int py, int pz) const;
 
     public:
       /** \cond */
@@ -237,7 +240,7 @@ namespace gfx
        * \param px z coordinate.
        * \return Intensity value.
        */
-      float getAveragePixel(double px, double py, double pz)
+      float getAveragePixel(double px, double py, double pz) const
       {
         return this->getAveragePixel(static_cast<float>(px), static_cast<float>(py), static_cast<float>(pz));
       }
@@ -440,6 +443,108 @@ namespace gfx
   /** Convenience typedef. */
   typedef boost::shared_ptr<VolumeGray8> VolumeGray8Sptr;
 
+  /** \brief One axis tap of trilinear sampling.
+   */
+  struct PerlinTap
+  {
+    /** Lower neighbor offset into octave data. */
+    unsigned m_lo;
+
+    /** Upper neighbor offset into octave data. */
+    unsigned m_hi;
+
+    /** Lower neighbor weight. */
+    float m_nwt;
+
+    /** Upper neighbor weight. */
+    float m_pwt;
+  };
+
+  /** \brief Perlin noise octaves prepared for sampling a volume.
+   *
+   * Octaves are kept in a flat vector, coarsest first. Trilinear indices and
+   * weights only depend on one axis each, so they are computed once per
+   * octave and axis of the destination volume. Sampling gives the exact same
+   * result as VolumeGray8::getAveragePixel().
+   */
+  class PerlinSampler
+  {
+    private:
+      /** Octave volumes. */
+      std::vector<VolumeGray8Sptr> m_octaves;
+
+      /** Taps along X, one row per octave. */
+      std::vector<PerlinTap> m_taps_x;
+
+      /** Taps along Y, one row per octave. */
+      std::vector<PerlinTap> m_taps_y;
+
+      /** Taps along Z, one row per octave. */
+      std::vector<PerlinTap> m_taps_z;
+
+      /** Destination width. */
+      unsigned m_w;
+
+      /** Destination height. */
+      unsigned m_h;
+
+      /** Destination depth. */
+      unsigned m_d;
+
+    public:
+      /** \brief Accessor.
+       *
+       * \return Number of octaves.
+       */
+      unsigned getOctaveCount() const
+      {
+        return static_cast<unsigned>(m_octaves.size());
+      }
+
+    public:
+      /** \brief Constructor.
+       *
+       * \param octaves Octave volumes, coarsest first.
+       * \param pw Destination width.
+       * \param ph Destination height.
+       * \param pd Destination depth.
+       */
+      PerlinSampler(const std::vector<VolumeGray8Sptr> &octaves, unsigned pw, unsigned ph, unsigned pd);
+
+    public:
+      /** \brief Sample one octave.
+       *
+       * \param octave Octave index.
+       * \param px Destination X coordinate.
+       * \param py Destination Y coordinate.
+       * \param pz Destination Z coordinate.
+       * \return Intensity value.
+       */
+      float sample(unsigned octave, unsigned px, unsigned py, unsigned pz) const
+      {
+        const uint8_t *data = m_octaves[octave]->getData();
+        const PerlinTap &tx = m_taps_x[octave * m_w + px],
+              &ty = m_taps_y[octave * m_h + py],
+              &tz = m_taps_z[octave * m_d + pz];
+        float x1y1z1 = static_cast<float>(data[tz.m_lo + ty.m_lo + tx.m_lo]) * (1.0f / 255.0f),
+              x2y1z1 = static_cast<float>(data[tz.m_lo + ty.m_lo + tx.m_hi]) * (1.0f / 255.0f),
+              x1y2z1 = static_cast<float>(data[tz.m_lo + ty.m_hi + tx.m_lo]) * (1.0f / 255.0f),
+              x1y1z2 = static_cast<float>(data[tz.m_hi + ty.m_lo + tx.m_lo]) * (1.0f / 255.0f),
+              x2y2z1 = static_cast<float>(data[tz.m_lo + ty.m_hi + tx.m_hi]) * (1.0f / 255.0f),
+              x1y2z2 = static_cast<float>(data[tz.m_hi + ty.m_hi + tx.m_lo]) * (1.0f / 255.0f),
+              x2y1z2 = static_cast<float>(data[tz.m_hi + ty.m_lo + tx.m_hi]) * (1.0f / 255.0f),
+              x2y2z2 = static_cast<float>(data[tz.m_hi + ty.m_hi + tx.m_hi]) * (1.0f / 255.0f);
+        // Same order of operations as in VolumeGray8::getAveragePixel().
+        float y1z1 = tx.m_nwt * x1y1z1 + tx.m_pwt * x2y1z1,
+              y2z1 = tx.m_nwt * x1y2z1 + tx.m_pwt * x2y2z1,
+              y1z2 = tx.m_nwt * x1y1z2 + tx.m_pwt * x2y1z2,
+              y2z2 = tx.m_nwt * x1y2z2 + tx.m_pwt * x2y2z2;
+        float z1 = ty.m_nwt * y1z1 + ty.m_pwt * y2z1,
+              z2 = ty.m_nwt * y1z2 + ty.m_pwt * y2z2;
+        return tz.m_nwt * z1 + tz.m_pwt * z2;
+      }
+  };
+
   /** \brief Perlin Noise parameters class.
    *
    * Default implementation produces 'cloud' noise.
@@ -460,12 +565,16 @@ namespace gfx
        */
       virtual void fill(VolumeGray8 &op, unsigned level);
 
-      /** \brief Generates noise from noise texture list.
+      /** \brief Generates noise for a slab of the target volume.
        *
-       * \param op Target volume.
-       * \param tt Texture indexing.
+       * Called concurrently for disjoint slabs.
+       *
+       * \param dst Target volume.
+       * \param op Noise octaves.
+       * \param z1 First Z coordinate (inclusive).
+       * \param z2 Last Z coordinate (exclusive).
        */
-      virtual Color noise(const std::list<VolumeGray8Sptr> &op, const math::vec3d &tt);
+      virtual void noise(Volume &dst, const PerlinSampler &op, unsigned z1, unsigned z2) const;
   };
 }
 
@@ -876,6 +876,38 @@ namespace math
     parent::m_array[14] = tt.z();
   }
 
+  /** \brief Interpolate between two rigid transformations.
+   *
+   * The translation is interpolated linearly. The rotation is interpolated by normalized linear interpolation
+   * of the basis, which is accurate for small rotations such as between consecutive simulation steps.
+   *
+   * \param lhs Transformation at ratio 0.
+   * \param rhs Transformation at ratio 1.
+   * \param ratio Interpolation ratio.
+   * \return Interpolated transformation.
+   */
+  template<typename T> mat4<T> mix_rigid(const mat4<T> &lhs, const mat4<T> &rhs, T ratio)
+  {
+    mat4<T> ret(rhs);
+    T inv = static_cast<T>(1) - ratio;
+
+    vec3<T> up(normalize(vec3<T>(lhs(0, 1), lhs(1, 1), lhs(2, 1)) * inv +
+          vec3<T>(rhs(0, 1), rhs(1, 1), rhs(2, 1)) * ratio));
+    vec3<T> bk(normalize(vec3<T>(lhs(0, 2), lhs(1, 2), lhs(2, 2)) * inv +
+          vec3<T>(rhs(0, 2), rhs(1, 2), rhs(2, 2)) * ratio));
+    vec3<T> rt(normalize(cross(up, bk)));
+    up = cross(bk, rt);
+
+    for(unsigned ii = 0; (ii < 3); ++ii)
+    {
+      ret(ii, 0) = rt[ii];
+      ret(ii, 1) = up[ii];
+      ret(ii, 2) = bk[ii];
+      ret(ii, 3) = lhs(ii, 3) * inv + rhs(ii, 3) * ratio;
+    }
+    return ret;
+  }
+
   /** Convenience typedef. */
   typedef mat2<float> mat2f;
   
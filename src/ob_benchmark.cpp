@@ -0,0 +1,1275 @@
+#include "ob_benchmark.hpp"
+
+#include "data/loader_settings.hpp"
+#include "data/pack.hpp"
+#include "data/raw_cache.hpp"
+#include "data/store.hpp"
+#include "data/xml_file.hpp"
+#include "gfx/color.hpp"
+#include "gfx/image.hpp"
+#include "gfx/mesh_data.hpp"
+#include "gfx/mesh_planet.hpp"
+#include "gfx/volume.hpp"
+#include "math/random.hpp"
+#include "thr/dispatch.hpp"
+#include "thr/generic.hpp"
+#include "thr/task_group.hpp"
+#include "ob_constants.hpp"
+#include "ob_height_map_planet.hpp"
+#include "ob_planet.hpp"
+#include "ob_population_map.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#include <boost/atomic.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+using namespace ob;
+
+/** \brief Loader settings for stored benchmark entries.
+ */
+class BenchmarkStoredLoader :
+  public data::LoaderSettings { };
+
+/** \brief Stored benchmark entry.
+ *
+ * Stands in for stored assets in the store benchmark, with no GL or AL involved.
+ */
+class BenchmarkStored :
+  public data::Storable<BenchmarkStored, BenchmarkStoredLoader>
+{
+  public:
+    /** Name the entry was created as. */
+    std::string m_name;
+
+  public:
+    /** \brief Constructor.
+     *
+     * \param pname Name.
+     */
+    BenchmarkStored(const std::string &pname) :
+      m_name(pname) { }
+
+  public:
+    /** \brief Get the storage size.
+     *
+     * \return Size in bytes.
+     */
+    uint64_t getStorageSize() const
+    {
+      return m_name.size();
+    }
+
+  public:
+    /** \brief Create implementation.
+     *
+     * \param pfname Name.
+     * \param loader Loader settings.
+     * \return Container for the new entry.
+     */
+    static container_type createImplementation(const boost::filesystem::path &pfname,
+        const BenchmarkStoredLoader &loader)
+    {
+      boost::ignore_unused_variable_warning(loader);
+      return container_type(new BenchmarkStored(pfname.string()));
+    }
+};
+
+namespace data
+{
+  template<> BenchmarkStored::store_type data::Storable<BenchmarkStored, BenchmarkStoredLoader>::g_store(0);
+}
+
+/** \brief Benchmark function.
+ *
+ * \return True if the self-check passed.
+ */
+typedef bool (*BenchmarkFunc)();
+
+/** \brief Benchmark table entry.
+ */
+struct Benchmark
+{
+  /** Name of benchmark. */
+  const char *name;
+
+  /** Function to run. */
+  BenchmarkFunc func;
+};
+
+/** True if all benchmarks have passed. */
+static bool benchmarks_passed = true;
+
+/** \brief Print one timing line.
+ *
+ * \param name Name of timed operation.
+ * \param usec Time taken (microseconds).
+ */
+static void benchmark_print(const char *name, uint64_t usec)
+{
+  std::cout << "  " << std::left << std::setw(32) << name << std::right << std::setw(10) <<
+    (static_cast<double>(usec) / 1000.0) << " ms" << std::endl;
+}
+
+/** \brief Generate random population positions.
+ *
+ * \return Position vector.
+ */
+static std::vector<math::vec3f> benchmark_population_positions()
+{
+  std::vector<math::vec3f> ret;
+
+  for(unsigned ii = 0; (ii < OB_POPULATION_RANDOM_COUNT * 2); ++ii)
+  {
+    ret.push_back(math::vec3f(math::mrand(-1.0f, 1.0f),
+          math::mrand(-1.0f, 1.0f),
+          math::mrand(-1.0f, 1.0f)));
+  }
+  return ret;
+}
+
+/** \brief Population painting benchmark.
+ *
+ * Paints the random population of a new game both serially and with
+ * PopulationMap::paintMany and compares the results.
+ *
+ * \return True if results are identical.
+ */
+static bool benchmark_population()
+{
+  std::vector<math::vec3f> positions = benchmark_population_positions();
+
+  PopulationMap serial;
+  uint64_t stamp = thr::usec_get_timestamp();
+  BOOST_FOREACH(const math::vec3f &vv, positions)
+  {
+    serial.paint(vv, OB_POPULATION_RANDOM_BRUSH);
+  }
+  benchmark_print("paint", thr::usec_get_timestamp() - stamp);
+
+  PopulationMap parallel;
+  stamp = thr::usec_get_timestamp();
+  parallel.paintMany(positions, OB_POPULATION_RANDOM_BRUSH);
+  benchmark_print("paintMany", thr::usec_get_timestamp() - stamp);
+
+  std::cout << "  " << serial.getBrickCount() << " bricks, population " <<
+    serial.getPopulation() << std::endl;
+  return serial.equals(parallel);
+}
+
+/** \brief Read the population of every voxel of a population map.
+ *
+ * \param op Population map.
+ * \return Population values, X fastest.
+ */
+static std::vector<uint8_t> benchmark_population_voxels(const PopulationMap &op)
+{
+  std::vector<uint8_t> ret(static_cast<unsigned>(OB_POPULATION_DETAIL * OB_POPULATION_DETAIL *
+        OB_POPULATION_DETAIL));
+  unsigned idx = 0;
+
+  for(int kk = 0; (kk < OB_POPULATION_DETAIL); ++kk)
+  {
+    for(int jj = 0; (jj < OB_POPULATION_DETAIL); ++jj)
+    {
+      for(int ii = 0; (ii < OB_POPULATION_DETAIL); ++ii)
+      {
+        math::vec3i voxel(ii, jj, kk);
+        ret[idx++] = static_cast<uint8_t>(op.getPopulation(voxel, voxel));
+      }
+    }
+  }
+  return ret;
+}
+
+/** \brief Reference population filter.
+ *
+ * The per-voxel 27-sample box average the separable filter replaced. Like the
+ * original, samples (x + 1, y, z) twice and never (x + 1, y - 1, z). Border
+ * voxels are left empty.
+ *
+ * \param src Population values, X fastest.
+ * \return Filtered population values.
+ */
+static std::vector<uint8_t> benchmark_filter_reference(const std::vector<uint8_t> &src)
+{
+  static const int SIDE = OB_POPULATION_DETAIL;
+  std::vector<uint8_t> ret(src.size(), 0);
+
+  for(int kk = 1; (kk < SIDE - 1); ++kk)
+  {
+    for(int jj = 1; (jj < SIDE - 1); ++jj)
+    {
+      for(int ii = 1; (ii < SIDE - 1); ++ii)
+      {
+        int sum = 0;
+        for(int dx = -1; (dx <= 1); ++dx)
+        {
+          for(int dy = -1; (dy <= 1); ++dy)
+          {
+            int yy = ((1 == dx) && (-1 == dy)) ? jj : jj + dy;
+            for(int dz = -1; (dz <= 1); ++dz)
+            {
+              sum += src[static_cast<unsigned>(((kk + dz) * SIDE + yy) * SIDE + ii + dx)];
+            }
+          }
+        }
+        ret[static_cast<unsigned>((kk * SIDE + jj) * SIDE + ii)] = static_cast<uint8_t>(sum / 27);
+      }
+    }
+  }
+  return ret;
+}
+
+/** \brief Population filter benchmark.
+ *
+ * Paints random brushes and brushes reaching the edges of the volume, filters
+ * them and compares the result with the reference filter.
+ *
+ * \return True if results are identical.
+ */
+static bool benchmark_filter()
+{
+  std::vector<math::vec3f> positions = benchmark_population_positions();
+  positions.push_back(math::vec3f(1.0f, 0.0f, 0.0f));
+  positions.push_back(math::vec3f(-1.0f, 0.0f, 0.0f));
+  positions.push_back(math::vec3f(0.0f, 1.0f, 0.0f));
+  positions.push_back(math::vec3f(0.0f, -1.0f, 0.0f));
+  positions.push_back(math::vec3f(0.0f, 0.0f, 1.0f));
+  positions.push_back(math::vec3f(0.0f, 0.0f, -1.0f));
+
+  PopulationMap pmap;
+  pmap.paintMany(positions, OB_POPULATION_RANDOM_BRUSH);
+  std::vector<uint8_t> reference = benchmark_filter_reference(benchmark_population_voxels(pmap));
+
+  uint64_t stamp = thr::usec_get_timestamp();
+  pmap.filter();
+  benchmark_print("filter", thr::usec_get_timestamp() - stamp);
+
+  std::cout << "  " << pmap.getBrickCount() << " bricks, population " <<
+    pmap.getPopulation() << std::endl;
+  return (benchmark_population_voxels(pmap) == reference);
+}
+
+/** \brief Heightmap sampling benchmark.
+ *
+ * Samples heights and normals of random surface points and the poles both
+ * one at a time and in batches and compares the results.
+ *
+ * \return True if results are identical and all normals point outward.
+ */
+static bool benchmark_height()
+{
+  static const unsigned HEIGHT_COUNT = 65536;
+  HeightMapPlanet hmap;
+  float gdist = 1.0f / (256.0f * 0.125f);
+
+  // Poles and their immediate neighborhood degenerate with a fixed up vector.
+  std::vector<math::vec3f> pnt;
+  pnt.push_back(hmap.normalizeHeight(math::vec3f(0.0f, 1.0f, 0.0f)));
+  pnt.push_back(hmap.normalizeHeight(math::vec3f(0.0f, -1.0f, 0.0f)));
+  pnt.push_back(hmap.normalizeHeight(math::vec3f(0.001f, 1.0f, 0.0f)));
+  pnt.push_back(hmap.normalizeHeight(math::vec3f(0.0f, -1.0f, 0.001f)));
+  for(unsigned ii = static_cast<unsigned>(pnt.size()); (ii < HEIGHT_COUNT); ++ii)
+  {
+    math::vec3f dir(math::mrand(-1.0f, 1.0f),
+        math::mrand(-1.0f, 1.0f),
+        math::mrand(-1.0f, 1.0f));
+    pnt.push_back(hmap.normalizeHeight(dir));
+  }
+
+  std::vector<float> serial_ht(HEIGHT_COUNT);
+  std::vector<math::vec3f> serial_nn(HEIGHT_COUNT);
+  uint64_t stamp = thr::usec_get_timestamp();
+  for(unsigned ii = 0; (ii < HEIGHT_COUNT); ++ii)
+  {
+    serial_ht[ii] = hmap.calcTerrain(pnt[ii]);
+    serial_nn[ii] = hmap.calcNormal(pnt[ii], gdist, serial_ht[ii]);
+  }
+  benchmark_print("calcTerrain + calcNormal", thr::usec_get_timestamp() - stamp);
+
+  std::vector<float> batch_ht(HEIGHT_COUNT);
+  std::vector<math::vec3f> batch_nn(HEIGHT_COUNT);
+  stamp = thr::usec_get_timestamp();
+  hmap.calcTerrain(&pnt.front(), &batch_ht.front(), HEIGHT_COUNT);
+  hmap.calcNormal(&pnt.front(), &batch_ht.front(), gdist, &batch_nn.front(), HEIGHT_COUNT);
+  benchmark_print("batch", thr::usec_get_timestamp() - stamp);
+
+  for(unsigned ii = 0; (ii < HEIGHT_COUNT); ++ii)
+  {
+    if((serial_ht[ii] != batch_ht[ii]) || (serial_nn[ii] != batch_nn[ii]))
+    {
+      std::cout << "  mismatch at " << pnt[ii] << ": " << serial_ht[ii] << " / " << serial_nn[ii] <<
+        " vs. " << batch_ht[ii] << " / " << batch_nn[ii] << std::endl;
+      return false;
+    }
+    // Fails for NaN normals as well.
+    if(!(math::dot(serial_nn[ii], math::normalize(pnt[ii])) > 0.0f))
+    {
+      std::cout << "  degenerate normal at " << pnt[ii] << ": " << serial_nn[ii] << std::endl;
+      return false;
+    }
+  }
+  std::cout << "  " << HEIGHT_COUNT << " points" << std::endl;
+  return true;
+}
+
+/** \brief Normal cube map benchmark.
+ *
+ * Builds a normal cube map and compares its lookups against calcNormal() for
+ * random surface points.
+ *
+ * \return True if the average deviation is within quantization error.
+ */
+static bool benchmark_normals()
+{
+  static const unsigned NORMAL_COUNT = 65536;
+  static const unsigned NORMAL_SIDE = 512;
+  HeightMapPlanet hmap;
+  float gdist = gfx::MeshPlanet::gradient_distance(NORMAL_SIDE);
+
+  uint64_t stamp = thr::usec_get_timestamp();
+  hmap.loadNormals(NORMAL_SIDE, gdist, "/nonexistent/benchmark");
+  benchmark_print("loadNormals", thr::usec_get_timestamp() - stamp);
+
+  std::vector<math::vec3f> pnt;
+  for(unsigned ii = 0; (ii < NORMAL_COUNT); ++ii)
+  {
+    pnt.push_back(math::normalize(math::vec3f(math::mrand(-1.0f, 1.0f),
+            math::mrand(-1.0f, 1.0f),
+            math::mrand(-1.0f, 1.0f))));
+  }
+
+  std::vector<float> ht(NORMAL_COUNT);
+  std::vector<math::vec3f> calc_nn(NORMAL_COUNT),
+    lookup_nn(NORMAL_COUNT);
+  hmap.calcHeight(&pnt.front(), &ht.front(), NORMAL_COUNT);
+  stamp = thr::usec_get_timestamp();
+  hmap.calcNormal(&pnt.front(), &ht.front(), gdist, &calc_nn.front(), NORMAL_COUNT);
+  benchmark_print("calcNormal", thr::usec_get_timestamp() - stamp);
+
+  stamp = thr::usec_get_timestamp();
+  for(unsigned ii = 0; (ii < NORMAL_COUNT); ++ii)
+  {
+    lookup_nn[ii] = hmap.lookupNormal(pnt[ii]);
+  }
+  benchmark_print("lookupNormal", thr::usec_get_timestamp() - stamp);
+
+  double deviation = 0.0;
+  for(unsigned ii = 0; (ii < NORMAL_COUNT); ++ii)
+  {
+    deviation += 1.0 - static_cast<double>(math::dot(calc_nn[ii], lookup_nn[ii]));
+  }
+  deviation /= static_cast<double>(NORMAL_COUNT);
+  std::cout << "  average deviation " << deviation << std::endl;
+  return (deviation < 0.01);
+}
+
+/** \brief Perlin noise benchmark.
+ *
+ * Generates a cloud noise volume with Volume::perlinNoise and compares it
+ * against direct per-voxel sampling of the same octaves.
+ *
+ * \return True if results are identical.
+ */
+static bool benchmark_perlin()
+{
+  static const unsigned PERLIN_SIDE = 64;
+  static const uint32_t PERLIN_SEED = 1;
+  gfx::VolumeGray8 vol(PERLIN_SIDE, PERLIN_SIDE, PERLIN_SIDE);
+
+  math::global_mrgen.seed(PERLIN_SEED);
+  uint64_t stamp = thr::usec_get_timestamp();
+  vol.perlinNoise();
+  benchmark_print("perlinNoise", thr::usec_get_timestamp() - stamp);
+
+  // Reference octaves are filled in the same order from the same seed.
+  math::global_mrgen.seed(PERLIN_SEED);
+  std::vector<gfx::VolumeGray8Sptr> octaves;
+  for(unsigned ii = 2; (ii <= PERLIN_SIDE); ii *= 2)
+  {
+    octaves.push_back(gfx::VolumeGray8Sptr(new gfx::VolumeGray8(ii, ii, ii)));
+    octaves.back()->fillGarble();
+  }
+
+  gfx::VolumeGray8 ref(PERLIN_SIDE, PERLIN_SIDE, PERLIN_SIDE);
+  stamp = thr::usec_get_timestamp();
+  for(unsigned ii = 0; (ii < PERLIN_SIDE); ++ii)
+  {
+    double di = static_cast<double>(ii) / static_cast<double>(PERLIN_SIDE - 1);
+
+    for(unsigned jj = 0; (jj < PERLIN_SIDE); ++jj)
+    {
+      double dj = static_cast<double>(jj) / static_cast<double>(PERLIN_SIDE - 1);
+
+      for(unsigned kk = 0; (kk < PERLIN_SIDE); ++kk)
+      {
+        double dk = static_cast<double>(kk) / static_cast<double>(PERLIN_SIDE - 1);
+        float ns = 0.0f,
+              wt = 1.0f;
+
+        BOOST_FOREACH(const gfx::VolumeGray8Sptr &vv, octaves)
+        {
+          ns += wt * (vv->getAveragePixel(dk, dj, di) - 0.5f);
+          wt *= 0.75f;
+        }
+        ns = ns + 0.5f;
+        if(ns < 0.0f)
+        {
+          ns = -ns;
+        }
+        else if(ns > 1.0f)
+        {
+          ns = 2.0f - ns;
+        }
+        ref.setPixel(kk, jj, ii, gfx::Color(ns, ns, ns, ns));
+      }
+    }
+  }
+  benchmark_print("getAveragePixel", thr::usec_get_timestamp() - stamp);
+
+  return std::equal(vol.getData(), vol.getData() + vol.getSizeBytes(), ref.getData());
+}
+
+/** \brief Raw cache benchmark.
+ *
+ * Loads a planet map both by decoding the PNG and from a raw cache and
+ * compares the results. Cache lookup includes hashing the source file.
+ *
+ * \return True if results are identical.
+ */
+static bool benchmark_cache()
+{
+  std::string fname;
+  {
+    std::ostringstream sstr;
+    sstr << PLANET_FILENAME << "_map_512_0.png";
+    fname = sstr.str();
+  }
+  gfx::ImageLoader loader = gfx::ImageLoader().clamp().noPremultiplyAlpha().cache();
+  boost::filesystem::path cache_fname = boost::filesystem::temp_directory_path() / "ob_benchmark.raw";
+
+  uint64_t stamp = thr::usec_get_timestamp();
+  boost::scoped_ptr<gfx::Image> img(gfx::Image::create(fname, loader));
+  benchmark_print("decode png", thr::usec_get_timestamp() - stamp);
+
+  uint64_t key = gfx::image_cache_key(fname, loader);
+  data::raw_cache_write(cache_fname, key, img->getWidth(), img->getHeight(), 1, img->getBpp(),
+      img->getData());
+
+  stamp = thr::usec_get_timestamp();
+  bool ret;
+  {
+    data::RawCache cache(cache_fname);
+    ret = cache.isValid(gfx::image_cache_key(fname, loader)) &&
+      (cache.getWidth() == img->getWidth()) &&
+      (cache.getHeight() == img->getHeight()) &&
+      (cache.getBpp() == img->getBpp()) &&
+      std::equal(img->getData(), img->getData() + img->getSizeBytes(), cache.getData());
+  }
+  benchmark_print("hash, map and compare", thr::usec_get_timestamp() - stamp);
+
+  boost::filesystem::remove(cache_fname);
+  return ret;
+}
+
+/** \brief Binary mesh benchmark.
+ *
+ * Reads the siegecruiser meshes both from XML and from binary meshes and
+ * compares the results. Binary reading includes checking the source file
+ * size and modification time.
+ *
+ * \return True if results are identical.
+ */
+static bool benchmark_mesh()
+{
+  static const char *fnames[] =
+  {
+    "mdl/siegecruiser_0.mesh", "mdl/siegecruiser_1.mesh", "mdl/siegecruiser_2.mesh", "mdl/siegecruiser_3.mesh",
+    "mdl/siegecruiser_4.mesh", "mdl/siegecruiser_5.mesh", "mdl/siegecruiser_6.mesh", "mdl/siegecruiser-0.mesh",
+    "mdl/siegecruiser-1.mesh", "mdl/siegecruiser-2.mesh", "mdl/siegecruiser-3.mesh", "mdl/siegecruiser-4.mesh",
+    NULL
+  };
+  boost::filesystem::path bin_fname = boost::filesystem::temp_directory_path() / "ob_benchmark.bmesh";
+  uint64_t time_xml = 0;
+  uint64_t time_binary = 0;
+  bool ret = true;
+
+  for(const char **ii = fnames; (*ii); ++ii)
+  {
+    uint64_t stamp = thr::usec_get_timestamp();
+    data::XmlFile xml_file(*ii);
+    gfx::MeshData xml_data(xml_file.tree());
+    time_xml += thr::usec_get_timestamp() - stamp;
+
+    uint64_t source_size = 0;
+    uint64_t source_time = 0;
+    bool valid = data::file_stamp(*ii, source_size, source_time);
+    xml_data.writeBinary(bin_fname, source_size, source_time);
+
+    stamp = thr::usec_get_timestamp();
+    gfx::MeshData bin_data;
+    uint64_t check_size = 0;
+    uint64_t check_time = 0;
+    valid = valid && data::file_stamp(*ii, check_size, check_time) && (check_size == source_size) &&
+      (check_time == source_time) && bin_data.readBinary(bin_fname);
+    time_binary += thr::usec_get_timestamp() - stamp;
+
+    ret = ret && valid &&
+      (xml_data.m_type == bin_data.m_type) &&
+      (xml_data.m_textures == bin_data.m_textures) &&
+      (xml_data.m_flags == bin_data.m_flags) &&
+      (xml_data.m_offset == bin_data.m_offset) &&
+      (xml_data.m_scale == bin_data.m_scale) &&
+      (xml_data.m_color == bin_data.m_color) &&
+      (xml_data.m_normal == bin_data.m_normal) &&
+      (xml_data.m_reference == bin_data.m_reference) &&
+      (xml_data.m_texcoord == bin_data.m_texcoord) &&
+      (xml_data.m_vertex == bin_data.m_vertex) &&
+      (xml_data.m_weight == bin_data.m_weight) &&
+      (xml_data.m_faces == bin_data.m_faces);
+  }
+  benchmark_print("parse xml", time_xml);
+  benchmark_print("stat, map and copy binary", time_binary);
+
+  boost::filesystem::remove(bin_fname);
+  return ret;
+}
+
+/** \brief Pack benchmark.
+ *
+ * Packs the model and texture files, then reads every file both as a loose
+ * file stream and straight from the pack mapping and compares the contents.
+ *
+ * \return True if contents are identical.
+ */
+static bool benchmark_pack()
+{
+  static const char *dirs[] = { "gfx", "mdl", NULL };
+  boost::filesystem::path pack_fname = boost::filesystem::temp_directory_path() / "ob_benchmark.pack";
+  std::vector<boost::filesystem::path> files;
+
+  for(const char **ii = dirs; (*ii); ++ii)
+  {
+    for(boost::filesystem::recursive_directory_iterator jj(*ii), ee; (jj != ee); ++jj)
+    {
+      if(boost::filesystem::is_regular_file(jj->status()))
+      {
+        files.push_back(jj->path());
+      }
+    }
+  }
+
+  uint64_t stamp = thr::usec_get_timestamp();
+  data::pack_write(pack_fname, files);
+  benchmark_print("write pack", thr::usec_get_timestamp() - stamp);
+
+  std::vector<uint64_t> loose_hashes;
+  stamp = thr::usec_get_timestamp();
+  BOOST_FOREACH(const boost::filesystem::path &vv, files)
+  {
+    data::shristr fd = data::open_read(vv);
+    std::vector<char> contents((std::istreambuf_iterator<char>(*fd)), std::istreambuf_iterator<char>());
+    loose_hashes.push_back(contents.empty() ? data::hash_data(NULL, 0) :
+        data::hash_data(&contents.front(), contents.size()));
+  }
+  benchmark_print("open and read loose files", thr::usec_get_timestamp() - stamp);
+
+  bool ret = true;
+  stamp = thr::usec_get_timestamp();
+  {
+    data::Pack pack(pack_fname);
+
+    for(unsigned ii = 0; (ii < files.size()); ++ii)
+    {
+      const uint8_t *pdata;
+      size_t psize;
+
+      ret = ret && pack.find(files[ii], pdata, psize) && (data::hash_data(pdata, psize) == loose_hashes[ii]);
+    }
+  }
+  benchmark_print("map pack and read entries", thr::usec_get_timestamp() - stamp);
+
+  std::cout << "  " << files.size() << " files" << std::endl;
+  boost::filesystem::remove(pack_fname);
+  return ret;
+}
+
+/** \brief Store lookups as done before lock striping.
+ *
+ * One mutex over a map keyed by path, for comparison.
+ */
+class BenchmarkStoreSingle
+{
+  private:
+    /** Entries. */
+    std::map<boost::filesystem::path, BenchmarkStored::container_type> m_data;
+
+    /** Guards the entries. */
+    boost::mutex m_mutex;
+
+  public:
+    /** \brief Store an entry.
+     *
+     * \param pfname Name.
+     */
+    void store(const boost::filesystem::path &pfname)
+    {
+      boost::mutex::scoped_lock scope(m_mutex);
+
+      m_data[pfname.stem()] = BenchmarkStored::container_type(new BenchmarkStored(pfname.string()));
+    }
+
+    /** \brief Find an entry.
+     *
+     * \param pfname Name.
+     * \return Container.
+     */
+    BenchmarkStored::container_type& locate(const boost::filesystem::path &pfname)
+    {
+      boost::mutex::scoped_lock scope(m_mutex);
+
+      return m_data.find(pfname.stem())->second;
+    }
+};
+
+/** Number of entries in the store benchmark. */
+static const unsigned STORE_ENTRY_COUNT = 512;
+
+/** Number of lookups per thread in the store benchmark. */
+static const unsigned STORE_LOCATE_COUNT = 100000;
+
+/** \brief Look up entries from a single mutex store.
+ *
+ * \param store Store.
+ * \param names Names to look up.
+ * \param first Index of first lookup.
+ * \param ret Set to false on a wrong result.
+ */
+static void benchmark_store_single(BenchmarkStoreSingle *store, const std::vector<boost::filesystem::path> *names,
+    unsigned first, bool *ret)
+{
+  for(unsigned ii = 0; (ii < STORE_LOCATE_COUNT); ++ii)
+  {
+    const boost::filesystem::path &name = (*names)[(first + ii) % names->size()];
+
+    if(store->locate(name).at()->m_name != name.string())
+    {
+      *ret = false;
+    }
+  }
+}
+
+/** \brief Look up entries from the store.
+ *
+ * \param names Names to look up.
+ * \param first Index of first lookup.
+ * \param ret Set to false on a wrong result.
+ */
+static void benchmark_store_locate(const std::vector<boost::filesystem::path> *names, unsigned first, bool *ret)
+{
+  for(unsigned ii = 0; (ii < STORE_LOCATE_COUNT); ++ii)
+  {
+    const boost::filesystem::path &name = (*names)[(first + ii) % names->size()];
+
+    if(BenchmarkStored::locate(name).at()->m_name != name.string())
+    {
+      *ret = false;
+    }
+  }
+}
+
+/** \brief Look up entries through handles.
+ *
+ * \param handles Handles to look up through.
+ * \param names Names of the handles.
+ * \param first Index of first lookup.
+ * \param ret Set to false on a wrong result.
+ */
+static void benchmark_store_handle(const std::vector<BenchmarkStored::handle_type> *handles,
+    const std::vector<boost::filesystem::path> *names, unsigned first, bool *ret)
+{
+  for(unsigned ii = 0; (ii < STORE_LOCATE_COUNT); ++ii)
+  {
+    unsigned idx = static_cast<unsigned>((first + ii) % names->size());
+
+    if((*handles)[idx]->at()->m_name != (*names)[idx].string())
+    {
+      *ret = false;
+    }
+  }
+}
+
+/** \brief Run a lookup function in many threads.
+ *
+ * \param name Name of timed operation.
+ * \param func Function taking the index of first lookup and the result flag.
+ * \return True if all lookups were correct.
+ */
+static bool benchmark_store_threads(const char *name, const boost::function<void(unsigned, bool*)> &func)
+{
+  unsigned thread_count = thr::hardware_concurrency() * 2;
+  boost::scoped_array<bool> results(new bool[thread_count]);
+  boost::thread_group threads;
+
+  uint64_t stamp = thr::usec_get_timestamp();
+  for(unsigned ii = 0; (ii < thread_count); ++ii)
+  {
+    results[ii] = true;
+    threads.create_thread(boost::bind(func, ii * 7919, &results[ii]));
+  }
+  threads.join_all();
+  benchmark_print(name, thr::usec_get_timestamp() - stamp);
+
+  return std::find(results.get(), results.get() + thread_count, false) == results.get() + thread_count;
+}
+
+/** \brief Store contention benchmark.
+ *
+ * Creates entries in parallel, then looks them up from twice as many
+ * threads as there are hardware threads. Lookups are timed from a single
+ * mutex store as before lock striping, from the striped store and through
+ * handles. All lookups are checked to return the right entry.
+ *
+ * \return True if all lookups were correct.
+ */
+static bool benchmark_store()
+{
+  std::vector<boost::filesystem::path> names;
+  BenchmarkStoreSingle single;
+
+  for(unsigned ii = 0; (ii < STORE_ENTRY_COUNT); ++ii)
+  {
+    std::ostringstream sstr;
+    sstr << "entry_" << ii;
+    names.push_back(sstr.str());
+    single.store(names.back());
+  }
+
+  uint64_t stamp = thr::usec_get_timestamp();
+  BOOST_FOREACH(const boost::filesystem::path &vv, names)
+  {
+    BenchmarkStored::createParaller(vv);
+  }
+  thr::wait();
+  benchmark_print("createParaller", thr::usec_get_timestamp() - stamp);
+
+  std::vector<BenchmarkStored::handle_type> handles;
+  BOOST_FOREACH(const boost::filesystem::path &vv, names)
+  {
+    handles.push_back(BenchmarkStored::handle(vv));
+  }
+
+  std::cout << "  " << (thr::hardware_concurrency() * 2) << " threads, " << STORE_LOCATE_COUNT <<
+    " lookups each" << std::endl;
+  bool ret = benchmark_store_threads("locate, single mutex",
+      boost::bind(benchmark_store_single, &single, &names, boost::placeholders::_1, boost::placeholders::_2));
+  ret = benchmark_store_threads("locate, striped",
+      boost::bind(benchmark_store_locate, &names, boost::placeholders::_1, boost::placeholders::_2)) && ret;
+  ret = benchmark_store_threads("handle",
+      boost::bind(benchmark_store_handle, &handles, &names, boost::placeholders::_1,
+        boost::placeholders::_2)) && ret;
+
+  handles.clear();
+  BenchmarkStored::storageClear();
+  return ret;
+}
+
+/** Thread counts for the scheduler benchmark, including the main thread. */
+static const unsigned SCHEDULER_THREADS[] = { 2, 4, 8, 16, 32, 0 };
+
+/** Number of root tasks in the scheduler throughput test. */
+static const unsigned SCHEDULER_ROOT_COUNT = 64;
+
+/** Number of leaf tasks dispatched from each root task. */
+static const unsigned SCHEDULER_LEAF_COUNT = 2048;
+
+/** Number of wake-up latency samples. */
+static const unsigned SCHEDULER_WAKE_COUNT = 100;
+
+/** \brief Scheduler benchmark leaf task.
+ *
+ * \param counter Counter to increment.
+ */
+static void benchmark_scheduler_leaf(boost::atomic<unsigned> *counter)
+{
+  ++(*counter);
+}
+
+/** \brief Scheduler benchmark root task.
+ *
+ * \param counter Counter to pass to leaves.
+ */
+static void benchmark_scheduler_root(boost::atomic<unsigned> *counter)
+{
+  for(unsigned ii = 0; (ii < SCHEDULER_LEAF_COUNT); ++ii)
+  {
+    thr::dispatch(benchmark_scheduler_leaf, counter);
+  }
+}
+
+/** \brief Scheduler benchmark wake-up task.
+ *
+ * \param stamp Where to store time of execution.
+ */
+static void benchmark_scheduler_wake(uint64_t *stamp)
+{
+  *stamp = thr::usec_get_timestamp();
+}
+
+/** \brief Scheduler benchmark.
+ *
+ * For each thread count, measures the throughput of small tasks fanned out
+ * from a number of root tasks and the latency from dispatching a task into
+ * an idle dispatcher to it starting. Every leaf task is checked to have run.
+ *
+ * \return True if all tasks were run.
+ */
+static bool benchmark_scheduler()
+{
+  bool ret = true;
+
+  for(const unsigned *ii = SCHEDULER_THREADS; (*ii); ++ii)
+  {
+    thr::thr_reserve(*ii - 1);
+
+    boost::atomic<unsigned> counter(0);
+    uint64_t stamp = thr::usec_get_timestamp();
+    for(unsigned jj = 0; (jj < SCHEDULER_ROOT_COUNT); ++jj)
+    {
+      thr::dispatch(benchmark_scheduler_root, &counter);
+    }
+    thr::wait();
+    uint64_t throughput_usec = std::max(thr::usec_get_timestamp() - stamp, static_cast<uint64_t>(1));
+    unsigned task_count = SCHEDULER_ROOT_COUNT * (SCHEDULER_LEAF_COUNT + 1);
+
+    uint64_t wake_usec = 0;
+    for(unsigned jj = 0; (jj < SCHEDULER_WAKE_COUNT); ++jj)
+    {
+      uint64_t start;
+
+      // Let the workers fall asleep.
+      thr::usec_sleep(1000);
+      stamp = thr::usec_get_timestamp();
+      thr::dispatch(benchmark_scheduler_wake, &start);
+      thr::wait();
+      wake_usec += start - stamp;
+    }
+
+    std::cout << "  " << std::setw(2) << *ii << " threads: " << std::setw(10) <<
+      static_cast<uint64_t>(static_cast<double>(task_count) * 1000000.0 /
+          static_cast<double>(throughput_usec)) << " tasks/s, wake-up " << std::setw(6) <<
+      (static_cast<double>(wake_usec) / static_cast<double>(SCHEDULER_WAKE_COUNT)) << " us" << std::endl;
+
+    if(counter.load() != SCHEDULER_ROOT_COUNT * SCHEDULER_LEAF_COUNT)
+    {
+      std::cout << "  " << counter.load() << " leaf tasks run, expected " <<
+        (SCHEDULER_ROOT_COUNT * SCHEDULER_LEAF_COUNT) << std::endl;
+      ret = false;
+    }
+  }
+
+  return ret;
+}
+
+/** Number of root tasks in the task allocation test. */
+static const unsigned TASK_ROOT_COUNT = 64;
+
+/** Number of leaf tasks dispatched from each root task. */
+static const unsigned TASK_LEAF_COUNT = 1024;
+
+/** \brief Task benchmark leaf task.
+ *
+ * Takes enough arguments not to fit inside a boost::function.
+ *
+ * \param counter Counter to increment.
+ * \param aa First value.
+ * \param bb Second value.
+ * \param cc Third value.
+ * \param dd Fourth value.
+ */
+static void benchmark_tasks_leaf(boost::atomic<unsigned> *counter, unsigned aa, unsigned bb, unsigned cc,
+    unsigned dd)
+{
+  if((aa == cc) && (bb == dd))
+  {
+    ++(*counter);
+  }
+}
+
+/** \brief Task benchmark root task, leaves through boost::function.
+ *
+ * \param counter Counter to pass to leaves.
+ * \param root Index of this root.
+ */
+static void benchmark_tasks_root_function(boost::atomic<unsigned> *counter, unsigned root)
+{
+  for(unsigned ii = 0; (ii < TASK_LEAF_COUNT); ++ii)
+  {
+    thr::dispatch_ext(thr::Task(boost::bind(benchmark_tasks_leaf, counter, root, ii, root, ii)));
+  }
+}
+
+/** \brief Task benchmark root task, leaves through task objects.
+ *
+ * \param counter Counter to pass to leaves.
+ * \param root Index of this root.
+ */
+static void benchmark_tasks_root_object(boost::atomic<unsigned> *counter, unsigned root)
+{
+  for(unsigned ii = 0; (ii < TASK_LEAF_COUNT); ++ii)
+  {
+    thr::dispatch(benchmark_tasks_leaf, counter, root, ii, root, ii);
+  }
+}
+
+/** \brief Run one round of the task benchmark.
+ *
+ * \param name Name of timed operation, NULL to not print.
+ * \param root Root task function.
+ * \param allocations Where to store the number of heap allocations done by task objects.
+ * \return True if all tasks were run.
+ */
+static bool benchmark_tasks_round(const char *name, void (*root)(boost::atomic<unsigned>*, unsigned),
+    unsigned *allocations)
+{
+  boost::atomic<unsigned> counter(0);
+
+  unsigned allocations_before = thr::task_allocation_count();
+  uint64_t stamp = thr::usec_get_timestamp();
+  for(unsigned ii = 0; (ii < TASK_ROOT_COUNT); ++ii)
+  {
+    thr::dispatch(root, &counter, ii);
+  }
+  thr::wait();
+  uint64_t usec = thr::usec_get_timestamp() - stamp;
+  *allocations = thr::task_allocation_count() - allocations_before;
+
+  if(name)
+  {
+    benchmark_print(name, usec);
+  }
+  return (counter.load() == TASK_ROOT_COUNT * TASK_LEAF_COUNT);
+}
+
+/** \brief Task allocation benchmark.
+ *
+ * Dispatches small tasks with bound arguments through boost::function and
+ * through task objects. Heap allocations are counted by the task object pool,
+ * which covers both pool growth and functors too large for inline storage.
+ * After warming up, dispatching task objects must not allocate.
+ *
+ * \return True if all tasks were run and task objects did not allocate.
+ */
+static bool benchmark_tasks()
+{
+  unsigned task_count = TASK_ROOT_COUNT * (TASK_LEAF_COUNT + 1);
+  unsigned function_allocations;
+  unsigned object_allocations;
+  bool ret = true;
+
+  // Warm up pools and queues.
+  for(unsigned ii = 0; (ii < 2); ++ii)
+  {
+    ret = benchmark_tasks_round(NULL, benchmark_tasks_root_function, &function_allocations) && ret;
+    ret = benchmark_tasks_round(NULL, benchmark_tasks_root_object, &object_allocations) && ret;
+  }
+
+  ret = benchmark_tasks_round("boost::function", benchmark_tasks_root_function, &function_allocations) && ret;
+  ret = benchmark_tasks_round("task objects", benchmark_tasks_root_object, &object_allocations) && ret;
+
+  std::cout << "  " << task_count << " tasks, task object allocations " << object_allocations << " (" <<
+    thr::task_allocation_count() << " in total)" << std::endl;
+
+  // Pool growth from a change in how threads share the work is tolerated, per-task allocation is not.
+  return ret && (object_allocations * 1000 < task_count);
+}
+
+/** Number of elements in the parallel loop test. */
+static const unsigned GROUP_ELEMENT_COUNT = 1 << 22;
+
+/** Grain size in the parallel loop test. */
+static const unsigned GROUP_GRAIN = 4096;
+
+/** Number of jobs before a continuation. */
+static const unsigned GROUP_JOB_COUNT = 256;
+
+/** Number of nested loop indices calling the privileged thread. */
+static const unsigned GROUP_PRIVILEGED_COUNT = 64;
+
+/** \brief Sum a range of elements.
+ *
+ * \param src Elements.
+ * \param sum Sum to add to.
+ * \param first First index.
+ * \param last One past last index.
+ */
+static void benchmark_groups_sum(const std::vector<uint32_t> *src, boost::atomic<uint64_t> *sum, unsigned first,
+    unsigned last)
+{
+  uint64_t ret = 0;
+
+  for(unsigned ii = first; (ii < last); ++ii)
+  {
+    ret += (*src)[ii];
+  }
+  *sum += ret;
+}
+
+/** \brief Increment a counter.
+ *
+ * \param counter Counter.
+ */
+static void benchmark_groups_count(boost::atomic<unsigned> *counter)
+{
+  ++(*counter);
+}
+
+/** \brief Continuation recording the counter.
+ *
+ * \param counter Counter.
+ * \param seen Where to store the value of the counter.
+ */
+static void benchmark_groups_continuation(boost::atomic<unsigned> *counter, unsigned *seen)
+{
+  *seen = counter->load();
+}
+
+/** \brief Privileged part of the nested loop.
+ *
+ * \param value Value to increment.
+ */
+static void benchmark_groups_privileged(unsigned *value)
+{
+  ++(*value);
+}
+
+/** \brief Inner part of the nested loop, calls the privileged thread.
+ *
+ * \param values Values to increment.
+ * \param first First index.
+ * \param last One past last index.
+ */
+static void benchmark_groups_inner(unsigned *values, unsigned first, unsigned last)
+{
+  for(unsigned ii = first; (ii < last); ++ii)
+  {
+    thr::wait_privileged(benchmark_groups_privileged, values + ii);
+  }
+}
+
+/** \brief Outer part of the nested loop, executed in the privileged thread.
+ *
+ * \param values Values to increment.
+ */
+static void benchmark_groups_outer(std::vector<unsigned> *values)
+{
+  thr::parallel_for(0, static_cast<unsigned>(values->size()), 1,
+      boost::bind(benchmark_groups_inner, &values->front(), boost::placeholders::_1, boost::placeholders::_2));
+}
+
+/** \brief Job failing with an error.
+ */
+static void benchmark_groups_fail()
+{
+  BOOST_THROW_EXCEPTION(std::runtime_error("intentional error"));
+}
+
+/** \brief Task group benchmark.
+ *
+ * Times a parallel loop summing elements against a serial loop, and
+ * checks that continuations run after their group, that a parallel loop
+ * in the privileged thread can wait for privileged jobs of its own tasks
+ * and that errors in jobs are passed to the waiter.
+ *
+ * \return True if all checks passed.
+ */
+static bool benchmark_groups()
+{
+  bool ret = true;
+
+  std::vector<uint32_t> elements(GROUP_ELEMENT_COUNT);
+  for(unsigned ii = 0; (ii < GROUP_ELEMENT_COUNT); ++ii)
+  {
+    elements[ii] = ii * 2654435761U;
+  }
+
+  boost::atomic<uint64_t> serial(0);
+  uint64_t stamp = thr::usec_get_timestamp();
+  benchmark_groups_sum(&elements, &serial, 0, GROUP_ELEMENT_COUNT);
+  benchmark_print("serial loop", thr::usec_get_timestamp() - stamp);
+
+  boost::atomic<uint64_t> parallel(0);
+  stamp = thr::usec_get_timestamp();
+  thr::parallel_for(0, GROUP_ELEMENT_COUNT, GROUP_GRAIN, boost::bind(benchmark_groups_sum, &elements, &parallel,
+        boost::placeholders::_1, boost::placeholders::_2));
+  benchmark_print("parallel_for", thr::usec_get_timestamp() - stamp);
+  if(parallel.load() != serial.load())
+  {
+    std::cout << "  parallel sum " << parallel.load() << ", expected " << serial.load() << std::endl;
+    ret = false;
+  }
+
+  boost::atomic<unsigned> counter(0);
+  unsigned seen = 0;
+  {
+    thr::TaskGroup first;
+    thr::TaskGroup second;
+
+    for(unsigned ii = 0; (ii < GROUP_JOB_COUNT); ++ii)
+    {
+      first.dispatch(benchmark_groups_count, &counter);
+    }
+    first.then(second, boost::bind(benchmark_groups_continuation, &counter, &seen));
+    second.wait();
+  }
+  if(seen != GROUP_JOB_COUNT)
+  {
+    std::cout << "  continuation saw " << seen << " jobs, expected " << GROUP_JOB_COUNT << std::endl;
+    ret = false;
+  }
+
+  std::vector<unsigned> values(GROUP_PRIVILEGED_COUNT, 0);
+  thr::wait_privileged(benchmark_groups_outer, &values);
+  if(std::count(values.begin(), values.end(), 1U) != static_cast<int>(GROUP_PRIVILEGED_COUNT))
+  {
+    std::cout << "  nested privileged jobs not all run" << std::endl;
+    ret = false;
+  }
+
+  {
+    thr::TaskGroup group;
+    bool caught = false;
+
+    group.dispatch(benchmark_groups_fail);
+    try
+    {
+      group.wait();
+    }
+    catch(const std::runtime_error&)
+    {
+      caught = true;
+    }
+    if(!caught)
+    {
+      std::cout << "  error in job not passed to waiter" << std::endl;
+      ret = false;
+    }
+  }
+
+  return ret;
+}
+
+/** \brief Worker scaling benchmark.
+ *
+ * Runs the same planet generation workload, a perlin noise volume and a
+ * normal cube map, with one to as many active workers as there are
+ * processors and prints the speedup over one worker. Leaves the last worker
+ * count active.
+ *
+ * \return True if the noise volumes are identical for all worker counts.
+ */
+static bool benchmark_scaling()
+{
+  static const unsigned SCALING_PERLIN_SIDE = 64;
+  static const unsigned SCALING_NORMAL_SIDE = 256;
+  static const uint32_t SCALING_SEED = 1;
+  unsigned count = thr::hardware_concurrency();
+  float gdist = gfx::MeshPlanet::gradient_distance(SCALING_NORMAL_SIDE);
+  HeightMapPlanet hmap;
+  std::vector<uint8_t> reference;
+  uint64_t base_usec = 0;
+  bool ret = true;
+
+  for(unsigned ii = 1; (ii <= count); ++ii)
+  {
+    gfx::VolumeGray8 vol(SCALING_PERLIN_SIDE, SCALING_PERLIN_SIDE, SCALING_PERLIN_SIDE);
+
+    thr::thr_workers(ii);
+
+    math::global_mrgen.seed(SCALING_SEED);
+    uint64_t stamp = thr::usec_get_timestamp();
+    vol.perlinNoise();
+    hmap.loadNormals(SCALING_NORMAL_SIDE, gdist, "/nonexistent/benchmark");
+    uint64_t usec = std::max(thr::usec_get_timestamp() - stamp, static_cast<uint64_t>(1));
+
+    if(1 == ii)
+    {
+      base_usec = usec;
+      reference.assign(vol.getData(), vol.getData() + vol.getSizeBytes());
+    }
+    else if(!std::equal(reference.begin(), reference.end(), vol.getData()))
+    {
+      std::cout << "  noise volume differs with " << ii << " workers" << std::endl;
+      ret = false;
+    }
+
+    std::cout << "  " << std::setw(2) << ii << " workers: " << std::setw(10) <<
+      (static_cast<double>(usec) / 1000.0) << " ms, speedup " <<
+      (static_cast<double>(base_usec) / static_cast<double>(usec)) << std::endl;
+  }
+
+  return ret;
+}
+
+/** Benchmark table. */
+static const Benchmark benchmarks[] =
+{
+  { "population", benchmark_population },
+  { "filter", benchmark_filter },
+  { "height", benchmark_height },
+  { "normals", benchmark_normals },
+  { "perlin", benchmark_perlin },
+  { "cache", benchmark_cache },
+  { "mesh", benchmark_mesh },
+  { "pack", benchmark_pack },
+  { "store", benchmark_store },
+  { "scheduler", benchmark_scheduler },
+  { "tasks", benchmark_tasks },
+  { "groups", benchmark_groups },
+  { "scaling", benchmark_scaling },
+  { NULL, NULL }
+};
+
+void ob::benchmark_run(const std::string &op)
+{
+  bool found = false;
+
+  for(const Benchmark *ii = benchmarks; (ii->name); ++ii)
+  {
+    if((op != "all") && (op != ii->name))
+    {
+      continue;
+    }
+    found = true;
+
+    std::cout << ii->name << ":" << std::endl;
+    thr::telemetry_reset();
+    bool passed = ii->func();
+    if(thr::telemetry_enabled())
+    {
+      thr::telemetry_report(std::cout);
+    }
+    std::cout << "  " << (passed ? "ok" : "FAILED") << std::endl;
+    benchmarks_passed = benchmarks_passed && passed;
+  }
+
+  if(!found)
+  {
+    std::cerr << "unknown benchmark: " << op << std::endl;
+    benchmarks_passed = false;
+  }
+
+  thr::thr_quit();
+}
+
+bool ob::benchmark_passed()
+{
+  return benchmarks_passed;
+}
@@ -0,0 +1,26 @@
+#ifndef OB_BENCHMARK_HPP
+#define OB_BENCHMARK_HPP
+
+#include <string>
+
+namespace ob
+{
+  /** \brief Run headless benchmarks.
+   *
+   * To be run in a separate thread while the main thread is executing
+   * thr::thr_main(). Quits the threading system when done.
+   *
+   * Each benchmark prints its timings and checks its own results.
+   *
+   * \param op Name of benchmark to run or "all".
+   */
+  extern void benchmark_run(const std::string &op);
+
+  /** \brief Tell if the benchmarks run passed their checks.
+   *
+   * \return True if all passed.
+   */
+  extern bool benchmark_passed();
+}
+
+#endif
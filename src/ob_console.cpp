@@ -1,5 +1,11 @@
 #include "ob_console.hpp"
 
+#include "thr/dispatch.hpp"
+#include "ob_globals.hpp"
+#include "ob_settings.hpp"
+
+#include <sstream>
+
 using namespace ob;
 
 Console::Console(const gfx::Font &fnt, float fs,
@@ -14,6 +20,85 @@ Console::Console(const gfx::Font &fnt, float fs,
   m_color_text_bottom = gfx::Color(0.04f, 0.00f, 0.00f, 0.94f);
 }
 
+void Console::execute()
+{
+  std::string line = ui::str_utf8(this->getInput().getLine());
+  std::istringstream command(line);
+  std::stringstream result;
+  std::string name;
+
+  this->ui::Console::execute();
+  command >> name;
+
+  if(0 == name.compare("stores"))
+  {
+    glob_store_report(result);
+  }
+  else if(0 == name.compare("store"))
+  {
+    command >> name;
+    if(!glob_store_report(result, name))
+    {
+      result << "unknown store: " << name << '\n';
+    }
+  }
+  else if(0 == name.compare("budget"))
+  {
+    unsigned budget;
+
+    command >> name >> budget;
+    if(command.fail())
+    {
+      result << "usage: budget <store> <megabytes>\n";
+    }
+    else if(!glob_store_budget(name, budget))
+    {
+      result << "unknown store: " << name << '\n';
+    }
+    else
+    {
+      conf->setBudget(name, budget);
+      glob_store_report(result, name);
+    }
+  }
+  else if(0 == name.compare("scheduler"))
+  {
+    std::string mode;
+
+    command >> mode;
+    if(0 == mode.compare("on"))
+    {
+      thr::telemetry_enable(true);
+    }
+    else if(0 == mode.compare("off"))
+    {
+      thr::telemetry_enable(false);
+    }
+    else if(0 == mode.compare("reset"))
+    {
+      thr::telemetry_reset();
+    }
+    else if(!mode.empty())
+    {
+      result << "usage: scheduler [on|off|reset]\n";
+    }
+    else
+    {
+      thr::telemetry_report(result);
+    }
+  }
+  else if(!name.empty())
+  {
+    result << "unknown command: " << name << '\n';
+  }
+
+  std::string row;
+  while(std::getline(result, row))
+  {
+    this->addRow(row);
+  }
+}
+
 void Console::render(gfx::SurfaceScreen &screen)
 {
   this->ui::Console::render(screen);
@@ -24,6 +24,16 @@ namespace ob
       virtual ~Console() { }
 
     public:
+      /** \brief Execute and clear the input line.
+       *
+       * Known commands:
+       * - stores: Show residency of all stores.
+       * - store <name>: Show residency of a store by entry.
+       * - budget <name> <megabytes>: Set the memory budget of a store, 0 for unlimited.
+       * - scheduler [on|off|reset]: Show scheduler telemetry, or start, stop or clear recording it.
+       */
+      virtual void execute();
+
       /** \cond */
       virtual void render(gfx::SurfaceScreen &screen);
       /** \endcond */
@@ -172,6 +172,9 @@ namespace ob
   /** Population map detail level. */
   static const int OB_POPULATION_DETAIL = 256;
 
+  /** Population map brick side length, must divide the detail level. */
+  static const int OB_POPULATION_BRICK = 8;
+
   /** After this, population may be capped. */
   static const int OB_POPULATION_RANDOM_LIMIT = 144;
 
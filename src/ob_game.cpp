@@ -4,6 +4,7 @@
 #include "gfx/image_png.hpp"
 #include "gfx/mesh_static.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 #include "ui/text_area.hpp"
 #include "ui/ui_stack.hpp"
 #include "ob_constants.hpp"
@@ -242,6 +243,34 @@ void mouse_grab_off()
   SDL_EventState(SDL_MOUSEMOTION, SDL_ENABLE);
 }
 
+/** \brief Generate random population positions on land.
+ *
+ * \return Position vector.
+ */
+std::vector<math::vec3f> random_population_positions()
+{
+  std::vector<math::vec3f> candidates,
+    ret;
+  std::vector<float> ht(OB_POPULATION_RANDOM_COUNT);
+
+  for(unsigned ii = 0; (ii < OB_POPULATION_RANDOM_COUNT); ++ii)
+  {
+    candidates.push_back(math::vec3f(math::mrand(-1.0f, 1.0f),
+          math::mrand(-1.0f, 1.0f),
+          math::mrand(-1.0f, 1.0f)));
+  }
+  glob->getHeightMapPlanet().calcHeight(&candidates.front(), &ht.front(), OB_POPULATION_RANDOM_COUNT);
+
+  for(unsigned ii = 0; (ii < OB_POPULATION_RANDOM_COUNT); ++ii)
+  {
+    if(ht[ii] > OB_TERRAIN_LEVEL)
+    {
+      ret.push_back(candidates[ii]);
+    }
+  }
+  return ret;
+}
+
 GLuint fb;
 GLuint ftex;
 
@@ -304,45 +333,30 @@ Game::Game() :
   glob_set_game(this);
 
   // Population paint.
+  thr::TimelineScope timeline_paint("game", "paint");
   for(unsigned ii = 0; (ii < OB_CITY_COUNT); ++ii)
   {
     City *city = new City(m_population, glob->getHeightMapPlanet());
     this->addCity(city);
   }
-  for(unsigned ii = 0; (ii < OB_POPULATION_RANDOM_COUNT); ++ii)
-  {
-    math::vec3f rndpos(math::mrand(-1.0f, 1.0f),
-        math::mrand(-1.0f, 1.0f),
-        math::mrand(-1.0f, 1.0f));
-    if(glob->getHeightMapPlanet().calcHeight(rndpos) > OB_TERRAIN_LEVEL)
-    {
-      m_population.paint(rndpos, OB_POPULATION_RANDOM_BRUSH);
-    }
-  }
+  m_population.paintMany(random_population_positions(), OB_POPULATION_RANDOM_BRUSH);
   m_population.scale(0.45f);
   BOOST_FOREACH(const CityMap::value_type &vv, m_cities)
   {
     vv.second->paintCenter(m_population, glob->getHeightMapPlanet());
   }
-  for(unsigned ii = 0; (ii < OB_POPULATION_RANDOM_COUNT); ++ii)
-  {
-    math::vec3f rndpos(math::mrand(-1.0f, 1.0f),
-        math::mrand(-1.0f, 1.0f),
-        math::mrand(-1.0f, 1.0f));
-    if(glob->getHeightMapPlanet().calcHeight(rndpos) > OB_TERRAIN_LEVEL)
-    {
-      m_population.paint(rndpos, OB_POPULATION_RANDOM_BRUSH);
-    }
-  }
-  //m_population.filter();
+  m_population.paintMany(random_population_positions(), OB_POPULATION_RANDOM_BRUSH);
+  m_population.filter();
 #if defined(DEBUG)
-  std::cout << "population: " << m_population.getPopulation() << std::endl;
+  std::cout << "population: " << m_population.getPopulation() << " in " <<
+    m_population.getBrickCount() << " bricks" << std::endl;
 #endif
+  timeline_paint.close();
   m_population.refresh();
 
   //std::cout << "game reset\n";
 #if !defined(DEBUG) // debug mode disables mouse grab by default
-  thr::wait_privileged(mouse_grab_on);
+  thr::defer_privileged(mouse_grab_on);
 #endif
   //std::cout << "mouse grabbed\n";
   
@@ -365,7 +379,7 @@ Game::Game() :
 
 Game::~Game()
 {
-  thr::wait_privileged(mouse_grab_off);
+  thr::defer_privileged(mouse_grab_off);
 
   //std::cout << "bullets\n";
   m_bullets_flak.clear();
@@ -1030,7 +1044,7 @@ void Game::renderSub(gfx::SurfaceScreen &screen, ui::UiStack &st, GameStatusEnum
   const gfx::Shader &sh_planet(glob->getShaderPlanet());
   const gfx::Shader &sh_planet_schematic(glob->getShaderPlanetSchematic());
   const gfx::Shader &sh_sun(glob->getShaderSun());
-  const math::mat4f &view = m_view.getCameraMatrix();
+  const math::mat4f view = m_view.getCameraMatrixInterpolated();
   math::vec3f fw = math::vec3f(-view(2, 0), -view(2, 1), -view(2, 2));
   math::vec3f up = math::vec3f(-view(1, 0), -view(1, 1), -view(1, 2));
   float frame_count = static_cast<float>(st.getFrameCount());
@@ -1561,8 +1575,10 @@ void Game::renderSub(gfx::SurfaceScreen &screen, ui::UiStack &st, GameStatusEnum
     gfx::bind_shader_2d_font();
     gfx::load_identity();
 
+    const ui::FpsCounter &fps_counter = st.getFpsCounter();
     std::stringstream fstr;
-    fstr << st.getFps();
+    fstr << st.getFps() << " fps " << (fps_counter.getFrameTime(0.99) / 1000) << " ms p99 " <<
+      fps_counter.getHitches() << " hitches";
     std::wstring fps = ui::wstr_utf8(fstr.str());
     draw_text(0.052f, 0.048f, 0.05f, fps, fnt, gfx::Color(0.0f, 0.0f, 0.0f, 1.0f));
     draw_text(0.05f, 0.05f, 0.05f, fps, fnt, gfx::Color(1.0f, 1.0f, 1.0f, 1.0f));
@@ -1653,10 +1669,34 @@ void Game::render(ui::UiStack &st, gfx::SurfaceScreen &screen)
   screen.update();
 }
 
+void Game::storeTransforms()
+{
+  BOOST_FOREACH(const BulletFlakMap::value_type &vv, m_bullets_flak)
+  {
+    vv.second->storeWm();
+  }
+  BOOST_FOREACH(const BulletRailgunMap::value_type &vv, m_bullets_railgun)
+  {
+    vv.second->storeWm();
+  }
+  BOOST_FOREACH(const MissileMap::value_type &vv, m_missiles_anti)
+  {
+    vv.second->storeWm();
+  }
+  BOOST_FOREACH(const MissileMap::value_type &vv, m_missiles_nuke)
+  {
+    vv.second->storeWm();
+  }
+  m_view.storeState();
+}
+
 void Game::update(ui::UiStack &st)
 {
   GameStatusEnum status = this->getGameStatus();
 
+  // Rendering interpolates from the state before this step.
+  this->storeTransforms();
+
   // If dead or out of nukes and escaping, freeze frame and update the score.
   if(OVER == status)
   {
@@ -1673,6 +1713,9 @@ void Game::update(ui::UiStack &st)
     this->updateSub(st, status);
   }
 
+  // Upload population changes of this frame.
+  m_population.flush();
+
   // Update fade status.
   fade.update();
 }
@@ -559,6 +559,12 @@ namespace ob
        */
       void drawHud(gfx::SurfaceScreen &screen, std::priority_queue<Target> &pri);
 
+      /** \brief Store the transforms of moving objects and the view.
+       *
+       * Done before each simulation step so rendering can interpolate from the previous step.
+       */
+      void storeTransforms();
+
       /** \brief Update the game state.
        *
        * \param screen Screen construct.
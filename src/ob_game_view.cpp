@@ -95,6 +95,24 @@ void GameView::cancelCourse()
   m_flag_course_change = false;
 }
 
+math::mat4f GameView::getCameraMatrixInterpolated() const
+{
+  float ratio = gfx::get_interpolation();
+  if(!m_wm_prev_valid || (ratio >= 1.0f))
+  {
+    return m_camera_matrix;
+  }
+
+  // Interpolate the camera orientations the view matrices were made from.
+  math::mat4f prev = m_camera_matrix_prev;
+  math::mat4f curr = m_camera_matrix;
+  prev.convertToView();
+  curr.convertToView();
+  math::mat4f ret = math::mix_rigid(prev, curr, ratio);
+  ret.convertToView();
+  return ret;
+}
+
 void GameView::gamisticEffect(void *args)
 {
   boost::ignore_unused_variable_warning(args);
@@ -173,6 +191,12 @@ void GameView::spawnExplosion()
   }
 }
 
+void GameView::storeState()
+{
+  this->storeWm();
+  m_camera_matrix_prev = m_camera_matrix;
+}
+
 void GameView::rotate(double rx, double ry)
 {
   m_rot.x() = math::min(math::max(rx + m_rot.x(), static_cast<double>(-1.0)),
@@ -28,6 +28,9 @@ namespace ob
       /** Relative matrix in object space. */
       math::mat4f m_camera_matrix;
 
+      /** Camera matrix of the previous simulation step. */
+      math::mat4f m_camera_matrix_prev;
+
       /** Matrix for course marker. */
       math::mat4f m_course_matrix;
 
@@ -101,6 +104,14 @@ namespace ob
       /** \brief Cancel course change. */
       void cancelCourse();
 
+      /** \brief Get the camera matrix to render with.
+       *
+       * Interpolated between the previous and the current camera matrix by the render interpolation ratio.
+       *
+       * \return Camera matrix.
+       */
+      math::mat4f getCameraMatrixInterpolated() const;
+
       /** \brief Increment escape speed.
        *
        * To be done once per frame once game has been won.
@@ -120,6 +131,10 @@ namespace ob
        */
       void spawnExplosion();
 
+      /** \brief Store the current matrices as the previous simulation step.
+       */
+      void storeState();
+
       /** \brief Update course marker.
        *
        * \param tgt Target course destination.
@@ -1,6 +1,8 @@
 #include "ob_globals.hpp"
 
+#include "data/load_graph.hpp"
 #include "data/log.hpp"
+#include "thr/timeline.hpp"
 #include "gfx/mesh_static.hpp"
 #include "thr/dispatch.hpp"
 #include "ob_atmosphere.hpp"
@@ -8,6 +10,8 @@
 #include "ob_game.hpp"
 #include "ob_menu_state.hpp"
 #include "ob_planet.hpp"
+#include "ob_population_map.hpp"
+#include "ob_settings.hpp"
 #include "ob_visualization_city.hpp"
 #include "ob_visualization_distort.hpp"
 #include "ob_visualization_flak.hpp"
@@ -23,10 +27,21 @@ using namespace ob;
 
 bool Globals::generate_enabled = false;
 
+bool Globals::progressive_enabled = false;
+
 Fade ob::fade;
 Game *ob::game = NULL;
 Globals *ob::glob = NULL;
 
+/** Planet subdivision for progressive startup, as in laptop detail. */
+static const unsigned PROGRESSIVE_SUBDIVIDE = 6;
+
+/** Planet texture detail for progressive startup, as in laptop detail. */
+static const unsigned PROGRESSIVE_TEXSIZE = 512;
+
+/** Planet volume detail for progressive startup, as in laptop detail. */
+static const unsigned PROGRESSIVE_VOLSIZE = 64;
+
 /** The game thread has stopped processing. */
 static bool game_is_ready = false;
 
@@ -45,11 +60,54 @@ static void glob_task_game()
     sstr << "can't create a game task when previous game task exists";
     BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
   }
+  glob->upgradePlanet();
   new Game(); // Will set the global value by itself.
   game_is_ready = true;
   fade.setDelta(-OB_FADE_DELTA);
 }
 
+/** \brief Store accessible by name.
+ */
+struct GlobStore
+{
+  /** Store name. */
+  const char *m_name;
+
+  /** Budget setter. */
+  void (*m_budget)(uint64_t);
+
+  /** Residency report. */
+  void (*m_report)(std::ostream&, bool);
+};
+
+/** Stores by name. */
+static const GlobStore glob_stores[] =
+{
+  { "font", &gfx::Font::storageBudget, &gfx::Font::storageReport },
+  { "mesh", &gfx::Mesh::storageBudget, &gfx::Mesh::storageReport },
+  { "sample", &snd::Sample::storageBudget, &snd::Sample::storageReport },
+  { "shader", &gfx::Shader::storageBudget, &gfx::Shader::storageReport },
+  { "texture_2d", &gfx::Texture2D::storageBudget, &gfx::Texture2D::storageReport },
+  { "texture_3d", &gfx::Texture3D::storageBudget, &gfx::Texture3D::storageReport },
+};
+
+/** \brief Find a store by name.
+ *
+ * \param name Store name.
+ * \return Store or NULL.
+ */
+static const GlobStore* glob_find_store(const std::string &name)
+{
+  BOOST_FOREACH(const GlobStore &vv, glob_stores)
+  {
+    if(0 == name.compare(vv.m_name))
+    {
+      return &vv;
+    }
+  }
+  return NULL;
+}
+
 /** \brirf Log to console.
  *
  * \param op String to log.
@@ -59,6 +117,120 @@ static void log_console(const std::string &op)
   glob->getConsole().addRow(ui::wstr_utf8(op));
 }
 
+/** \brief Task for creating the atmosphere.
+ *
+ * \param subdivide Planet subdivision.
+ * \param coalesce Planet coalesce.
+ */
+static void glob_task_atmosphere(unsigned subdivide, unsigned coalesce)
+{
+  gfx::Mesh::store("atmosphere", new Atmosphere(subdivide - 2, coalesce));
+}
+
+/** \brief Task for creating the planet.
+ *
+ * \param subdivide Planet subdivision.
+ * \param coalesce Planet coalesce.
+ * \param texsize Planet texture and heightmap detail.
+ * \param volsize Planet volumetric texture detail.
+ * \param hmap Height map to use.
+ */
+static void glob_task_planet(unsigned subdivide, unsigned coalesce, unsigned texsize, unsigned volsize,
+    HeightMapPlanet *hmap)
+{
+  gfx::Mesh::store("planet", new Planet(subdivide, coalesce, texsize, volsize, hmap,
+        Globals::is_generate_enabled()));
+}
+
+/** \brief Get a planet map or volume filename.
+ *
+ * \param type Either "map" or "volume".
+ * \param detail Texture or volume detail.
+ * \param idx Index of the map or volume.
+ * \return Filename.
+ */
+static std::string glob_planet_filename(const char *type, unsigned detail, unsigned idx)
+{
+  std::ostringstream sstr;
+  sstr << PLANET_FILENAME << '_' << type << '_' << detail << '_' << idx << ".png";
+  return sstr.str();
+}
+
+/** \brief Add the planet into a load graph.
+ *
+ * The planet depends on the planet maps and volumes that are available, and generates the rest.
+ *
+ * \param graph Load graph.
+ * \param subdivide Planet subdivision.
+ * \param coalesce Planet coalesce.
+ * \param texsize Planet texture and heightmap detail.
+ * \param volsize Planet volumetric texture detail.
+ * \param hmap Height map to use.
+ */
+static void glob_add_planet(data::LoadGraph &graph, unsigned subdivide, unsigned coalesce, unsigned texsize,
+    unsigned volsize, HeightMapPlanet *hmap)
+{
+  std::vector<std::string> planet_depends;
+
+  bool planet_maps_missing = false;
+  for(unsigned ii = 0; (ii < 10); ++ii)
+  {
+    std::string fname = glob_planet_filename("map", texsize, ii);
+
+    if(data::file_exists(fname))
+    {
+      graph.add(fname, gfx::Texture2D::createTask(fname,
+            gfx::ImageLoader().clamp().noPremultiplyAlpha().cache().evictable()));
+      planet_depends.push_back(fname);
+    }
+    else
+    {
+      planet_maps_missing = true;
+    }
+  }
+
+  for(unsigned ii = 0; (ii < 2); ++ii)
+  {
+    std::string fname = glob_planet_filename("volume", volsize, ii);
+
+    if(data::file_exists(fname))
+    {
+      graph.add(fname, gfx::Texture3D::createTask(fname,
+            gfx::ImageLoader().noPremultiplyAlpha().cache().evictable()));
+      planet_depends.push_back(fname);
+    }
+  }
+
+  // Planet maps that need to be generated look up their normals from the cube map.
+  if(planet_maps_missing)
+  {
+    graph.add("planet_normals", boost::bind(&HeightMapPlanet::loadNormals, hmap, texsize,
+          gfx::MeshPlanet::gradient_distance(texsize), PLANET_FILENAME, Globals::is_generate_enabled()));
+    planet_depends.push_back("planet_normals");
+  }
+
+  graph.add("planet", boost::bind(glob_task_planet, subdivide, coalesce, texsize, volsize, hmap), planet_depends);
+}
+
+/** \brief Task for loading a skybox mesh.
+ *
+ * \param mesh Mesh filename.
+ * \param texture Environment map filename, already loaded.
+ */
+static void glob_task_skybox(const std::string &mesh, const std::string &texture)
+{
+  gfx::Mesh::create(mesh).get()->addTextureFile(std::string("texture"), texture);
+}
+
+/** \brief Task for creating a visualization.
+ *
+ * \param name Name to store as.
+ */
+template <class T> static void glob_task_visualization(const char *name)
+{
+  gfx::Mesh::store(name, new T());
+}
+
 Globals::Globals(const gfx::SurfaceScreen &pscreen, const std::string &pdetail) :
   m_detail_level(pdetail),
   m_font("fnt/default.xml"),
@@ -67,6 +239,7 @@ Globals::Globals(const gfx::SurfaceScreen &pscreen, const std::string &pdetail)
   m_cursor_default(SDL_GetCursor()),
   m_menu_game(MenuState::create_menu_game()),
   m_menu_main(MenuState::create_menu_main()),
+  m_planet_upgrade(NULL),
   m_precalculated(false) { }
 
 Globals::~Globals()
@@ -110,50 +283,73 @@ void Globals::precalc()
 
 void Globals::precalc(unsigned subdivide, unsigned coalesce, unsigned texsize, unsigned volsize)
 {
+  uint64_t precalc_start = thr::usec_get_timestamp();
+  thr::TimelineScope timeline_interactive("startup", "interactive");
+
   thr::wait_privileged(&Globals::unreserve, this);
 
-  gfx::Texture2D::createParaller("gfx/console_background.png");
-  snd::play_stream("snd/music_menu.ogg");
+  data::LoadGraph graph;
 
-  thr::wait();
+  graph.add("gfx/console_background.png", gfx::Texture2D::createTask("gfx/console_background.png"));
 
-  m_console.setBackground(gfx::Texture2D::locate("console_background").get().get());
-  
-  gfx::Shader::createParaller("shader/3d_static.xml");
-  gfx::Shader::createParaller("shader/3d_overlay.xml");
-  gfx::Shader::createParaller("shader/3d_point_sprite.xml");
-  gfx::Shader::createParaller("shader/3d_overlay_line.xml");
-  gfx::Shader::createParaller("shader/ob_atmosphere.xml");
-  gfx::Shader::createParaller("shader/ob_distort.xml");
-  gfx::Shader::createParaller("shader/ob_sun.xml");
-  gfx::Shader::createParaller("shader/ob_world.xml");
-  gfx::Shader::createParaller("shader/ob_world_schematic.xml");
-
-  gfx::Texture2D::createParaller("gfx/textures/texture_flak_ammo.png");
-  gfx::Texture2D::createParaller("gfx/textures/icon_bullet_flak.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/icon_bullet_railgun.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/icon_city.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/icon_missile_anti_nuke.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/icon_missile_anti_ship.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/icon_silo.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/mainmenu_background.png");
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_missile_anti_nuke.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_warning_yellow_frame_1.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_missile_anti_ship.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_warning_red_frame_1.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_missile_nuke.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/texture_nuke_ammo.png");
-  gfx::Texture2D::createParaller("gfx/textures/texture_railgun_ammo.png");
-  gfx::Texture2D::createParaller("gfx/textures/texture_reload.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_silo_anti_nuke.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_silo_anti_nuke_new.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_silo_anti_ship.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_silo_anti_ship_new.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_silo_both.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_silo_both_new.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/texture_skull.png");
-  gfx::Texture2D::createParaller("gfx/billboards/billboard_target.png", gfx::ImageLoader().clamp());
-  gfx::Texture2D::createParaller("gfx/textures/texture_trace.png");
+  const char *fname_shader[] =
+  {
+    "shader/3d_static.xml",
+    "shader/3d_overlay.xml",
+    "shader/3d_point_sprite.xml",
+    "shader/3d_overlay_line.xml",
+    "shader/ob_atmosphere.xml",
+    "shader/ob_distort.xml",
+    "shader/ob_sun.xml",
+    "shader/ob_world.xml",
+    "shader/ob_world_schematic.xml"
+  };
+  for(unsigned ii = 0; (ii < sizeof(fname_shader) / sizeof(const char*)); ++ii)
+  {
+    graph.add(fname_shader[ii], gfx::Shader::createTask(fname_shader[ii]));
+  }
+
+  const char *fname_texture[] =
+  {
+    "gfx/textures/texture_flak_ammo.png",
+    "gfx/mainmenu_background.png",
+    "gfx/textures/texture_nuke_ammo.png",
+    "gfx/textures/texture_railgun_ammo.png",
+    "gfx/textures/texture_skull.png",
+    "gfx/textures/texture_trace.png"
+  };
+  for(unsigned ii = 0; (ii < sizeof(fname_texture) / sizeof(const char*)); ++ii)
+  {
+    graph.add(fname_texture[ii], gfx::Texture2D::createTask(fname_texture[ii]));
+  }
+
+  const char *fname_texture_clamp[] =
+  {
+    "gfx/textures/icon_bullet_flak.png",
+    "gfx/textures/icon_bullet_railgun.png",
+    "gfx/textures/icon_city.png",
+    "gfx/textures/icon_missile_anti_nuke.png",
+    "gfx/textures/icon_missile_anti_ship.png",
+    "gfx/textures/icon_silo.png",
+    "gfx/billboards/billboard_missile_anti_nuke.png",
+    "gfx/billboards/billboard_warning_yellow_frame_1.png",
+    "gfx/billboards/billboard_missile_anti_ship.png",
+    "gfx/billboards/billboard_warning_red_frame_1.png",
+    "gfx/billboards/billboard_missile_nuke.png",
+    "gfx/textures/texture_reload.png",
+    "gfx/billboards/billboard_silo_anti_nuke.png",
+    "gfx/billboards/billboard_silo_anti_nuke_new.png",
+    "gfx/billboards/billboard_silo_anti_ship.png",
+    "gfx/billboards/billboard_silo_anti_ship_new.png",
+    "gfx/billboards/billboard_silo_both.png",
+    "gfx/billboards/billboard_silo_both_new.png",
+    "gfx/billboards/billboard_target.png"
+  };
+  for(unsigned ii = 0; (ii < sizeof(fname_texture_clamp) / sizeof(const char*)); ++ii)
+  {
+    graph.add(fname_texture_clamp[ii], gfx::Texture2D::createTask(fname_texture_clamp[ii],
+          gfx::ImageLoader().clamp()));
+  }
 
   const char *fname_particle[OB_PARTICLE_COUNT] =
   {
@@ -189,97 +385,96 @@ void Globals::precalc(unsigned subdivide, unsigned coalesce, unsigned texsize, u
   };
   for(unsigned ii = 0; (ii < OB_PARTICLE_COUNT); ++ii)
   {
-    gfx::Texture2D::createParaller(fname_particle[ii], gfx::ImageLoader().clamp());
+    graph.add(fname_particle[ii], gfx::Texture2D::createTask(fname_particle[ii], gfx::ImageLoader().clamp()));
   }
 
-  // Speed up planet creation by potentially loading planet maps, slight code duplication.
-  for(unsigned ii = 0; (ii < 10); ++ii)
+  // Progressive startup reaches the menu with a low detail planet and upgrades it afterwards.
+  bool progressive = progressive_enabled &&
+    ((subdivide > PROGRESSIVE_SUBDIVIDE) || (texsize > PROGRESSIVE_TEXSIZE) || (volsize > PROGRESSIVE_VOLSIZE));
+  if(progressive)
   {
-    std::ostringstream sstream_fname;
-    sstream_fname << PLANET_FILENAME << "_map_" << texsize << "_" << ii << ".png";
-    std::string fname = sstream_fname.str();
-
-    if(data::file_exists(fname))
-    {
-      gfx::Texture2D::createParaller(fname, gfx::ImageLoader().clamp().noPremultiplyAlpha());
-    }
+    glob_add_planet(graph, PROGRESSIVE_SUBDIVIDE, coalesce, PROGRESSIVE_TEXSIZE, PROGRESSIVE_VOLSIZE,
+        &m_height_map_planet);
   }
-
-  // Speed up planet creation by potentially loading planet volumes, slight code duplication.
-  for(unsigned ii = 0; (ii < 2); ++ii)
+  else
   {
-    std::ostringstream sstream_fname;
-    sstream_fname << PLANET_FILENAME << "_volume_" << volsize << "_" << ii << ".png";
-    std::string fname = sstream_fname.str();
+    glob_add_planet(graph, subdivide, coalesce, texsize, volsize, &m_height_map_planet);
+  }
 
-    if(data::file_exists(fname))
-    {
-      gfx::Texture3D::createParaller(fname, gfx::ImageLoader().noPremultiplyAlpha());
-    }
+  // Each skybox mesh depends on its environment map.
+  const char *skybox_side[] =
+  {
+    "back",
+    "bottom",
+    "front",
+    "left",
+    "right",
+    "top"
+  };
+  for(unsigned ii = 0; (ii < sizeof(skybox_side) / sizeof(const char*)); ++ii)
+  {
+    std::ostringstream sstr_environ;
+    sstr_environ << "gfx/maps/enviroment_map_" << skybox_side[ii] << '_' << texsize << ".png";
+    std::ostringstream sstr_skybox;
+    sstr_skybox << "mdl/skybox_" << skybox_side[ii] << ".mesh";
+
+    graph.add(sstr_environ.str(), gfx::Texture2D::createTask(sstr_environ.str()));
+    graph.add(sstr_skybox.str(), boost::bind(glob_task_skybox, sstr_skybox.str(), sstr_environ.str()),
+        sstr_environ.str());
   }
 
-  // Speed up skybox creation by loading environment maps.
-  std::string texstr;
+  const char *fname_sample[] =
   {
-    std::stringstream sstr;
-    sstr << '_' << texsize << ".png";
-    texstr = sstr.str();
-  }
-  std::string environ_back = std::string("gfx/maps/enviroment_map_back") + texstr;
-  std::string environ_bottom = std::string("gfx/maps/enviroment_map_bottom") + texstr;
-  std::string environ_front = std::string("gfx/maps/enviroment_map_front") + texstr;
-  std::string environ_left = std::string("gfx/maps/enviroment_map_left") + texstr;
-  std::string environ_right = std::string("gfx/maps/enviroment_map_right") + texstr;
-  std::string environ_top = std::string("gfx/maps/enviroment_map_top") + texstr;
-
-  gfx::Texture2D::createParaller(environ_back);
-  gfx::Texture2D::createParaller(environ_bottom);
-  gfx::Texture2D::createParaller(environ_front);
-  gfx::Texture2D::createParaller(environ_left);
-  gfx::Texture2D::createParaller(environ_right);
-  gfx::Texture2D::createParaller(environ_top);
-
-  snd::Sample::createParaller("snd/ob_alarm.sample");
-  snd::Sample::createParaller("snd/ob_alarm_over.sample");
-  snd::Sample::createParaller("snd/ob_contact.sample");
-  snd::Sample::createParaller("snd/ob_flak_short.sample");
-  snd::Sample::createParaller("snd/ob_illegal_action.sample");
-  snd::Sample::createParaller("snd/ob_impact_in.sample");
-  snd::Sample::createParaller("snd/ob_locked.sample");
-  snd::Sample::createParaller("snd/ob_nuke.sample");
-  snd::Sample::createParaller("snd/ob_nuke_explosion.sample");
-  snd::Sample::createParaller("snd/ob_railgun.sample");
-  snd::Sample::createParaller("snd/ob_railgun_lock_long.sample");
-  snd::Sample::createParaller("snd/ob_route_change.sample");
-  snd::Sample::createParaller("snd/ob_route_change_accepted.sample");
-  snd::Sample::createParaller("snd/ob_target_destroyed.sample");
-
-  gfx::Mesh::createParaller("mdl/siegecruiser.mesh");
-
-  m_mesh_missile_anti = gfx::Mesh::create("mdl/missile_anti.mesh").get().get();
-  m_mesh_missile_nuke = gfx::Mesh::create("mdl/missile_icbm.mesh").get().get();
-  m_mesh_silo = gfx::Mesh::create("mdl/silo.mesh").get().get();
-  gfx::Mesh::store("atmosphere", new Atmosphere(subdivide - 2, coalesce));
-  gfx::Mesh::store("city", new VisualizationCity());
-  gfx::Mesh::store("distort", new VisualizationDistort());
-  gfx::Mesh::store("orbit", new VisualizationOrbit());
-  gfx::Mesh::store("nuke_marker", new VisualizationNuke());
-  gfx::Mesh::store("sun", new VisualizationSun());
-  m_mesh_bullet_flak = gfx::Mesh::store("bullet_flak", new VisualizationFlak()).get().get();
-  m_mesh_bullet_railgun = gfx::Mesh::store("bullet_railgun", new VisualizationRailgun()).get().get();
-
-  // Ensure all paraller tasks are done before performing tasks that depend on them. */
-  thr::wait(); 
-
-  gfx::Mesh::store("planet", new Planet(subdivide, coalesce, texsize, volsize, &m_height_map_planet, generate_enabled));
-
-  std::string textype("texture");
-  gfx::Mesh::create("mdl/skybox_back.mesh").get()->addTextureFile(textype, environ_back);
-  gfx::Mesh::create("mdl/skybox_bottom.mesh").get()->addTextureFile(textype, environ_bottom);
-  gfx::Mesh::create("mdl/skybox_front.mesh").get()->addTextureFile(textype, environ_front);
-  gfx::Mesh::create("mdl/skybox_left.mesh").get()->addTextureFile(textype, environ_left);
-  gfx::Mesh::create("mdl/skybox_right.mesh").get()->addTextureFile(textype, environ_right);
-  gfx::Mesh::create("mdl/skybox_top.mesh").get()->addTextureFile(textype, environ_top);
+    "snd/ob_alarm.sample",
+    "snd/ob_alarm_over.sample",
+    "snd/ob_contact.sample",
+    "snd/ob_flak_short.sample",
+    "snd/ob_illegal_action.sample",
+    "snd/ob_impact_in.sample",
+    "snd/ob_locked.sample",
+    "snd/ob_nuke.sample",
+    "snd/ob_nuke_explosion.sample",
+    "snd/ob_railgun.sample",
+    "snd/ob_railgun_lock_long.sample",
+    "snd/ob_route_change.sample",
+    "snd/ob_route_change_accepted.sample",
+    "snd/ob_target_destroyed.sample"
+  };
+  for(unsigned ii = 0; (ii < sizeof(fname_sample) / sizeof(const char*)); ++ii)
+  {
+    graph.add(fname_sample[ii], snd::Sample::createTask(fname_sample[ii]));
+  }
+
+  // Both missiles load the same texture, so they can't be loaded concurrently.
+  graph.add("mdl/siegecruiser.mesh", gfx::Mesh::createTask("mdl/siegecruiser.mesh"));
+  graph.add("mdl/missile_anti.mesh", gfx::Mesh::createTask("mdl/missile_anti.mesh"));
+  graph.add("mdl/missile_icbm.mesh", gfx::Mesh::createTask("mdl/missile_icbm.mesh"), "mdl/missile_anti.mesh");
+  graph.add("mdl/silo.mesh", gfx::Mesh::createTask("mdl/silo.mesh"));
+  graph.add("atmosphere", boost::bind(glob_task_atmosphere, subdivide, coalesce));
+  graph.add("city", boost::bind(glob_task_visualization<VisualizationCity>, "city"));
+  graph.add("distort", boost::bind(glob_task_visualization<VisualizationDistort>, "distort"));
+  graph.add("orbit", boost::bind(glob_task_visualization<VisualizationOrbit>, "orbit"));
+  graph.add("nuke_marker", boost::bind(glob_task_visualization<VisualizationNuke>, "nuke_marker"));
+  graph.add("sun", boost::bind(glob_task_visualization<VisualizationSun>, "sun"));
+  graph.add("bullet_flak", boost::bind(glob_task_visualization<VisualizationFlak>, "bullet_flak"));
+  graph.add("bullet_railgun", boost::bind(glob_task_visualization<VisualizationRailgun>, "bullet_railgun"));
+
+  graph.run();
+
+  snd::play_stream("snd/music_menu.ogg");
+
+  // Console background is needed first, everything else is located when the whole graph is done.
+  graph.locate("gfx/console_background.png").get();
+  m_console.setBackground(gfx::Texture2D::locate("console_background").get().get());
+
+  graph.wait();
+  graph.report();
+
+  m_mesh_missile_anti = gfx::Mesh::locate("missile_anti").get().get();
+  m_mesh_missile_nuke = gfx::Mesh::locate("missile_icbm").get().get();
+  m_mesh_silo = gfx::Mesh::locate("silo").get().get();
+  m_mesh_bullet_flak = gfx::Mesh::locate("bullet_flak").get().get();
+  m_mesh_bullet_railgun = gfx::Mesh::locate("bullet_railgun").get().get();
 
   m_shader_object = gfx::Shader::locate("3d_static").get().get();
   m_shader_overlay = gfx::Shader::locate("3d_overlay").get().get();
@@ -327,15 +522,78 @@ void Globals::precalc(unsigned subdivide, unsigned coalesce, unsigned texsize, u
   m_sample_contact = snd::Sample::locate("ob_contact").get().get();
   m_sample_flak = snd::Sample::locate("ob_flak_short").get().get();
   m_sample_illegal = snd::Sample::locate("ob_illegal_action").get().get();
+  m_sample_impact_in = snd::Sample::locate("ob_impact_in").get().get();
   m_sample_locked = snd::Sample::locate("ob_locked").get().get();
   m_sample_nuke = snd::Sample::locate("ob_nuke").get().get();
+  m_sample_nuke_explosion = snd::Sample::locate("ob_nuke_explosion").get().get();
   m_sample_railgun = snd::Sample::locate("ob_railgun").get().get();
   m_sample_railgun_lock = snd::Sample::locate("ob_railgun_lock_long").get().get();
   m_sample_route_change = snd::Sample::locate("ob_route_change").get().get();
   m_sample_route_change_accepted = snd::Sample::locate("ob_route_change_accepted").get().get();
   m_sample_target_destroyed = snd::Sample::locate("ob_target_destroyed").get().get();
 
+  timeline_interactive.close();
+  {
+    std::ostringstream sstr;
+    sstr << "interactive in " << (thr::usec_get_timestamp() - precalc_start) / 1000 << " ms";
+    data::log(sstr.str());
+  }
   m_precalculated = true;
+
+  if(progressive)
+  {
+    this->upgrade(subdivide, coalesce, texsize, volsize);
+  }
+}
+
+void Globals::upgrade(unsigned subdivide, unsigned coalesce, unsigned texsize, unsigned volsize)
+{
+  thr::TimelineScope timeline("startup", "upgrade");
+  uint64_t upgrade_start = thr::usec_get_timestamp();
+
+  bool planet_maps_missing = false;
+  for(unsigned ii = 0; (ii < 10); ++ii)
+  {
+    if(!data::file_exists(glob_planet_filename("map", texsize, ii)))
+    {
+      planet_maps_missing = true;
+    }
+  }
+  if(planet_maps_missing)
+  {
+    m_height_map_planet.loadNormals(texsize, gfx::MeshPlanet::gradient_distance(texsize), PLANET_FILENAME,
+        generate_enabled);
+  }
+
+  // The planet in store may be in use by a game, it is swapped when the next game is created.
+  gfx::Mesh *planet = new Planet(subdivide, coalesce, texsize, volsize, &m_height_map_planet, generate_enabled);
+  {
+    boost::mutex::scoped_lock scope(m_planet_mutex);
+    delete m_planet_upgrade;
+    m_planet_upgrade = planet;
+  }
+
+  std::ostringstream sstr;
+  sstr << "planet upgraded in " << (thr::usec_get_timestamp() - upgrade_start) / 1000 << " ms";
+  data::log(sstr.str());
+}
+
+void Globals::upgradePlanet()
+{
+  {
+    boost::mutex::scoped_lock scope(m_planet_mutex);
+
+    if(!m_planet_upgrade)
+    {
+      return;
+    }
+    gfx::Mesh::storageReplace("planet", m_planet_upgrade);
+    m_planet_upgrade = NULL;
+  }
+
+  // The lower detail maps are no longer referenced, keeping them would double the map memory.
+  gfx::Texture2D::storageRelease();
+  gfx::Texture3D::storageRelease();
 }
 
 void Globals::reserve_shader(gfx::ShaderSptr &dst, const char *cstr)
@@ -362,12 +620,20 @@ void Globals::unreserve()
   m_sample_contact = NULL;
   m_sample_flak = NULL;
   m_sample_illegal = NULL;
+  m_sample_impact_in = NULL;
   m_sample_locked = NULL;
   m_sample_nuke = NULL;
+  m_sample_nuke_explosion = NULL;
   m_sample_railgun = NULL;
+  m_sample_railgun_lock = NULL;
   m_sample_route_change = NULL;
   m_sample_route_change_accepted = NULL;
   m_sample_target_destroyed = NULL;
+  {
+    boost::mutex::scoped_lock scope(m_planet_mutex);
+    delete m_planet_upgrade;
+    m_planet_upgrade = NULL;
+  }
   gfx::Mesh::storageClear();
   m_mesh_bullet_flak = NULL;
   m_mesh_bullet_railgun = NULL;
@@ -413,6 +679,20 @@ void ob::glob_init(const gfx::SurfaceScreen &pscreen, const std::string &pdetail
   data::log.connect(data::log_default);
   glob = new Globals(pscreen, pdetail);
   data::log.connect(log_console);
+
+  if(conf)
+  {
+    const std::map<std::string, unsigned> &budgets = conf->getBudgets();
+
+    for(std::map<std::string, unsigned>::const_iterator ii = budgets.begin(), ee = budgets.end();
+        (ii != ee); ++ii)
+    {
+      if(!glob_store_budget(ii->first, ii->second))
+      {
+        data::log(std::string("unknown store in budget: ") + ii->first);
+      }
+    }
+  }
 }
 
 void ob::glob_precalc()
@@ -433,6 +713,7 @@ void ob::glob_quit()
   // If globals is NULL, set_game will not start a new thread.
   delete glob_get_game();
   game = NULL;
+  PopulationMap::release_recycled();
   data::log.disconnect_all_slots();
 }
 
@@ -465,6 +746,40 @@ void ob::glob_queue_game()
   }
 }
 
+bool ob::glob_store_budget(const std::string &name, unsigned op)
+{
+  const GlobStore *store = glob_find_store(name);
+
+  if(!store)
+  {
+    return false;
+  }
+  store->m_budget(static_cast<uint64_t>(op) * 1048576);
+  return true;
+}
+
+void ob::glob_store_report(std::ostream &ostr)
+{
+  BOOST_FOREACH(const GlobStore &vv, glob_stores)
+  {
+    ostr << vv.m_name << ": ";
+    vv.m_report(ostr, false);
+  }
+}
+
+bool ob::glob_store_report(std::ostream &ostr, const std::string &name)
+{
+  const GlobStore *store = glob_find_store(name);
+
+  if(!store)
+  {
+    return false;
+  }
+  ostr << store->m_name << ": ";
+  store->m_report(ostr, true);
+  return true;
+}
+
 void ob::glob_set_game(Game *op)
 {
   if(op)
@@ -12,6 +12,7 @@
 #include "ob_particle.hpp"
 
 #include <boost/array.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <functional>
 
@@ -41,6 +42,9 @@ namespace ob
       /** Flag telling whether game data generation is on. */
       static bool generate_enabled;
 
+      /** Flag telling whether progressive startup is on. */
+      static bool progressive_enabled;
+
     private:
       /** Detail level. */
       std::string m_detail_level;
@@ -195,6 +199,9 @@ namespace ob
       /** Sample. */
       snd::Sample *m_sample_illegal;
 
+      /** Sample. */
+      snd::Sample *m_sample_impact_in;
+
       /** Sample. */
       snd::Sample *m_sample_locked;
 
@@ -225,6 +232,12 @@ namespace ob
       /** Main menu. */
       MenuSptr m_menu_main;
 
+      /** Planet upgraded in the background, waiting to be swapped into the store. */
+      gfx::Mesh *m_planet_upgrade;
+
+      /** Guards the planet upgrade. */
+      boost::mutex m_planet_mutex;
+
       /** Precalculation trigger flag. */
       bool m_precalculated;
 
@@ -259,6 +272,24 @@ namespace ob
        */
       void precalc(unsigned subdivide, unsigned coalesce, unsigned texsize, unsigned volsize);
 
+      /** \brief Swap a planet upgraded in the background into the store.
+       *
+       * To be called from the game creation thread before creating a game. Does nothing if there is no
+       * upgrade waiting. Since no game exists at this point, the previous planet is released along with the
+       * maps only it referenced.
+       */
+      void upgradePlanet();
+
+    private:
+      /** \brief Create the planet at full detail after progressive startup.
+       *
+       * \param subdivide Planet subdivision.
+       * \param coalesce Planet coalesce.
+       * \param texsize Planet texture and heightmap detail.
+       * \param volsize Planet volumetric texture detail.
+       */
+      void upgrade(unsigned subdivide, unsigned coalesce, unsigned texsize, unsigned volsize);
+
     private:
       /** \brief Create a blank cursor.
        *
@@ -680,6 +711,15 @@ namespace ob
         return *m_sample_illegal;
       }
 
+      /** \brief Accessor.
+       *
+       * \return Sample reference.
+       */
+      snd::Sample& getSampleImpactIn() const
+      {
+        return *m_sample_impact_in;
+      }
+
       /** \brief Accessor.
        *
        * \return Sample reference.
@@ -869,6 +909,25 @@ namespace ob
       {
         generate_enabled = true;
       }
+
+      /** \brief Tell if progressive startup is enabled.
+       *
+       * \return True if yes, false if no.
+       */
+      static bool is_progressive_enabled()
+      {
+        return progressive_enabled;
+      }
+
+      /** \brief Set progressive startup on.
+       *
+       * The menu is reached with a planet at laptop detail, the planet at the requested detail is created
+       * afterwards and used from the next game on.
+       */
+      static void set_progressive()
+      {
+        progressive_enabled = true;
+      }
   };
 
   /** \brief Initialize all globals.
@@ -899,6 +958,28 @@ namespace ob
    */
   extern void glob_queue_game();
 
+  /** \brief Set the memory budget of a store.
+   *
+   * \param name Store name.
+   * \param op Budget in megabytes, 0 for unlimited.
+   * \return True on success, false if there is no such store.
+   */
+  extern bool glob_store_budget(const std::string &name, unsigned op);
+
+  /** \brief Write the residency of all stores.
+   *
+   * \param ostr Stream to write to.
+   */
+  extern void glob_store_report(std::ostream &ostr);
+
+  /** \brief Write the residency of a store with all its entries.
+   *
+   * \param ostr Stream to write to.
+   * \param name Store name.
+   * \return True on success, false if there is no such store.
+   */
+  extern bool glob_store_report(std::ostream &ostr, const std::string &name);
+
   /** \brief Set the game construct.
    *
    * \param op Game.
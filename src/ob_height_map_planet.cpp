@@ -11,14 +11,13 @@ HeightMapPlanet::HeightMapPlanet() :
       OB_PLANET_RADIUS * (1.0f - OB_PLANET_RADIUS_DIFF),
       OB_PLANET_RADIUS * (1.0f + OB_PLANET_RADIUS_DIFF)) { }
 
-float HeightMapPlanet::calcHeight(const math::vec3f &vv) const
+/** \brief Convert height into terrain level.
+ *
+ * \param ht Height.
+ * \return Terrain level.
+ */
+static float terrain_level(float ht)
 {
-  return std::max(this->gfx::HeightMapBall::calcHeight(vv), 0.45f);
-}
-
-float HeightMapPlanet::calcTerrain(const math::vec3f &vv) const
-{
-  float ht = this->calcHeight(vv);
   if(ht < 0.5f)
   {
     ht = (ht - 0.45f) / 0.05f;
@@ -30,3 +29,32 @@ float HeightMapPlanet::calcTerrain(const math::vec3f &vv) const
   return ht * 0.5f;
 }
 
+float HeightMapPlanet::calcHeight(const math::vec3f &vv) const
+{
+  return std::max(this->gfx::HeightMapBall::calcHeight(vv), 0.45f);
+}
+
+void HeightMapPlanet::calcHeight(const math::vec3f *pnt, float *ret, unsigned count) const
+{
+  this->gfx::HeightMapBall::calcHeight(pnt, ret, count);
+
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    ret[ii] = std::max(ret[ii], 0.45f);
+  }
+}
+
+float HeightMapPlanet::calcTerrain(const math::vec3f &vv) const
+{
+  return terrain_level(this->calcHeight(vv));
+}
+
+void HeightMapPlanet::calcTerrain(const math::vec3f *pnt, float *ret, unsigned count) const
+{
+  this->calcHeight(pnt, ret, count);
+
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    ret[ii] = terrain_level(ret[ii]);
+  }
+}
@@ -20,7 +20,9 @@ namespace ob
     public:
       /** \cond */
       virtual float calcHeight(const math::vec3f &pnt) const;
+      virtual void calcHeight(const math::vec3f *pnt, float *ret, unsigned count) const;
       virtual float calcTerrain(const math::vec3f &pnt) const;
+      virtual void calcTerrain(const math::vec3f *pnt, float *ret, unsigned count) const;
       /** \endcond */
   };
 }
@@ -1,6 +1,10 @@
+#include "data/generic.hpp"
+#include "data/pack.hpp"
 #include "snd/generic.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 #include "ui/ui_stack.hpp"
+#include "ob_benchmark.hpp"
 #include "ob_console_state.hpp"
 #include "ob_game.hpp"
 #include "ob_globals.hpp"
@@ -17,6 +21,9 @@
 using namespace ob;
 namespace po = boost::program_options;
 
+/** Pack mounted at startup if present. */
+static const char *PACK_FILENAME = "orbital_bombardment.pack";
+
 /** Console output content. */
 static const char *usage = ""
 "Usage: orbital_bombardment <options>\n"
@@ -26,6 +33,17 @@ static const char *usage = ""
 "Copyright (c) Faemiyah. Distributed using Creative Commons and BSD licences.\n"
 "\n";
 
+/** \brief Configure the threading system from settings.
+ *
+ * \return Number of workers to pass to thr::thr_main().
+ */
+static unsigned main_configure_threads()
+{
+  thr::thr_affinity(conf->getAffinity().get() != 0);
+  thr::thr_isolate(conf->getIsolate().get() != 0);
+  return static_cast<unsigned>(conf->getWorkers().get());
+}
+
 int main(int argc, char *argv[])
 {
 #if (CATCH_EXCEPTIONS != 0)
@@ -35,29 +53,72 @@ int main(int argc, char *argv[])
     unsigned w;
     unsigned h;
     unsigned b;
+    std::string timeline_filename;
 
     thr::thr_init();
+    if(boost::filesystem::exists(PACK_FILENAME))
+    {
+      data::pack_mount(PACK_FILENAME);
+    }
     conf_init();
 
     if(argc > 0)
     {
       po::options_description desc("Options");
       desc.add_options()
+        ("affinity,a", "Pin worker, rendering and audio threads to processors.")
+        ("benchmark,b", po::value<std::string>(), "Run a headless benchmark and exit (all, population, filter, height, normals, perlin, cache, mesh, pack, store, scheduler, tasks, groups, scaling).")
         ("detail,d", po::value<std::string>(), "Detail level (laptop, desktop, bleeding, custom).")
         ("generate,g", "Generated procedural data will be saved for faster loading the next time around.\nOnly use this if you really know what you're doing.")
+        ("framerate", po::value<unsigned>(), "Render at most this many frames per second with the game simulated at a fixed rate in between, 0 to render once per simulation step.")
         ("fullscreen,f", "Full-screen mode instead of window.")
         ("help,h", "Print help text.")
+        ("isolate,i", "Reserve a processor for the rendering thread, workers use the others.")
+        ("progressive,p", "Reach the menu with a low detail planet first and create the requested detail in the background.")
         ("resolution,r", po::value<std::string>(), "Resolution to use.")
-        ("window,w", "Window instead of full-screen mode.");
+        ("stats,s", "Record scheduler telemetry, print it after each benchmark or on exit.")
+        ("timeline,t", po::value<std::string>(), "Record a timeline of loading into given file as a Chrome trace and print a summary on exit.")
+        ("window,w", "Window instead of full-screen mode.")
+        ("workers,j", po::value<unsigned>(), "Number of worker threads, 0 for one less than the number of processors.");
 
       po::variables_map vmap;
       po::store(po::parse_command_line(argc, argv, desc), vmap);
       po::notify(vmap);
 
+      if(vmap.count("affinity"))
+      {
+        conf->getAffinity().set(1);
+      }
+      if(vmap.count("isolate"))
+      {
+        conf->getIsolate().set(1);
+      }
+      if(vmap.count("workers"))
+      {
+        conf->getWorkers().set(static_cast<int>(vmap["workers"].as<unsigned>()));
+      }
+      if(vmap.count("stats"))
+      {
+        thr::telemetry_enable(true);
+      }
+      if(vmap.count("benchmark"))
+      {
+        boost::thread benchmark_thread(boost::bind(benchmark_run, vmap["benchmark"].as<std::string>()));
+
+        thr::thr_main(main_configure_threads());
+
+        benchmark_thread.join();
+        conf_quit();
+        return benchmark_passed() ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
       if(vmap.count("detail"))
       {
         conf->setDetail(vmap["detail"].as<std::string>());
       }
+      if(vmap.count("framerate"))
+      {
+        conf->getFramerate().set(static_cast<int>(vmap["framerate"].as<unsigned>()));
+      }
       if(vmap.count("generate"))
       {
         Globals::set_generate();
@@ -67,6 +128,10 @@ int main(int argc, char *argv[])
         std::cout << usage << desc << std::endl;
         return 0;
       }
+      if(vmap.count("progressive"))
+      {
+        Globals::set_progressive();
+      }
       if(vmap.count("fullscreen"))
       {
         conf->getFullscreen().set(1);
@@ -75,6 +140,11 @@ int main(int argc, char *argv[])
       {
         conf->setResolution(vmap["resolution"].as<std::string>());
       }
+      if(vmap.count("timeline"))
+      {
+        timeline_filename = vmap["timeline"].as<std::string>();
+        thr::timeline_enable();
+      }
       if(vmap.count("window"))
       {
         conf->getFullscreen().set(0);
@@ -90,13 +160,14 @@ int main(int argc, char *argv[])
 
     {
       ui::UiStack stack(scr, 100);
+      stack.setFramerate(static_cast<unsigned>(conf->getFramerate().get()));
 
       stack.pushState(new ConsoleState(glob->getConsole()));
       stack.suspend();
 
       boost::thread precalc_thread(glob_precalc);
 
-      thr::thr_main(2);
+      thr::thr_main(main_configure_threads());
 
       precalc_thread.join();
     }
@@ -106,6 +177,13 @@ int main(int argc, char *argv[])
     glob_quit();
     snd::snd_quit();
     conf_quit();
+
+    if(!timeline_filename.empty())
+    {
+      data::shrostr timeline_file = data::open_write(timeline_filename);
+      thr::timeline_write(*timeline_file);
+      thr::timeline_summary(std::cout);
+    }
 #if (CATCH_EXCEPTIONS != 0)
   }
   catch(const boost::exception & e)
@@ -0,0 +1,51 @@
+#include "gfx/mesh_data.hpp"
+
+#include <iostream>
+
+#include <boost/exception/diagnostic_information.hpp>
+
+/** Console output content. */
+static const char *usage = ""
+"Usage: ob_mesh_convert <mesh files>\n"
+"Converts Orbital Bombardment XML meshes into binary meshes that are written\n"
+"next to the source files. Meta-meshes are skipped, the meshes they refer to\n"
+"must be converted separately.\n"
+"\n";
+
+int main(int argc, char *argv[])
+{
+  if(argc < 2)
+  {
+    std::cout << usage;
+    return EXIT_FAILURE;
+  }
+
+  for(int ii = 1; (ii < argc); ++ii)
+  {
+    boost::filesystem::path fname(argv[ii]);
+
+    try
+    {
+      if(gfx::mesh_binary_convert(fname))
+      {
+        std::cout << fname.string() << " -> " << gfx::mesh_binary_filename(fname).string() << std::endl;
+      }
+      else
+      {
+        std::cout << fname.string() << ": meta-mesh, skipped" << std::endl;
+      }
+    }
+    catch(const boost::exception &err)
+    {
+      std::cerr << fname.string() << ": " << boost::diagnostic_information(err) << std::endl;
+      return EXIT_FAILURE;
+    }
+    catch(const std::exception &err)
+    {
+      std::cerr << fname.string() << ": " << err.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
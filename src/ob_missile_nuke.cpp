@@ -185,7 +185,7 @@ bool MissileNuke::update()
       vv->gamisticEffect(this);
     }
 
-    snd::play(*(snd::Sample::locate("ob_nuke_explosion").get()), math::vec3f(m_pos));
+    snd::play(glob->getSampleNukeExplosion(), math::vec3f(m_pos));
 
     game->incSiloMinCountInRange();
     //std::cout << "more silos now popping: " << game->getSiloMinCountInRange() << '\n';
@@ -201,7 +201,7 @@ bool MissileNuke::update()
     {
       if(m_beepingsound == NULL)
       {
-        m_beepingsound = snd::play(*(snd::Sample::locate("ob_impact_in").get()), math::vec3f(m_pos));
+        m_beepingsound = snd::play(glob->getSampleImpactIn(), math::vec3f(m_pos));
       }
       /*// Closer -> more probable that impact sounds come.
       if(math::mrand(0.0f, static_cast<float>(OB_NUKE_IMPACT_IN_2 - ht2)) <
@@ -0,0 +1,64 @@
+#include "data/pack.hpp"
+
+#include <iostream>
+
+#include <boost/exception/diagnostic_information.hpp>
+
+namespace fs = boost::filesystem;
+
+/** Console output content. */
+static const char *usage = ""
+"Usage: ob_pack <pack file> <files or directories>\n"
+"Writes given files, and all files under given directories, into one Orbital\n"
+"Bombardment pack file. Run from the data root, files are stored under the\n"
+"names they are given with. Loose files override the pack when loading.\n"
+"\n";
+
+int main(int argc, char *argv[])
+{
+  if(argc < 3)
+  {
+    std::cout << usage;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    std::vector<fs::path> files;
+
+    for(int ii = 2; (ii < argc); ++ii)
+    {
+      fs::path fname(argv[ii]);
+
+      if(fs::is_directory(fname))
+      {
+        for(fs::recursive_directory_iterator jj(fname), ee; (jj != ee); ++jj)
+        {
+          if(fs::is_regular_file(jj->status()))
+          {
+            files.push_back(jj->path());
+          }
+        }
+      }
+      else
+      {
+        files.push_back(fname);
+      }
+    }
+
+    data::pack_write(argv[1], files);
+    std::cout << argv[1] << ": " << files.size() << " files" << std::endl;
+  }
+  catch(const boost::exception &err)
+  {
+    std::cerr << argv[1] << ": " << boost::diagnostic_information(err) << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch(const std::exception &err)
+  {
+    std::cerr << argv[1] << ": " << err.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -7,6 +7,7 @@
 #include "gfx/volume.hpp"
 #include "ui/generic.hpp"
 #include "thr/dispatch.hpp"
+#include "thr/timeline.hpp"
 #include "ob_constants.hpp"
 #include "ob_height_map_planet.hpp"
 #include "ob_game.hpp"
@@ -26,7 +27,7 @@ class PerlinCity :
 
   public:
     /** \cond */
-    virtual gfx::Color noise(const std::list<gfx::VolumeGray8Sptr> &op, const math::vec3d &tt);
+    virtual void noise(gfx::Volume &dst, const gfx::PerlinSampler &op, unsigned z1, unsigned z2) const;
     /** \cond */
 };
 
@@ -48,38 +49,45 @@ class PerlinRubble :
 
   public:
     /** \cond */
-    virtual gfx::Color noise(const std::list<gfx::VolumeGray8Sptr> &op,
-        const math::vec3d &tt);
+    virtual void noise(gfx::Volume &dst, const gfx::PerlinSampler &op, unsigned z1, unsigned z2) const;
     /** \cond */
 };
 
-gfx::Color PerlinCity::noise(const std::list<gfx::VolumeGray8Sptr> &op,
-    const math::vec3d &tt)
+void PerlinCity::noise(gfx::Volume &dst, const gfx::PerlinSampler &op, unsigned z1, unsigned z2) const
 {
-  float ns = 0.0f,
-        wt = 1.0f;
+  unsigned octaves = op.getOctaveCount();
 
-  for(std::list<gfx::VolumeGray8Sptr>::const_reverse_iterator ii = op.rbegin(), ee = op.rend();
-      (ii != ee); ++ii)
+  for(unsigned ii = z1; (ii < z2); ++ii)
   {
-    gfx::VolumeGray8 *vv = ii->get();
-    ns += wt * math::abs((vv->getAveragePixel(tt.x(), tt.y(), tt.z()) - 0.5f));
-    wt *= 0.5f;
-  }
-  //ns = ns*ns;
+    for(unsigned jj = 0; (jj < dst.getHeight()); ++jj)
+    {
+      for(unsigned kk = 0; (kk < dst.getWidth()); ++kk)
+      {
+        float ns = 0.0f,
+              wt = 1.0f;
 
-  //ns = ns + 0.5f;
-  if(ns < 0.0f)
-  {
-    ns = -ns;
-  }
-  else if(ns > 1.0f)
-  {
-    ns = 2.0f - ns;
-  }
+        for(unsigned ll = octaves; (ll > 0); --ll)
+        {
+          ns += wt * math::abs((op.sample(ll - 1, kk, jj, ii) - 0.5f));
+          wt *= 0.5f;
+        }
+        //ns = ns*ns;
 
-  return gfx::Color(ns, ns, ns);
-  //return m_gradient.getColor(ns);
+        //ns = ns + 0.5f;
+        if(ns < 0.0f)
+        {
+          ns = -ns;
+        }
+        else if(ns > 1.0f)
+        {
+          ns = 2.0f - ns;
+        }
+
+        dst.setPixel(kk, jj, ii, gfx::Color(ns, ns, ns));
+        //dst.setPixel(kk, jj, ii, m_gradient.getColor(ns));
+      }
+    }
+  }
 }
 
 PerlinRubble::PerlinRubble() :
@@ -91,43 +99,44 @@ PerlinRubble::PerlinRubble() :
   m_gradient.add(1.0f, gfx::Color(0.0f, 0.0f, 0.0f));
 }
 
-gfx::Color PerlinRubble::noise(const std::list<gfx::VolumeGray8Sptr> &op, const math::vec3d &tt)
+void PerlinRubble::noise(gfx::Volume &dst, const gfx::PerlinSampler &op, unsigned z1, unsigned z2) const
 {
-  float ns = 0.0f,
-        wt = 1.0f;
+  unsigned octaves = op.getOctaveCount();
 
-  for(std::list<gfx::VolumeGray8Sptr>::const_reverse_iterator ii = op.rbegin(), ee = op.rend();
-      (ii != ee); ++ii)
+  for(unsigned ii = z1; (ii < z2); ++ii)
   {
-    gfx::VolumeGray8 *vv = ii->get();
-    ns += wt * math::abs(vv->getAveragePixel(tt.x(), tt.y(), tt.z()) - 0.5f);
-    wt *= 0.6f;
-  }
-  //ns = ns*ns;
+    for(unsigned jj = 0; (jj < dst.getHeight()); ++jj)
+    {
+      for(unsigned kk = 0; (kk < dst.getWidth()); ++kk)
+      {
+        float ns = 0.0f,
+              wt = 1.0f;
 
-  ns = ns + 0.5f;
-  if(ns < 0.0f)
-  {
-    ns = -ns;
-  }
-  if(ns > 1.0f)
-  {
-    ns = 2.0f - ns;
-  }
-  if(ns < 0.0f)
-  {
-    ns = -ns;
-  }
+        for(unsigned ll = octaves; (ll > 0); --ll)
+        {
+          ns += wt * math::abs(op.sample(ll - 1, kk, jj, ii) - 0.5f);
+          wt *= 0.6f;
+        }
+        //ns = ns*ns;
 
-  /*gfx::Color ret;
-  ret.r() = ns * 1.0f;
-  ret.g() = ns * 0.8f;
-  ret.b() = ns * 0.1f;
-  ret.a() = 1.0f;
-  return ret;*/
+        ns = ns + 0.5f;
+        if(ns < 0.0f)
+        {
+          ns = -ns;
+        }
+        if(ns > 1.0f)
+        {
+          ns = 2.0f - ns;
+        }
+        if(ns < 0.0f)
+        {
+          ns = -ns;
+        }
 
-  return m_gradient.getColor(ns);
-  //return gfx::Color(0.0f, 0.0f, 0.0f);
+        dst.setPixel(kk, jj, ii, m_gradient.getColor(ns));
+      }
+    }
+  }
 }
 
 /** City generator. */
@@ -156,6 +165,8 @@ Planet::Planet(unsigned ps, unsigned pc, unsigned pt, unsigned pv, const HeightM
 
 void Planet::createVolumes(const std::string &fname_header, unsigned vside, bool psave)
 {
+  thr::TimelineScope timeline("planet", "volumes");
+
   for(unsigned ii = 0; (ii < 2); ++ii)
   {
     std::string volume_filename;
@@ -167,7 +178,8 @@ void Planet::createVolumes(const std::string &fname_header, unsigned vside, bool
 
     if(data::file_exists(volume_filename))
     {
-      this->addTextureFile(std::string("volume"), volume_filename, gfx::ImageLoader().noPremultiplyAlpha());
+      this->addTextureFile(std::string("volume"), volume_filename,
+          gfx::ImageLoader().noPremultiplyAlpha().cache().evictable());
     }
     else
     {
@@ -213,9 +225,9 @@ void Planet::createVolumes(const std::string &fname_header, unsigned vside, bool
         vol.write(volume_filename);
       }
       
-      gfx::Texture3D *tex = new gfx::Texture3D(vol);
-      gfx::Texture3D::store(volume_filename, tex);
-      this->addTexture("volume", tex);
+      // The handle keeps the volume from being evicted before the mesh references it.
+      gfx::Texture3D::handle_type tex = gfx::Texture3D::store(volume_filename, new gfx::Texture3D(vol), true);
+      this->addTextureFile(std::string("volume"), volume_filename);
     }
   }
 
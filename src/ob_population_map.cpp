@@ -2,10 +2,13 @@
 
 #include "math/random.hpp"
 #include "gfx/shader.hpp"
-#include "thr/dispatch.hpp"
+#include "thr/task_group.hpp"
+#include "thr/timeline.hpp"
 #include "ob_constants.hpp"
 #include "ob_globals.hpp"
 
+#include <algorithm>
+
 using namespace ob;
 
 /** Scale to transform real-world coordinate into population space. */
@@ -14,281 +17,829 @@ const float POP_SCALE = static_cast<float>(OB_POPULATION_DETAIL / 2) - 1.0f;
 /** Offset to transform real-world coordinate into population space. */
 const float POP_CENTER = static_cast<float>(OB_POPULATION_DETAIL - 1) * 0.5f;
 
-/** \brief Expand to the next power of two.
-*/
-PopulationMap::PopulationMap() :
-  gfx::VolumeGray16(OB_POPULATION_DETAIL, OB_POPULATION_DETAIL, OB_POPULATION_DETAIL),
-  m_population(0) { }
+/** Bricks per volume side. */
+static const int BRICK_COUNT = OB_POPULATION_DETAIL / OB_POPULATION_BRICK;
 
-PopulationMap::~PopulationMap()
+/** Bytes per brick. */
+static const unsigned BRICK_BYTES = OB_POPULATION_BRICK * OB_POPULATION_BRICK * OB_POPULATION_BRICK * 2;
+
+/** \brief Get the index of the brick containing a voxel.
+ *
+ * \param px X coordinate.
+ * \param py Y coordinate.
+ * \param pz Z coordinate.
+ * \return Brick index.
+ */
+static inline unsigned brick_index(int px, int py, int pz)
 {
-  const VolumeGray16* null_texture = NULL;
+  return static_cast<unsigned>(((pz / OB_POPULATION_BRICK) * BRICK_COUNT +
+        (py / OB_POPULATION_BRICK)) * BRICK_COUNT + (px / OB_POPULATION_BRICK));
+}
 
-  thr::wait_privileged(&PopulationMap::taskTexture, this, null_texture);
+/** \brief Get the byte offset of a voxel within its brick.
+ *
+ * \param px X coordinate.
+ * \param py Y coordinate.
+ * \param pz Z coordinate.
+ * \return Offset into brick data.
+ */
+static inline unsigned brick_offset(int px, int py, int pz)
+{
+  return static_cast<unsigned>((((pz % OB_POPULATION_BRICK) * OB_POPULATION_BRICK +
+          (py % OB_POPULATION_BRICK)) * OB_POPULATION_BRICK + (px % OB_POPULATION_BRICK)) * 2);
 }
 
-void PopulationMap::feed(const gfx::Shader &sh, unsigned idx) const
+/** Texture of a destroyed population map, to be reused by the next one.
+ *
+ * Only accessed from the privileged thread.
+ */
+static gfx::Texture3DSptr recycled_texture;
+
+/** Bricks that are not empty in the recycled texture. */
+static std::vector<bool> recycled_resident;
+
+/** \brief Downsample one mipmap level.
+ *
+ * \param src Source data, luminance-alpha.
+ * \param dst Destination data, half the side of source.
+ * \param side Side length of source.
+ */
+static void mip_down(const uint8_t *src, uint8_t *dst, int side)
 {
-  //std::cout << "dscale" << std::endl;
-  sh.getUniform("decal_scale")->update(POP_CENTER,
-      POP_SCALE / OB_PLANET_RADIUS / static_cast<float>(OB_POPULATION_DETAIL));
-  //std::cout << "decal" << std::endl;
-  m_texture->bind(*(sh.getUniform("decal")), idx);
+  int half = side / 2;
+
+  for(int kk = 0; (kk < half); ++kk)
+  {
+    for(int jj = 0; (jj < half); ++jj)
+    {
+      for(int ii = 0; (ii < half); ++ii)
+      {
+        const uint8_t *ptr = src + (((kk * 2) * side + jj * 2) * side + ii * 2) * 2;
+        for(int ch = 0; (ch < 2); ++ch)
+        {
+          int sum = ptr[ch] + ptr[ch + 2] +
+            ptr[ch + side * 2] + ptr[ch + side * 2 + 2] +
+            ptr[ch + side * side * 2] + ptr[ch + side * side * 2 + 2] +
+            ptr[ch + (side * side + side) * 2] + ptr[ch + (side * side + side) * 2 + 2];
+          *dst++ = static_cast<uint8_t>((sum + 4) / 8);
+        }
+      }
+    }
+  }
 }
 
-void PopulationMap::filter()
+/** \brief Pack runs of bricks into the staging buffer.
+ *
+ * Writes all per-brick mipmap levels of each run, and the average of each
+ * brick into the coarse level.
+ *
+ * \param bricks Bricks.
+ * \param runs Runs to pack.
+ * \param count Number of runs.
+ * \param staging Staging buffer.
+ * \param coarse Coarse level, one voxel per brick.
+ */
+static void pack_runs(const std::vector<PopulationBrick*> *bricks, const PopulationRun *runs,
+    unsigned count, uint8_t *staging, uint8_t *coarse)
 {
-  uint8_t *tmp = new uint8_t[this->getSizeBytes()];
-  memset(tmp, 0, this->getSizeBytes());
+  static const uint8_t empty[BRICK_BYTES] = { 0 };
+  uint8_t levels[2][BRICK_BYTES / 8];
 
-  for(unsigned kk = 1; (kk < m_d - 1); ++kk)
+  for(unsigned ii = 0; (ii < count); ++ii)
   {
-    for(unsigned jj = 1; (jj < m_h - 1); ++jj)
+    const PopulationRun &run = runs[ii];
+
+    for(unsigned jj = 0; (jj < run.m_count); ++jj)
     {
-      for(unsigned ii = 1; (ii < m_w - 1); ++ii)
+      const PopulationBrick *brick = (*bricks)[run.m_first + jj];
+      const uint8_t *src = brick ? brick->m_data : empty;
+      uint8_t *dst = staging + run.m_offset;
+      unsigned pingpong = 0;
+
+      for(int side = OB_POPULATION_BRICK; (side > 1); side /= 2)
       {
-        tmp[(kk * m_h * m_w + jj * m_w + ii) * 2] = this->filterCollect(ii, jj, kk);
+        unsigned row = static_cast<unsigned>(side * 2);
+
+        // Rows of all bricks in the run are interleaved.
+        for(int kk = 0; (kk < side * side); ++kk)
+        {
+          memcpy(dst + (static_cast<unsigned>(kk) * run.m_count + jj) * row,
+              src + static_cast<unsigned>(kk) * row, row);
+        }
+        dst += run.m_count * row * static_cast<unsigned>(side * side);
+
+        mip_down(src, levels[pingpong], side);
+        src = levels[pingpong];
+        pingpong = 1 - pingpong;
       }
+
+      coarse[(run.m_first + jj) * 2 + 0] = src[0];
+      coarse[(run.m_first + jj) * 2 + 1] = src[1];
     }
   }
+}
+
+PopulationMap::PopulationMap() :
+  m_bricks(BRICK_COUNT * BRICK_COUNT * BRICK_COUNT, NULL),
+  m_resident(BRICK_COUNT * BRICK_COUNT * BRICK_COUNT, false),
+  m_coarse(BRICK_COUNT * BRICK_COUNT * BRICK_COUNT * 2, 0),
+  m_upload_pending(false),
+  m_population(0) { }
+
+PopulationMap::~PopulationMap()
+{
+  // Also waits for pending uploads.
+  thr::defer_privileged(&PopulationMap::taskRelease, this);
+  thr::fence_privileged();
+
+  this->clear();
+}
+
+PopulationBrick& PopulationMap::acquireBrick(unsigned idx)
+{
+  PopulationBrick *ret = m_bricks[idx];
+
+  if(!ret)
+  {
+    ret = new PopulationBrick();
+    memset(ret->m_data, 0, BRICK_BYTES);
+    ret->m_population = 0;
+    ret->m_dirty = false;
+    m_bricks[idx] = ret;
+
+    boost::mutex::scoped_lock scope(m_brick_mutex);
+    m_allocated.push_back(idx);
+  }
 
-  delete[] m_data;
-  m_data = tmp;
+  return *ret;
 }
 
-uint8_t PopulationMap::filterCollect(unsigned px, unsigned py, unsigned pz)
+void PopulationMap::clear()
 {
-  int ret = 0;
-  int neighbouring[27] =
-  {
-    this->filterGet(px - 1, py - 1, pz - 1),
-    this->filterGet(px - 1, py - 1, pz + 0),
-    this->filterGet(px - 1, py - 1, pz + 1),
-    this->filterGet(px - 1, py + 0, pz - 1),
-    this->filterGet(px - 1, py + 0, pz + 0),
-    this->filterGet(px - 1, py + 0, pz + 1),
-    this->filterGet(px - 1, py + 1, pz - 1),
-    this->filterGet(px - 1, py + 1, pz + 0),
-    this->filterGet(px - 1, py + 1, pz + 1),
-    this->filterGet(px + 0, py - 1, pz - 1),
-    this->filterGet(px + 0, py - 1, pz + 0),
-    this->filterGet(px + 0, py - 1, pz + 1),
-    this->filterGet(px + 0, py + 0, pz - 1),
-    this->filterGet(px + 0, py + 0, pz + 0),
-    this->filterGet(px + 0, py + 0, pz + 1),
-    this->filterGet(px + 0, py + 1, pz - 1),
-    this->filterGet(px + 0, py + 1, pz + 0),
-    this->filterGet(px + 0, py + 1, pz + 1),
-    this->filterGet(px + 1, py - 0, pz - 1),
-    this->filterGet(px + 1, py - 0, pz + 0),
-    this->filterGet(px + 1, py - 0, pz + 1),
-    this->filterGet(px + 1, py + 0, pz - 1),
-    this->filterGet(px + 1, py + 0, pz + 0),
-    this->filterGet(px + 1, py + 0, pz + 1),
-    this->filterGet(px + 1, py + 1, pz - 1),
-    this->filterGet(px + 1, py + 1, pz + 0),
-    this->filterGet(px + 1, py + 1, pz + 1)
-  };
-
-  for(unsigned ii = 0; (ii < 27); ++ii)
-  {
-    ret += neighbouring[ii];
-  }
-
-  return static_cast<uint8_t>(ret / 27);
+  BOOST_FOREACH(unsigned vv, m_allocated)
+  {
+    delete m_bricks[vv];
+    m_bricks[vv] = NULL;
+  }
+  m_allocated.clear();
+  m_dirty.clear();
+  m_population = 0;
 }
 
-int PopulationMap::filterGet(unsigned px, unsigned py, unsigned pz)
+void PopulationMap::feed(const gfx::Shader &sh, unsigned idx) const
 {
-  return static_cast<int>(m_data[(pz * m_w * m_h + py * m_w + px) * 2]);
+  //std::cout << "dscale" << std::endl;
+  sh.getUniform("decal_scale")->update(POP_CENTER,
+      POP_SCALE / OB_PLANET_RADIUS / static_cast<float>(OB_POPULATION_DETAIL));
+  //std::cout << "decal" << std::endl;
+  m_texture->bind(*(sh.getUniform("decal")), idx);
 }
 
-int PopulationMap::paint(const math::vec3f &pos, float str, bool update)
+void PopulationMap::filter()
 {
-  float abs = math::abs(str);
-  math::vec3f spos = (math::normalize(pos) * POP_SCALE) + POP_CENTER;
-  math::vec3i ca(math::floor(spos.x()), math::floor(spos.y()), math::floor(spos.z())),
-    cb(math::ceil(spos.x()), math::ceil(spos.y()), math::ceil(spos.z()));
-  int ret = 0;
+  std::vector<PopulationBrick*> tmp(m_bricks.size(), NULL);
+  std::vector<unsigned> tmp_allocated;
+  std::vector<unsigned> population(BRICK_COUNT, 0);
+  thr::TaskGroup group;
 
-  // When updating in realtime, area must be 2^x or strange shit happens.
-  if(update)
+  // Every task writes a separate layer of bricks.
+  for(int ii = 0; (ii < BRICK_COUNT); ++ii)
   {
-    int logvalue = math::ceil(logf(abs) / logf(2.0f));
-    int rsize = 2;
-    for(int ii = 1; (ii < logvalue); ++ii)
-    {
-      rsize *= 2;
-    }
-    ca -= rsize - 1;
-    cb += rsize - 1;
+    group.dispatch(&PopulationMap::filterSlab, this, ii, &tmp, &tmp_allocated,
+        &population[static_cast<unsigned>(ii)]);
   }
-  else
+  group.wait();
+
+  this->clear();
+  m_bricks.swap(tmp);
+  m_allocated.swap(tmp_allocated);
+  BOOST_FOREACH(unsigned vv, population)
   {
-    int rsize = math::lround(abs);
-    ca -= rsize;
-    cb += rsize;
+    m_population += vv;
   }
+}
 
-  //std::cout << ca << " ; " << cb << std::endl;
+void PopulationMap::filterPlane(int pz, uint8_t *dst) const
+{
+  int layer = pz / OB_POPULATION_BRICK;
 
-  // Must bind ca & cb to limits.
-  if(update)
+  memset(dst, 0, OB_POPULATION_DETAIL * OB_POPULATION_DETAIL);
+  for(int jj = 0; (jj < BRICK_COUNT); ++jj)
   {
-    if(ca.x() < 0)
+    for(int ii = 0; (ii < BRICK_COUNT); ++ii)
     {
-      cb.x() += -ca.x();
-      ca.x() = 0; 
-    }
-    else if(cb.x() > 255)
-    {
-      ca.x() -= cb.x() - 255;
-      cb.x() = 255;
+      const PopulationBrick *brick = m_bricks[static_cast<unsigned>((layer * BRICK_COUNT + jj) * BRICK_COUNT + ii)];
+      if(!brick)
+      {
+        continue;
+      }
+
+      const uint8_t *src = brick->m_data + brick_offset(0, 0, pz);
+      for(int yy = 0; (yy < OB_POPULATION_BRICK); ++yy)
+      {
+        uint8_t *row = dst + (jj * OB_POPULATION_BRICK + yy) * OB_POPULATION_DETAIL + ii * OB_POPULATION_BRICK;
+        for(int xx = 0; (xx < OB_POPULATION_BRICK); ++xx)
+        {
+          row[xx] = src[xx * 2];
+        }
+        src += OB_POPULATION_BRICK * 2;
+      }
     }
-    if(ca.y() < 0)
+  }
+}
+
+void PopulationMap::filterSlab(int layer, std::vector<PopulationBrick*> *dst,
+    std::vector<unsigned> *dst_allocated, unsigned *population) const
+{
+  static const unsigned PLANE = OB_POPULATION_DETAIL * OB_POPULATION_DETAIL;
+  int za = math::max(layer * OB_POPULATION_BRICK, 1),
+      zb = math::min(layer * OB_POPULATION_BRICK + OB_POPULATION_BRICK, OB_POPULATION_DETAIL - 1);
+
+  // Nothing to do if there is no population within reach.
+  bool empty = true;
+  for(unsigned ii = static_cast<unsigned>(math::max(za - 1, 0) / OB_POPULATION_BRICK) * BRICK_COUNT * BRICK_COUNT,
+      ee = static_cast<unsigned>(zb / OB_POPULATION_BRICK + 1) * BRICK_COUNT * BRICK_COUNT;
+      (ii < ee) && (ii < m_bricks.size()); ++ii)
+  {
+    if(m_bricks[ii])
     {
-      cb.y() += -ca.y();
-      ca.y() = 0; 
+      empty = false;
+      break;
     }
-    else if(cb.x() > 255)
+  }
+  if(empty)
+  {
+    return;
+  }
+
+  // Input planes are loaded in a ring of three.
+  std::vector<uint8_t> planes(PLANE * 3);
+  std::vector<uint16_t> sum_z(PLANE),
+    sum_a(OB_POPULATION_DETAIL),
+    sum_b(OB_POPULATION_DETAIL);
+  std::vector<bool> rows(OB_POPULATION_DETAIL);
+  unsigned ret = 0;
+
+  this->filterPlane(za - 1, &planes[static_cast<unsigned>((za - 1) % 3) * PLANE]);
+  this->filterPlane(za, &planes[static_cast<unsigned>(za % 3) * PLANE]);
+  for(int kk = za; (kk < zb); ++kk)
+  {
+    this->filterPlane(kk + 1, &planes[static_cast<unsigned>((kk + 1) % 3) * PLANE]);
+
+    // Pass 1: sum along Z.
+    const uint8_t *p0 = &planes[0],
+          *p1 = &planes[PLANE],
+          *p2 = &planes[PLANE * 2];
+    for(int jj = 0; (jj < OB_POPULATION_DETAIL); ++jj)
     {
-      ca.y() -= cb.y() - 255;
-      cb.y() = 255;
+      bool nonzero = false;
+      for(int ii = jj * OB_POPULATION_DETAIL, ee = ii + OB_POPULATION_DETAIL; (ii < ee); ++ii)
+      {
+        uint16_t value = static_cast<uint16_t>(p0[ii] + p1[ii] + p2[ii]);
+        sum_z[static_cast<unsigned>(ii)] = value;
+        nonzero = nonzero || value;
+      }
+      rows[static_cast<unsigned>(jj)] = nonzero;
     }
-    if(ca.z() < 0)
+
+    for(int jj = 1; (jj < OB_POPULATION_DETAIL - 1); ++jj)
     {
-      cb.z() += -ca.z();
-      ca.z() = 0; 
+      if(!rows[static_cast<unsigned>(jj - 1)] && !rows[static_cast<unsigned>(jj)] &&
+          !rows[static_cast<unsigned>(jj + 1)])
+      {
+        continue;
+      }
+
+      // Pass 2: sum along Y. The original kernel samples the row ahead in X
+      // at y, y and y + 1, so that is kept in a separate sum.
+      const uint16_t *zp = &sum_z[static_cast<unsigned>((jj - 1) * OB_POPULATION_DETAIL)],
+            *zc = zp + OB_POPULATION_DETAIL,
+            *zn = zc + OB_POPULATION_DETAIL;
+      for(int ii = 0; (ii < OB_POPULATION_DETAIL); ++ii)
+      {
+        sum_a[static_cast<unsigned>(ii)] = static_cast<uint16_t>(zp[ii] + zc[ii] + zn[ii]);
+        sum_b[static_cast<unsigned>(ii)] = static_cast<uint16_t>(zc[ii] * 2 + zn[ii]);
+      }
+
+      // Pass 3: sum along X.
+      for(int ii = 1; (ii < OB_POPULATION_DETAIL - 1); ++ii)
+      {
+        int value = (sum_a[static_cast<unsigned>(ii - 1)] + sum_a[static_cast<unsigned>(ii)] +
+            sum_b[static_cast<unsigned>(ii + 1)]) / 27;
+        if(!value)
+        {
+          continue;
+        }
+
+        unsigned idx = brick_index(ii, jj, kk);
+        PopulationBrick *brick = (*dst)[idx];
+        if(!brick)
+        {
+          brick = new PopulationBrick();
+          memset(brick->m_data, 0, BRICK_BYTES);
+          brick->m_population = 0;
+          brick->m_dirty = false;
+          (*dst)[idx] = brick;
+
+          boost::mutex::scoped_lock scope(m_brick_mutex);
+          dst_allocated->push_back(idx);
+        }
+        brick->m_data[brick_offset(ii, jj, kk)] = static_cast<uint8_t>(value);
+        brick->m_population += static_cast<unsigned>(value);
+        ret += static_cast<unsigned>(value);
+      }
     }
-    else if(cb.z() > 255)
+  }
+
+  *population = ret;
+}
+
+bool PopulationMap::equals(const PopulationMap &op) const
+{
+  if(m_population != op.m_population)
+  {
+    return false;
+  }
+
+  static const uint8_t empty[BRICK_BYTES] = { 0 };
+  for(unsigned ii = 0; (ii < m_bricks.size()); ++ii)
+  {
+    const uint8_t *lhs = m_bricks[ii] ? m_bricks[ii]->m_data : empty,
+          *rhs = op.m_bricks[ii] ? op.m_bricks[ii]->m_data : empty;
+    if((lhs != rhs) && memcmp(lhs, rhs, BRICK_BYTES))
     {
-      ca.z() -= cb.z() - 255;
-      cb.z() = 255;
+      return false;
     }
   }
-  else
+  return true;
+}
+
+unsigned PopulationMap::getPopulation(const math::vec3i &ca, const math::vec3i &cb) const
+{
+  math::vec3i la(math::max(ca.x(), 0), math::max(ca.y(), 0), math::max(ca.z(), 0)),
+    lb(math::min(cb.x(), OB_POPULATION_DETAIL - 1), math::min(cb.y(), OB_POPULATION_DETAIL - 1),
+        math::min(cb.z(), OB_POPULATION_DETAIL - 1));
+  unsigned ret = 0;
+
+  for(int kk = la.z() / OB_POPULATION_BRICK; (kk <= lb.z() / OB_POPULATION_BRICK); ++kk)
   {
-    ca.x() = math::max(ca.x(), 0);
-    ca.y() = math::max(ca.y(), 0);
-    ca.z() = math::max(ca.z(), 0);
-    cb.x() = math::min(cb.x(), 255);
-    cb.y() = math::min(cb.y(), 255);
-    cb.z() = math::min(cb.z(), 255);
+    int za = math::max(kk * OB_POPULATION_BRICK, la.z()),
+        zb = math::min(kk * OB_POPULATION_BRICK + OB_POPULATION_BRICK - 1, lb.z());
+
+    for(int jj = la.y() / OB_POPULATION_BRICK; (jj <= lb.y() / OB_POPULATION_BRICK); ++jj)
+    {
+      int ya = math::max(jj * OB_POPULATION_BRICK, la.y()),
+          yb = math::min(jj * OB_POPULATION_BRICK + OB_POPULATION_BRICK - 1, lb.y());
+
+      for(int ii = la.x() / OB_POPULATION_BRICK; (ii <= lb.x() / OB_POPULATION_BRICK); ++ii)
+      {
+        const PopulationBrick *brick = m_bricks[static_cast<unsigned>((kk * BRICK_COUNT + jj) * BRICK_COUNT + ii)];
+        if(!brick)
+        {
+          continue;
+        }
+
+        int xa = math::max(ii * OB_POPULATION_BRICK, la.x()),
+            xb = math::min(ii * OB_POPULATION_BRICK + OB_POPULATION_BRICK - 1, lb.x());
+
+        // Whole brick within region, use the total.
+        if((xb - xa + 1 == OB_POPULATION_BRICK) && (yb - ya + 1 == OB_POPULATION_BRICK) &&
+            (zb - za + 1 == OB_POPULATION_BRICK))
+        {
+          ret += brick->m_population;
+          continue;
+        }
+
+        for(int zz = za; (zz <= zb); ++zz)
+        {
+          for(int yy = ya; (yy <= yb); ++yy)
+          {
+            for(int xx = xa; (xx <= xb); ++xx)
+            {
+              ret += brick->m_data[brick_offset(xx, yy, zz)];
+            }
+          }
+        }
+      }
+    }
   }
 
-  // Correct area.
-  math::vec3i cc = (cb - ca) + 1;
+  return ret;
+}
+
+int PopulationMap::paint(const math::vec3f &pos, float str, bool update)
+{
+  int ret = this->paintBrush(pos, str, update);
+
+  m_population = static_cast<unsigned>(static_cast<int>(m_population) + ret);
+  return ret;
+}
+
+int PopulationMap::paintBrush(const math::vec3f &pos, float str, bool update)
+{
+  float abs = math::abs(str),
+        abs2 = abs * abs;
+  math::vec3f spos = (math::normalize(pos) * POP_SCALE) + POP_CENTER;
+  int rsize = math::lround(abs);
+  int ret = 0;
+
+  // Must bind ca & cb to limits.
+  math::vec3i ca(math::max(math::floor(spos.x()) - rsize, 0),
+      math::max(math::floor(spos.y()) - rsize, 0),
+      math::max(math::floor(spos.z()) - rsize, 0)),
+    cb(math::min(math::ceil(spos.x()) + rsize, OB_POPULATION_DETAIL - 1),
+        math::min(math::ceil(spos.y()) + rsize, OB_POPULATION_DETAIL - 1),
+        math::min(math::ceil(spos.z()) + rsize, OB_POPULATION_DETAIL - 1));
+
+  //std::cout << ca << " ; " << cb << std::endl;
 
-  // Not needed always.
-  uint8_t *upd_data = NULL;
-  unsigned upd_idx = 0;
-  if(update)
+  // Squared distances along each axis, the brush is separable up to the square root.
+  float dx2[OB_POPULATION_DETAIL],
+        dy2[OB_POPULATION_DETAIL],
+        dz2[OB_POPULATION_DETAIL],
+        row[OB_POPULATION_DETAIL];
+  for(int ii = ca.x(); (ii <= cb.x()); ++ii)
+  {
+    float dd = static_cast<float>(ii) - spos.x();
+    dx2[ii - ca.x()] = dd * dd;
+  }
+  for(int ii = ca.y(); (ii <= cb.y()); ++ii)
+  {
+    float dd = static_cast<float>(ii) - spos.y();
+    dy2[ii - ca.y()] = dd * dd;
+  }
+  for(int ii = ca.z(); (ii <= cb.z()); ++ii)
   {
-    upd_data = new uint8_t[cc.x() * cc.y() * cc.z() * 2];
+    float dd = static_cast<float>(ii) - spos.z();
+    dz2[ii - ca.z()] = dd * dd;
   }
 
   for(int kk = ca.z(); (kk <= cb.z()); ++kk)
   {
-    unsigned plane_idx = static_cast<unsigned>(kk) * m_w * m_h;
+    float zz = dz2[kk - ca.z()];
+    if(zz >= abs2)
+    {
+      continue;
+    }
 
     for(int jj = ca.y(); (jj <= cb.y()); ++jj)
     {
-      unsigned row_idx = static_cast<unsigned>(jj) * m_w;
+      float yy = dy2[jj - ca.y()];
+      if(yy + zz >= abs2)
+      {
+        continue;
+      }
+
+      // Clip the row to the brush sphere.
+      float span = math::sqrt(abs2 - (yy + zz));
+      int xa = math::max(math::floor(spos.x() - span), ca.x()),
+          xb = math::min(math::ceil(spos.x() + span), cb.x()),
+          xcnt = xb - xa + 1;
+      const float *xx = dx2 + (xa - ca.x());
+
+      // Falloff for the whole row first, then apply it.
+      for(int ii = 0; (ii < xcnt); ++ii)
+      {
+        float dist2 = (xx[ii] + yy) + zz;
+        row[ii] = (dist2 < abs2) ? (1.0f - math::sqrt(dist2) / abs) : 0.0f;
+      }
 
-      for(int ii = ca.x(); (ii <= cb.x()); ++ii)
+      for(int ii = 0; (ii < xcnt); ++ii)
       {
-        unsigned idx = plane_idx + row_idx + static_cast<unsigned>(ii);
-        uint8_t *ptr = m_data + (idx * 2);
-        math::vec3f coord(static_cast<float>(ii), static_cast<float>(jj),
-            static_cast<float>(kk));
-        float dist = math::length(coord - spos),
-              curr_str = 1.0f - dist / abs;
-        if(update)
+        float curr_str = row[ii];
+        if(curr_str <= 0.0f)
         {
-          //std::cout << "dist " << dist;
+          continue;
         }
-        if(curr_str > 0.0f)
+
+        int diff = math::lround((curr_str * str) * 255.0f);
+        if(!diff)
         {
-          int diff = math::lround((curr_str * str) * 255.0f);
-          int old_pop = static_cast<int>(ptr[0]);
-          int old_rubble = static_cast<int>(ptr[1]);
-          int new_pop = math::min(math::max(old_pop + diff, 0), 255);
-          int new_rubble = math::min(math::max(old_rubble - diff, 0), 255);
-
-          ret += new_pop - old_pop;
-          //std::cout << diff << std::endl;
-          ptr[0] = static_cast<uint8_t>(new_pop);
-          ptr[1] = static_cast<uint8_t>(new_rubble);
+          continue;
         }
-        if(update)
+
+        int px = xa + ii;
+        PopulationBrick &brick = this->acquireBrick(brick_index(px, jj, kk));
+        uint8_t *ptr = brick.m_data + brick_offset(px, jj, kk);
+        int old_pop = static_cast<int>(ptr[0]);
+        int old_rubble = static_cast<int>(ptr[1]);
+        int new_pop = math::min(math::max(old_pop + diff, 0), 255);
+        int new_rubble = math::min(math::max(old_rubble - diff, 0), 255);
+
+        ret += new_pop - old_pop;
+        //std::cout << diff << std::endl;
+        ptr[0] = static_cast<uint8_t>(new_pop);
+        ptr[1] = static_cast<uint8_t>(new_rubble);
+        brick.m_population = static_cast<unsigned>(static_cast<int>(brick.m_population) +
+            new_pop - old_pop);
+        if(update && !brick.m_dirty && ((new_pop != old_pop) || (new_rubble != old_rubble)))
         {
-          upd_data[upd_idx + 0] = ptr[0];
-          upd_data[upd_idx + 1] = ptr[1];
-          //std::cout << " -> " << static_cast<int>(ptr[1]) << std::endl;
-          upd_idx += 2;
+          boost::mutex::scoped_lock scope(m_brick_mutex);
+          brick.m_dirty = true;
+          m_dirty.push_back(brick_index(px, jj, kk));
         }
       }
     }
   }
 
-  if(update)
+  return ret;
+}
+
+void PopulationMap::paintMany(const std::vector<math::vec3f> &pos, float str)
+{
+  // Slabs must be thick enough that brushes in every other slab never touch
+  // the same brick.
+  int reach = math::lround(math::abs(str)) + 1,
+      slab = ((2 * reach + OB_POPULATION_BRICK) / OB_POPULATION_BRICK + 1) * OB_POPULATION_BRICK,
+      slab_count = (OB_POPULATION_DETAIL + slab - 1) / slab;
+  std::vector<std::vector<unsigned> > slabs(static_cast<unsigned>(slab_count));
+  std::vector<int> results(static_cast<unsigned>(slab_count), 0);
+
+  for(unsigned ii = 0; (ii < pos.size()); ++ii)
   {
-    thr::wait_privileged(&PopulationMap::taskSubTexture, this, upd_data, boost::ref(ca), boost::ref(cc));
-    delete[] upd_data;
+    math::vec3f spos = (math::normalize(pos[ii]) * POP_SCALE) + POP_CENTER;
+    int idx = math::min(math::max(math::floor(spos.z()) / slab, 0), slab_count - 1);
+    slabs[static_cast<unsigned>(idx)].push_back(ii);
   }
 
-  m_population += static_cast<unsigned>(ret);
-  return ret;
+  thr::TaskGroup group;
+  for(int ii = 0; (ii < 2); ++ii)
+  {
+    for(int jj = ii; (jj < slab_count); jj += 2)
+    {
+      unsigned idx = static_cast<unsigned>(jj);
+      if(!slabs[idx].empty())
+      {
+        group.dispatch(&PopulationMap::paintSlab, this, boost::cref(pos),
+            boost::cref(slabs[idx]), str, &results[idx]);
+      }
+    }
+    group.wait();
+  }
+
+  BOOST_FOREACH(int vv, results)
+  {
+    m_population = static_cast<unsigned>(static_cast<int>(m_population) + vv);
+  }
+}
+
+void PopulationMap::paintSlab(const std::vector<math::vec3f> &pos,
+    const std::vector<unsigned> &indices, float str, int *result)
+{
+  int ret = 0;
+
+  BOOST_FOREACH(unsigned vv, indices)
+  {
+    ret += this->paintBrush(pos[vv], str, false);
+  }
+
+  *result = ret;
 }
 
 void PopulationMap::scale(float op)
 {
-  for(unsigned ii = 0; (ii < this->getSizeBytes()); ii += 2)
+  unsigned population = 0;
+
+  BOOST_FOREACH(unsigned vv, m_allocated)
   {
-    uint8_t *ptr = m_data + ii;
-    int curr_pop = static_cast<int>(*ptr);
-    *ptr = static_cast<uint8_t>(math::lround(static_cast<float>(curr_pop) * op));
+    PopulationBrick *brick = m_bricks[vv];
+
+    brick->m_population = 0;
+    for(unsigned ii = 0; (ii < BRICK_BYTES); ii += 2)
+    {
+      uint8_t *ptr = brick->m_data + ii;
+      int curr_pop = static_cast<int>(*ptr);
+      *ptr = static_cast<uint8_t>(math::lround(static_cast<float>(curr_pop) * op));
+      brick->m_population += *ptr;
+    }
+    population += brick->m_population;
   }
+
+  m_population = population;
 }
 
 void PopulationMap::refresh()
 {
-  for(unsigned ii = 0; (ii < this->getSizeBytes()); ii += 2)
+  thr::TimelineScope timeline("game", "refresh");
+  unsigned population = 0;
+
+  BOOST_FOREACH(unsigned vv, m_allocated)
+  {
+    PopulationBrick *brick = m_bricks[vv];
+
+    brick->m_population = 0;
+    for(unsigned ii = 0; (ii < BRICK_BYTES); ii += 2)
+    {
+      uint8_t *ptr = brick->m_data + ii;
+      int curr_pop = static_cast<int>(*ptr);
+      if(curr_pop > OB_POPULATION_RANDOM_LIMIT)
+      {
+        curr_pop -= math::mrand(0, curr_pop - OB_POPULATION_RANDOM_LIMIT);
+        *ptr = static_cast<uint8_t>(curr_pop);
+      }
+      brick->m_population += *ptr;
+    }
+    population += brick->m_population;
+  }
+  m_population = population;
+
+  // All bricks are uploaded, nothing stays dirty.
+  BOOST_FOREACH(unsigned vv, m_dirty)
+  {
+    m_bricks[vv]->m_dirty = false;
+  }
+  m_dirty.clear();
+
+  // Residency of the texture is needed, the fence also waits for a pending upload using the staging area.
+  thr::defer_privileged(&PopulationMap::taskTexture, this);
+  thr::fence_privileged();
+
+  // Upload everything that is either populated now or was populated in the
+  // texture before.
+  std::vector<unsigned> indices;
+  for(unsigned ii = 0; (ii < m_bricks.size()); ++ii)
+  {
+    if(m_bricks[ii] || m_resident[ii])
+    {
+      indices.push_back(ii);
+    }
+  }
+  {
+    boost::mutex::scoped_lock scope(m_upload_mutex);
+    m_upload_pending = true;
+  }
+  this->pack(indices, true);
+
+  thr::defer_privileged(&PopulationMap::taskUpload, this);
+}
+
+void PopulationMap::flush()
+{
+  if(m_dirty.empty() || !m_texture)
+  {
+    return;
+  }
   {
-    uint8_t *ptr = m_data + ii;
-    int curr_pop = static_cast<int>(*ptr);
-    if(curr_pop > OB_POPULATION_RANDOM_LIMIT)
+    boost::mutex::scoped_lock scope(m_upload_mutex);
+    if(m_upload_pending)
     {
-      curr_pop -= math::mrand(0, curr_pop - OB_POPULATION_RANDOM_LIMIT);
-      *ptr = static_cast<uint8_t>(curr_pop);
+      return;
     }
+    m_upload_pending = true;
   }
 
-  //std::cout << "waiting\n";
-  thr::wait_privileged(&PopulationMap::taskTexture, this, this);
-  //std::cout << "done\n";
+  BOOST_FOREACH(unsigned vv, m_dirty)
+  {
+    m_bricks[vv]->m_dirty = false;
+  }
+  this->pack(m_dirty, false);
+  m_dirty.clear();
+
+  thr::defer_privileged(&PopulationMap::taskUpload, this);
 }
 
-void PopulationMap::taskTexture(const gfx::VolumeGray16 *vol)
+void PopulationMap::pack(std::vector<unsigned> &indices, bool parallel)
 {
-  if(vol)
+  // Coalesce consecutive bricks along X into runs.
+  std::vector<PopulationRun> runs;
+  std::sort(indices.begin(), indices.end());
+  m_staging.clear();
+  m_uploads.clear();
+  for(std::vector<unsigned>::const_iterator ii = indices.begin(), ee = indices.end(); (ii != ee);)
   {
-    //std::cout << "creating texture\n";
-    m_texture = gfx::Texture3DSptr(new gfx::Texture3D(*vol, gfx::ImageLoader().generateMipmaps()));
-    //std::cout << "done\n";
+    PopulationRun run;
+    run.m_first = *ii;
+    run.m_count = 1;
+    for(++ii; (ii != ee) && (*ii == run.m_first + run.m_count) &&
+        ((*ii % static_cast<unsigned>(BRICK_COUNT)) != 0); ++ii)
+    {
+      ++run.m_count;
+    }
+    run.m_offset = static_cast<unsigned>(m_staging.size());
+    runs.push_back(run);
+
+    math::vec3i pos(static_cast<int>(run.m_first) % BRICK_COUNT,
+        (static_cast<int>(run.m_first) / BRICK_COUNT) % BRICK_COUNT,
+        static_cast<int>(run.m_first) / (BRICK_COUNT * BRICK_COUNT));
+    pos *= OB_POPULATION_BRICK;
+    unsigned offset = run.m_offset;
+    for(int jj = 0, side = OB_POPULATION_BRICK; (side > 1); ++jj, side /= 2)
+    {
+      PopulationUpload upload;
+      upload.m_level = jj;
+      upload.m_pos = math::vec3i(pos.x() >> jj, pos.y() >> jj, pos.z() >> jj);
+      upload.m_size = math::vec3i(static_cast<int>(run.m_count) * side, side, side);
+      upload.m_offset = offset;
+      m_uploads.push_back(upload);
+      offset += run.m_count * static_cast<unsigned>(side * side * side * 2);
+    }
+    m_staging.resize(offset);
   }
-  else
+
+  // Per-brick mipmap levels.
+  static const unsigned RUNS_PER_TASK = 64;
+  thr::TaskGroup group;
+  for(unsigned ii = 0; (ii < runs.size()); ii += RUNS_PER_TASK)
   {
+    unsigned count = math::min(static_cast<unsigned>(runs.size()) - ii, RUNS_PER_TASK);
+    if(parallel)
+    {
+      group.dispatch(pack_runs, &m_bricks, &runs[ii], count, &m_staging[0], &m_coarse[0]);
+    }
+    else
+    {
+      pack_runs(&m_bricks, &runs[ii], count, &m_staging[0], &m_coarse[0]);
+    }
+  }
+  if(parallel)
+  {
+    group.wait();
+  }
+
+  // Remaining levels span several bricks, they are small enough to upload whole.
+  int side = BRICK_COUNT,
+      level = 0;
+  for(int ii = OB_POPULATION_BRICK; (ii > 1); ii /= 2)
+  {
+    ++level;
+  }
+  unsigned offset = static_cast<unsigned>(m_staging.size());
+  m_staging.insert(m_staging.end(), m_coarse.begin(), m_coarse.end());
+  for(;;)
+  {
+    PopulationUpload upload;
+    upload.m_level = level;
+    upload.m_pos = math::vec3i(0, 0, 0);
+    upload.m_size = math::vec3i(side, side, side);
+    upload.m_offset = offset;
+    m_uploads.push_back(upload);
+
+    if(side <= 1)
+    {
+      break;
+    }
+    unsigned next = static_cast<unsigned>(m_staging.size());
+    m_staging.resize(next + static_cast<unsigned>(side * side * side / 4));
+    mip_down(&m_staging[offset], &m_staging[next], side);
+    offset = next;
+    side /= 2;
+    ++level;
+  }
+
+  BOOST_FOREACH(unsigned vv, indices)
+  {
+    m_resident[vv] = (NULL != m_bricks[vv]);
+  }
+}
+
+void PopulationMap::taskRelease()
+{
+  if(m_texture)
+  {
+    recycled_texture = m_texture;
+    recycled_resident.swap(m_resident);
     m_texture = gfx::Texture3DSptr();
   }
 }
 
-void PopulationMap::taskSubTexture(const uint8_t *data, const math::vec3i &idx,
-    const math::vec3i &size)
+void PopulationMap::taskTexture()
+{
+  if(m_texture)
+  {
+    return;
+  }
+
+  if(recycled_texture)
+  {
+    m_texture = recycled_texture;
+    m_resident.swap(recycled_resident);
+    recycled_texture = gfx::Texture3DSptr();
+    return;
+  }
+
+  // Contents of a new texture are undefined, everything must be written.
+  m_texture = gfx::Texture3DSptr(new gfx::Texture3D(OB_POPULATION_DETAIL, OB_POPULATION_DETAIL,
+        OB_POPULATION_DETAIL, 16, NULL));
+  m_resident.assign(m_bricks.size(), true);
+}
+
+void PopulationMap::taskUpload()
 {
   m_texture->bind();
-  glTexSubImage3D(GL_TEXTURE_3D, 0, idx.x(), idx.y(), idx.z(), size.x(), size.y(), size.z(),
-      GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, data);
-  // TODO: is this fast enough on all cards?
+  BOOST_FOREACH(const PopulationUpload &vv, m_uploads)
+  {
+    glTexSubImage3D(GL_TEXTURE_3D, vv.m_level, vv.m_pos.x(), vv.m_pos.y(), vv.m_pos.z(),
+        vv.m_size.x(), vv.m_size.y(), vv.m_size.z(), GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
+        &m_staging[vv.m_offset]);
+    thr::timeline_upload(vv.m_size.x() * vv.m_size.y() * vv.m_size.z() * 2);
+  }
+
+  boost::mutex::scoped_lock scope(m_upload_mutex);
+  m_upload_pending = false;
 }
 
+void PopulationMap::release_recycled()
+{
+  recycled_texture = gfx::Texture3DSptr();
+  recycled_resident.clear();
+}
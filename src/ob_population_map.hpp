@@ -2,8 +2,12 @@
 #define OB_POPULATION_MAP_HPP
 
 #include "gfx/texture_3d.hpp"
-#include "gfx/volume.hpp"
-#include "math/rect.hpp"
+#include "math/vec.hpp"
+#include "ob_constants.hpp"
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
 
 namespace gfx
 {
@@ -12,12 +16,96 @@ namespace gfx
 
 namespace ob
 {
+  /** \brief One brick of the population map.
+   *
+   * Population and rubble are stored interleaved, two bytes per voxel.
+   */
+  struct PopulationBrick
+  {
+    /** Brick data. */
+    uint8_t m_data[OB_POPULATION_BRICK * OB_POPULATION_BRICK * OB_POPULATION_BRICK * 2];
+
+    /** Population within this brick (color units). */
+    unsigned m_population;
+
+    /** Set if waiting for upload. */
+    bool m_dirty;
+  };
+
+  /** \brief One region of a population map texture upload.
+   */
+  struct PopulationUpload
+  {
+    /** Mipmap level. */
+    int m_level;
+
+    /** Region position (voxels). */
+    math::vec3i m_pos;
+
+    /** Region size (voxels). */
+    math::vec3i m_size;
+
+    /** Offset into staging buffer. */
+    unsigned m_offset;
+  };
+
+  /** \brief Run of consecutive bricks along X packed for upload.
+   */
+  struct PopulationRun
+  {
+    /** First brick index. */
+    unsigned m_first;
+
+    /** Number of bricks. */
+    unsigned m_count;
+
+    /** Offset into staging buffer. */
+    unsigned m_offset;
+  };
+
   /** \brief Population map in 3D.
-  */
-  class PopulationMap :
-    public gfx::VolumeGray16
+   *
+   * The map is stored in bricks that are allocated on first write. Since all
+   * paint operations are projected onto the planet surface, only the bricks
+   * in a thin shell are ever allocated.
+   *
+   * The texture is uploaded brick by brick with mipmaps generated on the
+   * CPU. When a population map is destroyed, its texture is kept for the
+   * next one, which then only uploads the bricks populated in either.
+   */
+  class PopulationMap
   {
     private:
+      /** Bricks, NULL where not allocated. */
+      std::vector<PopulationBrick*> m_bricks;
+
+      /** Indices of allocated bricks. */
+      std::vector<unsigned> m_allocated;
+
+      /** Bricks that are not empty in the texture. */
+      std::vector<bool> m_resident;
+
+      /** Coarsest per-brick mipmap level, one voxel per brick. */
+      std::vector<uint8_t> m_coarse;
+
+      /** Indices of bricks waiting for upload. */
+      std::vector<unsigned> m_dirty;
+
+      /** Staging buffer for uploads, kept between frames. */
+      std::vector<uint8_t> m_staging;
+
+      /** Upload regions within the staging buffer. */
+      std::vector<PopulationUpload> m_uploads;
+
+      /** Set while an upload is waiting in the privileged thread. */
+      bool m_upload_pending;
+
+      /** Guards brick bookkeeping when painting from several threads. */
+      mutable boost::mutex m_brick_mutex;
+
+      /** Guards the upload state. */
+      boost::mutex m_upload_mutex;
+
       /** Current population (color units). */
       unsigned m_population;
 
@@ -34,6 +122,15 @@ namespace ob
         return m_population;
       }
 
+      /** \brief Accessor.
+       *
+       * \return Number of allocated bricks.
+       */
+      unsigned getBrickCount() const
+      {
+        return static_cast<unsigned>(m_allocated.size());
+      }
+
       /** \brief Accessor.
        *
        * \return Texture of this.
@@ -48,23 +145,89 @@ namespace ob
       PopulationMap();
 
       /** \brief Destructor. */
-      virtual ~PopulationMap();
+      ~PopulationMap();
 
     private:
+      /** \brief Get a brick, allocating it if necessary.
+       *
+       * \param idx Brick index.
+       * \return Brick.
+       */
+      PopulationBrick& acquireBrick(unsigned idx);
+
+      /** \brief Paint one brush.
+       *
+       * Bricks touched by concurrent calls must not overlap. Does not update
+       * the total population.
+       *
+       * \param pos 3D position to paint into.
+       * \param str Brush strength.
+       * \param update Mark changes for upload.
+       * \return Population change.
+       */
+      int paintBrush(const math::vec3f &pos, float str, bool update);
+
+      /** \brief Paint task for one slab.
+       *
+       * \param pos Brush positions.
+       * \param indices Indices of positions to paint in this slab.
+       * \param str Brush strength.
+       * \param result Population change is written here.
+       */
+      void paintSlab(const std::vector<math::vec3f> &pos,
+          const std::vector<unsigned> &indices, float str, int *result);
+
+      /** \brief Extract population of one plane for filtering.
+       *
+       * \param pz Z coordinate.
+       * \param dst Destination, one byte per voxel.
+       */
+      void filterPlane(int pz, uint8_t *dst) const;
+
+      /** \brief Filter task for one layer of bricks.
+       *
+       * \param layer Brick layer.
+       * \param dst Destination bricks.
+       * \param dst_allocated Indices of allocated destination bricks.
+       * \param population Population of the filtered layer is written here.
+       */
+      void filterSlab(int layer, std::vector<PopulationBrick*> *dst,
+          std::vector<unsigned> *dst_allocated, unsigned *population) const;
+
+      /** \brief Pack bricks into the staging buffer.
+       *
+       * Generates the upload regions for all mipmap levels.
+       *
+       * \param indices Brick indices, will be sorted.
+       * \param parallel True to pack in worker threads.
+       */
+      void pack(std::vector<unsigned> &indices, bool parallel);
+
+      /** Texture release task.
+       *
+       * Hands the texture over to the next population map.
+       */
+      void taskRelease();
+
       /** Texture task.
        *
-       * \param vol Volume to pass (this or NULL).
+       * Reuses the texture of a previous population map or creates a new one.
        */
-      void taskTexture(const gfx::VolumeGray16 *vol);
+      void taskTexture();
 
-      /** Sub-texture task.
+      /** Upload task.
        *
-       * \param data Data to update.
-       * \param idx Update index.
-       * \param size Update size.
+       * Uploads all regions in the staging buffer.
        */
-      void taskSubTexture(const uint8_t *data, const math::vec3i &idx,
-          const math::vec3i &size);
+      void taskUpload();
+
+    public:
+      /** \brief Release the texture kept for reuse.
+       *
+       * Must be called from the privileged thread before the GL context is
+       * destroyed.
+       */
+      static void release_recycled();
 
     public:
       /** \brief Feed into shader.
@@ -74,27 +237,34 @@ namespace ob
        */
       void feed(const gfx::Shader &sh, unsigned idx) const;
 
-      /** \brief Filter this.
-      */
-      void filter();
+      /** \brief Upload all dirty bricks.
+       *
+       * Packs the dirty bricks into the staging buffer and dispatches one
+       * upload task into the privileged thread without waiting for it. If the
+       * previous upload has not been completed yet, does nothing and the
+       * bricks stay dirty until the next call.
+       *
+       * To be called once per frame.
+       */
+      void flush();
 
-      /** \brief Collect average value from around a certain pixel.
+      /** \brief Filter this.
        *
-       * \param px X coordinate.
-       * \param py Y coordinate.
-       * \param pz Z coordinate.
-       * \return Average value.
+       * Replaces population with a 3x3x3 box average and removes rubble.
+       * Border voxels are left empty. Computed as three separable passes
+       * with brick layers processed in parallel.
        */
-      uint8_t filterCollect(unsigned px, unsigned py, unsigned pz);
+      void filter();
 
-      /** \brief Get a value from given coordinates or negative.
+      /** \brief Get population within a region.
        *
-       * \param px X coordinate.
-       * \param py Y coordinate.
-       * \param pz Z coordinate.
-       * \return Value here or negative.
+       * Bricks completely within the region are summed from their totals.
+       *
+       * \param ca Region start (inclusive).
+       * \param cb Region end (inclusive).
+       * \return Population within the region (color units).
        */
-      int filterGet(unsigned px, unsigned py, unsigned pz);
+      unsigned getPopulation(const math::vec3i &ca, const math::vec3i &cb) const;
 
       /** \brief Paint into the population map.
        *
@@ -109,11 +279,32 @@ namespace ob
        *
        * \param pos 3D position to paint into.
        * \param str Brush strength.
-       * \param update Set to true to immediately update the sub-texture.
+       * \param update Set to true to mark the changes for upload in flush().
        * \return Amount of population strength removed in total.
        */
       int paint(const math::vec3f &pos, float str, bool update = false);
 
+      /** \brief Paint many brushes of same strength.
+       *
+       * The volume is split into slabs along Z and every other slab is painted
+       * in parallel, so that concurrently painted brushes never overlap.
+       * Overlapping brushes of same strength commute, so the result is
+       * identical to painting them in order.
+       *
+       * Waits for all outstanding tasks as thr::wait() does.
+       *
+       * \param pos Brush positions.
+       * \param str Brush strength.
+       */
+      void paintMany(const std::vector<math::vec3f> &pos, float str);
+
+      /** \brief Tell if population and rubble data equals another map.
+       *
+       * \param op Other map.
+       * \return True if equal.
+       */
+      bool equals(const PopulationMap &op) const;
+
       /** \brief Scale all population values.
        *
        * \param op Factor.
@@ -121,17 +312,14 @@ namespace ob
       void scale(float op);
 
       /** \brief Refresh the texture in this.
-      */
+       *
+       * Randomizes population above the limit and uploads all bricks.
+       */
       void refresh();
 
-    public:
       /** \brief Clears this.
       */
-      void clear()
-      {
-        m_population = 0;
-        this->gfx::Volume::clear(static_cast<uint8_t>(0));
-      }
+      void clear();
   };
 }
 
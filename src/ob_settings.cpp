@@ -38,11 +38,16 @@ void Settings::defaults()
 {
   m_camera_rot_speed_y.set(OB_CAMERA_ROT_SPEED_STEP * 4.0f, OB_CAMERA_ROT_SPEED_STEP, OB_CAMERA_ROT_SPEED_STEP * 10.0f);
   m_camera_rot_speed_x.set(-m_camera_rot_speed_y.get(), -OB_CAMERA_ROT_SPEED_STEP * 10.0f, OB_CAMERA_ROT_SPEED_STEP * 10.0f);
+  m_affinity.set(0, 0, 1);
+  m_budgets.clear();
   m_detail.assign("desktop");
+  m_framerate.set(0, 0, 1000);
   m_fullscreen.set(0, 0, 1);
+  m_isolate.set(0, 0, 1);
   m_resolution.assign("800x600@32");
   m_volume_music.set(0.5f, 0.0f, 1.0f);
   m_volume_samples.set(1.0f, 0.0f, 1.0f);
+  m_workers.set(0, 0, 63);
 
   m_detail_levels.clear();
   m_detail_levels.push_back("laptop");
@@ -98,7 +103,18 @@ void Settings::load(const std::string &pfname)
     const std::string &type = vv.first;
     const pt::ptree &subtree = vv.second;
 
-    if(!type.compare("camera_rot_speed_x"))
+    if(!type.compare("affinity"))
+    {
+      m_affinity.set(subtree.get<int>(""));
+    }
+    else if(!type.compare("budget"))
+    {
+      BOOST_FOREACH(const pt::ptree::value_type &ww, subtree)
+      {
+        this->setBudget(ww.first, ww.second.get<unsigned>(""));
+      }
+    }
+    else if(!type.compare("camera_rot_speed_x"))
     {
       m_camera_rot_speed_x.set(subtree.get<float>(""));
     }
@@ -110,6 +126,10 @@ void Settings::load(const std::string &pfname)
     {
       m_detail.assign(subtree.get<std::string>(""));
     }
+    else if(!type.compare("framerate"))
+    {
+      m_framerate.set(subtree.get<int>(""));
+    }
     else if(!type.compare("fullscreen"))
     {
       m_fullscreen.set(subtree.get<int>(""));
@@ -120,6 +140,10 @@ void Settings::load(const std::string &pfname)
       std::string name = subtree.get<std::string>("name");
       m_high_scores.add(score, ui::wstr_utf8(name), false);
     }
+    else if(!type.compare("isolate"))
+    {
+      m_isolate.set(subtree.get<int>(""));
+    }
     else if(!type.compare("resolution"))
     {
       m_resolution.assign(subtree.get<std::string>(""));
@@ -132,6 +156,10 @@ void Settings::load(const std::string &pfname)
     {
       this->setVolumeSamples(subtree.get<float>(""));
     }
+    else if(!type.compare("workers"))
+    {
+      m_workers.set(subtree.get<int>(""));
+    }
     else if(type.compare("<xmlattr>"))
     {
       std::stringstream err;
@@ -157,13 +185,22 @@ void Settings::save(const std::string &pfname)
 
   pt::ptree xtree;
 
+  xtree.put("settings.affinity", m_affinity.get());
+  for(std::map<std::string, unsigned>::const_iterator ii = m_budgets.begin(), ee = m_budgets.end();
+      (ii != ee); ++ii)
+  {
+    xtree.put(std::string("settings.budget.") + ii->first, ii->second);
+  }
   xtree.put("settings.camera_rot_speed_x", m_camera_rot_speed_x.get());
   xtree.put("settings.camera_rot_speed_y", m_camera_rot_speed_y.get());
   xtree.put("settings.detail", m_detail);
+  xtree.put("settings.framerate", m_framerate.get());
   xtree.put("settings.fullscreen", m_fullscreen.get());
+  xtree.put("settings.isolate", m_isolate.get());
   xtree.put("settings.resolution", m_resolution);
   xtree.put("settings.volume_music", m_volume_music.get());
   xtree.put("settings.volume_samples", m_volume_samples.get());
+  xtree.put("settings.workers", m_workers.get());
 
   const std::vector<HighScoreEntry> &hvec = m_high_scores.getEntries();
   for(unsigned ii = 0; (ii < hvec.size()); ++ii)
@@ -3,6 +3,8 @@
 
 #include "ob_high_scores.hpp"
 
+#include <map>
+
 namespace ob
 {
   /** \brief Setting struct.
@@ -114,6 +116,9 @@ namespace ob
       /** High score table. */
       HighScores m_high_scores;
 
+      /** Memory budgets of stores in megabytes by store name. */
+      std::map<std::string, unsigned> m_budgets;
+
       /** Mouse rotation speed. */
       settingf m_camera_rot_speed_x;
 
@@ -126,9 +131,21 @@ namespace ob
       /** Audio volume. */
       settingf m_volume_samples;
 
+      /** Pin threads to processors. */
+      settingi m_affinity;
+
+      /** Render framerate with the simulation decoupled from it, 0 to render once per simulation step. */
+      settingi m_framerate;
+
       /** Fullscreen mode. */
       settingi m_fullscreen;
 
+      /** Reserve a processor for the rendering thread. */
+      settingi m_isolate;
+
+      /** Number of worker threads, 0 for one less than the number of processors. */
+      settingi m_workers;
+
       /** Fullscreen mode. */
       std::string m_detail;
 
@@ -195,6 +212,33 @@ namespace ob
       void setVolumeSamples(float op);
 
     public:
+      /** \brief Accessor.
+       *
+       * \return Thread affinity setting.
+       */
+      settingi& getAffinity()
+      {
+        return m_affinity;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Thread affinity setting.
+       */
+      const settingi& getAffinity() const
+      {
+        return m_affinity;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Store memory budgets in megabytes.
+       */
+      const std::map<std::string, unsigned>& getBudgets() const
+      {
+        return m_budgets;
+      }
+
       /** \brief Accessor.
        *
        * \return Mouse rotation speed setting.
@@ -249,6 +293,24 @@ namespace ob
         return m_detail_levels;
       }
 
+      /** \brief Accessor.
+       *
+       * \return Render framerate setting.
+       */
+      settingi& getFramerate()
+      {
+        return m_framerate;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Render framerate setting.
+       */
+      const settingi& getFramerate() const
+      {
+        return m_framerate;
+      }
+
       /** \brief Accessor.
        *
        * \return Fullscreen setting.
@@ -285,6 +347,24 @@ namespace ob
         return m_high_scores;
       }
 
+      /** \brief Accessor.
+       *
+       * \return Rendering thread isolation setting.
+       */
+      settingi& getIsolate()
+      {
+        return m_isolate;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Rendering thread isolation setting.
+       */
+      const settingi& getIsolate() const
+      {
+        return m_isolate;
+      }
+
       /** \brief Accessor.
        *
        * \return Resolution.
@@ -348,6 +428,41 @@ namespace ob
         return m_volume_samples;
       }
 
+      /** \brief Accessor.
+       *
+       * \return Worker thread count setting.
+       */
+      settingi& getWorkers()
+      {
+        return m_workers;
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Worker thread count setting.
+       */
+      const settingi& getWorkers() const
+      {
+        return m_workers;
+      }
+
+      /** \brief Set the memory budget of a store.
+       *
+       * \param name Store name.
+       * \param op New budget in megabytes, 0 for unlimited.
+       */
+      void setBudget(const std::string &name, unsigned op)
+      {
+        if(0 < op)
+        {
+          m_budgets[name] = op;
+        }
+        else
+        {
+          m_budgets.erase(name);
+        }
+      }
+
       /** \brief Setter.
        *
        * \param op New detail level string.
@@ -6,12 +6,13 @@
 namespace fs = boost::filesystem;
 using namespace ob;
 
-static data::Registration<gfx::Mesh, gfx::MeshLoader, VisualizationMesh> reg("ob_visualization");
+static data::Registration<gfx::Mesh, gfx::MeshLoader, VisualizationMesh, gfx::MeshData>
+  reg("ob_visualization");
 
 VisualizationMesh::VisualizationMesh(const boost::filesystem::path &pfname,
-    const boost::property_tree::ptree &root, const gfx::MeshLoader &loader)
+    const gfx::MeshData &mesh_data, const gfx::MeshLoader &loader)
 {
-  this->load(pfname, root, loader);
+  this->load(pfname, mesh_data, loader);
 }
 
 void VisualizationMesh::compile()
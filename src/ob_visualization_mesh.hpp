@@ -20,10 +20,10 @@ namespace ob
       /** \brief Constructor.
        *
        * \param pfname File to load from.
-       * \param root Property tree root.
+       * \param mesh_data Mesh file contents.
        * \param loader Loader settigns.
        */
-      VisualizationMesh(const boost::filesystem::path &pfname, const boost::property_tree::ptree &root,
+      VisualizationMesh(const boost::filesystem::path &pfname, const gfx::MeshData &mesh_data,
           const gfx::MeshLoader &loader);
 
       /** \brief Destructor. */
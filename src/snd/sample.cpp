@@ -1,6 +1,7 @@
 #include "snd/sample.hpp"
 
 #include "data/log.hpp"
+#include "data/pack.hpp"
 #include "thr/generic.hpp"
 #include "ui/generic.hpp"
 
@@ -119,7 +120,7 @@ void Sample::load(const fs::path &pfname, const SampleLoader &loader)
 
   this->unreserve();
 
-  fs::path location = data::open_search(pfname);
+  data::MappedFile mapped(pfname);
   {
     std::ostringstream sstr;
     sstr << "loading sample " << pfname;
@@ -131,7 +132,8 @@ void Sample::load(const fs::path &pfname, const SampleLoader &loader)
   SDL_AudioSpec spec;
   uint8_t *buf;
 
-  if(&spec != SDL_LoadWAV(location.generic_string().c_str(), &spec, &buf, &m_size))
+  SDL_RWops *rw = SDL_RWFromConstMem(mapped.getData(), static_cast<int>(mapped.getSize()));
+  if((NULL == rw) || (&spec != SDL_LoadWAV_RW(rw, 1, &spec, &buf, &m_size)))
   {
     std::ostringstream sstr;
     sstr << "could not load wav file: " << pfname << ": " << SDL_GetError();
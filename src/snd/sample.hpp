@@ -52,6 +52,15 @@ namespace snd
         return m_gain;
       }
 
+      /** \brief Get the size of sample data.
+       *
+       * \return Size in bytes.
+       */
+      uint64_t getStorageSize() const
+      {
+        return m_size;
+      }
+
       /** \brief Set the level.
        *
        * \param op New level.
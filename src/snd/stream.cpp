@@ -1,6 +1,7 @@
 #include "snd/stream.hpp"
 
 #include "data/generic.hpp"
+#include "thr/dispatch.hpp"
 #include "ui/generic.hpp"
 
 #include <fstream>
@@ -339,6 +340,7 @@ void Stream::run()
 {
   int16_t buffer[BLOCK_SAMPLES * 2];
 
+  thr::thr_pin_audio();
   while(!m_stop)
   {
     if(m_source.numQueuedBuffers() < QUEUE_BLOCKS)
@@ -1,64 +1,230 @@
 #include "thr/dispatch.hpp"
 
 #include "data/circular_buffer.hpp"
+#include "thr/histogram.hpp"
 #include "thr/promise.hpp"
-#include "thr/worker_thread.hpp"
+#include "thr/timeline.hpp"
+#include "thr/work_deque.hpp"
 
-#include <boost/scoped_ptr.hpp>
+#include <boost/atomic.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <iomanip>
 
 using namespace thr;
 
-/** Convenience typedef. */
-typedef boost::shared_ptr<ThreadStorage> ThreadStorageSptr;
+/** Maximum number of threads taking part in the dispatcher, the privileged thread included. */
+static const unsigned THREADS_MAX = 64;
+
+/** \brief Thread taking part in the dispatcher.
+ */
+struct Worker
+{
+  /** Own tasks. */
+  WorkDeque m_deque;
+
+  /** Thread, NULL for the privileged thread. */
+  ThreadSptr m_thread;
+
+  /** Index in the worker table, 0 for the privileged thread. */
+  unsigned m_index;
+
+  /** Number of tasks being executed on the stack of this thread. */
+  unsigned m_depth;
+
+  /** Number of tasks on the stack of this thread already counted as waiting. */
+  unsigned m_waiting;
+
+  /** State for choosing steal victims. */
+  uint32_t m_seed;
+
+  /** Number of tasks of any kind being executed on the stack of this thread, for telemetry. */
+  unsigned m_nesting;
+
+  /** Time slept within the outermost task being executed in microseconds, for telemetry. */
+  uint64_t m_nested_sleep;
+
+  /** Time spent executing tasks, sleeping excluded, in microseconds. */
+  boost::atomic<uint64_t> m_busy;
+
+  /** Time spent sleeping or parked in microseconds. */
+  boost::atomic<uint64_t> m_slept;
+
+  /** Number of tasks executed. */
+  boost::atomic<uint64_t> m_tasks;
+
+  /** Number of tasks stolen from other threads. */
+  boost::atomic<uint64_t> m_steals;
+
+  /** Number of times slept or parked. */
+  boost::atomic<uint64_t> m_sleeps;
 
-/** Convenience typedef. */
-typedef boost::shared_ptr<WorkerThread> WorkerThreadSptr;
+  /** \brief Constructor.
+   *
+   * \param pindex Index in the worker table.
+   * \param pseed Seed for choosing steal victims.
+   */
+  Worker(unsigned pindex, uint32_t pseed) :
+    m_index(pindex),
+    m_depth(0),
+    m_waiting(0),
+    m_seed(pseed),
+    m_nesting(0),
+    m_nested_sleep(0),
+    m_busy(0),
+    m_slept(0),
+    m_tasks(0),
+    m_steals(0),
+    m_sleeps(0) { }
+};
 
-/** Convenience typedef. */
-typedef std::map<boost::thread::id, WorkerThreadSptr> ThreadMap;
+/** \brief Nothing to release for a thread-specific worker.
+ *
+ * \param op Worker.
+ */
+static void worker_release(Worker *op)
+{
+  boost::ignore_unused_variable_warning(op);
+}
 
-/** Active workers. */
-static ThreadStorage workers_active;
+/** The privileged thread. */
+static Worker privileged_worker(0, 1);
 
-/** Suspended workers that are available for work. */
-static ThreadStorage workers_sleeping;
+/** Id of the privileged thread. */
+static boost::thread::id privileged_id;
 
-/** Workers waiting on a collection point. */
-static ThreadStorage workers_waiting;
+/** All threads taking part in the dispatcher, the privileged thread first. */
+static Worker* workers[THREADS_MAX];
 
-/** Temporary condition variable storage. */
-static std::vector<CondSptr> temporary_cond_storage;
+/** Number of threads in the worker table. */
+static boost::atomic<unsigned> worker_count(0);
 
-/** Temporary condition variable queue. */
-static data::CircularBuffer<boost::condition_variable*> temporary_conds;
+/** Number of workers taking part in the dispatcher, the privileged thread excluded, others are parked. */
+static boost::atomic<unsigned> workers_active(0);
 
-/** The main privileged thread. */
-static WorkerThread privileged_thread;
+/** True if threads are pinned to processors. */
+static boost::atomic<bool> affinity_enabled(false);
 
-/** Thread list. */
-static ThreadMap threads;
+/** True if the privileged thread only executes normal tasks when waiting. */
+static boost::atomic<bool> privileged_isolated(false);
 
-/** Task list. */
-static data::CircularBuffer<Task> tasks_normal;
+/** Worker of the current thread. */
+static boost::thread_specific_ptr<Worker> worker_current(worker_release);
+
+/** Task list for tasks dispatched from outside workers or from full deques. */
+static data::CircularBuffer<TaskObject*> tasks_injected;
 
 /** High-priority task list. */
 static data::CircularBuffer<Promise*> tasks_important;
 
 /** Privileged task list. */
-static data::CircularBuffer<Task> tasks_privileged;
+static data::CircularBuffer<TaskObject*> tasks_privileged;
+
+/** Deferred privileged tasks, most recently deferred first. */
+static boost::atomic<TaskObject*> tasks_deferred(NULL);
+
+/** Number of injected tasks, readable without locking. */
+static boost::atomic<unsigned> tasks_injected_count(0);
+
+/** Number of important tasks, readable without locking. */
+static boost::atomic<unsigned> tasks_important_count(0);
 
-/** The dispatcher needs to be guarded. */
+/** Number of privileged tasks, readable without locking. */
+static boost::atomic<unsigned> tasks_privileged_count(0);
+
+/** Number of normal and important tasks dispatched but not completed. */
+static boost::atomic<unsigned> tasks_outstanding(0);
+
+/** Sum of task depths of all threads in wait(), guarded by the mutex. */
+static unsigned waiting_depth = 0;
+
+/** Number of threads in wait(). */
+static boost::atomic<unsigned> waiters(0);
+
+/** Number of threads in wait_pending(). */
+static boost::atomic<unsigned> pending_waiters(0);
+
+/** Number of workers sleeping. */
+static boost::atomic<unsigned> sleepers(0);
+
+/** True if the privileged thread is sleeping. */
+static boost::atomic<bool> privileged_sleeping(false);
+
+/** The queues and sleeping need to be guarded. */
 static boost::mutex mut;
 
-/** Sleeping area for anyone waiting for normal task queue to be emptied. */
-static boost::condition_variable cond_wait_normal;
+/** Sleeping area for workers. */
+static boost::condition_variable cond_workers;
+
+/** Sleeping area for the privileged thread. */
+static boost::condition_variable cond_privileged;
 
-/** Sleeping area for anyone waiting for privileged task queue to be emptied. */
-static boost::condition_variable cond_wait_privileged;
+/** Sleeping area for threads outside the dispatcher waiting for tasks or promises. */
+static boost::condition_variable cond_external;
+
+/** Parking area for inactive workers. */
+static boost::condition_variable cond_parked;
 
 /** True if quitting the dispatching system. */
-static bool quitting = false;
+static boost::atomic<bool> quitting(false);
+
+/** True if recording telemetry. */
+static boost::atomic<bool> telemetry_on(false);
+
+/** Timestamp of last telemetry reset in microseconds. */
+static boost::atomic<uint64_t> telemetry_start(0);
+
+/** Depth of own deques after pushing. */
+static Histogram telemetry_depth_local;
+
+/** Depth of the injected task list after queueing. */
+static Histogram telemetry_depth_injected;
+
+/** Depth of the important task list after queueing. */
+static Histogram telemetry_depth_important;
+
+/** Depth of the privileged task list after queueing. */
+static Histogram telemetry_depth_privileged;
+
+/** Number of deferred privileged tasks executed at once. */
+static Histogram telemetry_depth_deferred;
+
+/** Time from queueing to start of normal tasks. */
+static Histogram telemetry_queued_normal;
+
+/** Time from queueing to start of important tasks. */
+static Histogram telemetry_queued_important;
+
+/** Time from queueing to start of privileged tasks. */
+static Histogram telemetry_queued_privileged;
+
+/** Time from deferring to start of deferred privileged tasks. */
+static Histogram telemetry_queued_deferred;
+
+/** Execution time of normal tasks. */
+static Histogram telemetry_run_normal;
+
+/** Execution time of important tasks. */
+static Histogram telemetry_run_important;
+
+/** Execution time of privileged tasks. */
+static Histogram telemetry_run_privileged;
+
+/** Execution time of deferred privileged tasks. */
+static Histogram telemetry_run_deferred;
+
+/** Time spent in wait(). */
+static Histogram telemetry_wait_all;
+
+/** Time spent in wait_pending(). */
+static Histogram telemetry_wait_group;
+
+/** Time spent waiting for important tasks. */
+static Histogram telemetry_wait_important;
+
+/** Time spent waiting for privileged tasks. */
+static Histogram telemetry_wait_privileged;
 
 /** \brief Tell if given thread is the primary thread.
  *
@@ -68,7 +234,7 @@ static bool quitting = false;
  */
 static inline bool is_primary_thread(const boost::thread::id &op)
 {
-  return (privileged_thread.id() == op);
+  return (privileged_id == op);
 }
 
 /** \brief Tell if this is the primary thread.
@@ -94,7 +260,7 @@ static inline std::string get_thread_id(boost::thread::id tid)
     return sstr.str();
   }
 
-  if(threads.find(tid) != threads.end())
+  if((tid == boost::this_thread::get_id()) && worker_current.get())
   {
     std::ostringstream sstr;
     sstr << "worker thread " << tid;
@@ -117,172 +283,490 @@ static inline std::string get_thread_id()
   return get_thread_id(boost::this_thread::get_id());
 }
 
-/** \brief Inner common implementation of dispatch.
+/** \brief Tell if the privileged thread executes normal tasks outside waiting.
+ *
+ * \return True if yes, false if no.
  */
-static void inner_dispatch()
+static bool privileged_takes_normal()
 {
-  WorkerThread* thr = workers_waiting.last();
-  if(NULL != thr)
+  return !privileged_isolated.load() || (0 >= workers_active.load());
+}
+
+/** \brief Tell if a worker is parked.
+ *
+ * \param self Worker.
+ * \return True if yes, false if no.
+ */
+static bool worker_parked(const Worker *self)
+{
+  return (self->m_index > workers_active.load());
+}
+
+/** \brief Pin the calling thread to its processor if affinity is enabled.
+ *
+ * The privileged thread gets the first processor. Workers get the following ones, wrapping around, and skip
+ * the first processor if the privileged thread is isolated.
+ *
+ * \param index Index in the worker table.
+ */
+static void affinity_apply(unsigned index)
+{
+  unsigned cpus = boost::thread::hardware_concurrency();
+
+  if(!affinity_enabled.load() || (0 >= cpus))
   {
-    workers_waiting.remove(thr);
-    workers_active.addLast(thr);
-    thr->notify(true); // Needed for work.
     return;
   }
 
-  thr = workers_sleeping.last();
-  if(NULL != thr)
+  if(0 >= index)
   {
-    workers_sleeping.remove(thr);
-    workers_active.addLast(thr);
-    thr->notify();
-    return;
+    cpu_pin(0);
+  }
+  else if(privileged_isolated.load() && (1 < cpus))
+  {
+    cpu_pin(1 + (index - 1) % (cpus - 1));
+  }
+  else
+  {
+    cpu_pin(index % cpus);
+  }
+}
+
+/** \brief Get a timestamp if recording telemetry.
+ *
+ * \return Timestamp in microseconds, 0 if not recording.
+ */
+static uint64_t telemetry_stamp()
+{
+  return telemetry_on.load(boost::memory_order_relaxed) ? usec_get_timestamp() : 0;
+}
+
+/** \brief Record a time span if both ends were stamped.
+ *
+ * \param hist Histogram to add to.
+ * \param start Start timestamp, 0 if not recorded.
+ * \param end End timestamp, 0 if not recorded.
+ */
+static void telemetry_span(Histogram &hist, uint64_t start, uint64_t end)
+{
+  if((0 < start) && (start <= end))
+  {
+    hist.add(end - start);
+  }
+}
+
+/** \brief Start executing a task.
+ *
+ * \param self Worker of this thread.
+ * \param queued Histogram of queueing times.
+ * \param enqueued Timestamp of queueing, 0 if not recorded.
+ * \return Start timestamp, 0 if not recording.
+ */
+static uint64_t telemetry_begin(Worker *self, Histogram &queued, uint64_t enqueued)
+{
+  uint64_t ret = telemetry_stamp();
+
+  telemetry_span(queued, enqueued, ret);
+  ++(self->m_nesting);
+  return ret;
+}
+
+/** \brief Finish executing a task.
+ *
+ * Only the outermost task adds to busy time, sleeping within it excluded.
+ *
+ * \param self Worker of this thread.
+ * \param run Histogram of execution times.
+ * \param start Return value of telemetry_begin().
+ */
+static void telemetry_end(Worker *self, Histogram &run, uint64_t start)
+{
+  --(self->m_nesting);
+
+  if(0 < start)
+  {
+    uint64_t duration = usec_get_timestamp() - start;
+
+    run.add(duration);
+    self->m_tasks.fetch_add(1, boost::memory_order_relaxed);
+    if(0 >= self->m_nesting)
+    {
+      self->m_busy.fetch_add(duration - std::min(duration, self->m_nested_sleep), boost::memory_order_relaxed);
+    }
+  }
+
+  if(0 >= self->m_nesting)
+  {
+    self->m_nested_sleep = 0;
   }
 }
 
-/** \brief Inner common implementation of dispatch_privileged.
+/** \brief Finish sleeping.
  *
- * \param pfunctor Task to execute.
- * \return Task id created.
+ * \param self Worker of this thread.
+ * \param start Timestamp of falling asleep, 0 if not recorded.
  */
-static void inner_dispatch_privileged(const Task &pfunctor)
+static void telemetry_sleep(Worker *self, uint64_t start)
 {
-  tasks_privileged.put(pfunctor);
+  uint64_t end = telemetry_stamp();
 
-  if(privileged_thread.isSleeping())
+  if((0 < start) && (start <= end))
   {
-    ThreadStorage *storage = privileged_thread.getStorage();
+    self->m_slept.fetch_add(end - start, boost::memory_order_relaxed);
+    self->m_sleeps.fetch_add(1, boost::memory_order_relaxed);
+    if(0 < self->m_nesting)
+    {
+      self->m_nested_sleep += end - start;
+    }
+  }
+}
 
-    storage->remove(&privileged_thread);
-    workers_active.addLast(&privileged_thread);
-    privileged_thread.notify(true);
+/** \brief Wake up everyone sleeping.
+ *
+ * Must be called from a locked context.
+ */
+static void wake_all()
+{
+  cond_workers.notify_all();
+  cond_privileged.notify_all();
+  cond_external.notify_all();
+}
+
+/** \brief Wake up a thread for new work.
+ *
+ * Workers are preferred, the privileged thread only takes normal work if all workers are busy.
+ */
+static void wake_one()
+{
+  // Pairs with the fence in sleeping, either the sleeper sees the work or we see the sleeper.
+  boost::atomic_thread_fence(boost::memory_order_seq_cst);
+
+  if(0 < sleepers.load(boost::memory_order_relaxed))
+  {
+    boost::mutex::scoped_lock scope(mut);
+    cond_workers.notify_one();
+  }
+  else if(privileged_sleeping.load(boost::memory_order_relaxed) && privileged_takes_normal())
+  {
+    boost::mutex::scoped_lock scope(mut);
+    cond_privileged.notify_one();
   }
 }
 
-/** \brief Inner task running, important (promised) tasks.
+/** \brief Tell if waiting for normal tasks is over.
+ *
+ * Must be called from a locked context.
  *
+ * \return True if every outstanding task is held by a thread in wait().
+ */
+static bool wait_done()
+{
+  return (tasks_outstanding.load() <= waiting_depth);
+}
+
+/** \brief Mark a normal or important task completed.
+ */
+static void task_complete()
+{
+  --tasks_outstanding;
+
+  if(0 < waiters.load())
+  {
+    boost::mutex::scoped_lock scope(mut);
+
+    if(wait_done())
+    {
+      wake_all();
+    }
+  }
+}
+
+/** \brief Execute a normal task.
+ *
+ * \param op Task, released after execution.
+ * \param self Worker of this thread.
+ */
+static void task_execute(TaskObject *op, Worker *self)
+{
+  uint64_t start = telemetry_begin(self, telemetry_queued_normal, op->m_enqueued);
+
+  ++(self->m_depth);
+  (*op)();
+  --(self->m_depth);
+  telemetry_end(self, telemetry_run_normal, start);
+  task_release(op);
+  task_complete();
+}
+
+/** \brief Execute a task and release it.
+ *
+ * \param op Task.
+ */
+static void task_run(TaskObject *op)
+{
+  (*op)();
+  task_release(op);
+}
+
+/** \brief Execute the task of a promise and fulfill it.
+ *
+ * \param op Promise.
+ * \param timeline Timeline scope of the waiting thread, may be NULL.
+ */
+static void promise_execute(Promise *op, TimelineScope *timeline)
+{
+  if(timeline)
+  {
+    // Work done on behalf of the waiting thread is accounted to its timeline.
+    timeline_adopt(timeline, boost::bind(&Promise::task, op));
+  }
+  else
+  {
+    op->task();
+  }
+
+  boost::mutex::scoped_lock scope(mut);
+  op->fulfill();
+  wake_all();
+}
+
+/** \brief Wait for a promise to be fulfilled.
+ *
+ * Returns immediately after thr_quit() has been called.
+ *
+ * \param op Promise.
  * \param pscope Previously created scoped lock.
+ */
+static void promise_wait(Promise &op, boost::mutex::scoped_lock &pscope)
+{
+  while(!op.isDone() && !quitting.load())
+  {
+    cond_external.wait(pscope);
+  }
+}
+
+/** \brief Inner task running, important (promised) tasks.
+ *
+ * \param self Worker of this thread.
  * \return True if executed something, false if not.
  */
-static bool inner_run_important(boost::mutex::scoped_lock &pscope)
+static bool inner_run_important(Worker *self)
 {
-  if(tasks_important.empty())
+  if(0 >= tasks_important_count.load())
   {
     return false;
   }
-  Promise *promise = tasks_important.get();
-  pscope.unlock();
-  promise->task();
-  pscope.lock();
+  Promise *promise;
+  {
+    boost::mutex::scoped_lock scope(mut);
+
+    if(tasks_important.empty())
+    {
+      return false;
+    }
+    promise = tasks_important.get();
+    --tasks_important_count;
+  }
+  // The promise may be gone as soon as it has been fulfilled.
+  uint64_t start = telemetry_begin(self, telemetry_queued_important, promise->getTask()->m_enqueued);
+  promise_execute(promise, NULL);
+  telemetry_end(self, telemetry_run_important, start);
+  task_complete();
   return true;
 }
 
 /** \brief Inner task running, normal tasks.
  *
- * \param pscope Previously created scoped lock.
+ * Takes a task from the own deque, the injected tasks or steals one from another thread.
+ *
+ * \param self Worker of this thread.
  * \return True if executed something, false if not.
  */
-static bool inner_run_normal(boost::mutex::scoped_lock &pscope)
+static bool inner_run_normal(Worker *self)
 {
-  if(tasks_normal.empty())
+  TaskObject *task = self->m_deque.pop();
+
+  if((NULL == task) && (0 < tasks_injected_count.load()))
+  {
+    boost::mutex::scoped_lock scope(mut);
+
+    if(!tasks_injected.empty())
+    {
+      task = tasks_injected.get();
+      --tasks_injected_count;
+    }
+  }
+
+  if(NULL == task)
+  {
+    unsigned count = worker_count.load(boost::memory_order_acquire);
+
+    // Start from a random victim so that thieves spread out.
+    self->m_seed ^= self->m_seed << 13;
+    self->m_seed ^= self->m_seed >> 17;
+    self->m_seed ^= self->m_seed << 5;
+    for(unsigned ii = 0, first = self->m_seed % count; ((ii < count) && (NULL == task)); ++ii)
+    {
+      Worker *victim = workers[(first + ii) % count];
+
+      if(victim != self)
+      {
+        task = victim->m_deque.steal();
+      }
+      if((NULL != task) && telemetry_on.load(boost::memory_order_relaxed))
+      {
+        self->m_steals.fetch_add(1, boost::memory_order_relaxed);
+      }
+    }
+  }
+
+  if(NULL == task)
   {
     return false;
   }
-  Task functor = tasks_normal.get();
-  pscope.unlock();
-  functor();
-  pscope.lock();
+  task_execute(task, self);
   return true;
 }
 
 /** \brief Inner task running, privileged tasks.
  *
- * \param tlist Task list.
- * \param scope Previously created scoped lock.
  * \return True if executed something, false if not.
  */
-static bool inner_run_privileged(boost::mutex::scoped_lock &pscope)
+static bool inner_run_privileged()
 {
-  if(tasks_privileged.empty())
+  if(0 >= tasks_privileged_count.load())
   {
     return false;
   }
-  Task functor = tasks_privileged.get();
-  pscope.unlock();
-  functor();
-  pscope.lock();
+  TaskObject *task;
+  {
+    boost::mutex::scoped_lock scope(mut);
+
+    if(tasks_privileged.empty())
+    {
+      return false;
+    }
+    task = tasks_privileged.get();
+    --tasks_privileged_count;
+  }
+  uint64_t start = telemetry_begin(&privileged_worker, telemetry_queued_privileged, task->m_enqueued);
+  task_run(task);
+  telemetry_end(&privileged_worker, telemetry_run_privileged, start);
   return true;
 }
 
-/** \brief Acquire a temporary condition variable.
- *
- * Must be called from a locked context.
+/** \brief Tell if there is work for a thread.
  *
- * \return Condition variable that must be released later.
+ * \param self Worker of this thread.
+ * \param normal True if normal and important tasks count, false to only look for privileged tasks.
+ * \return True if yes, false if no.
  */
-static boost::condition_variable* temporary_cond_acquire()
+static bool work_available(Worker *self, bool normal)
 {
-  if(temporary_conds.empty())
+  if((self == &privileged_worker) && (0 < tasks_privileged_count.load()))
+  {
+    return true;
+  }
+  if(!normal)
+  {
+    return false;
+  }
+  if((0 < tasks_important_count.load()) || (0 < tasks_injected_count.load()))
   {
-    CondSptr ret(new boost::condition_variable());
-    temporary_cond_storage.push_back(ret);
-    return ret.get();
+    return true;
   }
-  return temporary_conds.get();
+
+  unsigned count = worker_count.load(boost::memory_order_acquire);
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    if(!workers[ii]->m_deque.empty())
+    {
+      return true;
+    }
+  }
+  return false;
 }
 
-/** \brief Release a previously acquired temporary condition variable.
+/** \brief Sleep until woken up.
  *
- * Must be called from a locked context.
+ * Does not sleep if there is work available or quitting. Workers do not sleep if they should be parked.
  *
- * \param op Condition variable to release.
+ * \param self Worker of this thread.
+ * \param normal True if normal and important tasks count as work, false to only look for privileged tasks.
+ * \param pscope Previously created scoped lock.
  */
-static void temporary_cond_release(boost::condition_variable *op)
+static void suspend(Worker *self, bool normal, boost::mutex::scoped_lock &pscope)
 {
-  temporary_conds.put(op);
+  if(&privileged_worker == self)
+  {
+    privileged_sleeping.store(true);
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+    if(!quitting.load() && !work_available(self, normal))
+    {
+      uint64_t stamp = telemetry_stamp();
+      cond_privileged.wait(pscope);
+      telemetry_sleep(self, stamp);
+    }
+    privileged_sleeping.store(false);
+    return;
+  }
+
+  ++sleepers;
+  boost::atomic_thread_fence(boost::memory_order_seq_cst);
+  if(!quitting.load() && !worker_parked(self) && !work_available(self, normal))
+  {
+    uint64_t stamp = telemetry_stamp();
+    cond_workers.wait(pscope);
+    telemetry_sleep(self, stamp);
+  }
+  --sleepers;
 }
 
-/** \brief Wake up anyone waiting for normal tasks to complete.
+/** \brief Count the tasks on the stack of a waiting thread as waiting.
  *
- * Must be called from a locked context.
+ * Tasks on the stack of a waiting thread can't complete until it returns, so wait() must not wait for them.
+ * Nested waits only add the new tasks. Must be called from a locked context.
  *
- * Do not call this function if normal task queue is not empty.
+ * \param self Worker of this thread.
+ * \return Previous number of tasks counted for this thread.
+ */
+static unsigned waiting_enter(Worker *self)
+{
+  unsigned ret = self->m_waiting;
+
+  waiting_depth += self->m_depth - ret;
+  self->m_waiting = self->m_depth;
+  return ret;
+}
+
+/** \brief Undo waiting_enter().
  *
- * If the caller is a worker thread, it must be in the active worker storage.
+ * Must be called from a locked context.
  *
- * \param tid Thread id.
+ * \param self Worker of this thread.
+ * \param previous Return value of waiting_enter().
  */
-static bool wake_normal()
+static void waiting_leave(Worker *self, unsigned previous)
 {
-  if(1 != workers_active.size())
-  {
-    return false;
-  }
-  // We were the only worker active.
-  workers_waiting.notifyAll(&workers_active);
-  cond_wait_normal.notify_all();
-  return true;
+  waiting_depth -= self->m_depth - previous;
+  self->m_waiting = previous;
 }
 
-/** \brief Clean up important jobs if we're a normal thread.
+/** \brief Clean up important jobs if we're a worker thread.
  *
  * Ensured that an important job can't queue up other important jobs that could potentially create deadlocks.
  *
- * \param pfunctor Task to execute.
- * \param scope Previously created scoped lock.
- * \param tid Id of this thread.
+ * \param op Task to execute.
  * \return True if cleaned up the queue, false if not.
  */
-static bool cleanup_important(const Task &pfunctor, boost::mutex::scoped_lock &pscope, boost::thread::id tid)
+static bool cleanup_important(TaskObject *op)
 {
-  if(threads.end() == threads.find(tid))
+  if(NULL == worker_current.get())
   {
     return false;
   }
-  while(inner_run_important(pscope));
-  pscope.unlock();
-  pfunctor();
-  pscope.lock();
+  while(inner_run_important(worker_current.get()));
+  task_run(op);
   return true;
 }
 
@@ -290,92 +774,416 @@ static bool cleanup_important(const Task &pfunctor, boost::mutex::scoped_lock &p
  *
  * Ensures that a privileged job can't queue up other privileged jobs that would potentially create deadlocks.
  *
- * \param pfunctor Task to execute.
- * \param scope Previously created scoped lock.
+ * \param op Task to execute.
  * \param tid Id of this thread.
  * \return True if cleaned up the queue, false if not.
  */
-static bool cleanup_privileged(const Task &pfunctor, boost::mutex::scoped_lock &pscope, boost::thread::id tid)
+static bool cleanup_privileged(TaskObject *op, boost::thread::id tid)
 {
   if(!is_primary_thread(tid))
   {
     return false;
   }
-  while(inner_run_privileged(pscope));
-  pscope.unlock();
-  pfunctor();
-  pscope.lock();
+  while(inner_run_privileged());
+  task_run(op);
   return true;
 }
 
+/** \brief Delete all tasks that will not be executed.
+ *
+ * Must be called from a locked context. Promises are only dropped, their waiters are released by quitting.
+ */
+static void clear_tasks()
+{
+  unsigned cleared = 0;
+
+  for(; !tasks_injected.empty(); ++cleared)
+  {
+    task_release(tasks_injected.get());
+  }
+  tasks_injected_count = 0;
+
+  unsigned count = worker_count.load(boost::memory_order_acquire);
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    for(TaskObject *task = workers[ii]->m_deque.steal(); (NULL != task); task = workers[ii]->m_deque.steal())
+    {
+      task_release(task);
+      ++cleared;
+    }
+  }
+
+  for(; !tasks_important.empty(); ++cleared)
+  {
+    tasks_important.get();
+  }
+  tasks_important_count = 0;
+  while(!tasks_privileged.empty())
+  {
+    task_release(tasks_privileged.get());
+  }
+  tasks_privileged_count = 0;
+
+  // Tasks still running will complete normally.
+  tasks_outstanding -= cleared;
+}
+
 /** \brief The normal thread run function.
  *
  * The function to be started by normal workers.
+ *
+ * \param self Worker of this thread.
  */
-static void run_normal()
+static void run_normal(Worker *self)
 {
-  boost::mutex::scoped_lock scope(mut);
-  boost::thread::id tid = boost::this_thread::get_id();
-  WorkerThread* thr = (*threads.find(tid)).second.get();
+  worker_current.reset(self);
+  affinity_apply(self->m_index);
 
-  while(!quitting)
+  while(!quitting.load())
   {
-    if(inner_run_important(scope))
+    if(worker_parked(self))
+    {
+      boost::mutex::scoped_lock scope(mut);
+      uint64_t stamp = telemetry_stamp();
+
+      while(worker_parked(self) && !quitting.load())
+      {
+        cond_parked.wait(scope);
+      }
+      telemetry_sleep(self, stamp);
+      continue;
+    }
+    if(inner_run_important(self))
     {
       continue;
     }
-    if(inner_run_normal(scope))
+    if(inner_run_normal(self))
     {
       continue;
     }
-    wake_normal();
-    workers_active.remove(thr);
-    workers_sleeping.addLast(thr);
-    thr->suspend(scope);
+
+    boost::mutex::scoped_lock scope(mut);
+    suspend(self, true, scope);
+  }
+}
+
+void thr::defer_privileged_task(TaskObject *op)
+{
+  // Deferred tasks run in the middle of flushing would run out of order if they flushed first.
+  if(is_primary_thread())
+  {
+    task_run(op);
+    return;
   }
 
-  // Remove from active workers before exiting.
-  workers_active.remove(thr);
+  op->m_enqueued = telemetry_stamp();
+
+  TaskObject *head = tasks_deferred.load(boost::memory_order_relaxed);
+  do {
+    op->m_next = head;
+  } while(!tasks_deferred.compare_exchange_weak(head, op, boost::memory_order_release,
+        boost::memory_order_relaxed));
 }
 
 void thr::dispatch_ext(const Task &pfunctor)
 {
-  boost::mutex::scoped_lock scope(mut);
+  dispatch_task(task_create(pfunctor));
+}
+
+void thr::dispatch_privileged_ext(const Task &pfunctor)
+{
+  dispatch_privileged_task(task_create(pfunctor));
+}
 
-  tasks_normal.put(pfunctor);
+void thr::dispatch_privileged_task(TaskObject *op)
+{
+  if(cleanup_privileged(op, boost::this_thread::get_id()))
+  {
+    return;
+  }
 
-  inner_dispatch();
+  uint64_t stamp = telemetry_stamp();
+  boost::mutex::scoped_lock scope(mut);
+
+  op->m_enqueued = stamp;
+  tasks_privileged.put(op);
+  ++tasks_privileged_count;
+  if(0 < stamp)
+  {
+    telemetry_depth_privileged.add(tasks_privileged_count.load());
+  }
+  cond_privileged.notify_one();
 }
 
-void thr::dispatch_privileged_ext(const Task &pfunctor)
+void thr::dispatch_task(TaskObject *op)
 {
-  boost::thread::id tid = boost::this_thread::get_id();
+  Worker *self = worker_current.get();
+  uint64_t stamp = telemetry_stamp();
+
+  ++tasks_outstanding;
+  op->m_enqueued = stamp;
+
+  // The task may be gone as soon as it has been queued.
+  if((NULL != self) && self->m_deque.push(op))
+  {
+    if(0 < stamp)
+    {
+      telemetry_depth_local.add(self->m_deque.size());
+    }
+    wake_one();
+    return;
+  }
+
   boost::mutex::scoped_lock scope(mut);
 
-  if(cleanup_privileged(pfunctor, scope, tid))
+  tasks_injected.put(op);
+  ++tasks_injected_count;
+  if(0 < stamp)
+  {
+    telemetry_depth_injected.add(tasks_injected_count.load());
+  }
+
+  // Anyone counted as sleeping is already waiting, notify after unlocking so it does not block on the mutex.
+  bool wake_worker = (0 < sleepers.load());
+  bool wake_privileged = !wake_worker && privileged_sleeping.load() && privileged_takes_normal();
+  scope.unlock();
+  if(wake_worker)
   {
+    cond_workers.notify_one();
+  }
+  else if(wake_privileged)
+  {
+    cond_privileged.notify_one();
+  }
+}
+
+void thr::fence_privileged()
+{
+  if(is_primary_thread())
+  {
+    flush_privileged();
     return;
   }
 
-  inner_dispatch_privileged(pfunctor);
+  // Flushing as a privileged task executes everything deferred before the task was queued.
+  wait_privileged_task(task_create(&thr::flush_privileged));
+}
+
+void thr::flush_privileged()
+{
+  if(!is_primary_thread())
+  {
+    std::ostringstream sstr;
+    sstr << "trying to flush deferred privileged tasks from unprivileged thread " << get_thread_id();
+    BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
+  }
+
+  TaskObject *list = tasks_deferred.exchange(NULL, boost::memory_order_acquire);
+  TaskObject *ordered = NULL;
+  unsigned count = 0;
+
+  // Reverse into the order of deferring.
+  while(list)
+  {
+    TaskObject *next = list->m_next;
+
+    list->m_next = ordered;
+    ordered = list;
+    list = next;
+    ++count;
+  }
+  if((0 < count) && telemetry_on.load(boost::memory_order_relaxed))
+  {
+    telemetry_depth_deferred.add(count);
+  }
+
+  while(ordered)
+  {
+    TaskObject *task = ordered;
+    uint64_t start = telemetry_begin(&privileged_worker, telemetry_queued_deferred, task->m_enqueued);
+
+    ordered = task->m_next;
+    task_run(task);
+    telemetry_end(&privileged_worker, telemetry_run_deferred, start);
+  }
+}
+
+void thr::notify_pending()
+{
+  // Pairs with the lock in wait_pending(), either the waiter sees the counter or we see the waiter.
+  boost::atomic_thread_fence(boost::memory_order_seq_cst);
+
+  if(0 < pending_waiters.load())
+  {
+    boost::mutex::scoped_lock scope(mut);
+    wake_all();
+  }
+}
+
+/** \brief Create workers.
+ *
+ * Must be called from a locked context.
+ *
+ * \param nthreads Number of workers in addition to the privileged thread.
+ */
+static void worker_spawn(unsigned nthreads)
+{
+  unsigned count = worker_count.load(boost::memory_order_relaxed);
+
+  for(nthreads += 1; (count < nthreads); ++count)
+  {
+    Worker *worker = new Worker(count, count * 2654435761U + 1);
+
+    workers[count] = worker;
+    // Publish before starting, thieves only look at published workers.
+    worker_count.store(count + 1, boost::memory_order_release);
+    worker->m_thread = ThreadSptr(new boost::thread(run_normal, worker));
+  }
+}
+
+/** \brief Write one summary line of a worker.
+ *
+ * \param ostr Stream to write to.
+ * \param self Worker.
+ * \param elapsed Time since telemetry reset in microseconds.
+ */
+static void telemetry_worker(std::ostream &ostr, const Worker *self, uint64_t elapsed)
+{
+  std::ostringstream name;
+
+  if(0 >= self->m_index)
+  {
+    name << "privileged";
+  }
+  else
+  {
+    name << "worker " << self->m_index << (worker_parked(self) ? " (parked)" : "");
+  }
+
+  ostr << std::setw(24) << std::left << name.str() << std::right << std::fixed << std::setprecision(1) <<
+    std::setw(10) << (static_cast<double>(self->m_busy.load()) * 100.0 / static_cast<double>(elapsed)) <<
+    std::setw(10) << (static_cast<double>(self->m_slept.load()) * 100.0 / static_cast<double>(elapsed)) <<
+    std::setw(10) << self->m_tasks.load() << std::setw(10) << self->m_steals.load() <<
+    std::setw(10) << self->m_sleeps.load() << '\n';
+}
+
+void thr::telemetry_enable(bool op)
+{
+  if(op && !telemetry_on.load())
+  {
+    telemetry_reset();
+  }
+  telemetry_on = op;
+}
+
+bool thr::telemetry_enabled()
+{
+  return telemetry_on.load();
+}
+
+void thr::telemetry_report(std::ostream &ostr)
+{
+  uint64_t elapsed = std::max(usec_get_timestamp() - telemetry_start.load(), static_cast<uint64_t>(1));
+
+  ostr << "scheduler telemetry" << (telemetry_on.load() ? "" : " (disabled)") << " over " << std::fixed <<
+    std::setprecision(1) << (static_cast<double>(elapsed) / 1000.0) << " ms\n";
+
+  Histogram::header(ostr, "queue depth");
+  telemetry_depth_local.summary(ostr, "local");
+  telemetry_depth_injected.summary(ostr, "injected");
+  telemetry_depth_important.summary(ostr, "important");
+  telemetry_depth_privileged.summary(ostr, "privileged");
+  telemetry_depth_deferred.summary(ostr, "deferred");
+
+  Histogram::header(ostr, "queued us");
+  telemetry_queued_normal.summary(ostr, "normal");
+  telemetry_queued_important.summary(ostr, "important");
+  telemetry_queued_privileged.summary(ostr, "privileged");
+  telemetry_queued_deferred.summary(ostr, "deferred");
+
+  Histogram::header(ostr, "run us");
+  telemetry_run_normal.summary(ostr, "normal");
+  telemetry_run_important.summary(ostr, "important");
+  telemetry_run_privileged.summary(ostr, "privileged");
+  telemetry_run_deferred.summary(ostr, "deferred");
+
+  Histogram::header(ostr, "blocked us");
+  telemetry_wait_all.summary(ostr, "wait");
+  telemetry_wait_group.summary(ostr, "wait group");
+  telemetry_wait_important.summary(ostr, "wait important");
+  telemetry_wait_privileged.summary(ostr, "wait privileged");
+
+  ostr << std::setw(24) << std::left << "thread" << std::right << std::setw(10) << "busy %" <<
+    std::setw(10) << "sleep %" << std::setw(10) << "tasks" << std::setw(10) << "steals" <<
+    std::setw(10) << "sleeps" << '\n';
+
+  // Workers are only deleted with the mutex held.
+  boost::mutex::scoped_lock scope(mut);
+  unsigned count = worker_count.load(boost::memory_order_acquire);
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    telemetry_worker(ostr, workers[ii], elapsed);
+  }
+}
+
+void thr::telemetry_reset()
+{
+  telemetry_depth_local.reset();
+  telemetry_depth_injected.reset();
+  telemetry_depth_important.reset();
+  telemetry_depth_privileged.reset();
+  telemetry_depth_deferred.reset();
+  telemetry_queued_normal.reset();
+  telemetry_queued_important.reset();
+  telemetry_queued_privileged.reset();
+  telemetry_queued_deferred.reset();
+  telemetry_run_normal.reset();
+  telemetry_run_important.reset();
+  telemetry_run_privileged.reset();
+  telemetry_run_deferred.reset();
+  telemetry_wait_all.reset();
+  telemetry_wait_group.reset();
+  telemetry_wait_important.reset();
+  telemetry_wait_privileged.reset();
+
+  boost::mutex::scoped_lock scope(mut);
+  unsigned count = worker_count.load(boost::memory_order_acquire);
+  for(unsigned ii = 0; (ii < count); ++ii)
+  {
+    Worker *worker = workers[ii];
+
+    worker->m_busy = 0;
+    worker->m_slept = 0;
+    worker->m_tasks = 0;
+    worker->m_steals = 0;
+    worker->m_sleeps = 0;
+  }
+  telemetry_start = usec_get_timestamp();
+}
+
+void thr::thr_affinity(bool op)
+{
+  affinity_enabled = op;
 }
 
 void thr::thr_init()
 {
-  if(!privileged_thread.isUninitialized())
+  if(boost::thread::id() != privileged_id)
   {
     std::stringstream sstr;
     sstr << "thread system already initialized";
     BOOST_THROW_EXCEPTION(std::runtime_error(sstr.str()));
   }
 
-  privileged_thread.acquire();
-  workers_active.addLast(&privileged_thread);
+  privileged_id = boost::this_thread::get_id();
+  worker_current.reset(&privileged_worker);
+  workers[0] = &privileged_worker;
+  worker_count.store(1, boost::memory_order_release);
 }
 
 void thr::thr_main(unsigned nthreads)
 {
-  if(privileged_thread.isUninitialized())
+  if(boost::thread::id() == privileged_id)
   {
     thr_init();
   }
@@ -392,56 +1200,71 @@ void thr::thr_main(unsigned nthreads)
   {
     nthreads = thr::hardware_concurrency() - 1;
   }
+  affinity_apply(0);
+  thr_workers(nthreads);
 
-  // Lock this scope only.
+  while(!quitting.load())
   {
-    boost::mutex::scoped_lock scope(mut);
+    if(inner_run_privileged())
+    {
+      continue;
+    }
+
+    bool normal = privileged_takes_normal();
 
-    // Add other threads.
-    while(threads.size() < nthreads)
+    if(normal && inner_run_important(&privileged_worker))
     {
-      WorkerThreadSptr thr(new WorkerThread(run_normal));
+      continue;
+    }
 
-      threads[thr->id()] = thr;
-      workers_active.addLast(thr.get());
+    if(normal && inner_run_normal(&privileged_worker))
+    {
+      continue;
     }
 
-    while(!quitting)
+    // Deferred tasks are not worth waking up for, but run them before sleeping.
+    if(NULL != tasks_deferred.load(boost::memory_order_relaxed))
     {
-      if(inner_run_privileged(scope))
-      {
-        continue;
-      }
+      flush_privileged();
+      continue;
+    }
 
-      // In main loop and the list of privileged tasks was emptied, can safely
-      // wake up all other tasks waiting for it.
-      cond_wait_privileged.notify_all();
+    boost::mutex::scoped_lock scope(mut);
+    suspend(&privileged_worker, normal, scope);
+  }
 
-      if(inner_run_important(scope))
-      {
-        continue;
-      }
+  unsigned count = worker_count.load(boost::memory_order_acquire);
+  for(unsigned ii = 1; (ii < count); ++ii)
+  {
+    workers[ii]->m_thread->join();
+  }
+  flush_privileged();
 
-      if(inner_run_normal(scope))
-      {
-        continue;
-      }
+  boost::mutex::scoped_lock scope(mut);
+  clear_tasks();
+  for(unsigned ii = 1; (ii < count); ++ii)
+  {
+    delete workers[ii];
+  }
+  worker_count.store(1, boost::memory_order_release);
+  workers_active = 0;
+}
 
-      // Nothing to do, perform potential wakeup for collection point.
-      wake_normal();
+void thr::thr_isolate(bool op)
+{
+  boost::mutex::scoped_lock scope(mut);
 
-      workers_active.remove(&privileged_thread);
-      workers_sleeping.addFirst(&privileged_thread);
-      privileged_thread.suspend(scope);
-    }
+  privileged_isolated = op;
+  cond_privileged.notify_all();
+}
 
-    scope.unlock();
-    BOOST_FOREACH(const ThreadMap::value_type &vv, threads)
-    {
-      vv.second->join();
-    }
-    scope.lock();
-    threads.clear();
+void thr::thr_pin_audio()
+{
+  unsigned cpus = boost::thread::hardware_concurrency();
+
+  if(affinity_enabled.load() && (0 < cpus))
+  {
+    cpu_pin(cpus - 1);
   }
 }
 
@@ -451,134 +1274,214 @@ void thr::thr_quit()
 
   quitting = true;
 
-  // Wake all threads.
-  workers_waiting.notifyAll(&workers_active);
-  workers_sleeping.notifyAll(&workers_active);
-
-  // Wake all waiters, their wishes will not be fullfilled.
-  cond_wait_normal.notify_all();
-  cond_wait_privileged.notify_all();
+  // Wake everyone, waiters' wishes will not be fullfilled.
+  wake_all();
+  cond_parked.notify_all();
 
   // Clear all tasks, they will not be done.
-  tasks_normal.clear();
-  tasks_important.clear();
-  tasks_privileged.clear();
+  clear_tasks();
+}
+
+void thr::thr_reserve(unsigned nthreads)
+{
+  boost::mutex::scoped_lock scope(mut);
+
+  nthreads = std::min(nthreads, THREADS_MAX - 1);
+  worker_spawn(nthreads);
+  if(workers_active.load() < nthreads)
+  {
+    workers_active = nthreads;
+    cond_parked.notify_all();
+  }
+}
+
+void thr::thr_workers(unsigned nthreads)
+{
+  boost::mutex::scoped_lock scope(mut);
+
+  nthreads = std::min(nthreads, THREADS_MAX - 1);
+  worker_spawn(nthreads);
+  workers_active = nthreads;
+
+  // Sleeping workers that are now surplus go to park, an isolated privileged thread may have to take over.
+  cond_parked.notify_all();
+  cond_workers.notify_all();
+  cond_privileged.notify_all();
 }
 
 void thr::wait()
 {
-  boost::thread::id tid = boost::this_thread::get_id();
+  Worker *self = worker_current.get();
+  uint64_t stamp = telemetry_stamp();
   boost::mutex::scoped_lock scope(mut);
 
-  // Privileged thread has a special loop.
-  if(is_primary_thread(tid))
+  // Threads outside the dispatcher can only sleep.
+  if(NULL == self)
   {
-    while(!quitting)
+    ++waiters;
+    while(!quitting.load() && !wait_done())
     {
-      if(inner_run_privileged(scope))
-      {
-        continue;
-      }
+      cond_external.wait(scope);
+    }
+    --waiters;
+    telemetry_span(telemetry_wait_all, stamp, telemetry_stamp());
+    return;
+  }
 
-      if(inner_run_important(scope))
-      {
-        continue;
-      }
+  unsigned waiting_previous = waiting_enter(self);
+  ++waiters;
 
-      if(inner_run_normal(scope))
-      {
-        continue;
-      }
+  while(!quitting.load())
+  {
+    if(wait_done())
+    {
+      // Other waiters may be waiting for this thread only.
+      wake_all();
+      break;
+    }
 
-      if(wake_normal())
-      {
-        return;
-      }
+    scope.unlock();
+    bool executed = ((&privileged_worker == self) && inner_run_privileged()) || inner_run_important(self) ||
+      inner_run_normal(self);
+    scope.lock();
 
-      workers_active.remove(&privileged_thread);
-      workers_waiting.addFirst(&privileged_thread);
-      if(!privileged_thread.wait(scope))
-      {
-        return;
-      }
+    if(!executed && !wait_done())
+    {
+      suspend(self, true, scope);
     }
-    return;
   }
 
-  // All normal workers have a simpler loop.
-  ThreadMap::iterator iter = threads.find(tid);
-  if(threads.end() != iter)
+  waiting_leave(self, waiting_previous);
+  --waiters;
+  telemetry_span(telemetry_wait_all, stamp, telemetry_stamp());
+}
+
+void thr::wait_pending(const boost::atomic<unsigned> &op)
+{
+  Worker *self = worker_current.get();
+  unsigned waiting_previous = 0;
+  uint64_t stamp = telemetry_stamp();
+  boost::mutex::scoped_lock scope(mut);
+
+  if(self)
   {
-    WorkerThread* thr = (*iter).second.get();
+    waiting_previous = waiting_enter(self);
 
-    while(!quitting)
+    // Waiters in wait() may have been waiting for this thread only.
+    if((0 < waiters.load()) && wait_done())
     {
-      if(inner_run_important(scope))
-      {
-        continue;
-      }
+      wake_all();
+    }
+  }
+  ++pending_waiters;
 
-      if(inner_run_normal(scope))
-      {
-        continue;
-      }
+  while((0 < op.load()) && !quitting.load())
+  {
+    bool executed = false;
+
+    if(self)
+    {
+      scope.unlock();
+      executed = ((&privileged_worker == self) && inner_run_privileged()) || inner_run_important(self) ||
+        inner_run_normal(self);
+      scope.lock();
+    }
 
-      if(wake_normal())
+    if(!executed && (0 < op.load()))
+    {
+      if(self)
       {
-        return;
+        suspend(self, true, scope);
       }
-
-      workers_active.remove(thr);
-      workers_waiting.addLast(thr);
-      if(!thr->wait(scope))
+      else
       {
-        return;
+        cond_external.wait(scope);
       }
     }
-    return;
   }
 
-  if(tasks_normal.empty() && workers_active.empty())
+  --pending_waiters;
+  if(self)
   {
-    return;
+    waiting_leave(self, waiting_previous);
   }
-  cond_wait_normal.wait(scope);
+  telemetry_span(telemetry_wait_group, stamp, telemetry_stamp());
 }
 
 void thr::wait_ext(const Task &pfunctor)
 {
-  boost::thread::id tid = boost::this_thread::get_id();
-  boost::mutex::scoped_lock scope(mut);
+  wait_task(task_create(pfunctor));
+}
+
+void thr::wait_privileged_ext(const Task &pfunctor)
+{
+  wait_privileged_task(task_create(pfunctor));
+}
 
-  if(cleanup_privileged(pfunctor, scope, tid))
+void thr::wait_privileged_task(TaskObject *op)
+{
+  if(cleanup_privileged(op, boost::this_thread::get_id()))
   {
     return;
   }
 
-  if(cleanup_important(pfunctor, scope, tid))
+  Promise pr(op);
+  uint64_t stamp = telemetry_stamp();
+  boost::mutex::scoped_lock scope(mut);
+
+  // Task would never be executed after quitting.
+  if(quitting.load())
   {
     return;
   }
-
-  boost::condition_variable *temporary_cond = temporary_cond_acquire();
-  Promise pr(pfunctor, temporary_cond);
-  tasks_important.put(&pr);
-  inner_dispatch();
-  pr.wait(scope);
-  temporary_cond_release(temporary_cond);
+  TaskObject *task = task_create(boost::bind(promise_execute, &pr, timeline_current()));
+  task->m_enqueued = stamp;
+  tasks_privileged.put(task);
+  ++tasks_privileged_count;
+  if(0 < stamp)
+  {
+    telemetry_depth_privileged.add(tasks_privileged_count.load());
+  }
+  cond_privileged.notify_one();
+  promise_wait(pr, scope);
+  telemetry_span(telemetry_wait_privileged, stamp, telemetry_stamp());
 }
 
-void thr::wait_privileged_ext(const Task &pfunctor)
+void thr::wait_task(TaskObject *op)
 {
-  boost::thread::id tid = boost::this_thread::get_id();
-  boost::mutex::scoped_lock scope(mut);
+  if(cleanup_privileged(op, boost::this_thread::get_id()))
+  {
+    return;
+  }
 
-  if(cleanup_privileged(pfunctor, scope, tid))
+  if(cleanup_important(op))
   {
     return;
   }
 
-  inner_dispatch_privileged(pfunctor);
-  cond_wait_privileged.wait(scope);
+  Promise pr(op);
+  uint64_t stamp = telemetry_stamp();
+  {
+    boost::mutex::scoped_lock scope(mut);
+
+    // Task would never be executed after quitting.
+    if(quitting.load())
+    {
+      return;
+    }
+    ++tasks_outstanding;
+    op->m_enqueued = stamp;
+    tasks_important.put(&pr);
+    ++tasks_important_count;
+    if(0 < stamp)
+    {
+      telemetry_depth_important.add(tasks_important_count.load());
+    }
+  }
+  wake_one();
+
+  boost::mutex::scoped_lock scope(mut);
+  promise_wait(pr, scope);
+  telemetry_span(telemetry_wait_important, stamp, telemetry_stamp());
 }
 
@@ -1,7 +1,9 @@
 #ifndef THR_DISPATCH_HPP
 #define THR_DISPATCH_HPP
 
-#include "thr/generic.hpp"
+#include "thr/task_object.hpp"
+
+#include <boost/atomic.hpp>
 
 namespace thr
 {
@@ -12,10 +14,22 @@ namespace thr
    * This function will never block, the job will always be added to the queue for execution. The actual time
    * of execution is undetermined.
    *
+   * Jobs dispatched from a thread taking part in the dispatcher go into the own queue of that thread, where
+   * other threads steal them from when idle. Jobs from other threads go into a common queue.
+   *
    * \param pfunctor Functor to store.
    */
   extern void dispatch_ext(const Task &pfunctor);
 
+  /** \brief Add a job as a task object.
+   *
+   * As dispatch_ext(), but the job is a task object created with task_create(). The dispatcher releases the
+   * task object after execution. Used by the wrappers so that binding a job does not allocate.
+   *
+   * \param op Task object.
+   */
+  extern void dispatch_task(TaskObject *op);
+
   /** \brief Add a privileged job.
    *
    * Add a primary, privileged job for execution. Only the privileged main executor may execute this job. A
@@ -32,6 +46,94 @@ namespace thr
    */
   extern void dispatch_privileged_ext(const Task &pfunctor);
 
+  /** \brief Add a privileged job as a task object.
+   *
+   * As dispatch_privileged_ext(), but the job is a task object created with task_create(). The dispatcher
+   * releases the task object after execution. Used by the wrappers so that binding a job does not allocate.
+   *
+   * \param op Task object.
+   */
+  extern void dispatch_privileged_task(TaskObject *op);
+
+  /** \brief Add a deferred privileged job as a task object.
+   *
+   * Deferred privileged jobs are collected without waking the privileged thread and executed in the order they
+   * were deferred when the privileged thread calls flush_privileged(), typically once at the start of a frame,
+   * or when it would otherwise go to sleep. Never blocks. Use fence_privileged() if the results are needed.
+   *
+   * If called from the privileged thread, the job is executed immediately.
+   *
+   * \param op Task object.
+   */
+  extern void defer_privileged_task(TaskObject *op);
+
+  /** \brief Wait until deferred privileged jobs are done.
+   *
+   * Waits until all deferred privileged jobs added before the call, by any thread, have been executed. From
+   * the privileged thread, executes them. Returns immediately after thr_quit() has been called.
+   */
+  extern void fence_privileged();
+
+  /** \brief Execute deferred privileged jobs.
+   *
+   * Must be called from the privileged thread. Executes the jobs deferred so far, jobs deferred meanwhile
+   * wait for the next call.
+   */
+  extern void flush_privileged();
+
+  /** \brief Wake up threads in wait_pending().
+   *
+   * Must be called after a counter waited for reaches zero.
+   */
+  extern void notify_pending();
+
+  /** \brief Enable or disable recording scheduler telemetry.
+   *
+   * Enabling resets the telemetry. Recording costs a few timestamps per job.
+   *
+   * \param op True to record, false to stop.
+   */
+  extern void telemetry_enable(bool op);
+
+  /** \brief Tell if recording scheduler telemetry.
+   *
+   * \return True if yes, false if no.
+   */
+  extern bool telemetry_enabled();
+
+  /** \brief Write a summary of scheduler telemetry.
+   *
+   * Writes histograms of queue depths after queueing, times from queueing to start and from start to finish of
+   * normal, important, privileged and deferred privileged jobs and times spent blocked waiting, followed by
+   * busy and sleeping ratios of every thread. The depth of deferred privileged jobs is the number executed at
+   * once.
+   *
+   * \param ostr Stream to write to.
+   */
+  extern void telemetry_report(std::ostream &ostr);
+
+  /** \brief Clear recorded scheduler telemetry.
+   */
+  extern void telemetry_reset();
+
+  /** \brief Enable or disable pinning threads to processors.
+   *
+   * The privileged thread is pinned to the first processor and workers to the following ones, wrapping
+   * around. Must be called before thr_main, threads already running are not moved.
+   *
+   * \param op True to pin, false to let threads float.
+   */
+  extern void thr_affinity(bool op);
+
+  /** \brief Enable or disable isolating the privileged thread.
+   *
+   * An isolated privileged thread only executes normal jobs when waiting, or if there are no active workers.
+   * With affinity, workers also leave the processor of the privileged thread alone.
+   *
+   * \param op True to isolate, false to let the privileged thread help with normal jobs.
+   */
+  extern void thr_isolate(bool op);
+
   /** \brief Initialize threading system.
    *
    * Must be called from the main thread before any other threading calls are
@@ -48,6 +150,12 @@ namespace thr
    */
   extern void thr_main(unsigned ntasks = 0);
 
+  /** \brief Pin the calling thread to the audio processor.
+   *
+   * The audio processor is the last one. Does nothing unless affinity is enabled.
+   */
+  extern void thr_pin_audio();
+
   /** \brief Stop threading and dispatching.
    *
    * Orders all threads to quit, including the main thread, which will join all other threads before returning
@@ -55,6 +163,24 @@ namespace thr
    */
   extern void thr_quit();
 
+  /** \brief Add worker threads.
+   *
+   * Creates workers until there are at least the given number of them, and activates parked workers up to
+   * that number. Workers are never removed before thr_main returns. Must be called after thr_init.
+   *
+   * \param ntasks Number of workers in addition to the main thread.
+   */
+  extern void thr_reserve(unsigned ntasks);
+
+  /** \brief Set the number of active worker threads.
+   *
+   * Creates workers as thr_reserve. Surplus workers are parked after finishing their current job and do not
+   * take part in the dispatcher until activated again. Must be called after thr_init.
+   *
+   * \param ntasks Number of active workers in addition to the main thread.
+   */
+  extern void thr_workers(unsigned ntasks);
+
   /** \brief Wait until all outstanding jobs are done.
    *
    * If no jobs are in execution, this function returns immediately.
@@ -63,9 +189,20 @@ namespace thr
    *
    * If called from a primary thread, execute all jobs with priority on the privileged jobs until no jobs of
    * any kind remain.
+   *
+   * Returns immediately after thr_quit() has been called.
    */
   extern void wait();
 
+  /** \brief Wait until a counter of pending jobs reaches zero.
+   *
+   * Executes other jobs meanwhile if called from a thread taking part in the dispatcher, privileged jobs
+   * included if called from the privileged thread. Returns immediately after thr_quit() has been called.
+   *
+   * \param op Counter, whoever brings it to zero must call notify_pending().
+   */
+  extern void wait_pending(const boost::atomic<unsigned> &op);
+
   /** \brief Add an important job and wait for it to complete.
    *
    * If called from a privileged thread, execution of privileged functions still has higher priority than the
@@ -73,10 +210,21 @@ namespace thr
    *
    * If called from within a worker thread, execute important jobs until the given job has been completed.
    *
+   * After thr_quit() has been called, the job is not executed unless called from a worker thread.
+   *
    * \param pfunctor Functor to store.
    */
   extern void wait_ext(const Task &pfunctor);
 
+  /** \brief Wait with a task object.
+   *
+   * As wait_ext(), but the job is a task object created with task_create(). The dispatcher releases the
+   * task object after execution. Used by the wrappers so that binding a job does not allocate.
+   *
+   * \param op Task object.
+   */
+  extern void wait_task(TaskObject *op);
+
   /** \brief Add a privileged job and wait for it to complete.
    *
    * As dispatch_privileged(const Task&), but always block until the privileged job queue is empty.
@@ -84,119 +232,186 @@ namespace thr
    * If called from the privileged thread, start executing privileged functions and continue until privileged
    * job queue is empty, then execute given function and return.
    *
+   * After thr_quit() has been called, the job is not executed unless called from the privileged thread.
+   *
    * \param pfunctor Functor to store.
    */
   extern void wait_privileged_ext(const Task &pfunctor);
 
-  /** \brief Wrapper for dispatch_ext.
+  /** \brief Wait with a task object.
+   *
+   * As wait_privileged_ext(), but the job is a task object created with task_create(). The dispatcher
+   * releases the task object after execution. Used by the wrappers so that binding a job does not allocate.
+   *
+   * \param op Task object.
+   */
+  extern void wait_privileged_task(TaskObject *op);
+
+  /** \brief Wrapper for dispatch_task.
    *
    * \param op Any binding.
    */
   template <typename Type> inline void dispatch(Type op)
   {
-    dispatch_ext(op);
+    dispatch_task(task_create(op));
   }
   /** \cond */
   template <typename T0, typename T1>
   inline void dispatch(T0 op0, T1 op1)
   {
-    dispatch_ext(boost::bind(op0, op1));
+    dispatch_task(task_create(boost::bind(op0, op1)));
   }
   template <typename T0, typename T1, typename T2>
   inline void dispatch(T0 op0, T1 op1, T2 op2)
   {
-    dispatch_ext(boost::bind(op0, op1, op2));
+    dispatch_task(task_create(boost::bind(op0, op1, op2)));
   }
   template <typename T0, typename T1, typename T2, typename T3>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3, op4));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3, op4)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3, op4, op5));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
   inline void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8, T9 op9)
   {
-    dispatch_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9));
+    dispatch_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9)));
   }
   /** \endcond */
 
-  /** \brief Wrapper for dispatch_privileged_ext.
+  /** \brief Wrapper for dispatch_privileged_task.
    *
    * \param op Any binding.
    */
   template <typename Type> inline void dispatch_privileged(Type op)
   {
-    dispatch_privileged_ext(op);
+    dispatch_privileged_task(task_create(op));
   }
   /** \cond */
   template <typename T0, typename T1>
   inline void dispatch_privileged(T0 op0, T1 op1)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1)));
   }
   template <typename T0, typename T1, typename T2>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2)));
   }
   template <typename T0, typename T1, typename T2, typename T3>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3, op4));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
   inline void dispatch_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8, T9 op9)
   {
-    dispatch_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9));
+    dispatch_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9)));
+  }
+  /** \endcond */
+
+  /** \brief Wrapper for defer_privileged_task.
+   *
+   * \param op Any binding.
+   */
+  template <typename Type> inline void defer_privileged(Type op)
+  {
+    defer_privileged_task(task_create(op));
+  }
+  /** \cond */
+  template <typename T0, typename T1>
+  inline void defer_privileged(T0 op0, T1 op1)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1)));
+  }
+  template <typename T0, typename T1, typename T2>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3, typename T4>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8)));
+  }
+  template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
+  inline void defer_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8, T9 op9)
+  {
+    defer_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9)));
   }
   /** \endcond */
 
@@ -208,57 +423,57 @@ namespace thr
    */
   template <typename Type> inline void wait(Type op)
   {
-    wait_ext(op);
+    wait_task(task_create(op));
   }
   /** \cond */
   template <typename T0, typename T1>
   inline void wait(T0 op0, T1 op1)
   {
-    wait_ext(boost::bind(op0, op1));
+    wait_task(task_create(boost::bind(op0, op1)));
   }
   template <typename T0, typename T1, typename T2>
   inline void wait(T0 op0, T1 op1, T2 op2)
   {
-    wait_ext(boost::bind(op0, op1, op2));
+    wait_task(task_create(boost::bind(op0, op1, op2)));
   }
   template <typename T0, typename T1, typename T2, typename T3>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3, op4));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3, op4)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3, op4, op5));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
   inline void wait(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8, T9 op9)
   {
-    wait_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9));
+    wait_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9)));
   }
   /** \endcond */
 
-  /** \brief Wrapper for wait_privileged_ext.
+  /** \brief Wrapper for wait_privileged_task.
    *
    * As wait(), but add one job before continuing.
    *
@@ -266,53 +481,53 @@ namespace thr
    */
   template <typename Type> inline void wait_privileged(Type op)
   {
-    wait_privileged_ext(Task(op));
+    wait_privileged_task(task_create(op));
   }
   /** \cond */
   template <typename T0, typename T1>
   inline void wait_privileged(T0 op0, T1 op1)
   {
-    wait_privileged_ext(boost::bind(op0, op1));
+    wait_privileged_task(task_create(boost::bind(op0, op1)));
   }
   template <typename T0, typename T1, typename T2>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2)));
   }
   template <typename T0, typename T1, typename T2, typename T3>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3, op4));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8)));
   }
   template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7, typename T8, typename T9>
   inline void wait_privileged(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6, T7 op7, T8 op8, T9 op9)
   {
-    wait_privileged_ext(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9));
+    wait_privileged_task(task_create(boost::bind(op0, op1, op2, op3, op4, op5, op6, op7, op8, op9)));
   }
   /** \endcond */
 }
@@ -17,6 +17,13 @@ namespace thr
   /** Convenience typedef. */
   typedef boost::shared_ptr<boost::thread> ThreadSptr;
 
+  /** \brief Pin the calling thread to a processor.
+   *
+   * \param op Processor index.
+   * \return True on success, false if not supported or failed.
+   */
+  extern bool cpu_pin(unsigned op);
+
   /** \brief Get hardware concurrency.
    *
    * Throws an error if the information is not available.
@@ -25,7 +32,7 @@ namespace thr
 
   /** \brief Get a timestamp in microseconds.
    *
-   * The zero point of the timestamp is unspecified.
+   * The timestamp is monotonic where supported. The zero point of the timestamp is unspecified.
    *
    * \return Timestamp in microseconds.
    */
@@ -0,0 +1,114 @@
+#include "thr/histogram.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+using namespace thr;
+
+/** Width of the name column in summaries. */
+static const int HISTOGRAM_NAME_WIDTH = 24;
+
+/** Width of value columns in summaries. */
+static const int HISTOGRAM_VALUE_WIDTH = 10;
+
+/** \brief Get the bucket of a value.
+ *
+ * \param op Value.
+ * \return Bucket index.
+ */
+static unsigned histogram_bucket(uint64_t op)
+{
+  unsigned ret = 0;
+
+  for(; (0 < op) && (ret < Histogram::BUCKETS - 1); op >>= 1)
+  {
+    ++ret;
+  }
+  return ret;
+}
+
+Histogram::Histogram()
+{
+  this->reset();
+}
+
+void Histogram::add(uint64_t op)
+{
+  m_buckets[histogram_bucket(op)].fetch_add(1, boost::memory_order_relaxed);
+  m_sum.fetch_add(op, boost::memory_order_relaxed);
+
+  uint64_t prev = m_max.load(boost::memory_order_relaxed);
+  while((prev < op) && !m_max.compare_exchange_weak(prev, op, boost::memory_order_relaxed));
+}
+
+uint64_t Histogram::count() const
+{
+  uint64_t ret = 0;
+
+  for(unsigned ii = 0; (ii < BUCKETS); ++ii)
+  {
+    ret += m_buckets[ii].load(boost::memory_order_relaxed);
+  }
+  return ret;
+}
+
+double Histogram::mean() const
+{
+  uint64_t cnt = this->count();
+
+  if(0 >= cnt)
+  {
+    return 0.0;
+  }
+  return static_cast<double>(this->getSum()) / static_cast<double>(cnt);
+}
+
+uint64_t Histogram::percentile(double op) const
+{
+  uint64_t cnt = this->count();
+  uint64_t target = static_cast<uint64_t>(op * static_cast<double>(cnt));
+  uint64_t seen = 0;
+
+  for(unsigned ii = 0; (ii < BUCKETS); ++ii)
+  {
+    seen += m_buckets[ii].load(boost::memory_order_relaxed);
+    if((seen > target) || (seen >= cnt))
+    {
+      uint64_t bound = (0 >= ii) ? 0 : ((static_cast<uint64_t>(1) << ii) - 1);
+      return std::min(bound, this->getMax());
+    }
+  }
+  return this->getMax();
+}
+
+void Histogram::reset()
+{
+  for(unsigned ii = 0; (ii < BUCKETS); ++ii)
+  {
+    m_buckets[ii].store(0, boost::memory_order_relaxed);
+  }
+  m_sum.store(0, boost::memory_order_relaxed);
+  m_max.store(0, boost::memory_order_relaxed);
+}
+
+void Histogram::summary(std::ostream &ostr, const char *name) const
+{
+  ostr << std::setw(HISTOGRAM_NAME_WIDTH) << std::left << name << std::right <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << this->count() <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << std::fixed << std::setprecision(1) << this->mean() <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << this->percentile(0.5) <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << this->percentile(0.9) <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << this->percentile(0.99) <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << this->getMax() << '\n';
+}
+
+void Histogram::header(std::ostream &ostr, const char *name)
+{
+  ostr << std::setw(HISTOGRAM_NAME_WIDTH) << std::left << name << std::right <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << "count" <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << "mean" <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << "p50" <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << "p90" <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << "p99" <<
+    std::setw(HISTOGRAM_VALUE_WIDTH) << "max" << '\n';
+}
@@ -0,0 +1,105 @@
+#ifndef THR_HISTOGRAM_HPP
+#define THR_HISTOGRAM_HPP
+
+#include "thr/generic.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace thr
+{
+  /** \brief Histogram with power of two buckets.
+   *
+   * Bucket 0 counts zero values, bucket n counts values in [2^(n-1), 2^n). The last bucket also counts all
+   * larger values. Adding is lock-free and may be done from any thread.
+   */
+  class Histogram :
+    public boost::noncopyable
+  {
+    public:
+      /** Number of buckets. */
+      static const unsigned BUCKETS = 32;
+
+    private:
+      /** Counts of values by bucket. */
+      boost::atomic<uint64_t> m_buckets[BUCKETS];
+
+      /** Sum of values. */
+      boost::atomic<uint64_t> m_sum;
+
+      /** Largest value. */
+      boost::atomic<uint64_t> m_max;
+
+    public:
+      /** \brief Constructor. */
+      Histogram();
+
+    public:
+      /** \brief Add a value.
+       *
+       * \param op Value.
+       */
+      void add(uint64_t op);
+
+      /** \brief Get the number of values.
+       *
+       * \return Value count.
+       */
+      uint64_t count() const;
+
+      /** \brief Get the mean of values.
+       *
+       * \return Mean or 0 if empty.
+       */
+      double mean() const;
+
+      /** \brief Get an upper bound of a percentile.
+       *
+       * \param op Percentile in [0, 1].
+       * \return Upper bound of the bucket containing the percentile, or the largest value if smaller.
+       */
+      uint64_t percentile(double op) const;
+
+      /** \brief Remove all values.
+       */
+      void reset();
+
+      /** \brief Write a single line summary.
+       *
+       * Writes the count, mean, median, 90th and 99th percentile and largest value.
+       *
+       * \param ostr Stream to write to.
+       * \param name Name of the histogram.
+       */
+      void summary(std::ostream &ostr, const char *name) const;
+
+    public:
+      /** \brief Write column titles for summary lines.
+       *
+       * \param ostr Stream to write to.
+       * \param name Title of the name column.
+       */
+      static void header(std::ostream &ostr, const char *name);
+
+    public:
+      /** \brief Accessor.
+       *
+       * \return Largest value.
+       */
+      uint64_t getMax() const
+      {
+        return m_max.load(boost::memory_order_relaxed);
+      }
+
+      /** \brief Accessor.
+       *
+       * \return Sum of values.
+       */
+      uint64_t getSum() const
+      {
+        return m_sum.load(boost::memory_order_relaxed);
+      }
+  };
+}
+
+#endif
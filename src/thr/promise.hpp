@@ -1,11 +1,9 @@
 #ifndef THR_PROMISE_HPP
 #define THR_PROMISE_HPP
 
-#include "thr/generic.hpp"
+#include "thr/task_object.hpp"
 
-#include <boost/thread/future.hpp>
-
-#include <iostream>
+#include <boost/noncopyable.hpp>
 
 namespace thr
 {
@@ -13,49 +11,70 @@ namespace thr
   *
   * Promise is an abstract concept of a job that has been promised to be fullfilled.
   *
-  * Used for waiting for a specific task to be performed.
+  * Used for waiting for a specific task to be performed. The dispatcher guards the fulfillment and signals
+  * waiters.
   */
-  class Promise
+  class Promise :
+    public boost::noncopyable
   {
     private:
-      /** Task to execute. */
-      Task m_task;
+      /** Task to execute, owned. */
+      TaskObject *m_task;
 
-      /** Condition variable to use for fulfilling the promise. */
-      boost::condition_variable *m_cond;
+      /** Has the promise been fulfilled? */
+      bool m_done;
 
     public:
-      /** \brief Constructor.
+      /** \brief Accessor.
        *
-       * \param pfunctor Function to run.
-       * \param pcond Condition variable to signal.
+       * \return Task to execute.
        */
-      Promise(const Task& pfunctor, boost::condition_variable *pcond) :
-        m_task(pfunctor),
-        m_cond(pcond) { }
+      TaskObject* getTask() const
+      {
+        return m_task;
+      }
+
+      /** \brief Tell if the promise has been fulfilled.
+       *
+       * \return True if yes, false if no.
+       */
+      bool isDone() const
+      {
+        return m_done;
+      }
 
     public:
-      /** \brief Run the task in the promise.
+      /** \brief Constructor.
        *
-       * Implicitly fulfills the promise.
+       * \param ptask Task to run, released with the promise.
        */
-      void task()
+      Promise(TaskObject *ptask) :
+        m_task(ptask),
+        m_done(false) { }
+
+      /** \brief Destructor. */
+      ~Promise()
       {
-        m_task();
-        m_cond->notify_all();
+        task_release(m_task);
       }
 
-      /** \brief Wait for the promise to be fulfilled.
+    public:
+      /** \brief Mark the promise fulfilled.
+       */
+      void fulfill()
+      {
+        m_done = true;
+      }
+
+      /** \brief Run the task in the promise.
        *
-       * \param pscope Scoped lock to release for the duration of wait.
+       * Does not fulfill the promise.
        */
-      void wait(boost::mutex::scoped_lock &pscope)
+      void task()
       {
-        m_cond->wait(pscope);
+        (*m_task)();
       }
   };
 }
 
-
 #endif
-
@@ -0,0 +1,101 @@
+#include "thr/task_group.hpp"
+
+#include <boost/foreach.hpp>
+
+using namespace thr;
+
+TaskGroup::TaskGroup() :
+  m_pending(0) { }
+
+TaskGroup::~TaskGroup()
+{
+  this->join();
+
+  BOOST_FOREACH(TaskObject *vv, m_continuations)
+  {
+    task_release(vv);
+  }
+}
+
+void TaskGroup::add(TaskObject *op)
+{
+  ++m_pending;
+  dispatch_task(op);
+}
+
+void TaskGroup::complete()
+{
+  // The group may be gone as soon as the count reaches zero, only the last completion may touch it.
+  unsigned pending = m_pending.load();
+  while(1 < pending)
+  {
+    if(m_pending.compare_exchange_weak(pending, pending - 1))
+    {
+      return;
+    }
+  }
+
+  std::vector<TaskObject*> continuations;
+  {
+    boost::mutex::scoped_lock scope(m_mutex);
+
+    if(1 == m_pending.fetch_sub(1))
+    {
+      continuations.swap(m_continuations);
+    }
+  }
+  notify_pending();
+
+  BOOST_FOREACH(TaskObject *vv, continuations)
+  {
+    dispatch_task(vv);
+  }
+}
+
+void TaskGroup::fail(const boost::exception_ptr &op)
+{
+  boost::mutex::scoped_lock scope(m_mutex);
+
+  if(!m_error)
+  {
+    m_error = op;
+  }
+}
+
+void TaskGroup::join()
+{
+  wait_pending(m_pending);
+
+  // Last completion may still hold the lock.
+  boost::mutex::scoped_lock scope(m_mutex);
+}
+
+void TaskGroup::thenTask(TaskObject *op)
+{
+  {
+    boost::mutex::scoped_lock scope(m_mutex);
+
+    if(0 < m_pending.load())
+    {
+      m_continuations.push_back(op);
+      return;
+    }
+  }
+  dispatch_task(op);
+}
+
+void TaskGroup::wait()
+{
+  this->join();
+
+  boost::exception_ptr error;
+  {
+    boost::mutex::scoped_lock scope(m_mutex);
+    error = m_error;
+    m_error = boost::exception_ptr();
+  }
+  if(error)
+  {
+    boost::rethrow_exception(error);
+  }
+}
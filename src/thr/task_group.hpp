@@ -0,0 +1,287 @@
+#ifndef THR_TASK_GROUP_HPP
+#define THR_TASK_GROUP_HPP
+
+#include "thr/dispatch.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace thr
+{
+  template <typename Type> class TaskGroupCall;
+
+  /** \brief Group of jobs that can be waited for.
+   *
+   * Unlike thr::wait(), waiting for a group only waits for the jobs in the group. The waiting thread helps
+   * executing pending jobs meanwhile, so groups may be nested freely, also in the privileged thread.
+   *
+   * Continuations are dispatched when all jobs in the group have completed.
+   */
+  class TaskGroup :
+    public boost::noncopyable
+  {
+    private:
+      /** Number of jobs not yet completed. */
+      boost::atomic<unsigned> m_pending;
+
+      /** Guards the last completion, continuations and error. */
+      boost::mutex m_mutex;
+
+      /** Continuations to dispatch on completion. */
+      std::vector<TaskObject*> m_continuations;
+
+      /** First error in a job, empty if none. */
+      boost::exception_ptr m_error;
+
+    public:
+      /** \brief Constructor. */
+      TaskGroup();
+
+      /** \brief Destructor.
+       *
+       * Waits for the jobs in the group, errors are discarded.
+       */
+      ~TaskGroup();
+
+    private:
+      /** \brief Add a job.
+       *
+       * \param op Task object.
+       */
+      void add(TaskObject *op);
+
+      /** \brief Wait for the jobs without rethrowing errors.
+       */
+      void join();
+
+    public:
+      /** \brief Mark a job completed.
+       *
+       * Called by the job wrapper.
+       */
+      void complete();
+
+      /** \brief Record an error in a job.
+       *
+       * Only the first error is kept.
+       *
+       * \param op Error.
+       */
+      void fail(const boost::exception_ptr &op);
+
+      /** \brief Add a continuation as a task object.
+       *
+       * \param op Task object, dispatched immediately if the group has no pending jobs.
+       */
+      void thenTask(TaskObject *op);
+
+      /** \brief Wait until all jobs in the group have completed.
+       *
+       * Executes pending jobs meanwhile. Rethrows the first error in a job, if any. Returns immediately after
+       * thr_quit() has been called.
+       */
+      void wait();
+
+    public:
+      /** \brief Add a job.
+       *
+       * \param op Any binding.
+       */
+      template <typename Type> void dispatch(Type op)
+      {
+        this->add(task_create(TaskGroupCall<Type>(this, op)));
+      }
+      /** \cond */
+      template <typename T0, typename T1>
+      void dispatch(T0 op0, T1 op1)
+      {
+        this->dispatch(boost::bind(op0, op1));
+      }
+      template <typename T0, typename T1, typename T2>
+      void dispatch(T0 op0, T1 op1, T2 op2)
+      {
+        this->dispatch(boost::bind(op0, op1, op2));
+      }
+      template <typename T0, typename T1, typename T2, typename T3>
+      void dispatch(T0 op0, T1 op1, T2 op2, T3 op3)
+      {
+        this->dispatch(boost::bind(op0, op1, op2, op3));
+      }
+      template <typename T0, typename T1, typename T2, typename T3, typename T4>
+      void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4)
+      {
+        this->dispatch(boost::bind(op0, op1, op2, op3, op4));
+      }
+      template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5>
+      void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5)
+      {
+        this->dispatch(boost::bind(op0, op1, op2, op3, op4, op5));
+      }
+      template <typename T0, typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
+      void dispatch(T0 op0, T1 op1, T2 op2, T3 op3, T4 op4, T5 op5, T6 op6)
+      {
+        this->dispatch(boost::bind(op0, op1, op2, op3, op4, op5, op6));
+      }
+      /** \endcond */
+
+      /** \brief Add a continuation.
+       *
+       * The continuation is dispatched as a normal job when all jobs in the group have completed, or
+       * immediately if there are no pending jobs. It is not a part of the group.
+       *
+       * \param op Any binding.
+       */
+      template <typename Type> void then(Type op)
+      {
+        this->thenTask(task_create(op));
+      }
+
+      /** \brief Add a continuation as a job of another group.
+       *
+       * As then(Type), but the continuation is a job of the given group, so waiting for that group also waits
+       * for this group to complete.
+       *
+       * \param group Group of the continuation.
+       * \param op Any binding.
+       */
+      template <typename Type> void then(TaskGroup &group, Type op)
+      {
+        ++(group.m_pending);
+        this->thenTask(task_create(TaskGroupCall<Type>(&group, op)));
+      }
+  };
+
+  /** \brief Job wrapper for task groups.
+   *
+   * Executes the job and marks it completed in the group.
+   */
+  template <typename Type> class TaskGroupCall
+  {
+    private:
+      /** Group of the job. */
+      TaskGroup *m_group;
+
+      /** Job. */
+      Type m_task;
+
+    public:
+      /** \brief Constructor.
+       *
+       * \param pgroup Group of the job.
+       * \param ptask Job.
+       */
+      TaskGroupCall(TaskGroup *pgroup, const Type &ptask) :
+        m_group(pgroup),
+        m_task(ptask) { }
+
+    public:
+      /** \brief Execute the job.
+       */
+      void operator()()
+      {
+        try
+        {
+          m_task();
+        }
+        catch(...)
+        {
+          m_group->fail(boost::current_exception());
+        }
+        m_group->complete();
+      }
+  };
+
+  /** \brief Part of a parallel loop.
+   *
+   * Splits off the upper half of the range into a new job until the range is within the grain size, then
+   * executes the remaining range. Idle threads steal the split off jobs and split them further.
+   */
+  template <typename Type> class ParallelForCall
+  {
+    private:
+      /** Group of the loop. */
+      TaskGroup *m_group;
+
+      /** Function taking the first and one past last index of a range. */
+      Type m_func;
+
+      /** First index. */
+      unsigned m_first;
+
+      /** One past last index. */
+      unsigned m_last;
+
+      /** Maximum number of indices in one call. */
+      unsigned m_grain;
+
+    public:
+      /** \brief Constructor.
+       *
+       * \param pgroup Group of the loop.
+       * \param pfunc Function taking the first and one past last index of a range.
+       * \param pfirst First index.
+       * \param plast One past last index.
+       * \param pgrain Maximum number of indices in one call.
+       */
+      ParallelForCall(TaskGroup *pgroup, const Type &pfunc, unsigned pfirst, unsigned plast,
+          unsigned pgrain) :
+        m_group(pgroup),
+        m_func(pfunc),
+        m_first(pfirst),
+        m_last(plast),
+        m_grain(pgrain) { }
+
+    public:
+      /** \brief Execute the range.
+       */
+      void operator()()
+      {
+        unsigned last = m_last;
+
+        while(last - m_first > m_grain)
+        {
+          unsigned mid = m_first + (last - m_first) / 2;
+
+          m_group->dispatch(ParallelForCall<Type>(m_group, m_func, mid, last, m_grain));
+          last = mid;
+        }
+        m_func(m_first, last);
+      }
+  };
+
+  /** \brief Execute a loop in parallel.
+   *
+   * Calls the function for disjoint ranges covering the whole range, each at most grain indices long. Returns
+   * when all ranges are done, rethrowing the first error, if any.
+   *
+   * \param first First index.
+   * \param last One past last index.
+   * \param grain Maximum number of indices in one call.
+   * \param op Function taking the first and one past last index of a range.
+   */
+  template <typename Type> void parallel_for(unsigned first, unsigned last, unsigned grain, Type op)
+  {
+    if(first >= last)
+    {
+      return;
+    }
+
+    TaskGroup group;
+    try
+    {
+      ParallelForCall<Type>(&group, op, first, last, std::max(grain, 1U))();
+    }
+    catch(...)
+    {
+      group.fail(boost::current_exception());
+    }
+    group.wait();
+  }
+}
+
+#endif
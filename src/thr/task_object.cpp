@@ -0,0 +1,167 @@
+#include "thr/task_object.hpp"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace thr;
+
+/** Number of task objects moved between a thread and the global pool at once. */
+static const unsigned TASK_BATCH = 64;
+
+/** \brief Task objects cached by one thread.
+ */
+struct TaskCache
+{
+  /** First free task object. */
+  TaskObject *m_first;
+
+  /** Number of free task objects. */
+  unsigned m_count;
+
+  /** \brief Constructor. */
+  TaskCache() :
+    m_first(NULL),
+    m_count(0) { }
+};
+
+/** Global pool, a list of batches. */
+static TaskObject *task_pool = NULL;
+
+/** Global pool guard. */
+static boost::mutex task_pool_mutex;
+
+/** Heap allocations done by task objects. */
+static boost::atomic<unsigned> task_allocations(0);
+
+/** \brief Return a list of free task objects to the global pool.
+ *
+ * \param op First task object.
+ */
+static void task_pool_put(TaskObject *op)
+{
+  boost::mutex::scoped_lock scope(task_pool_mutex);
+
+  op->m_next_batch = task_pool;
+  task_pool = op;
+}
+
+/** \brief Return the cache of an exiting thread to the global pool.
+ *
+ * \param op Cache.
+ */
+static void task_cache_release(TaskCache *op)
+{
+  if(op->m_first)
+  {
+    task_pool_put(op->m_first);
+  }
+  delete op;
+}
+
+/** Cache of the current thread. */
+static boost::thread_specific_ptr<TaskCache> task_cache(task_cache_release);
+
+/** \brief Get the cache of the current thread.
+ *
+ * \return Cache.
+ */
+static TaskCache* task_cache_get()
+{
+  TaskCache *ret = task_cache.get();
+
+  if(!ret)
+  {
+    ret = new TaskCache();
+    task_cache.reset(ret);
+  }
+  return ret;
+}
+
+/** \brief Refill an empty cache from the global pool or the heap.
+ *
+ * \param op Cache.
+ */
+static void task_cache_fill(TaskCache *op)
+{
+  {
+    boost::mutex::scoped_lock scope(task_pool_mutex);
+
+    if(task_pool)
+    {
+      op->m_first = task_pool;
+      task_pool = task_pool->m_next_batch;
+    }
+  }
+
+  // Batches returned by exiting threads may be partial.
+  if(op->m_first)
+  {
+    op->m_count = 0;
+    for(TaskObject *ii = op->m_first; (ii); ii = ii->m_next)
+    {
+      ++(op->m_count);
+    }
+    return;
+  }
+
+  // Objects are never returned to the heap.
+  TaskObject *batch = new TaskObject[TASK_BATCH];
+  ++task_allocations;
+  for(unsigned ii = 0; (ii < TASK_BATCH - 1); ++ii)
+  {
+    batch[ii].m_next = batch + ii + 1;
+  }
+  op->m_first = batch;
+  op->m_count = TASK_BATCH;
+}
+
+void TaskObject::countHeap()
+{
+  ++task_allocations;
+}
+
+TaskObject* thr::task_acquire()
+{
+  TaskCache *cache = task_cache_get();
+
+  if(!cache->m_first)
+  {
+    task_cache_fill(cache);
+  }
+
+  TaskObject *ret = cache->m_first;
+  cache->m_first = ret->m_next;
+  --(cache->m_count);
+  return ret;
+}
+
+unsigned thr::task_allocation_count()
+{
+  return task_allocations.load();
+}
+
+void thr::task_release(TaskObject *op)
+{
+  TaskCache *cache = task_cache_get();
+
+  op->clear();
+  op->m_enqueued = 0;
+  op->m_next = cache->m_first;
+  cache->m_first = op;
+  ++(cache->m_count);
+
+  // Threads executing more tasks than they create pass the surplus on a batch at a time.
+  if(cache->m_count >= TASK_BATCH * 2)
+  {
+    TaskObject *last = cache->m_first;
+    for(unsigned ii = 1; (ii < TASK_BATCH); ++ii)
+    {
+      last = last->m_next;
+    }
+    TaskObject *batch = cache->m_first;
+    cache->m_first = last->m_next;
+    cache->m_count -= TASK_BATCH;
+    last->m_next = NULL;
+    task_pool_put(batch);
+  }
+}
@@ -0,0 +1,168 @@
+#ifndef THR_TASK_OBJECT_HPP
+#define THR_TASK_OBJECT_HPP
+
+#include "thr/generic.hpp"
+
+#include <new>
+
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+namespace thr
+{
+  /** \brief Task object.
+   *
+   * Type-erased functor stored inline in a pooled object. Unlike Task, binding a call into a task object
+   * does not allocate unless the functor is larger than the inline storage. Task objects are acquired with
+   * task_create() and released with task_release() after execution.
+   */
+  class TaskObject
+  {
+    public:
+      /** Size of inline storage, functors larger than this are allocated from the heap. */
+      static const unsigned INLINE_SIZE = 88;
+
+      /** Convenience typedef. */
+      typedef boost::aligned_storage<INLINE_SIZE>::type storage_type;
+
+    private:
+      /** Inline storage for the functor. */
+      storage_type m_storage;
+
+      /** Functor, points to inline storage or heap, NULL if not assigned. */
+      void *m_functor;
+
+      /** Call function. */
+      void (*m_invoke)(void*);
+
+      /** Destroy function. */
+      void (*m_destroy)(void*);
+
+    public:
+      /** Next free task object while in a pool, next deferred task object while deferred. */
+      TaskObject *m_next;
+
+      /** Next batch of free task objects, only valid for the first object of a batch in the global pool. */
+      TaskObject *m_next_batch;
+
+      /** Timestamp of queueing in microseconds for telemetry, 0 if not recorded. */
+      uint64_t m_enqueued;
+
+    private:
+      /** \brief Call a functor.
+       *
+       * \param op Functor.
+       */
+      template <typename Type> static void invoke(void *op)
+      {
+        (*static_cast<Type*>(op))();
+      }
+
+      /** \brief Destroy a functor in inline storage.
+       *
+       * \param op Functor.
+       */
+      template <typename Type> static void destroyInline(void *op)
+      {
+        static_cast<Type*>(op)->~Type();
+      }
+
+      /** \brief Destroy a functor in the heap.
+       *
+       * \param op Functor.
+       */
+      template <typename Type> static void destroyHeap(void *op)
+      {
+        delete static_cast<Type*>(op);
+      }
+
+      /** \brief Count a functor allocated from the heap.
+       */
+      static void countHeap();
+
+    public:
+      /** \brief Constructor. */
+      TaskObject() :
+        m_functor(NULL),
+        m_next(NULL),
+        m_next_batch(NULL),
+        m_enqueued(0) { }
+
+    public:
+      /** \brief Assign a functor.
+       *
+       * The task object must not have a functor already.
+       *
+       * \param op Functor to copy.
+       */
+      template <typename Type> void assign(const Type &op)
+      {
+        if((sizeof(Type) <= INLINE_SIZE) &&
+            (boost::alignment_of<Type>::value <= boost::alignment_of<storage_type>::value))
+        {
+          m_functor = new(&m_storage) Type(op);
+          m_destroy = destroyInline<Type>;
+        }
+        else
+        {
+          m_functor = new Type(op);
+          m_destroy = destroyHeap<Type>;
+          countHeap();
+        }
+        m_invoke = invoke<Type>;
+      }
+
+      /** \brief Destroy the functor.
+       */
+      void clear()
+      {
+        if(m_functor)
+        {
+          m_destroy(m_functor);
+          m_functor = NULL;
+        }
+      }
+
+    public:
+      /** \brief Execute the functor.
+       */
+      void operator()()
+      {
+        m_invoke(m_functor);
+      }
+  };
+
+  /** \brief Get a task object from the pool.
+   *
+   * \return Task object without a functor.
+   */
+  extern TaskObject* task_acquire();
+
+  /** \brief Get the number of heap allocations done by task objects.
+   *
+   * Counts both pool growth and functors too large for inline storage.
+   *
+   * \return Allocation count.
+   */
+  extern unsigned task_allocation_count();
+
+  /** \brief Destroy the functor of a task object and return it to the pool.
+   *
+   * \param op Task object.
+   */
+  extern void task_release(TaskObject *op);
+
+  /** \brief Create a task object.
+   *
+   * \param op Functor to copy.
+   * \return Task object.
+   */
+  template <typename Type> inline TaskObject* task_create(const Type &op)
+  {
+    TaskObject *ret = task_acquire();
+    ret->assign(op);
+    return ret;
+  }
+}
+
+#endif
@@ -2,10 +2,38 @@
 
 #if !defined(WIN32)
 #include <sys/time.h>
+#include <time.h>
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
 #endif
 
 using namespace thr;
 
+bool thr::cpu_pin(unsigned op)
+{
+#if defined(WIN32)
+  if(op >= sizeof(DWORD_PTR) * 8)
+  {
+    return false;
+  }
+  return (0 != SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << op));
+#elif defined(__linux__)
+  if(op >= CPU_SETSIZE)
+  {
+    return false;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(op, &cpus);
+  return (0 == pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus));
+#else
+  boost::ignore_unused_variable_warning(op);
+  return false;
+#endif
+}
+
 unsigned thr::hardware_concurrency()
 {
   unsigned ret = boost::thread::hardware_concurrency();
@@ -23,7 +51,18 @@ unsigned thr::hardware_concurrency()
 uint64_t thr::usec_get_timestamp()
 {
 #if defined(WIN32)
-  return static_cast<uint64_t>(timeGetTime()) * 1000;
+  LARGE_INTEGER count;
+  LARGE_INTEGER frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  uint64_t ticks = static_cast<uint64_t>(count.QuadPart);
+  uint64_t rate = static_cast<uint64_t>(frequency.QuadPart);
+  return ticks / rate * 1000000 + ticks % rate * 1000000 / rate;
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 +
+    static_cast<uint64_t>(ts.tv_nsec) / 1000;
 #else
   struct timeval tv;
   gettimeofday(&tv, NULL);
@@ -38,8 +77,8 @@ void thr::usec_sleep(uint64_t op)
   Sleep(static_cast<unsigned>(op / 1000));
 #else
   struct timespec ts;
-  ts.tv_sec = static_cast<time_t>(op / 1000000000);
-  ts.tv_nsec = static_cast<long int>(op % 1000000000);
+  ts.tv_sec = static_cast<time_t>(op / 1000000);
+  ts.tv_nsec = static_cast<long int>(op % 1000000) * 1000;
   nanosleep(&ts, NULL);
 #endif
 }
@@ -0,0 +1,261 @@
+#include "thr/timeline.hpp"
+
+#include <iomanip>
+#include <map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace thr;
+
+/** \brief Summary of one timeline category.
+ */
+struct TimelineSummary
+{
+  /** Number of events. */
+  unsigned m_count;
+
+  /** Total duration (microseconds). */
+  uint64_t m_total;
+
+  /** Longest duration (microseconds). */
+  uint64_t m_max;
+
+  /** Bytes read. */
+  uint64_t m_bytes_read;
+
+  /** Bytes uploaded. */
+  uint64_t m_bytes_uploaded;
+};
+
+/** \brief Cleanup function for the innermost scope pointer.
+ *
+ * Scopes are owned by their creators.
+ */
+static void timeline_no_cleanup(TimelineScope *op)
+{
+  boost::ignore_unused_variable_warning(op);
+}
+
+/** Innermost scope of each thread. */
+static boost::thread_specific_ptr<TimelineScope> timeline_scope(timeline_no_cleanup);
+
+/** Recording enabled. */
+static bool timeline_is_enabled = false;
+
+/** Recorded events. */
+static std::vector<TimelineEvent> timeline_events;
+
+/** Thread indices. */
+static std::map<boost::thread::id, unsigned> timeline_threads;
+
+/** Guards the recorded events. */
+static boost::mutex timeline_mutex;
+
+/** \brief Write a string as a JSON string.
+ *
+ * \param ostr Stream to write to.
+ * \param op String.
+ */
+static void write_json_string(std::ostream &ostr, const std::string &op)
+{
+  ostr << '"';
+  for(std::string::const_iterator ii = op.begin(), ee = op.end(); (ii != ee); ++ii)
+  {
+    if(('"' == *ii) || ('\\' == *ii))
+    {
+      ostr << '\\';
+    }
+    ostr << *ii;
+  }
+  ostr << '"';
+}
+
+TimelineScope::TimelineScope(const std::string &category, const std::string &name) :
+  m_parent(NULL),
+  m_open(timeline_is_enabled)
+{
+  if(!m_open)
+  {
+    return;
+  }
+
+  m_event.m_category = category;
+  m_event.m_name = name;
+  m_event.m_start = usec_get_timestamp();
+  m_event.m_end = 0;
+  m_event.m_thread = 0;
+  m_event.m_bytes_read = 0;
+  m_event.m_bytes_uploaded = 0;
+
+  m_parent = timeline_scope.get();
+  timeline_scope.reset(this);
+}
+
+TimelineScope::~TimelineScope()
+{
+  this->close();
+}
+
+void TimelineScope::close()
+{
+  if(!m_open)
+  {
+    return;
+  }
+  m_open = false;
+
+  BOOST_ASSERT(timeline_scope.get() == this);
+
+  m_event.m_end = usec_get_timestamp();
+  timeline_scope.reset(m_parent);
+
+  boost::mutex::scoped_lock scope(timeline_mutex);
+  boost::thread::id tid = boost::this_thread::get_id();
+  std::map<boost::thread::id, unsigned>::iterator iter = timeline_threads.find(tid);
+
+  if(timeline_threads.end() == iter)
+  {
+    unsigned idx = static_cast<unsigned>(timeline_threads.size());
+    timeline_threads[tid] = idx;
+    m_event.m_thread = idx;
+  }
+  else
+  {
+    m_event.m_thread = iter->second;
+  }
+  timeline_events.push_back(m_event);
+}
+
+void thr::timeline_adopt(TimelineScope *scope, const Task &task)
+{
+  TimelineScope *prev = timeline_scope.get();
+
+  timeline_scope.reset(scope);
+  try
+  {
+    task();
+  }
+  catch(...)
+  {
+    timeline_scope.reset(prev);
+    throw;
+  }
+  timeline_scope.reset(prev);
+}
+
+TimelineScope* thr::timeline_current()
+{
+  return timeline_scope.get();
+}
+
+void thr::timeline_enable()
+{
+  timeline_is_enabled = true;
+}
+
+bool thr::timeline_enabled()
+{
+  return timeline_is_enabled;
+}
+
+void thr::timeline_read(uint64_t op)
+{
+  TimelineScope *scope = timeline_scope.get();
+
+  if(scope)
+  {
+    scope->addRead(op);
+  }
+}
+
+void thr::timeline_summary(std::ostream &ostr)
+{
+  boost::mutex::scoped_lock scope(timeline_mutex);
+
+  if(timeline_events.empty())
+  {
+    return;
+  }
+
+  std::map<std::string, TimelineSummary> summaries;
+  uint64_t first = timeline_events.front().m_start;
+  uint64_t last = timeline_events.front().m_end;
+
+  BOOST_FOREACH(const TimelineEvent &vv, timeline_events)
+  {
+    std::map<std::string, TimelineSummary>::iterator iter = summaries.find(vv.m_category);
+    if(summaries.end() == iter)
+    {
+      TimelineSummary empty = { 0, 0, 0, 0, 0 };
+      iter = summaries.insert(std::make_pair(vv.m_category, empty)).first;
+    }
+
+    TimelineSummary &ss = iter->second;
+    uint64_t duration = vv.m_end - vv.m_start;
+    ++ss.m_count;
+    ss.m_total += duration;
+    ss.m_max = std::max(ss.m_max, duration);
+    ss.m_bytes_read += vv.m_bytes_read;
+    ss.m_bytes_uploaded += vv.m_bytes_uploaded;
+
+    first = std::min(first, vv.m_start);
+    last = std::max(last, vv.m_end);
+  }
+
+  ostr << std::fixed << std::setprecision(1) << "timeline: " << timeline_events.size() << " events on " <<
+    timeline_threads.size() << " threads in " << static_cast<double>(last - first) / 1000.0 << " ms\n" <<
+    std::setw(16) << std::left << "category" << std::right << std::setw(8) << "count" << std::setw(12) <<
+    "total ms" << std::setw(12) << "max ms" << std::setw(12) << "read MB" << std::setw(12) << "upload MB" << '\n';
+  for(std::map<std::string, TimelineSummary>::const_iterator ii = summaries.begin(), ee = summaries.end();
+      (ii != ee); ++ii)
+  {
+    const TimelineSummary &ss = ii->second;
+
+    ostr << std::setw(16) << std::left << ii->first << std::right << std::setw(8) << ss.m_count <<
+      std::setw(12) << static_cast<double>(ss.m_total) / 1000.0 <<
+      std::setw(12) << static_cast<double>(ss.m_max) / 1000.0 <<
+      std::setw(12) << static_cast<double>(ss.m_bytes_read) / 1048576.0 <<
+      std::setw(12) << static_cast<double>(ss.m_bytes_uploaded) / 1048576.0 << '\n';
+  }
+}
+
+void thr::timeline_upload(uint64_t op)
+{
+  TimelineScope *scope = timeline_scope.get();
+
+  if(scope)
+  {
+    scope->addUpload(op);
+  }
+}
+
+void thr::timeline_write(std::ostream &ostr)
+{
+  boost::mutex::scoped_lock scope(timeline_mutex);
+  uint64_t first = 0;
+
+  BOOST_FOREACH(const TimelineEvent &vv, timeline_events)
+  {
+    if((0 == first) || (vv.m_start < first))
+    {
+      first = vv.m_start;
+    }
+  }
+
+  ostr << "{\"traceEvents\":[";
+  for(unsigned ii = 0; (ii < timeline_events.size()); ++ii)
+  {
+    const TimelineEvent &vv = timeline_events[ii];
+
+    ostr << ((ii > 0) ? ",\n" : "\n") << "{\"name\":";
+    write_json_string(ostr, vv.m_name);
+    ostr << ",\"cat\":";
+    write_json_string(ostr, vv.m_category);
+    ostr << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << vv.m_thread << ",\"ts\":" << (vv.m_start - first) <<
+      ",\"dur\":" << (vv.m_end - vv.m_start) << ",\"args\":{\"read\":" << vv.m_bytes_read << ",\"upload\":" <<
+      vv.m_bytes_uploaded << "}}";
+  }
+  ostr << "\n]}\n";
+}
@@ -0,0 +1,151 @@
+#ifndef THR_TIMELINE_HPP
+#define THR_TIMELINE_HPP
+
+#include "thr/generic.hpp"
+
+#include <boost/noncopyable.hpp>
+
+namespace thr
+{
+  /** \brief One recorded timeline event.
+   */
+  struct TimelineEvent
+  {
+    /** Category, used for grouping in the summary. */
+    std::string m_category;
+
+    /** Name of the event. */
+    std::string m_name;
+
+    /** Start timestamp (microseconds). */
+    uint64_t m_start;
+
+    /** End timestamp (microseconds). */
+    uint64_t m_end;
+
+    /** Index of the thread, in order of first recorded event. */
+    unsigned m_thread;
+
+    /** Bytes read from files while this was the innermost event. */
+    uint64_t m_bytes_read;
+
+    /** Bytes uploaded to the GPU while this was the innermost event. */
+    uint64_t m_bytes_uploaded;
+  };
+
+  /** \brief Scope that records one timeline event.
+   *
+   * Does nothing unless the timeline is enabled. Scopes nest within each
+   * thread and bytes are accounted to the innermost scope only.
+   */
+  class TimelineScope :
+    public boost::noncopyable
+  {
+    private:
+      /** Event being recorded. */
+      TimelineEvent m_event;
+
+      /** Enclosing scope. */
+      TimelineScope *m_parent;
+
+      /** Set while recording. */
+      bool m_open;
+
+    public:
+      /** \brief Constructor.
+       *
+       * \param category Category.
+       * \param name Name of the event.
+       */
+      TimelineScope(const std::string &category, const std::string &name);
+
+      /** \brief Destructor.
+       *
+       * Closes the scope if not closed yet.
+       */
+      ~TimelineScope();
+
+    public:
+      /** \brief Add read bytes.
+       *
+       * \param op Number of bytes.
+       */
+      void addRead(uint64_t op)
+      {
+        m_event.m_bytes_read += op;
+      }
+
+      /** \brief Add uploaded bytes.
+       *
+       * \param op Number of bytes.
+       */
+      void addUpload(uint64_t op)
+      {
+        m_event.m_bytes_uploaded += op;
+      }
+
+      /** \brief Close the scope and record the event.
+       *
+       * Scopes must be closed in reverse order of opening.
+       */
+      void close();
+  };
+
+  /** \brief Run a task with a scope of another thread as the innermost scope.
+   *
+   * Used to account work done in the privileged thread on behalf of a
+   * waiting thread. The owner of the scope must be blocked for the duration.
+   *
+   * \param scope Scope to adopt, may be NULL.
+   * \param task Task to run.
+   */
+  extern void timeline_adopt(TimelineScope *scope, const Task &task);
+
+  /** \brief Get the innermost scope of the calling thread.
+   *
+   * \return Scope or NULL.
+   */
+  extern TimelineScope* timeline_current();
+
+  /** \brief Enable recording.
+   *
+   * Scopes opened before enabling are not recorded.
+   */
+  extern void timeline_enable();
+
+  /** \brief Tell if recording is enabled.
+   *
+   * \return True if yes, false if no.
+   */
+  extern bool timeline_enabled();
+
+  /** \brief Account read bytes to the innermost scope of the calling thread.
+   *
+   * \param op Number of bytes.
+   */
+  extern void timeline_read(uint64_t op);
+
+  /** \brief Write a summary table of the recorded events.
+   *
+   * Events are grouped by category.
+   *
+   * \param ostr Stream to write to.
+   */
+  extern void timeline_summary(std::ostream &ostr);
+
+  /** \brief Account uploaded bytes to the innermost scope of the calling thread.
+   *
+   * \param op Number of bytes.
+   */
+  extern void timeline_upload(uint64_t op);
+
+  /** \brief Write the recorded events as a Chrome trace.
+   *
+   * The result can be opened in chrome://tracing.
+   *
+   * \param ostr Stream to write to.
+   */
+  extern void timeline_write(std::ostream &ostr);
+}
+
+#endif
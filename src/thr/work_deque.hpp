@@ -0,0 +1,152 @@
+#ifndef THR_WORK_DEQUE_HPP
+#define THR_WORK_DEQUE_HPP
+
+#include "thr/task_object.hpp"
+
+#include <boost/atomic.hpp>
+
+namespace thr
+{
+  /** \brief Work-stealing deque.
+   *
+   * Lock-free deque of tasks owned by one worker (Chase and Lev). The owner pushes and pops at the bottom in
+   * LIFO order, other threads steal from the top in FIFO order. The capacity is fixed, the owner must put
+   * tasks elsewhere when the deque is full.
+   */
+  class WorkDeque
+  {
+    public:
+      /** Capacity, must be a power of two. */
+      static const unsigned CAPACITY = 4096;
+
+    private:
+      /** Task slots. */
+      boost::atomic<TaskObject*> m_tasks[CAPACITY];
+
+      /** Index of the next task to steal. */
+      boost::atomic<int64_t> m_top;
+
+      /** Index of the next free slot. */
+      boost::atomic<int64_t> m_bottom;
+
+    public:
+      /** \brief Tell if the deque seems empty.
+       *
+       * The result may be out of date by the time it is returned.
+       *
+       * \return True if yes, false if no.
+       */
+      bool empty() const
+      {
+        return (m_bottom.load(boost::memory_order_acquire) <= m_top.load(boost::memory_order_acquire));
+      }
+
+      /** \brief Get the number of tasks.
+       *
+       * The result may be out of date by the time it is returned.
+       *
+       * \return Task count.
+       */
+      unsigned size() const
+      {
+        int64_t ret = m_bottom.load(boost::memory_order_acquire) - m_top.load(boost::memory_order_acquire);
+        return (0 < ret) ? static_cast<unsigned>(ret) : 0;
+      }
+
+    public:
+      /** \brief Constructor. */
+      WorkDeque() :
+        m_top(0),
+        m_bottom(0)
+      {
+        for(unsigned ii = 0; (ii < CAPACITY); ++ii)
+        {
+          m_tasks[ii].store(NULL, boost::memory_order_relaxed);
+        }
+      }
+
+    public:
+      /** \brief Pop a task from the bottom.
+       *
+       * May only be called by the owner.
+       *
+       * \return Task or NULL if empty.
+       */
+      TaskObject* pop()
+      {
+        int64_t bottom = m_bottom.load(boost::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, boost::memory_order_relaxed);
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        int64_t top = m_top.load(boost::memory_order_relaxed);
+
+        if(top > bottom)
+        {
+          m_bottom.store(bottom + 1, boost::memory_order_relaxed);
+          return NULL;
+        }
+
+        TaskObject *ret = m_tasks[bottom & (CAPACITY - 1)].load(boost::memory_order_relaxed);
+        if(top == bottom)
+        {
+          // Last task, race against thieves.
+          if(!m_top.compare_exchange_strong(top, top + 1, boost::memory_order_seq_cst,
+                boost::memory_order_relaxed))
+          {
+            ret = NULL;
+          }
+          m_bottom.store(bottom + 1, boost::memory_order_relaxed);
+        }
+        return ret;
+      }
+
+      /** \brief Push a task to the bottom.
+       *
+       * May only be called by the owner.
+       *
+       * \param op Task.
+       * \return True on success, false if full.
+       */
+      bool push(TaskObject *op)
+      {
+        int64_t bottom = m_bottom.load(boost::memory_order_relaxed);
+        int64_t top = m_top.load(boost::memory_order_acquire);
+
+        if(bottom - top >= static_cast<int64_t>(CAPACITY))
+        {
+          return false;
+        }
+        m_tasks[bottom & (CAPACITY - 1)].store(op, boost::memory_order_relaxed);
+        boost::atomic_thread_fence(boost::memory_order_release);
+        m_bottom.store(bottom + 1, boost::memory_order_relaxed);
+        return true;
+      }
+
+      /** \brief Steal a task from the top.
+       *
+       * May be called by anyone.
+       *
+       * \return Task or NULL if empty or lost a race to another thread.
+       */
+      TaskObject* steal()
+      {
+        int64_t top = m_top.load(boost::memory_order_acquire);
+        boost::atomic_thread_fence(boost::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(boost::memory_order_acquire);
+
+        if(top >= bottom)
+        {
+          return NULL;
+        }
+
+        TaskObject *ret = m_tasks[top & (CAPACITY - 1)].load(boost::memory_order_relaxed);
+        if(!m_top.compare_exchange_strong(top, top + 1, boost::memory_order_seq_cst,
+              boost::memory_order_relaxed))
+        {
+          return NULL;
+        }
+        return ret;
+      }
+  };
+}
+
+#endif
@@ -2,14 +2,28 @@
 
 #include "thr/generic.hpp"
 
+#include <algorithm>
+#include <ostream>
 #include <sstream>
+#include <vector>
 
 using namespace ui;
 
+/** Initial spin window in microseconds. */
+static const uint64_t FPS_SPIN_INITIAL = 1000;
+
+/** Minimum spin window in microseconds. */
+static const uint64_t FPS_SPIN_MIN = 200;
+
 FpsCounter::FpsCounter(unsigned maxrate) :
   m_frame_counter(0),
   m_last_ticks(thr::usec_get_timestamp()),
-  m_excess_ticks(0.0)
+  m_excess_ticks(0.0),
+  m_spin_us(FPS_SPIN_INITIAL),
+  m_frame_next(0),
+  m_frame_second(0),
+  m_frame_time_max(0),
+  m_hitches(0)
 {
   this->assignFramerates(maxrate, std::max(maxrate / 4, 1U));
 }
@@ -17,18 +31,40 @@ FpsCounter::FpsCounter(unsigned maxrate) :
 FpsCounter::FpsCounter(unsigned maxrate, unsigned minrate) :
   m_frame_counter(0),
   m_last_ticks(thr::usec_get_timestamp()),
-  m_excess_ticks(0.0)
+  m_excess_ticks(0.0),
+  m_spin_us(FPS_SPIN_INITIAL),
+  m_frame_next(0),
+  m_frame_second(0),
+  m_frame_time_max(0),
+  m_hitches(0)
 {
   this->assignFramerates(maxrate, minrate);
 }
 
 void FpsCounter::appendFrame(uint64_t stamp)
 {
-  m_frame_list.push_front(stamp);
+  if(m_frame_next > 0)
+  {
+    uint64_t frame_time = stamp - m_frame_stamps[(m_frame_next - 1) % FRAME_HISTORY];
 
-  while(m_frame_list.back() <= stamp - 1000000)
+    m_frame_time_max = std::max(m_frame_time_max, frame_time);
+    if(static_cast<double>(frame_time) > m_tick_us * 2.0)
+    {
+      ++m_hitches;
+    }
+  }
+
+  m_frame_stamps[m_frame_next % FRAME_HISTORY] = stamp;
+  ++m_frame_next;
+
+  // Overwritten frames are no longer within the window.
+  if(m_frame_next - m_frame_second > FRAME_HISTORY)
+  {
+    m_frame_second = m_frame_next - FRAME_HISTORY;
+  }
+  while(m_frame_stamps[m_frame_second % FRAME_HISTORY] + 1000000 <= stamp)
   {
-    m_frame_list.pop_back();
+    ++m_frame_second;
   }
 }
 
@@ -65,7 +101,7 @@ unsigned FpsCounter::check(bool allow_suspend)
 
   if(allow_suspend && (m_excess_ticks < 0.0))
   {
-    thr::usec_sleep(static_cast<uint64_t>(-m_excess_ticks));
+    this->waitUntil(current_ticks + static_cast<uint64_t>(-m_excess_ticks));
     current_ticks = this->getCurrentTicks();
   }
 
@@ -84,7 +120,6 @@ unsigned FpsCounter::check(bool allow_suspend)
   {
     ++m_frame_counter;
     m_excess_ticks -= m_tick_us;
-    //std::cout << m_excess_ticks << '\n';
     if(m_excess_ticks > 0.0)
     {
       return 1;
@@ -103,12 +138,72 @@ uint64_t FpsCounter::getCurrentTicks()
   return ret;
 }
 
+uint64_t FpsCounter::getFrameTime(double op) const
+{
+  uint64_t first = std::max(m_frame_next, static_cast<uint64_t>(FRAME_HISTORY)) - FRAME_HISTORY + 1;
+  if(m_frame_next <= first)
+  {
+    return 0;
+  }
+
+  std::vector<uint64_t> frame_times;
+  frame_times.reserve(static_cast<unsigned>(m_frame_next - first));
+  for(uint64_t ii = first; (ii < m_frame_next); ++ii)
+  {
+    frame_times.push_back(m_frame_stamps[ii % FRAME_HISTORY] - m_frame_stamps[(ii - 1) % FRAME_HISTORY]);
+  }
+
+  double rank = std::min(std::max(op, 0.0), 1.0) * static_cast<double>(frame_times.size() - 1);
+  std::vector<uint64_t>::iterator nth = frame_times.begin() + static_cast<ptrdiff_t>(rank + 0.5);
+  std::nth_element(frame_times.begin(), nth, frame_times.end());
+  return *nth;
+}
+
+void FpsCounter::report(std::ostream &ostr) const
+{
+  ostr << "frames: " << this->getCurrentFps() << '/' << m_desired_framerate << " fps, frame us p50 " <<
+    this->getFrameTime(0.5) << " p95 " << this->getFrameTime(0.95) << " p99 " << this->getFrameTime(0.99) <<
+    " max " << m_frame_time_max << ", " << m_hitches << " hitches\n";
+}
+
 void FpsCounter::reset()
 {
   this->getCurrentTicks();
 
-  m_frame_list.clear();
+  m_frame_next = 0;
+  m_frame_second = 0;
+  m_frame_time_max = 0;
+  m_hitches = 0;
   m_excess_ticks = 0.0;
   m_frame_counter = 0;
 }
 
+void FpsCounter::waitUntil(uint64_t deadline)
+{
+  uint64_t stamp = thr::usec_get_timestamp();
+
+  if(deadline > stamp + m_spin_us)
+  {
+    uint64_t wakeup = deadline - m_spin_us;
+
+    thr::usec_sleep(wakeup - stamp);
+    stamp = thr::usec_get_timestamp();
+
+    // Grow the spin window to the oversleep at once, shrink it slowly.
+    uint64_t oversleep = (stamp > wakeup) ? (stamp - wakeup) : 0;
+    if(oversleep > m_spin_us)
+    {
+      m_spin_us = std::min(oversleep, static_cast<uint64_t>(m_tick_us));
+    }
+    else
+    {
+      m_spin_us = std::max(m_spin_us - (m_spin_us - oversleep) / 16, FPS_SPIN_MIN);
+    }
+  }
+
+  while(stamp < deadline)
+  {
+    boost::this_thread::yield();
+    stamp = thr::usec_get_timestamp();
+  }
+}
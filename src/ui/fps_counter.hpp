@@ -3,22 +3,30 @@
 
 #include "ui/generic.hpp"
 
-#include <list>
+#include <iosfwd>
 
 namespace ui
 {
-  /** \brier Class to keep track of the current framerate<
+  /** \brief Class to keep track of the current framerate and pace frames.
    *
-   * TODO: Should this be adjusted to work with something else than SDL?
+   * Frames are paced against a monotonic clock. Waiting for the next frame sleeps until shortly before the
+   * deadline and spins the rest, the spin window adapts to the observed oversleep of the system.
+   *
+   * Timestamps of rendered frames are kept in a fixed ring buffer, used for both the current framerate and
+   * frame time statistics.
    */
   class FpsCounter
   {
+    public:
+      /** Number of rendered frames remembered, power of two. */
+      static const unsigned FRAME_HISTORY = 1024;
+
     private:
       /** Frame counter of frames (supposed to be) rendered. */
       uint64_t m_frame_counter;
 
       /** Ticks when last checked. */
-      uint64_t m_last_ticks;;
+      uint64_t m_last_ticks;
 
       /** \brief The desired framerate.
        *
@@ -39,15 +47,30 @@ namespace ui
       /** Excess ticks to use. */
       double m_excess_ticks;
 
-      /** Listing of latest rendered frames to keep track of the framerate. */
-      std::list<uint64_t> m_frame_list;
+      /** Microseconds to spin instead of sleeping before a deadline. */
+      uint64_t m_spin_us;
+
+      /** Timestamps of latest rendered frames. */
+      uint64_t m_frame_stamps[FRAME_HISTORY];
+
+      /** Number of rendered frames appended, next index to the ring buffer. */
+      uint64_t m_frame_next;
+
+      /** Index of the oldest rendered frame within the last second. */
+      uint64_t m_frame_second;
+
+      /** Longest frame time since reset. */
+      uint64_t m_frame_time_max;
+
+      /** Number of hitches since reset. */
+      uint64_t m_hitches;
 
     public:
       /** \brief Default constructor.
        *
        * Per default behavior, the minimum (slowdown) framerate is specified to
        * one fourth of the maximum framerate.
-       * 
+       *
        * \param maxrate Maximum framerate.
        */
       FpsCounter(unsigned maxrate);
@@ -79,18 +102,43 @@ namespace ui
        */
       uint64_t getCurrentTicks();
 
+      /** \brief Wait until a deadline.
+       *
+       * Sleeps until the spin window before the deadline, then spins.
+       *
+       * \param deadline Timestamp to wait for.
+       */
+      void waitUntil(uint64_t deadline);
+
     public:
       /** \brief Check if a frame should be drawn.
        *
        * If there is time and it is allowed, this method will suspend.
        *
        * The return value of 0 is system inaccuracies, and perfectly reasonable.
-       * 
+       *
        * \param allow_suspend True to allow sleeping.
        * \return 0: do nothing, 1: essentials, 2: everything.
        */
       unsigned check(bool allow_suspend);
 
+      /** \brief Get a frame time percentile.
+       *
+       * Calculated over the remembered frames.
+       *
+       * \param op Percentile in [0, 1].
+       * \return Frame time in microseconds, 0 if less than two frames rendered.
+       */
+      uint64_t getFrameTime(double op) const;
+
+      /** \brief Write frame time statistics.
+       *
+       * Writes the framerate, median, 95th and 99th percentile and longest frame time and the hitch count.
+       *
+       * \param ostr Stream to write to.
+       */
+      void report(std::ostream &ostr) const;
+
       /** \brief Reset the frame calculation.
        *
        * Should be done after a long period of inactivity in framerate
@@ -105,7 +153,7 @@ namespace ui
        */
       unsigned getCurrentFps() const
       {
-        return static_cast<unsigned>(m_frame_list.size());
+        return static_cast<unsigned>(m_frame_next - m_frame_second);
       }
 
       /** \brief Returns the number of frames this has allowed to be rendered.
@@ -117,6 +165,26 @@ namespace ui
         return m_frame_counter;
       }
 
+      /** \brief Get the longest frame time since reset.
+       *
+       * \return Frame time in microseconds.
+       */
+      uint64_t getFrameTimeMax() const
+      {
+        return m_frame_time_max;
+      }
+
+      /** \brief Get the number of hitches since reset.
+       *
+       * A hitch is a rendered frame taking more than twice the target frame time.
+       *
+       * \return Hitch count.
+       */
+      uint64_t getHitches() const
+      {
+        return m_hitches;
+      }
+
       /** \brief Get the target framerate.
        *
        * \return Target fps.
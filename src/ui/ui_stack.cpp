@@ -5,10 +5,14 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <algorithm>
 #include <sstream>
 
 using namespace ui;
 
+/** Maximum number of simulation steps per frame in decoupled mode. */
+static const unsigned UI_STACK_MAX_STEPS = 4;
+
 /** \brief Convert SDL modifiers to key event modifiers.
  *
  * \param op SDL modifiers.
@@ -39,6 +43,7 @@ static uint8_t sdl_mod_to_mod(SDLMod op)
  */
 static void ui_stack_render_task(UiStack *ui_stack, UiState *ui_state)
 {
+  gfx::set_interpolation(ui_stack->getInterpolation());
   ui_state->render(*ui_stack, ui_stack->getScreen());
 
   gfx::check_opengl_errors();
@@ -46,13 +51,40 @@ static void ui_stack_render_task(UiStack *ui_stack, UiState *ui_state)
 
 UiStack::UiStack(gfx::SurfaceScreen &scr, unsigned fps) :
   m_screen(scr),
-  m_fps_counter(fps) { }
+  m_fps_counter(fps),
+  m_tick_rate(fps),
+  m_framerate(0),
+  m_step_count(0),
+  m_sim_stamp(0),
+  m_sim_excess(0.0),
+  m_interpolation(1.0f) { }
 
 UiStack::~UiStack()
 {
   this->join();
 }
 
+unsigned UiStack::advanceSimulation()
+{
+  double tick_us = 1000000.0 / static_cast<double>(m_tick_rate);
+  uint64_t stamp = thr::usec_get_timestamp();
+
+  m_sim_excess += static_cast<double>(stamp - m_sim_stamp);
+  m_sim_stamp = stamp;
+
+  unsigned ret = static_cast<unsigned>(m_sim_excess / tick_us);
+  // Slow down instead of catching up further.
+  if(ret > UI_STACK_MAX_STEPS)
+  {
+    ret = UI_STACK_MAX_STEPS;
+    m_sim_excess = tick_us * static_cast<double>(UI_STACK_MAX_STEPS);
+  }
+  m_sim_excess -= tick_us * static_cast<double>(ret);
+
+  m_interpolation = std::min(static_cast<float>(m_sim_excess / tick_us), 1.0f);
+  return ret;
+}
+
 bool UiStack::handleEventKey(const EventKey &ev)
 {
   if(ev.isPress())
@@ -84,6 +116,9 @@ bool UiStack::handleEventKey(const EventKey &ev)
 
 void UiStack::handleEvents()
 {
+  // GL commands deferred during the previous frame go first.
+  thr::flush_privileged();
+
   // Clear old events before acquiring new ones.
   m_events_key.clear();
   m_events_misc.clear();
@@ -246,6 +281,9 @@ bool UiStack::reinstateFirst()
 
 void UiStack::run() 
 {
+  m_sim_stamp = thr::usec_get_timestamp();
+  m_sim_excess = 0.0;
+
   while(!m_state_list.empty())
   {
     unsigned state = m_fps_counter.check(true);
@@ -266,7 +304,13 @@ void UiStack::run()
       continue;
     }
 
-    thr::wait(&UiState::update, topst, boost::ref(*this));
+    // Decoupled mode takes as many steps as the elapsed time requires, possibly none.
+    unsigned steps = (0 < m_framerate) ? this->advanceSimulation() : 1;
+    for(unsigned ii = 0; (ii < steps) && topst->isAlive(); ++ii)
+    {
+      thr::wait(&UiState::update, topst, boost::ref(*this));
+      ++m_step_count;
+    }
     // State may have decided to die also during update.
     if(!topst->isAlive())
     {
@@ -280,6 +324,13 @@ void UiStack::run()
     }
   }
 
+  // Workers are gone after quitting, report while they still exist.
+  if(thr::telemetry_enabled())
+  {
+    m_fps_counter.report(std::cout);
+    thr::telemetry_report(std::cout);
+  }
+
   // Destructing UI stack should take threading with it.
   thr::thr_quit();
 }
@@ -303,6 +354,13 @@ void UiStack::saveScreen(const char *type)
   m_screen.save(sstr.str());
 }
 
+void UiStack::setFramerate(unsigned op)
+{
+  m_framerate = op;
+  m_fps_counter = FpsCounter((0 < op) ? op : m_tick_rate);
+  m_interpolation = 1.0f;
+}
+
 void UiStack::suspend()
 {
   BOOST_ASSERT(NULL == m_thread.get());
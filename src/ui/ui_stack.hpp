@@ -40,6 +40,24 @@ namespace ui
       /** FPS calulator / bookkeeper. */
       FpsCounter m_fps_counter;
 
+      /** Simulation rate (Hz). */
+      unsigned m_tick_rate;
+
+      /** Render framerate with the simulation decoupled from it, 0 to render once per simulation step. */
+      unsigned m_framerate;
+
+      /** Number of simulation steps taken. */
+      uint64_t m_step_count;
+
+      /** Timestamp the simulation time was last advanced at. */
+      uint64_t m_sim_stamp;
+
+      /** Time not yet simulated in microseconds. */
+      double m_sim_excess;
+
+      /** Render interpolation ratio between the previous and the current simulation step. */
+      float m_interpolation;
+
       /** Thread to suspend into. */
       boost::scoped_ptr<boost::thread> m_thread;
 
@@ -60,7 +78,7 @@ namespace ui
       /** \brief Default constructor.
        *
        * \param scr Screen to attach to.
-       * \param fps Maximum response frequency (Hz).
+       * \param fps Simulation rate and maximum response frequency (Hz).
        */
       UiStack(gfx::SurfaceScreen &scr, unsigned fps);
 
@@ -83,6 +101,14 @@ namespace ui
       virtual bool handleEventKey(const EventKey &ev);
 
     private:
+      /** \brief Advance the simulation time in decoupled mode.
+       *
+       * Calculates the number of simulation steps to take and the render interpolation ratio after them.
+       *
+       * \return Number of simulation steps to take.
+       */
+      unsigned advanceSimulation();
+
       /** \brief Get all pending events into the event lists.
        *
        * Will handle the events on the states, topmost first.
@@ -130,6 +156,18 @@ namespace ui
        */
       void saveScreen(const char *type);
 
+      /** \brief Set the render framerate.
+       *
+       * With a nonzero framerate, the simulation runs at a fixed rate independent of rendering. Frames are
+       * rendered at most at the given rate, interpolated between the last two simulation steps. Catching up
+       * is limited to a few simulation steps per frame, beyond that the simulation slows down.
+       *
+       * Should be called before running.
+       *
+       * \param op Render framerate, 0 to render once per simulation step.
+       */
+      void setFramerate(unsigned op);
+
       /** \brief Suspend.
        *
        * Suspend the UI stack into a thread.
@@ -169,11 +207,29 @@ namespace ui
 
       /** \brief Frame count accessor.
        *
-       * \return Current frame count.
+       * \return Number of simulation steps taken.
        */
       uint64_t getFrameCount() const
       {
-        return m_fps_counter.getFrameCount();
+        return m_step_count;
+      }
+
+      /** \brief Framerate counter accessor.
+       *
+       * \return Framerate counter for frame time statistics.
+       */
+      const FpsCounter& getFpsCounter() const
+      {
+        return m_fps_counter;
+      }
+
+      /** \brief Get the render interpolation ratio.
+       *
+       * \return Ratio between the previous and the current simulation step, 1 if not decoupled.
+       */
+      float getInterpolation() const
+      {
+        return m_interpolation;
       }
 
       /** \brief Get the number of states.